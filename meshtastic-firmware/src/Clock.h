@@ -0,0 +1,47 @@
+#pragma once
+
+#include <Arduino.h>
+
+/**
+ * Where the mesh stack gets the time from.
+ *
+ * The code that keeps mesh time (the thread scheduler, PacketHistory, retransmissions and getTime()) reads clockMillis()
+ * rather than millis(), and checks those times with Throttle::isWithinClockTimespanMs(). Normally that is the hardware
+ * clock, but a test or simulation can install another clock, such as a VirtualClock, and run ten minutes of flood expiry or
+ * a day of duty cycling in milliseconds. With a virtual clock, advance it by what mainScheduler.runOrDelay() returns instead
+ * of sleeping.
+ *
+ * Everything else, such as the radio drivers, the screen and the modules, stays on millis() and
+ * Throttle::isWithinTimespanMs(), since its timeouts have to pass in real time: a busy-wait on clockMillis() would never end.
+ */
+class Clock
+{
+  public:
+    virtual ~Clock() {}
+
+    /// Milliseconds since boot, wrapping like millis()
+    virtual uint32_t now() = 0;
+};
+
+/// Time that only moves when told to, so timing-dependent behaviour is reproducible
+class VirtualClock : public Clock
+{
+  public:
+    explicit VirtualClock(uint32_t start = 0) : msec(start) {}
+
+    virtual uint32_t now() override { return msec; }
+
+    void advance(uint32_t by) { msec += by; }
+    void set(uint32_t to) { msec = to; }
+
+  private:
+    volatile uint32_t msec;
+};
+
+/// The clock in use, nullptr for the hardware one
+extern Clock *installedClock;
+
+inline uint32_t clockMillis()
+{
+    return installedClock ? installedClock->now() : millis();
+}
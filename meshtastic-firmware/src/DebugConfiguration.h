@@ -36,6 +36,104 @@
 
 #define DEBUG_PORT (*console) // Serial debug port
 
+// -----------------------------------------------------------------------------
+// Log filtering
+// -----------------------------------------------------------------------------
+
+// Log severities, for the filters below
+#define LOG_SEVERITY_TRACE 0
+#define LOG_SEVERITY_DEBUG 1
+#define LOG_SEVERITY_INFO 2
+#define LOG_SEVERITY_WARN 3
+#define LOG_SEVERITY_ERROR 4
+#define LOG_SEVERITY_CRIT 5
+#define LOG_SEVERITY_OFF 6
+
+// Least severe messages built into the firmware, e.g. -DLOG_MIN_SEVERITY_MESH=LOG_SEVERITY_INFO drops the per-packet debug
+// lines of the router. Calls below the limit are compiled out, arguments and format strings included.
+#ifndef LOG_MIN_SEVERITY
+#define LOG_MIN_SEVERITY LOG_SEVERITY_TRACE
+#endif
+#ifndef LOG_MIN_SEVERITY_MESH
+#define LOG_MIN_SEVERITY_MESH LOG_MIN_SEVERITY
+#endif
+#ifndef LOG_MIN_SEVERITY_RADIO
+#define LOG_MIN_SEVERITY_RADIO LOG_MIN_SEVERITY
+#endif
+#ifndef LOG_MIN_SEVERITY_GPS
+#define LOG_MIN_SEVERITY_GPS LOG_MIN_SEVERITY
+#endif
+#ifndef LOG_MIN_SEVERITY_MQTT
+#define LOG_MIN_SEVERITY_MQTT LOG_MIN_SEVERITY
+#endif
+#ifndef LOG_MIN_SEVERITY_MODULES
+#define LOG_MIN_SEVERITY_MODULES LOG_MIN_SEVERITY
+#endif
+
+enum LogSubsystem : uint8_t {
+    LOG_SUBSYSTEM_OTHER,
+    LOG_SUBSYSTEM_MESH,
+    LOG_SUBSYSTEM_RADIO,
+    LOG_SUBSYSTEM_GPS,
+    LOG_SUBSYSTEM_MQTT,
+    LOG_SUBSYSTEM_MODULES,
+    LOG_SUBSYSTEM_COUNT
+};
+
+constexpr bool logPathStartsWith(const char *s, const char *prefix)
+{
+    return !*prefix || (*s == *prefix && logPathStartsWith(s + 1, prefix + 1));
+}
+
+constexpr const char *logPathFind(const char *s, const char *needle)
+{
+    return !*s ? nullptr : logPathStartsWith(s, needle) ? s : logPathFind(s + 1, needle);
+}
+
+/// The subsystem a source file belongs to, from its path
+constexpr LogSubsystem logSubsystemOf(const char *file)
+{
+    return logPathFind(file, "src/mesh/")
+               ? (logPathFind(file, "Interface") || logPathFind(file, "Radio") ? LOG_SUBSYSTEM_RADIO : LOG_SUBSYSTEM_MESH)
+           : logPathFind(file, "SimRadio")     ? LOG_SUBSYSTEM_RADIO
+           : logPathFind(file, "src/gps/")     ? LOG_SUBSYSTEM_GPS
+           : logPathFind(file, "src/mqtt/")    ? LOG_SUBSYSTEM_MQTT
+           : logPathFind(file, "src/modules/") ? LOG_SUBSYSTEM_MODULES
+                                               : LOG_SUBSYSTEM_OTHER;
+}
+
+constexpr int logMinSeverity(LogSubsystem subsystem)
+{
+    return subsystem == LOG_SUBSYSTEM_MESH      ? LOG_MIN_SEVERITY_MESH
+           : subsystem == LOG_SUBSYSTEM_RADIO   ? LOG_MIN_SEVERITY_RADIO
+           : subsystem == LOG_SUBSYSTEM_GPS     ? LOG_MIN_SEVERITY_GPS
+           : subsystem == LOG_SUBSYSTEM_MQTT    ? LOG_MIN_SEVERITY_MQTT
+           : subsystem == LOG_SUBSYSTEM_MODULES ? LOG_MIN_SEVERITY_MODULES
+                                                : LOG_MIN_SEVERITY;
+}
+
+/// Forces the compile time filter to be evaluated by the compiler, even without optimization
+template <bool enabled> struct LogCompiledIn {
+    static constexpr bool value = enabled;
+};
+
+// A file can claim a subsystem other than the one of its directory by defining LOG_SUBSYSTEM before any include
+#ifndef LOG_SUBSYSTEM
+#define LOG_SUBSYSTEM logSubsystemOf(__FILE__)
+#endif
+
+#ifdef ARCH_PORTDUINO
+/// Least severe message each subsystem writes to the console, set from the Logging section of config.yaml
+extern uint8_t logSubsystemSeverity[LOG_SUBSYSTEM_COUNT];
+// Trace lines also feed the trace file, so only the compile time filter applies to them
+#define LOG_RUNTIME_ENABLED(severity)                                                                                         \
+    ((severity) == LOG_SEVERITY_TRACE || logSubsystemSeverity[LOG_SUBSYSTEM] <= (severity))
+#else
+#define LOG_RUNTIME_ENABLED(severity) true
+#endif
+
+#define LOG_ENABLED(severity) (LogCompiledIn<(severity) >= logMinSeverity(LOG_SUBSYSTEM)>::value && LOG_RUNTIME_ENABLED(severity))
+
 #ifdef USE_SEGGER
 // #undef DEBUG_PORT
 #define LOG_DEBUG(...) SEGGER_RTT_printf(0, __VA_ARGS__)
@@ -46,12 +144,12 @@
 #define LOG_TRACE(...) SEGGER_RTT_printf(0, __VA_ARGS__)
 #else
 #if defined(DEBUG_PORT) && !defined(DEBUG_MUTE)
-#define LOG_DEBUG(...) DEBUG_PORT.log(MESHTASTIC_LOG_LEVEL_DEBUG, __VA_ARGS__)
-#define LOG_INFO(...) DEBUG_PORT.log(MESHTASTIC_LOG_LEVEL_INFO, __VA_ARGS__)
-#define LOG_WARN(...) DEBUG_PORT.log(MESHTASTIC_LOG_LEVEL_WARN, __VA_ARGS__)
-#define LOG_ERROR(...) DEBUG_PORT.log(MESHTASTIC_LOG_LEVEL_ERROR, __VA_ARGS__)
-#define LOG_CRIT(...) DEBUG_PORT.log(MESHTASTIC_LOG_LEVEL_CRIT, __VA_ARGS__)
-#define LOG_TRACE(...) DEBUG_PORT.log(MESHTASTIC_LOG_LEVEL_TRACE, __VA_ARGS__)
+#define LOG_DEBUG(...) (LOG_ENABLED(LOG_SEVERITY_DEBUG) ? DEBUG_PORT.log(MESHTASTIC_LOG_LEVEL_DEBUG, __VA_ARGS__) : (void)0)
+#define LOG_INFO(...) (LOG_ENABLED(LOG_SEVERITY_INFO) ? DEBUG_PORT.log(MESHTASTIC_LOG_LEVEL_INFO, __VA_ARGS__) : (void)0)
+#define LOG_WARN(...) (LOG_ENABLED(LOG_SEVERITY_WARN) ? DEBUG_PORT.log(MESHTASTIC_LOG_LEVEL_WARN, __VA_ARGS__) : (void)0)
+#define LOG_ERROR(...) (LOG_ENABLED(LOG_SEVERITY_ERROR) ? DEBUG_PORT.log(MESHTASTIC_LOG_LEVEL_ERROR, __VA_ARGS__) : (void)0)
+#define LOG_CRIT(...) (LOG_ENABLED(LOG_SEVERITY_CRIT) ? DEBUG_PORT.log(MESHTASTIC_LOG_LEVEL_CRIT, __VA_ARGS__) : (void)0)
+#define LOG_TRACE(...) (LOG_ENABLED(LOG_SEVERITY_TRACE) ? DEBUG_PORT.log(MESHTASTIC_LOG_LEVEL_TRACE, __VA_ARGS__) : (void)0)
 #else
 #define LOG_DEBUG(...)
 #define LOG_INFO(...)
@@ -0,0 +1,361 @@
+#include "LogRing.h"
+
+#if MESHTASTIC_LOG_RING
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+/// One conversion in a printf format string
+struct Spec {
+    const char *start;  // The '%'
+    const char *end;    // Just past the conversion character
+    const char *lengthStart;
+    int numStars;       // '*' width and precision, each taking an int argument
+    bool precisionStar; // The last '*' is the precision
+    int precision;      // -1 if none is given in the format
+    char length;        // 0, 'H' for hh, 'h', 'l', 'L' for ll, 'j', 'z', 't' or 'D' for long double
+    char conversion;
+};
+
+/// Parse the conversion at p, which points at a '%'. @return false if it is not one we can defer.
+bool parseSpec(const char *p, Spec &spec)
+{
+    spec.start = p++;
+    spec.numStars = 0;
+    spec.precisionStar = false;
+    spec.precision = -1;
+    spec.length = 0;
+    while (*p && strchr("-+ #0", *p))
+        p++;
+    if (*p == '*') {
+        spec.numStars++;
+        p++;
+    }
+    while (*p >= '0' && *p <= '9')
+        p++;
+    if (*p == '.') {
+        p++;
+        spec.precision = 0;
+        if (*p == '*') {
+            spec.numStars++;
+            spec.precisionStar = true;
+            p++;
+        }
+        while (*p >= '0' && *p <= '9')
+            spec.precision = spec.precision * 10 + *p++ - '0';
+    }
+    spec.lengthStart = p;
+    if (p[0] == 'h' && p[1] == 'h') {
+        spec.length = 'H';
+        p += 2;
+    } else if (p[0] == 'l' && p[1] == 'l') {
+        spec.length = 'L';
+        p += 2;
+    } else if (*p == 'h' || *p == 'l' || *p == 'j' || *p == 'z' || *p == 't') {
+        spec.length = *p++;
+    } else if (*p == 'L') {
+        spec.length = 'D';
+        p++;
+    }
+    spec.conversion = *p;
+    if (!*p || !strchr("diouxXcsfFeEgGaAp%", *p) || (spec.conversion == 's' && spec.length == 'l') ||
+        (spec.conversion == 'c' && spec.length == 'l'))
+        return false; // %n, wide characters and anything we don't know are formatted right away
+    spec.end = p + 1;
+    return true;
+}
+
+bool isSigned(char conversion)
+{
+    return conversion == 'd' || conversion == 'i';
+}
+
+bool isUnsigned(char conversion)
+{
+    return conversion == 'o' || conversion == 'u' || conversion == 'x' || conversion == 'X';
+}
+
+bool isFloat(char conversion)
+{
+    return strchr("fFeEgGaA", conversion) != nullptr;
+}
+
+/// Bounded appender, keeps track of how much of a slot is used
+struct Writer {
+    uint8_t *pos;
+    uint8_t *end;
+
+    bool put(const void *data, size_t length)
+    {
+        if ((size_t)(end - pos) < length)
+            return false;
+        memcpy(pos, data, length);
+        pos += length;
+        return true;
+    }
+};
+
+struct Reader {
+    const uint8_t *pos;
+
+    template <typename T> T get()
+    {
+        T value;
+        memcpy(&value, pos, sizeof(value));
+        pos += sizeof(value);
+        return value;
+    }
+};
+
+/// Copy the format string and the raw arguments into a slot
+bool capture(uint8_t *data, const char *format, va_list arg)
+{
+    Writer w = {data, data + LOG_RING_SLOT_SIZE};
+    if (!w.put(format, strlen(format) + 1))
+        return false;
+
+    for (const char *p = strchr(format, '%'); p; p = strchr(p, '%')) {
+        Spec spec;
+        if (!parseSpec(p, spec))
+            return false;
+        p = spec.end;
+        int precision = spec.precision;
+        for (int i = 0; i < spec.numStars; i++) {
+            const int star = va_arg(arg, int);
+            if (!w.put(&star, sizeof(star)))
+                return false;
+            if (spec.precisionStar && i == spec.numStars - 1)
+                precision = star; // Negative means there is none
+        }
+        bool ok = true;
+        if (isSigned(spec.conversion)) {
+            long long v;
+            switch (spec.length) {
+            case 'l':
+                v = va_arg(arg, long);
+                break;
+            case 'L':
+                v = va_arg(arg, long long);
+                break;
+            case 'j':
+                v = va_arg(arg, intmax_t);
+                break;
+            case 'z':
+                v = va_arg(arg, size_t);
+                break;
+            case 't':
+                v = va_arg(arg, ptrdiff_t);
+                break;
+            case 'H':
+                v = (signed char)va_arg(arg, int);
+                break;
+            case 'h':
+                v = (short)va_arg(arg, int);
+                break;
+            default:
+                v = va_arg(arg, int);
+            }
+            ok = w.put(&v, sizeof(v));
+        } else if (isUnsigned(spec.conversion)) {
+            unsigned long long v;
+            switch (spec.length) {
+            case 'l':
+                v = va_arg(arg, unsigned long);
+                break;
+            case 'L':
+                v = va_arg(arg, unsigned long long);
+                break;
+            case 'j':
+                v = va_arg(arg, uintmax_t);
+                break;
+            case 'z':
+                v = va_arg(arg, size_t);
+                break;
+            case 't':
+                v = va_arg(arg, ptrdiff_t);
+                break;
+            case 'H':
+                v = (unsigned char)va_arg(arg, unsigned int);
+                break;
+            case 'h':
+                v = (unsigned short)va_arg(arg, unsigned int);
+                break;
+            default:
+                v = va_arg(arg, unsigned int);
+            }
+            ok = w.put(&v, sizeof(v));
+        } else if (spec.conversion == 'c') {
+            const int v = va_arg(arg, int);
+            ok = w.put(&v, sizeof(v));
+        } else if (isFloat(spec.conversion)) {
+            const double v = spec.length == 'D' ? (double)va_arg(arg, long double) : va_arg(arg, double);
+            ok = w.put(&v, sizeof(v));
+        } else if (spec.conversion == 'p') {
+            const void *v = va_arg(arg, void *);
+            ok = w.put(&v, sizeof(v));
+        } else if (spec.conversion == 's') {
+            const char *s = va_arg(arg, const char *);
+            if (!s)
+                s = "(null)";
+            // With a precision, s may be a buffer that isn't terminated, like a payload passed to "%.*s"
+            const size_t length = precision >= 0 ? strnlen(s, precision) : strlen(s);
+            const char terminator = '\0';
+            ok = w.put(s, length) && w.put(&terminator, 1);
+        }
+        if (!ok)
+            return false;
+    }
+    return true;
+}
+
+/// printf one conversion with its '*' arguments
+template <typename T> int formatOne(char *out, size_t size, const char *spec, const int *stars, int numStars, T value)
+{
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat-nonliteral"
+    switch (numStars) {
+    case 0:
+        return snprintf(out, size, spec, value);
+    case 1:
+        return snprintf(out, size, spec, stars[0], value);
+    default:
+        return snprintf(out, size, spec, stars[0], stars[1], value);
+    }
+#pragma GCC diagnostic pop
+}
+
+/// Format a message captured by capture()
+void render(const uint8_t *data, char *buf, size_t size)
+{
+    const char *format = reinterpret_cast<const char *>(data);
+    Reader r = {data + strlen(format) + 1};
+    size_t len = 0;
+    auto append = [&](int n) {
+        if (n > 0)
+            len = std::min(len + n, size - 1);
+    };
+
+    const char *p = format;
+    while (*p && len < size - 1) {
+        const char *next = strchr(p, '%');
+        if (!next) {
+            append(snprintf(buf + len, size - len, "%s", p));
+            break;
+        }
+        const size_t literal = std::min<size_t>(next - p, size - 1 - len);
+        memcpy(buf + len, p, literal);
+        len += literal;
+        if (len == size - 1)
+            break;
+
+        Spec spec;
+        parseSpec(next, spec); // Already checked by capture()
+        p = spec.end;
+        if (spec.conversion == '%') {
+            buf[len++] = '%';
+            continue;
+        }
+
+        // The spec without its length modifier, integers are passed on as long long
+        char specBuf[32];
+        const size_t head = std::min<size_t>(spec.lengthStart - spec.start, sizeof(specBuf) - 4);
+        memcpy(specBuf, spec.start, head);
+        size_t specLen = head;
+        if (isSigned(spec.conversion) || isUnsigned(spec.conversion)) {
+            specBuf[specLen++] = 'l';
+            specBuf[specLen++] = 'l';
+        }
+        specBuf[specLen++] = spec.conversion;
+        specBuf[specLen] = '\0';
+
+        int stars[2];
+        for (int i = 0; i < spec.numStars; i++)
+            stars[i] = r.get<int>();
+        char *out = buf + len;
+        const size_t room = size - len;
+        if (isSigned(spec.conversion))
+            append(formatOne(out, room, specBuf, stars, spec.numStars, r.get<long long>()));
+        else if (isUnsigned(spec.conversion))
+            append(formatOne(out, room, specBuf, stars, spec.numStars, r.get<unsigned long long>()));
+        else if (spec.conversion == 'c')
+            append(formatOne(out, room, specBuf, stars, spec.numStars, r.get<int>()));
+        else if (isFloat(spec.conversion))
+            append(formatOne(out, room, specBuf, stars, spec.numStars, r.get<double>()));
+        else if (spec.conversion == 'p')
+            append(formatOne(out, room, specBuf, stars, spec.numStars, r.get<const void *>()));
+        else if (spec.conversion == 's') {
+            const char *s = reinterpret_cast<const char *>(r.pos);
+            r.pos += strlen(s) + 1;
+            append(formatOne(out, room, specBuf, stars, spec.numStars, s));
+        }
+    }
+    buf[len] = '\0';
+}
+} // namespace
+
+LogRing::LogRing()
+{
+    for (uint32_t i = 0; i < LOG_RING_SLOTS; i++)
+        slots[i].seq.store(i, std::memory_order_relaxed);
+}
+
+bool LogRing::push(const Entry &entry, const char *format, va_list arg, bool *wasEmpty)
+{
+    // Claim a slot, see Dmitry Vyukov's bounded MPMC queue
+    uint32_t pos = writePos.load(std::memory_order_relaxed);
+    Slot *slot;
+    while (true) {
+        slot = &slots[pos & (LOG_RING_SLOTS - 1)];
+        const int32_t diff = (int32_t)(slot->seq.load(std::memory_order_acquire) - pos);
+        if (diff == 0) {
+            if (writePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                if (wasEmpty)
+                    *wasEmpty = pos == readPos.load(std::memory_order_relaxed);
+                break;
+            }
+        } else if (diff < 0) {
+            return false; // Full
+        } else {
+            pos = writePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    slot->entry = entry;
+    va_list copy;
+    va_copy(copy, arg);
+    slot->formatted = !capture(slot->data, format, copy);
+    va_end(copy);
+    if (slot->formatted)
+        vsnprintf(reinterpret_cast<char *>(slot->data), sizeof(slot->data), format, arg);
+
+    slot->seq.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+bool LogRing::pop(Entry &entry, char *buf, size_t size)
+{
+    const uint32_t pos = readPos.load(std::memory_order_relaxed); // Only we change it
+    Slot &slot = slots[pos & (LOG_RING_SLOTS - 1)];
+    if (slot.seq.load(std::memory_order_acquire) != pos + 1)
+        return false; // Empty, or the oldest message is still being written
+
+    entry = slot.entry;
+    if (slot.formatted) {
+        strncpy(buf, reinterpret_cast<const char *>(slot.data), size - 1);
+        buf[size - 1] = '\0';
+    } else {
+        render(slot.data, buf, size);
+    }
+    slot.seq.store(pos + LOG_RING_SLOTS, std::memory_order_release);
+    readPos.store(pos + 1, std::memory_order_relaxed);
+    return true;
+}
+
+bool LogRing::isEmpty() const
+{
+    const uint32_t pos = readPos.load(std::memory_order_relaxed);
+    return slots[pos & (LOG_RING_SLOTS - 1)].seq.load(std::memory_order_acquire) != pos + 1;
+}
+#endif
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <atomic>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Deferred logging relies on atomic compare-and-swap, which the ESP32 targets and Linux provide
+#ifndef MESHTASTIC_LOG_RING
+#if defined(ARCH_ESP32) || defined(ARCH_PORTDUINO)
+#define MESHTASTIC_LOG_RING 1
+#else
+#define MESHTASTIC_LOG_RING 0
+#endif
+#endif
+
+// Number of messages that can wait to be written, must be a power of two
+#ifndef LOG_RING_SLOTS
+#ifdef ARCH_PORTDUINO
+#define LOG_RING_SLOTS 256
+#else
+#define LOG_RING_SLOTS 32
+#endif
+#endif
+
+// Bytes per message, for the format string, the arguments and the strings passed for %s. A message that doesn't fit is
+// formatted into the slot instead, so it is at least as large as the buffer RedirectablePrint::vprintf() formats into
+#ifndef LOG_RING_SLOT_SIZE
+#ifdef ARCH_PORTDUINO
+#define LOG_RING_SLOT_SIZE 512
+#else
+#define LOG_RING_SLOT_SIZE 192
+#endif
+#endif
+
+// How often the console writes out queued messages
+#ifndef LOG_DRAIN_INTERVAL_MS
+#define LOG_DRAIN_INTERVAL_MS 50
+#endif
+
+/**
+ * Lock-free queue of log messages, formatted only when they are taken out.
+ *
+ * push() copies the format string and the raw arguments into a fixed-size slot without formatting anything or taking a
+ * lock, so it is cheap and safe to call from any task. Strings passed for %s are copied too, so callers may pass
+ * temporaries, and "%.*s" may be given a buffer that isn't terminated. A message that doesn't fit in a slot is formatted right
+ * away instead. When the queue is full push() refuses the message, and the caller writes it out itself. Any number of tasks
+ * may push, but only one at a time may pop.
+ */
+class LogRing
+{
+  public:
+    struct Entry {
+        const char *level; // One of the MESHTASTIC_LOG_LEVEL_* strings
+        uint32_t millis;
+        uint32_t rtc;    // Local time in seconds, 0 if we don't know the time
+        char thread[16]; // Name of the OSThread that logged, empty if none
+    };
+
+    LogRing();
+
+    /**
+     * Queue a message
+     * @param wasEmpty set to whether the queue was empty before, so whoever pops can be woken
+     * @return false if the queue is full, and the message wasn't queued
+     */
+    bool push(const Entry &entry, const char *format, va_list arg, bool *wasEmpty = nullptr);
+
+    /**
+     * Take the oldest message out of the queue and format it into buf, which is always terminated
+     * @return false if the queue is empty
+     */
+    bool pop(Entry &entry, char *buf, size_t size);
+
+    bool isEmpty() const;
+
+  private:
+    static_assert((LOG_RING_SLOTS & (LOG_RING_SLOTS - 1)) == 0, "LOG_RING_SLOTS must be a power of two");
+
+    struct Slot {
+        std::atomic<uint32_t> seq; // Equals the write position when free, the write position + 1 once it holds a message
+        Entry entry;
+        bool formatted; // data holds the finished text rather than a format string and arguments
+        uint8_t data[LOG_RING_SLOT_SIZE];
+    };
+
+    Slot slots[LOG_RING_SLOTS];
+    std::atomic<uint32_t> writePos{0};
+    std::atomic<uint32_t> readPos{0}; // Only changed by pop(), read by push() to tell whether the queue was empty
+};
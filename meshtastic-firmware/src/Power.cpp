@@ -673,6 +673,7 @@ bool Power::setup()
 #endif
 
     enabled = found;
+    notifyScheduleChanged();
     low_voltage_counter = 0;
 
     return found;
@@ -118,7 +118,7 @@ void RedirectablePrint::log_to_serial(const char *logLevel, const char *format,
             Print::write("\u001b[35m", 5);
     }
 
-    uint32_t rtc_sec = getValidTime(RTCQuality::RTCQualityDevice, true); // display local time on logfile
+    uint32_t rtc_sec = logRtc; // display local time on logfile
     if (rtc_sec > 0) {
         long hms = rtc_sec % SEC_PER_DAY;
         // hms += tz.tz_dsttime * SEC_PER_HOUR;
@@ -135,13 +135,13 @@ void RedirectablePrint::log_to_serial(const char *logLevel, const char *format,
         if (color) {
             ::printf("\u001b[0m");
         }
-        ::printf("| %02d:%02d:%02d %u ", hour, min, sec, millis() / 1000);
+        ::printf("| %02d:%02d:%02d %u ", hour, min, sec, logMillis / 1000);
 #else
         printf("%s ", logLevel);
         if (color) {
             printf("\u001b[0m");
         }
-        printf("| %02d:%02d:%02d %u ", hour, min, sec, millis() / 1000);
+        printf("| %02d:%02d:%02d %u ", hour, min, sec, logMillis / 1000);
 #endif
     } else {
 #ifdef ARCH_PORTDUINO
@@ -149,21 +149,18 @@ void RedirectablePrint::log_to_serial(const char *logLevel, const char *format,
         if (color) {
             ::printf("\u001b[0m");
         }
-        ::printf("| ??:??:?? %u ", millis() / 1000);
+        ::printf("| ??:??:?? %u ", logMillis / 1000);
 #else
         printf("%s ", logLevel);
         if (color) {
             printf("\u001b[0m");
         }
-        printf("| ??:??:?? %u ", millis() / 1000);
+        printf("| ??:??:?? %u ", logMillis / 1000);
 #endif
     }
-    auto thread = concurrency::OSThread::currentThread;
-    if (thread) {
+    if (*logThreadName) {
         print("[");
-        // printf("%p ", thread);
-        // assert(thread->ThreadName.length());
-        print(thread->ThreadName);
+        print(logThreadName);
         print("] ");
     }
     r += vprintf(logLevel, format, arg);
@@ -194,9 +191,8 @@ void RedirectablePrint::log_to_syslog(const char *logLevel, const char *format,
         default:
             ll = 0;
         }
-        auto thread = concurrency::OSThread::currentThread;
-        if (thread) {
-            syslog.vlogf(ll, thread->ThreadName.c_str(), format, arg);
+        if (*logThreadName) {
+            syslog.vlogf(ll, logThreadName, format, arg);
         } else {
             syslog.vlogf(ll, format, arg);
         }
@@ -226,13 +222,11 @@ void RedirectablePrint::log_to_ble(const char *logLevel, const char *format, va_
                 message = new char[len + 1];
                 vsnprintf(message, len + 1, format, arg);
             }
-            auto thread = concurrency::OSThread::currentThread;
             meshtastic_LogRecord logRecord = meshtastic_LogRecord_init_zero;
             logRecord.level = getLogLevel(logLevel);
             strcpy(logRecord.message, message);
-            if (thread)
-                strcpy(logRecord.source, thread->ThreadName.c_str());
-            logRecord.time = getValidTime(RTCQuality::RTCQualityDevice, true);
+            strcpy(logRecord.source, logThreadName);
+            logRecord.time = logRtc;
 
             uint8_t *buffer = new uint8_t[meshtastic_LogRecord_size];
             size_t size = pb_encode_to_bytes(buffer, meshtastic_LogRecord_size, meshtastic_LogRecord_fields, &logRecord);
@@ -277,14 +271,6 @@ meshtastic_LogRecord_Level RedirectablePrint::getLogLevel(const char *logLevel)
 
 void RedirectablePrint::log(const char *logLevel, const char *format, ...)
 {
-
-    // append \n to format
-    size_t len = strlen(format);
-    char *newFormat = new char[len + 2];
-    strcpy(newFormat, format);
-    newFormat[len] = '\n';
-    newFormat[len + 1] = '\0';
-
 #if ARCH_PORTDUINO
     // level trace is special, two possible ways to handle it.
     if (strcmp(logLevel, MESHTASTIC_LOG_LEVEL_TRACE) == 0) {
@@ -298,32 +284,70 @@ void RedirectablePrint::log(const char *logLevel, const char *format, ...)
             va_end(arg);
         }
         if (settingsMap[logoutputlevel] < level_trace && strcmp(logLevel, MESHTASTIC_LOG_LEVEL_TRACE) == 0) {
-            delete[] newFormat;
             return;
         }
     }
     if (settingsMap[logoutputlevel] < level_debug && strcmp(logLevel, MESHTASTIC_LOG_LEVEL_DEBUG) == 0) {
-        delete[] newFormat;
         return;
     } else if (settingsMap[logoutputlevel] < level_info && strcmp(logLevel, MESHTASTIC_LOG_LEVEL_INFO) == 0) {
-        delete[] newFormat;
         return;
     } else if (settingsMap[logoutputlevel] < level_warn && strcmp(logLevel, MESHTASTIC_LOG_LEVEL_WARN) == 0) {
-        delete[] newFormat;
         return;
     }
 #endif
     if (moduleConfig.serial.override_console_serial_port && strcmp(logLevel, MESHTASTIC_LOG_LEVEL_DEBUG) == 0) {
-        delete[] newFormat;
         return;
     }
 
+    auto thread = concurrency::OSThread::currentThread;
+    const char *threadName = thread ? thread->ThreadName.c_str() : "";
+    uint32_t rtc = getValidTime(RTCQuality::RTCQualityDevice, true);
+
+#if MESHTASTIC_LOG_RING
+    if (logRing) {
+        LogRing::Entry entry;
+        entry.level = logLevel;
+        entry.millis = millis();
+        entry.rtc = rtc;
+        strncpy(entry.thread, threadName, sizeof(entry.thread) - 1);
+        entry.thread[sizeof(entry.thread) - 1] = '\0';
+
+        va_list arg;
+        va_start(arg, format);
+        bool wasEmpty = false;
+        const bool queued = logRing->push(entry, format, arg, &wasEmpty);
+        va_end(arg);
+
+        if (queued) {
+            if (wasEmpty)
+                onLogQueued();
+            // Errors go out right away, after whatever was logged before them
+            if (strcmp(logLevel, MESHTASTIC_LOG_LEVEL_ERROR) == 0 || strcmp(logLevel, MESHTASTIC_LOG_LEVEL_CRIT) == 0)
+                drainLog();
+            return;
+        }
+        // The queue is full, because whoever logged hasn't let the console run for a while. Rather than lose the message,
+        // write out the queue and then the message right here, like without the queue
+        drainLog();
+    }
+#endif
+
+    // append \n to format
+    size_t len = strlen(format);
+    char *newFormat = new char[len + 2];
+    strcpy(newFormat, format);
+    newFormat[len] = '\n';
+    newFormat[len + 1] = '\0';
+
 #ifdef HAS_FREE_RTOS
     if (inDebugPrint != nullptr && xSemaphoreTake(inDebugPrint, portMAX_DELAY) == pdTRUE) {
 #else
     if (!inDebugPrint) {
         inDebugPrint = true;
 #endif
+        logThreadName = threadName;
+        logRtc = rtc;
+        logMillis = millis();
 
         va_list arg;
         va_start(arg, format);
@@ -344,6 +368,65 @@ void RedirectablePrint::log(const char *logLevel, const char *format, ...)
     return;
 }
 
+void RedirectablePrint::emit(const char *logLevel, const char *format, ...)
+{
+    va_list arg;
+    va_start(arg, format);
+    log_to_serial(logLevel, format, arg);
+    log_to_syslog(logLevel, format, arg);
+    log_to_ble(logLevel, format, arg);
+    va_end(arg);
+}
+
+void RedirectablePrint::startLogRing()
+{
+#if MESHTASTIC_LOG_RING
+    if (!logRing)
+        logRing = new LogRing();
+#endif
+}
+
+bool RedirectablePrint::hasQueuedLog() const
+{
+#if MESHTASTIC_LOG_RING
+    return logRing && !logRing->isEmpty();
+#else
+    return false;
+#endif
+}
+
+void RedirectablePrint::drainLog()
+{
+#if MESHTASTIC_LOG_RING
+    if (!logRing || logRing->isEmpty())
+        return;
+#ifdef HAS_FREE_RTOS
+    if (inDebugPrint != nullptr && xSemaphoreTake(inDebugPrint, portMAX_DELAY) == pdTRUE) {
+#else
+    if (!inDebugPrint) {
+        inDebugPrint = true;
+#endif
+#ifdef ARCH_PORTDUINO
+        static char text[512];
+#else
+        static char text[256];
+#endif
+        LogRing::Entry entry;
+        while (logRing->pop(entry, text, sizeof(text))) {
+            logThreadName = entry.thread;
+            logRtc = entry.rtc;
+            logMillis = entry.millis;
+            emit(entry.level, "%s\n", text);
+        }
+#ifdef HAS_FREE_RTOS
+        xSemaphoreGive(inDebugPrint);
+#else
+        inDebugPrint = false;
+#endif
+    }
+#endif
+}
+
 void RedirectablePrint::hexDump(const char *logLevel, unsigned char *buf, uint16_t len)
 {
     const char alphabet[17] = "0123456789abcdef";
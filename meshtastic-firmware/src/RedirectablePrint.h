@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../freertosinc.h"
+#include "LogRing.h"
 #include "mesh/generated/meshtastic/mesh.pb.h"
 #include <Print.h>
 #include <stdarg.h>
@@ -20,6 +21,9 @@ class RedirectablePrint : public Print
     StaticSemaphore_t _MutexStorageSpace;
 #else
     volatile bool inDebugPrint = false;
+#endif
+#if MESHTASTIC_LOG_RING
+    LogRing *logRing = nullptr;
 #endif
   public:
     explicit RedirectablePrint(Print *_dest) : dest(_dest) {}
@@ -41,6 +45,18 @@ class RedirectablePrint : public Print
      */
     void log(const char *logLevel, const char *format, ...) __attribute__((format(printf, 3, 4)));
 
+    /**
+     * From now on queue log messages and write them from drainLog(), rather than make every caller wait for the serial port.
+     * Until this is called (and on platforms without MESHTASTIC_LOG_RING) messages are written right away.
+     */
+    void startLogRing();
+
+    /// Write out all queued log messages
+    void drainLog();
+
+    /// True if there are queued log messages waiting for drainLog()
+    bool hasQueuedLog() const;
+
     /** like printf but va_list based */
     size_t vprintf(const char *logLevel, const char *format, va_list arg);
 
@@ -49,11 +65,21 @@ class RedirectablePrint : public Print
     std::string mt_sprintf(const std::string fmt_str, ...);
 
   protected:
+    // Where the message being written came from, captured when it was logged
+    const char *logThreadName = "";
+    uint32_t logRtc = 0;
+    uint32_t logMillis = 0;
+
+    /// A message was queued while the queue was empty, subclasses that call drainLog() can be woken here. Called from any task
+    virtual void onLogQueued() {}
+
     /// Subclasses can override if they need to change how we format over the serial port
     virtual void log_to_serial(const char *logLevel, const char *format, va_list arg);
     meshtastic_LogRecord_Level getLogLevel(const char *logLevel);
 
   private:
+    /// Write a message to every log destination
+    void emit(const char *logLevel, const char *format, ...) __attribute__((format(printf, 3, 4)));
     void log_to_syslog(const char *logLevel, const char *format, va_list arg);
     void log_to_ble(const char *logLevel, const char *format, va_list arg);
 };
\ No newline at end of file
@@ -5,6 +5,7 @@
 #include "Throttle.h"
 #include "configuration.h"
 #include "time.h"
+#include <algorithm>
 
 #ifdef RP2040_SLOW_CLOCK
 #define Port Serial2
@@ -64,11 +65,15 @@ SerialConsole::SerialConsole() : StreamAPI(&Port), RedirectablePrint(&Port), con
 
 int32_t SerialConsole::runOnce()
 {
-    return runOncePart();
+    drainLog();
+    int32_t delay = runOncePart();
+    // Queued log messages are written from here, come back soon enough that the queue doesn't fill up
+    return hasQueuedLog() ? std::min<int32_t>(delay, LOG_DRAIN_INTERVAL_MS) : delay;
 }
 
 void SerialConsole::flush()
 {
+    drainLog();
     Port.flush();
 }
 
@@ -100,8 +105,7 @@ void SerialConsole::log_to_serial(const char *logLevel, const char *format, va_l
 {
     if (usingProtobufs && config.security.debug_log_api_enabled) {
         meshtastic_LogRecord_Level ll = RedirectablePrint::getLogLevel(logLevel);
-        auto thread = concurrency::OSThread::currentThread;
-        emitLogRecord(ll, thread ? thread->ThreadName.c_str() : "", format, arg);
+        emitLogRecord(ll, logThreadName, format, arg);
     } else
         RedirectablePrint::log_to_serial(logLevel, format, arg);
 }
\ No newline at end of file
@@ -39,6 +39,9 @@ class SerialConsole : public StreamAPI, public RedirectablePrint, private concur
 
     /// Possibly switch to protobufs if we see a valid protobuf message
     virtual void log_to_serial(const char *logLevel, const char *format, va_list arg);
+
+    /// Write the queued log messages as soon as whoever logged them yields, rather than after our current delay
+    virtual void onLogQueued() override { wake(); }
 };
 
 // A simple wrapper to allow non class aware code write to the console
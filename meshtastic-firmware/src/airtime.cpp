@@ -1,5 +1,6 @@
 #include "airtime.h"
 #include "NodeDB.h"
+#include "concurrency/LockGuard.h"
 #include "configuration.h"
 
 AirTime *airTime = NULL;
@@ -11,7 +12,9 @@ uint32_t air_period_rx[PERIODS_TO_LOG];
 
 void AirTime::logAirtime(reportTypes reportType, uint32_t airtime_ms)
 {
-
+#if RADIO_TASK
+    concurrency::LockGuard guard(&lock);
+#endif
     if (reportType == TX_LOG) {
         LOG_DEBUG("Packet TX: %ums", airtime_ms);
         this->airtimes.periodTX[0] = this->airtimes.periodTX[0] + airtime_ms;
@@ -102,6 +105,9 @@ uint32_t AirTime::getSecondsSinceBoot()
 
 float AirTime::channelUtilizationPercent()
 {
+#if RADIO_TASK
+    concurrency::LockGuard guard(&lock);
+#endif
     uint32_t sum = 0;
     for (uint32_t i = 0; i < CHANNEL_UTILIZATION_PERIODS; i++) {
         sum += this->channelUtilization[i];
@@ -112,6 +118,9 @@ float AirTime::channelUtilizationPercent()
 
 float AirTime::utilizationTXPercent()
 {
+#if RADIO_TASK
+    concurrency::LockGuard guard(&lock);
+#endif
     uint32_t sum = 0;
     for (uint32_t i = 0; i < MINUTES_IN_HOUR; i++) {
         sum += this->utilizationTX[i];
@@ -147,6 +156,9 @@ bool AirTime::isTxAllowedAirUtil()
 // Get the amount of minutes we have to be silent before we can send again
 uint8_t AirTime::getSilentMinutes(float txPercent, float dutyCycle)
 {
+#if RADIO_TASK
+    concurrency::LockGuard guard(&lock);
+#endif
     float newTxPercent = txPercent;
     for (int8_t i = MINUTES_IN_HOUR - 1; i >= 0; --i) {
         newTxPercent -= ((float)this->utilizationTX[i] / (MS_IN_MINUTE * MINUTES_IN_HOUR / 100));
@@ -161,6 +173,9 @@ AirTime::AirTime() : concurrency::OSThread("AirTime"), airtimes({}) {}
 
 int32_t AirTime::runOnce()
 {
+#if RADIO_TASK
+    concurrency::LockGuard guard(&lock);
+#endif
     secSinceBoot++;
 
     uint8_t utilPeriod = this->getPeriodUtilMinute();
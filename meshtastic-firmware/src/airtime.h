@@ -1,6 +1,7 @@
 #pragma once
 
 #include "MeshRadio.h"
+#include "concurrency/Lock.h"
 #include "concurrency/OSThread.h"
 #include "configuration.h"
 #include <Arduino.h>
@@ -70,6 +71,9 @@ class AirTime : private concurrency::OSThread
     uint8_t max_channel_util_percent = 40;
     uint8_t polite_channel_util_percent = 25;
     uint8_t polite_duty_cycle_percent = 50; // half of Duty Cycle allowance is ok for metadata
+#if RADIO_TASK
+    concurrency::Lock lock; // The radio task logs airtime while the main loop reads and rotates it
+#endif
 
     struct airtimeStruct {
         uint32_t periodTX[PERIODS_TO_LOG];     // AirTime transmitted
@@ -15,13 +15,32 @@ BinarySemaphorePosix::~BinarySemaphorePosix() {}
  */
 bool BinarySemaphorePosix::take(uint32_t msec)
 {
+#if RADIO_TASK
+    std::unique_lock<std::mutex> lock(mutex);
+    const bool r = condition.wait_for(lock, std::chrono::milliseconds(msec), [this] { return given; });
+    given = false;
+    return r;
+#else
     delay(msec); // FIXME
     return false;
+#endif
 }
 
-void BinarySemaphorePosix::give() {}
+void BinarySemaphorePosix::give()
+{
+#if RADIO_TASK
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        given = true;
+    }
+    condition.notify_one();
+#endif
+}
 
-IRAM_ATTR void BinarySemaphorePosix::giveFromISR(BaseType_t *pxHigherPriorityTaskWoken) {}
+IRAM_ATTR void BinarySemaphorePosix::giveFromISR(BaseType_t *pxHigherPriorityTaskWoken)
+{
+    give();
+}
 
 } // namespace concurrency
 
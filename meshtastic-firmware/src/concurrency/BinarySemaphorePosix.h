@@ -2,6 +2,11 @@
 
 #include "../freertosinc.h"
 
+#ifndef HAS_FREE_RTOS
+#include <condition_variable>
+#include <mutex>
+#endif
+
 namespace concurrency
 {
 
@@ -9,7 +14,10 @@ namespace concurrency
 
 class BinarySemaphorePosix
 {
-    // SemaphoreHandle_t semaphore;
+    // Only used with RADIO_TASK, otherwise everything runs on the one thread and take() is a plain delay
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool given = false;
 
   public:
     BinarySemaphorePosix();
@@ -24,9 +24,19 @@ void Lock::unlock()
 #else
 Lock::Lock() {}
 
-void Lock::lock() {}
+void Lock::lock()
+{
+#if RADIO_TASK
+    mutex.lock();
+#endif
+}
 
-void Lock::unlock() {}
+void Lock::unlock()
+{
+#if RADIO_TASK
+    mutex.unlock();
+#endif
+}
 #endif
 
 } // namespace concurrency
@@ -2,6 +2,10 @@
 
 #include "../freertosinc.h"
 
+#ifndef HAS_FREE_RTOS
+#include <mutex>
+#endif
+
 namespace concurrency
 {
 
@@ -29,6 +33,8 @@ class Lock
   private:
 #ifdef HAS_FREE_RTOS
     SemaphoreHandle_t handle;
+#else
+    std::mutex mutex; // Only used with RADIO_TASK, otherwise everything runs on the one thread
 #endif
 };
 
@@ -14,4 +14,14 @@ LockGuard::~LockGuard()
     lock->unlock();
 }
 
+UnlockGuard::UnlockGuard(Lock *lock) : lock(lock)
+{
+    lock->unlock();
+}
+
+UnlockGuard::~UnlockGuard()
+{
+    lock->lock();
+}
+
 } // namespace concurrency
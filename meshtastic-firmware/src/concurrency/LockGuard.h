@@ -21,4 +21,20 @@ class LockGuard
     Lock *lock;
 };
 
+/**
+ * @brief RAII unlock, lets go of a lock the caller holds for the length of a scope
+ */
+class UnlockGuard
+{
+  public:
+    explicit UnlockGuard(Lock *lock);
+    ~UnlockGuard();
+
+    UnlockGuard(const UnlockGuard &) = delete;
+    UnlockGuard &operator=(const UnlockGuard &) = delete;
+
+  private:
+    Lock *lock;
+};
+
 } // namespace concurrency
@@ -15,7 +15,7 @@ bool NotifiedWorkerThread::notify(uint32_t v, bool overwrite)
     bool r = notifyCommon(v, overwrite);
 
     if (r)
-        mainDelay.interrupt();
+        wakeDelay->interrupt();
 
     return r;
 }
@@ -52,7 +52,7 @@ IRAM_ATTR bool NotifiedWorkerThread::notifyFromISR(BaseType_t *highPriWoken, uin
 {
     bool r = notifyCommon(v, overwrite);
     if (r)
-        mainDelay.interruptFromISR(highPriWoken);
+        wakeDelay->interruptFromISR(highPriWoken);
 
     return r;
 }
@@ -16,7 +16,7 @@ class NotifiedWorkerThread : public OSThread
     uint32_t notification = 0;
 
   public:
-    NotifiedWorkerThread(const char *name) : OSThread(name) {}
+    NotifiedWorkerThread(const char *name, ThreadController *controller = &mainController) : OSThread(name, 0, controller) {}
 
     /**
      * Notify this thread so it can run
@@ -36,6 +36,9 @@ class NotifiedWorkerThread : public OSThread
     bool notifyLater(uint32_t delay, uint32_t v, bool overwrite);
 
   protected:
+    /// Interrupted when we are notified, so whatever runs us stops sleeping
+    InterruptableDelay *wakeDelay = &mainDelay;
+
     virtual void onNotify(uint32_t notification) = 0;
 
     /// just calls checkNotification()
@@ -1,6 +1,8 @@
 #include "OSThread.h"
+#include "Clock.h"
 #include "configuration.h"
 #include "memGet.h"
+#include <algorithm>
 #include <assert.h>
 
 namespace concurrency
@@ -15,7 +17,7 @@ bool OSThread::showRun = false;
 /// Show debugging info for threads we decide not to run;
 bool OSThread::showWaiting = false;
 
-const OSThread *OSThread::currentThread;
+OSTHREAD_LOCAL const OSThread *OSThread::currentThread;
 
 ThreadController mainController, timerController;
 InterruptableDelay mainDelay;
@@ -36,13 +38,18 @@ OSThread::OSThread(const char *_name, uint32_t period, ThreadController *_contro
     if (controller) {
         bool added = controller->add(this);
         assert(added);
+        if (controller == &mainController)
+            mainScheduler.add(this);
     }
 }
 
 OSThread::~OSThread()
 {
-    if (controller)
+    if (controller) {
         controller->remove(this);
+        if (controller == &mainController)
+            mainScheduler.remove(this);
+    }
 }
 
 /**
@@ -54,7 +61,8 @@ void OSThread::setIntervalFromNow(unsigned long _interval)
     interval = _interval;
 
     // Cache the next run based on the last_run
-    _cached_next_run = millis() + interval;
+    _cached_next_run = clockMillis() + interval;
+    notifyScheduleChanged();
 }
 
 bool OSThread::shouldRun(unsigned long time)
@@ -78,23 +86,41 @@ bool OSThread::shouldRun(unsigned long time)
 
 void OSThread::run()
 {
-#ifdef DEBUG_HEAP
+    // mainScheduler keeps the time we were due, other controllers don't
+    if (controller == &mainController) {
+        const int32_t late = (int32_t)(clockMillis() - scheduledRun);
+        if (late > 0) {
+            stats.totalLateMillis += late;
+            stats.maxLateMillis = std::max<uint32_t>(stats.maxLateMillis, late);
+        }
+    }
+#if OSTHREAD_PROFILE_HEAP
     auto heap = memGet.getFreeHeap();
 #endif
     currentThread = this;
+    wakeRequested = false; // Before runOnce(), so a wake() while it runs gets us run again
+    const uint32_t start = micros();
     auto newDelay = runOnce();
-#ifdef DEBUG_HEAP
+    const uint32_t elapsed = micros() - start;
+    stats.runs++;
+    stats.totalMicros += elapsed;
+    stats.maxMicros = std::max(stats.maxMicros, elapsed);
+#if OSTHREAD_PROFILE_HEAP
     auto newHeap = memGet.getFreeHeap();
+    stats.heapDelta += (int32_t)(newHeap - heap);
+#endif
+#ifdef DEBUG_HEAP
     if (newHeap < heap)
         LOG_DEBUG("------ Thread %s leaked heap %d -> %d (%d) ------", ThreadName.c_str(), heap, newHeap, newHeap - heap);
     if (heap < newHeap)
         LOG_DEBUG("++++++ Thread %s freed heap %d -> %d (%d) ++++++", ThreadName.c_str(), heap, newHeap, newHeap - heap);
 #endif
 
-    runned();
+    runned(clockMillis());
 
+    // mainScheduler reads our next run time once we return, no need to flag it
     if (newDelay >= 0)
-        setInterval(newDelay);
+        Thread::setInterval(newDelay);
 
     currentThread = NULL;
 }
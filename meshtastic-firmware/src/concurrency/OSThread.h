@@ -6,6 +6,7 @@
 #include "Thread.h"
 #include "ThreadController.h"
 #include "concurrency/InterruptableDelay.h"
+#include "concurrency/Scheduler.h"
 
 namespace concurrency
 {
@@ -15,6 +16,33 @@ extern InterruptableDelay mainDelay;
 
 #define RUN_SAME -1
 
+// Where the radio can run on a task of its own (RADIO_TASK), which sets currentThread too. Build flags only, this header
+// comes before configuration.h
+#if defined(ESP_PLATFORM) || defined(ARCH_PORTDUINO)
+#define OSTHREAD_LOCAL thread_local
+#else
+#define OSTHREAD_LOCAL
+#endif
+
+// Track the change in free heap across each run, only where reading the free heap is cheap
+#ifndef OSTHREAD_PROFILE_HEAP
+#if defined(ARCH_ESP32) || defined(DEBUG_HEAP)
+#define OSTHREAD_PROFILE_HEAP 1
+#else
+#define OSTHREAD_PROFILE_HEAP 0
+#endif
+#endif
+
+/// Counters kept for every thread since boot, cheap enough to always be on
+struct OSThreadStats {
+    uint32_t runs = 0;
+    uint64_t totalMicros = 0; // Time spent in runOnce()
+    uint32_t maxMicros = 0;
+    uint64_t totalLateMillis = 0; // How long after its requested time each run started
+    uint32_t maxLateMillis = 0;
+    int32_t heapDelta = 0; // Net change in free heap across all runs, if OSTHREAD_PROFILE_HEAP
+};
+
 /**
  * @brief Base threading
  *
@@ -30,8 +58,20 @@ extern InterruptableDelay mainDelay;
  */
 class OSThread : public Thread
 {
+    friend class Scheduler;
+
     ThreadController *controller;
 
+    /// Where mainScheduler has us, -1 if not in its heap
+    int32_t heapIndex = -1;
+    uint32_t scheduledRun = 0;
+
+    /// Set when our interval or enabled flag changed, until mainScheduler has moved us
+    volatile bool scheduleChanged = false;
+
+    /// Set by wake(), cleared when we start running
+    volatile bool wakeRequested = false;
+
     /// Show debugging info for disabled threads
     static bool showDisabled;
 
@@ -42,8 +82,8 @@ class OSThread : public Thread
     static bool showWaiting;
 
   public:
-    /// For debug printing only (might be null)
-    static const OSThread *currentThread;
+    /// For debug printing only (might be null), the thread running on this task
+    static OSTHREAD_LOCAL const OSThread *currentThread;
 
     OSThread(const char *name, uint32_t period = 0, ThreadController *controller = &mainController);
 
@@ -55,11 +95,40 @@ class OSThread : public Thread
 
     virtual int32_t disable();
 
+    const OSThreadStats &getStats() const { return stats; }
+
     /**
      * Wait a specified number msecs starting from the current time (rather than the last time we were run)
      */
     void setIntervalFromNow(unsigned long _interval);
 
+    /// Also lets mainScheduler know, safe to call from ISRs
+    void setInterval(unsigned long _interval)
+    {
+        Thread::setInterval(_interval);
+        notifyScheduleChanged();
+    }
+
+    /**
+     * Tell mainScheduler that our enabled flag was changed directly. setInterval(), setIntervalFromNow() and disable() do
+     * this themselves. A disabled thread isn't run again until this is called. Safe to call from ISRs.
+     */
+    void notifyScheduleChanged()
+    {
+        scheduleChanged = true;
+        mainScheduler.markChanged();
+    }
+
+    /**
+     * Run as soon as possible. Unlike setInterval(0) this isn't lost if runOnce() is in progress on the main loop and returns a
+     * longer interval. Safe to call from ISRs and other tasks.
+     */
+    void wake()
+    {
+        wakeRequested = true;
+        notifyScheduleChanged();
+    }
+
   protected:
     /**
      * The method that will be called each time our thread gets a chance to run
@@ -71,6 +140,11 @@ class OSThread : public Thread
 
     // Do not override this
     virtual void run();
+
+  private:
+    OSThreadStats stats;
+
+    uint32_t nextRunTime() const { return _cached_next_run; }
 };
 
 /**
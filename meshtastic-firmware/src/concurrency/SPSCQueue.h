@@ -0,0 +1,51 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace concurrency
+{
+
+/**
+ * @brief Lock-free queue between exactly one producer task and one consumer task
+ *
+ * For handing work between tasks on different cores without a mutex, e.g. received packets from the radio task to the
+ * Router. push() must only be called from the producer and pop() from the consumer, neither ever blocks. N must be a power
+ * of two.
+ */
+template <class T, size_t N> class SPSCQueue
+{
+    static_assert(N && (N & (N - 1)) == 0, "N must be a power of two");
+
+    T items[N];
+    std::atomic<uint32_t> head{0}; // Next to pop, only written by the consumer
+    std::atomic<uint32_t> tail{0}; // Next to push, only written by the producer
+
+  public:
+    /// @return false if the queue is full
+    bool push(const T &item)
+    {
+        const uint32_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) == N)
+            return false;
+        items[t & (N - 1)] = item;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// @return false if the queue is empty
+    bool pop(T &item)
+    {
+        const uint32_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire))
+            return false;
+        item = items[h & (N - 1)];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool isEmpty() const { return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire); }
+};
+
+} // namespace concurrency
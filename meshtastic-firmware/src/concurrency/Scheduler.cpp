@@ -0,0 +1,194 @@
+#include "Scheduler.h"
+#include "Clock.h"
+#include "OSThread.h"
+#include <algorithm>
+
+namespace concurrency
+{
+
+Scheduler mainScheduler;
+
+/// Run times are clockMillis() values, compared so that they keep working when the clock wraps around
+bool Scheduler::runsBefore(const OSThread *a, const OSThread *b)
+{
+    return (int32_t)(a->scheduledRun - b->scheduledRun) < 0;
+}
+
+uint32_t Scheduler::nextRun(const OSThread *thread, uint32_t now)
+{
+    if (thread->wakeRequested)
+        return now;
+    // A thread that became due while we weren't looking counts as due now, so its lateness only counts time spent waiting
+    // for us
+    const int32_t wait = (int32_t)(thread->nextRunTime() - now);
+    return now + std::min<int32_t>(std::max<int32_t>(wait, 0), SCHEDULER_MAX_WAIT_MS);
+}
+
+void Scheduler::add(OSThread *thread)
+{
+    push(thread, clockMillis());
+}
+
+void Scheduler::remove(OSThread *thread)
+{
+    if (thread->heapIndex >= 0) {
+        removeAt(thread->heapIndex);
+        return;
+    }
+    auto found = std::find(parked.begin(), parked.end(), thread);
+    if (found != parked.end()) {
+        parked.erase(found);
+        return;
+    }
+    for (auto &due : dueNow)
+        if (due == thread)
+            due = nullptr;
+}
+
+void Scheduler::push(OSThread *thread, uint32_t now)
+{
+    thread->scheduleChanged = false;
+    if (!thread->enabled) {
+        parked.push_back(thread);
+        return;
+    }
+    thread->scheduledRun = nextRun(thread, now);
+    heap.push_back(thread);
+    thread->heapIndex = heap.size() - 1;
+    siftUp(heap.size() - 1);
+}
+
+void Scheduler::removeAt(size_t index)
+{
+    heap[index]->heapIndex = -1;
+    OSThread *last = heap.back();
+    heap.pop_back();
+    if (index < heap.size()) {
+        place(index, last);
+        siftUp(index);
+        siftDown(last->heapIndex);
+    }
+}
+
+void Scheduler::place(size_t index, OSThread *thread)
+{
+    heap[index] = thread;
+    thread->heapIndex = index;
+}
+
+void Scheduler::siftUp(size_t index)
+{
+    OSThread *thread = heap[index];
+    while (index > 0) {
+        const size_t parent = (index - 1) / 2;
+        if (!runsBefore(thread, heap[parent]))
+            break;
+        place(index, heap[parent]);
+        index = parent;
+    }
+    place(index, thread);
+}
+
+void Scheduler::siftDown(size_t index)
+{
+    OSThread *thread = heap[index];
+    while (true) {
+        size_t child = 2 * index + 1;
+        if (child >= heap.size())
+            break;
+        if (child + 1 < heap.size() && runsBefore(heap[child + 1], heap[child]))
+            child++;
+        if (!runsBefore(heap[child], thread))
+            break;
+        place(index, heap[child]);
+        index = child;
+    }
+    place(index, thread);
+}
+
+void Scheduler::updateChanged(uint32_t now)
+{
+    if (!anyChanged)
+        return;
+    anyChanged = false; // Cleared first, so a change flagged while we look is seen on the next pass
+
+    // Flagged threads get their new run time, or are parked if they were disabled
+    bool changed = false;
+    for (size_t i = 0; i < heap.size();) {
+        OSThread *thread = heap[i];
+        if (!thread->scheduleChanged) {
+            i++;
+            continue;
+        }
+        thread->scheduleChanged = false;
+        changed = true;
+        if (thread->enabled) {
+            thread->scheduledRun = nextRun(thread, now);
+            i++;
+            continue;
+        }
+        // Move the last thread here, it is looked at next, the heap is rebuilt below
+        OSThread *last = heap.back();
+        heap.pop_back();
+        if (i < heap.size())
+            place(i, last);
+        thread->heapIndex = -1;
+        parked.push_back(thread);
+    }
+
+    // Parked threads that were enabled again go back in the heap
+    for (size_t i = 0; i < parked.size();) {
+        OSThread *thread = parked[i];
+        if (!thread->scheduleChanged) {
+            i++;
+            continue;
+        }
+        thread->scheduleChanged = false;
+        if (!thread->enabled) {
+            i++;
+            continue;
+        }
+        parked[i] = parked.back();
+        parked.pop_back();
+        thread->scheduledRun = nextRun(thread, now);
+        heap.push_back(thread);
+        thread->heapIndex = heap.size() - 1;
+        changed = true;
+    }
+
+    if (changed)
+        for (size_t i = heap.size() / 2; i-- > 0;)
+            siftDown(i);
+}
+
+long Scheduler::runOrDelay()
+{
+    uint32_t now = clockMillis();
+    updateChanged(now);
+
+    // Take every due thread off the heap before running any, so each runs at most once per pass even if it asks to run again
+    // right away, like ThreadController did
+    while (!heap.empty() && (int32_t)(heap[0]->scheduledRun - now) <= 0) {
+        dueNow.push_back(heap[0]);
+        removeAt(0);
+    }
+
+    for (size_t i = 0; i < dueNow.size(); i++) {
+        OSThread *thread = dueNow[i];
+        if (!thread)
+            continue; // Deleted by a thread that ran before it
+        if (thread->wakeRequested ? thread->enabled : thread->shouldRun(now))
+            thread->run();
+        if (dueNow[i]) // Unless it deleted itself
+            push(thread, clockMillis());
+    }
+    dueNow.clear();
+
+    now = clockMillis();
+    updateChanged(now);
+    if (heap.empty())
+        return SCHEDULER_MAX_WAIT_MS;
+    return std::max<int32_t>(0, (int32_t)(heap[0]->scheduledRun - now));
+}
+
+} // namespace concurrency
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace concurrency
+{
+
+class OSThread;
+
+// Longest the scheduler goes without looking at an enabled thread
+#ifndef SCHEDULER_MAX_WAIT_MS
+#define SCHEDULER_MAX_WAIT_MS (60 * 1000UL)
+#endif
+
+/**
+ * @brief Runs the OSThreads of mainController in order of when they are next due
+ *
+ * Threads are kept in a binary min-heap keyed by their next run time, so a pass of the main loop only touches the threads
+ * that are due and the time until the next one is read off the top of the heap. This replaces ThreadController::runOrDelay(),
+ * which asked every thread whether it should run on every pass.
+ *
+ * The heap is only changed from the main loop. A thread whose interval or enabled flag changes from elsewhere (another task,
+ * an ISR, or another thread's runOnce) just flags itself, see OSThread::notifyScheduleChanged(), and is moved to its new place
+ * at the start of the next pass.
+ *
+ * Disabled threads are parked outside the heap, so they cost nothing while they stay disabled. Whoever enables one again has
+ * to call notifyScheduleChanged(), directly or through setInterval() or setIntervalFromNow().
+ */
+class Scheduler
+{
+  public:
+    void add(OSThread *thread);
+    void remove(OSThread *thread);
+
+    /// Some thread has flagged a schedule change, safe to call from ISRs
+    void markChanged() { anyChanged = true; }
+
+    /**
+     * Run every thread that is due
+     * @return msecs until the next thread is due, to sleep in mainDelay
+     */
+    long runOrDelay();
+
+  private:
+    std::vector<OSThread *> heap;
+    std::vector<OSThread *> dueNow; // Threads taken off the heap to run in this pass, nullptr once deleted
+    std::vector<OSThread *> parked; // Disabled threads, back in the heap once notifyScheduleChanged() finds them enabled
+    volatile bool anyChanged = false;
+
+    static bool runsBefore(const OSThread *a, const OSThread *b);
+    static uint32_t nextRun(const OSThread *thread, uint32_t now);
+
+    void push(OSThread *thread, uint32_t now);
+    void removeAt(size_t index);
+    void siftUp(size_t index);
+    void siftDown(size_t index);
+    void place(size_t index, OSThread *thread);
+
+    /// Give flagged threads their new run time
+    void updateChanged(uint32_t now);
+};
+
+extern Scheduler mainScheduler;
+
+} // namespace concurrency
@@ -0,0 +1,84 @@
+#include "ThreadStatsReporter.h"
+#include "configuration.h"
+#include <algorithm>
+#include <vector>
+
+#ifdef ARCH_PORTDUINO
+#include "platform/portduino/PortduinoGlue.h"
+#include <cstdio>
+#include <fstream>
+#endif
+
+namespace concurrency
+{
+
+static const OSThread *otherThreads[THREAD_STATS_OTHER_THREADS];
+static int numOtherThreads; // Only changed from setup(), which runs on the main loop like format()
+
+ThreadStatsReporter::ThreadStatsReporter() : OSThread("ThreadStats", THREAD_STATS_INTERVAL_MS) {}
+
+void ThreadStatsReporter::addThread(const OSThread *thread)
+{
+    if (numOtherThreads == THREAD_STATS_OTHER_THREADS) {
+        LOG_WARN("No room to report thread stats of %s", thread->ThreadName.c_str());
+        return;
+    }
+    otherThreads[numOtherThreads++] = thread;
+}
+
+std::string ThreadStatsReporter::format()
+{
+    std::vector<const OSThread *> threads;
+    for (int i = 0; i < MAX_THREADS; i++) {
+        // Only OSThreads are ever added to mainController
+        auto thread = static_cast<const OSThread *>(mainController.get(i));
+        if (thread && thread->getStats().runs)
+            threads.push_back(thread);
+    }
+    for (int i = 0; i < numOtherThreads; i++) {
+        if (otherThreads[i]->getStats().runs)
+            threads.push_back(otherThreads[i]);
+    }
+    std::sort(threads.begin(), threads.end(), [](const OSThread *a, const OSThread *b) {
+        return a->getStats().totalMicros > b->getStats().totalMicros;
+    });
+
+    std::string report;
+    char line[160];
+    snprintf(line, sizeof(line), "thread runs cpu_ms max_us late_avg_ms late_max_ms heap_delta uptime_s=%lu\n",
+             (unsigned long)(millis() / 1000));
+    report += line;
+    for (auto thread : threads) {
+        const OSThreadStats &stats = thread->getStats();
+        snprintf(line, sizeof(line), "%s %lu %llu %lu %lu %lu %ld\n", thread->ThreadName.c_str(), (unsigned long)stats.runs,
+                 (unsigned long long)(stats.totalMicros / 1000), (unsigned long)stats.maxMicros,
+                 (unsigned long)(stats.totalLateMillis / stats.runs), (unsigned long)stats.maxLateMillis,
+                 (long)stats.heapDelta);
+        report += line;
+    }
+    return report;
+}
+
+int32_t ThreadStatsReporter::runOnce()
+{
+    const std::string report = format();
+
+    size_t start = 0;
+    for (size_t end = report.find('\n'); end != std::string::npos; start = end + 1, end = report.find('\n', start))
+        LOG_INFO("Thread stats: %s", report.substr(start, end - start).c_str());
+
+#ifdef ARCH_PORTDUINO
+    const std::string &path = settingsStrings[threadStatsFilename];
+    if (path != "") {
+        const std::string tmp = path + ".tmp";
+        std::ofstream file(tmp, std::ios::trunc);
+        file << report;
+        file.close();
+        if (!file || rename(tmp.c_str(), path.c_str()) != 0)
+            LOG_WARN("Could not write thread stats to %s", path.c_str());
+    }
+#endif
+    return THREAD_STATS_INTERVAL_MS;
+}
+
+} // namespace concurrency
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "concurrency/OSThread.h"
+#include <string>
+
+// Most threads addThread() can add, on top of those in mainController
+#ifndef THREAD_STATS_OTHER_THREADS
+#define THREAD_STATS_OTHER_THREADS 2
+#endif
+
+// How often thread statistics are reported, 0 to never report them
+#ifndef THREAD_STATS_INTERVAL_MS
+#ifdef ARCH_PORTDUINO
+#define THREAD_STATS_INTERVAL_MS (60 * 1000)
+#else
+#define THREAD_STATS_INTERVAL_MS (15 * 60 * 1000)
+#endif
+#endif
+
+namespace concurrency
+{
+
+/**
+ * @brief Reports the OSThreadStats of every thread, busiest first
+ *
+ * The report goes to the log, and so to clients that have the debug log API enabled. On Linux it is also written to the
+ * Logging: ThreadStatsFile of config.yaml, replaced as a whole each time so readers never see half of it.
+ */
+class ThreadStatsReporter : public OSThread
+{
+  public:
+    ThreadStatsReporter();
+
+    /// The report, one line per thread that has run
+    static std::string format();
+
+    /**
+     * Also report a thread that runs on a task of its own rather than from mainController, like the radio with RADIO_TASK.
+     * Its stats are read without a lock while it may be running, so they can be off by a run, and it has no lateness
+     */
+    static void addThread(const OSThread *thread);
+
+  protected:
+    int32_t runOnce() override;
+};
+
+} // namespace concurrency
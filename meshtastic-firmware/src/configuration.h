@@ -380,5 +380,36 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define HAS_SCREEN 0
 #endif
 
+// Run the radio on a task of its own instead of in the main loop, so a slow screen redraw or TLS handshake can't hold up an
+// ACK or a relay. The task is pinned to RADIO_TASK_CORE on ESP32 (the main loop runs on core 1), a thread on Linux.
+#ifndef RADIO_TASK
+#define RADIO_TASK 0
+#endif
+#if RADIO_TASK && !defined(ARCH_ESP32) && !defined(ARCH_PORTDUINO)
+#error "RADIO_TASK is only supported on ESP32 and Linux"
+#endif
+#ifndef RADIO_TASK_CORE
+#define RADIO_TASK_CORE 0
+#endif
+
+// Send direct text messages compressed with unishox2 when that makes them smaller, to nodes whose NodeInfo says they can
+// decompress them, and say in our NodeInfo that we can. Receiving compressed messages is always supported.
+#ifndef TEXT_COMPRESSION
+#define TEXT_COMPRESSION 0
+#endif
+
+// Send our telemetry, position and nodeinfo broadcasts as deltas against an earlier one, see PayloadDelta.h. Only for meshes
+// where every node runs firmware that can decode them, which is any built after this option was added
+#ifndef PAYLOAD_DELTA
+#define PAYLOAD_DELTA 0
+#endif
+
+// Send our environment, power and air quality telemetry to the mesh this many samples to a packet, see TelemetryBatch.h. 1 sends
+// each as it is taken. Receiving batches is always supported, but only by firmware built after this option was added: older
+// nodes, and the phones attached to them, take a batch for a garbled Telemetry message. Only for meshes where every node is new
+#ifndef TELEMETRY_BATCH_SIZE
+#define TELEMETRY_BATCH_SIZE 1
+#endif
+
 #include "DebugConfiguration.h"
 #include "RF95Configuration.h"
@@ -1154,6 +1154,7 @@ int32_t GPS::runOnce()
 // clear the GPS rx/tx buffer as quickly as possible
 void GPS::clearBuffer()
 {
+    nmeaSentenceLen = 0;
 #ifdef ARCH_ESP32
     _serial_gps->flush(false);
 #else
@@ -1719,7 +1720,6 @@ bool GPS::hasFlow()
 
 bool GPS::whileActive()
 {
-    unsigned int charsInBuf = 0;
     bool isValid = false;
 #ifdef GPS_DEBUG
     std::string debugmsg = "";
@@ -1734,21 +1734,30 @@ bool GPS::whileActive()
         clearBuffer();
     }
 #endif
-    // First consume any chars that have piled up at the receiver
-    while (_serial_gps->available() > 0) {
-        int c = _serial_gps->read();
-        UBXscratch[charsInBuf] = c;
+    // First consume any chars that have piled up at the receiver, a block at a time
+    uint8_t block[64];
+    int waiting;
+    while ((waiting = _serial_gps->available()) > 0) {
+        size_t len = _serial_gps->readBytes(block, std::min<size_t>(waiting, sizeof(block)));
+        if (len == 0)
+            break;
+        for (size_t i = 0; i < len; i++) {
+            const char c = block[i];
 #ifdef GPS_DEBUG
-        debugmsg += vformat("%c", (c >= 32 && c <= 126) ? c : '.');
-#endif
-        isValid |= reader.encode(c);
-        if (charsInBuf > sizeof(UBXscratch) - 10 || c == '\r') {
-            if (strnstr((char *)UBXscratch, "$GPTXT,01,01,02,u-blox ag - www.u-blox.com*50", charsInBuf)) {
-                rebootsSeen++;
+            debugmsg += vformat("%c", (c >= 32 && c <= 126) ? c : '.');
+#endif
+            // Collect whole sentences, bytes outside of one (e.g. UBX replies) are of no use to TinyGPS++
+            if (c == '$') {
+                nmeaSentenceLen = 0;
+            } else if (nmeaSentenceLen == 0) {
+                continue;
+            } else if (nmeaSentenceLen == sizeof(nmeaSentence)) {
+                nmeaSentenceLen = 0; // Too long to be one we want, drop it
+                continue;
             }
-            charsInBuf = 0;
-        } else {
-            charsInBuf++;
+            nmeaSentence[nmeaSentenceLen++] = c;
+            if (c == '\n')
+                isValid |= handleSentence();
         }
     }
 #ifdef GPS_DEBUG
@@ -1758,6 +1767,36 @@ bool GPS::whileActive()
 #endif
     return isValid;
 }
+
+bool GPS::handleSentence()
+{
+    const char *sentence = nmeaSentence;
+    const size_t len = nmeaSentenceLen;
+    nmeaSentenceLen = 0;
+
+    static const char ubloxBanner[] = "$GPTXT,01,01,02,u-blox ag - www.u-blox.com*50";
+    if (len > sizeof(ubloxBanner) - 1 && memcmp(sentence, ubloxBanner, sizeof(ubloxBanner) - 1) == 0) {
+        rebootsSeen++;
+        return false;
+    }
+
+    // TinyGPS++ only looks at GGA and RMC (and GSA for the custom fields) from any talker, don't make it parse the rest
+    if (len < 7 || sentence[6] != ',')
+        return false;
+    const char *type = sentence + 3;
+    bool wanted = strncmp(type, "GGA", 3) == 0 || strncmp(type, "RMC", 3) == 0;
+#ifndef TINYGPS_OPTION_NO_CUSTOM_FIELDS
+    wanted = wanted || strncmp(type, "GSA", 3) == 0;
+#endif
+    if (!wanted)
+        return false;
+
+    bool isValid = false;
+    for (size_t i = 0; i < len; i++)
+        isValid |= reader.encode(sentence[i]);
+    return isValid;
+}
+
 void GPS::enable()
 {
     // Clear the old scheduling info (reset the lock-time prediction)
@@ -201,6 +201,13 @@ class GPS : private concurrency::OSThread
     // scratch space for creating ublox packets
     uint8_t UBXscratch[250] = {0};
 
+    // NMEA sentence being received by whileActive(), it can span several calls. NMEA 0183 limits sentences to 82 chars.
+    char nmeaSentence[128];
+    size_t nmeaSentenceLen = 0;
+
+    /// Pass the sentence in nmeaSentence to TinyGPS++ if it is one we use, @return true if it completed a valid sentence
+    bool handleSentence();
+
     int rebootsSeen = 0;
 
     int getACK(uint8_t *buffer, uint16_t size, uint8_t requestedClass, uint8_t requestedID, uint32_t waitMillis);
@@ -424,6 +424,91 @@ float GeoCoord::bearing(double lat1, double lon1, double lat2, double lon2)
     return atan2(y, x);
 }
 
+// Latitude and longitude as integers: degrees * 1e7
+#define FAST_DEGREE 10000000
+
+// Beyond this difference in latitude or longitude, or this close to the poles, the fast path falls back to the exact one
+#define FAST_MAX_RANGE_DEGREES 1
+#define FAST_MAX_LATITUDE_DEGREES 80
+
+// cos() of each whole degree of latitude, scaled by 65535
+static const uint16_t cosTable[91] = {
+    65535, 65525, 65495, 65445, 65375, 65286, 65176, 65047, 64897, 64728, 64539, 64331, 64103, 63855, 63588, 63302,
+    62996, 62671, 62327, 61965, 61583, 61182, 60763, 60325, 59869, 59395, 58902, 58392, 57864, 57318, 56755, 56174,
+    55577, 54962, 54331, 53683, 53019, 52339, 51642, 50930, 50203, 49460, 48702, 47929, 47142, 46340, 45524, 44695,
+    43851, 42995, 42125, 41243, 40347, 39440, 38521, 37589, 36647, 35693, 34728, 33753, 32768, 31772, 30767, 29752,
+    28729, 27696, 26655, 25607, 24550, 23486, 22414, 21336, 20251, 19161, 18064, 16962, 15854, 14742, 13625, 12505,
+    11380, 10252, 9121,  7987,  6850,  5712,  4571,  3430,  2287,  1144,  0};
+
+/**
+ * Project point b onto a flat plane around point a (equirectangular, scaled by the cosine of the mean latitude).
+ * Only integer math: the cosine is interpolated from a table of whole degrees.
+ * @return false if the points are too far apart, or too close to a pole, for the approximation to hold
+ */
+static bool projectFast(int32_t lat_a, int32_t lng_a, int32_t lat_b, int32_t lng_b, int32_t &east, int32_t &north)
+{
+    int64_t dLat = (int64_t)lat_b - lat_a;
+    int64_t dLng = (int64_t)lng_b - lng_a;
+    if (dLng > 180LL * FAST_DEGREE) // Shorter across the antimeridian
+        dLng -= 360LL * FAST_DEGREE;
+    else if (dLng < -180LL * FAST_DEGREE)
+        dLng += 360LL * FAST_DEGREE;
+
+    int64_t meanLat = ((int64_t)lat_a + lat_b) / 2;
+    if (meanLat < 0)
+        meanLat = -meanLat;
+    if (dLat > FAST_MAX_RANGE_DEGREES * FAST_DEGREE || dLat < -FAST_MAX_RANGE_DEGREES * FAST_DEGREE ||
+        dLng > FAST_MAX_RANGE_DEGREES * FAST_DEGREE || dLng < -FAST_MAX_RANGE_DEGREES * FAST_DEGREE ||
+        meanLat > FAST_MAX_LATITUDE_DEGREES * FAST_DEGREE)
+        return false;
+
+    uint32_t degrees = meanLat / FAST_DEGREE;
+    uint32_t fraction = meanLat % FAST_DEGREE;
+    int64_t cosLat = cosTable[degrees] + ((int64_t)(cosTable[degrees + 1] - cosTable[degrees]) * fraction) / FAST_DEGREE;
+
+    east = (int32_t)(dLng * cosLat / 65535);
+    north = (int32_t)dLat;
+    return true;
+}
+
+/**
+ * Fast distance between two positions, for the short ranges of a mesh: no double precision math, and no trig.
+ *
+ * Positions less than 1 degree apart in both latitude and longitude, and not within 10 degrees of a pole, use an
+ * equirectangular approximation. Compared with the great circle distance, it is off by less than 0.02% (5 m at 111 km).
+ * Other positions fall back to latLongToMeter().
+ *
+ * @param lat_a, lng_a, lat_b, lng_b
+ * Positions in degrees * 1e7, as latitude_i / longitude_i
+ * @return distance in meters
+ */
+float GeoCoord::latLongToMeterFast(int32_t lat_a, int32_t lng_a, int32_t lat_b, int32_t lng_b)
+{
+    int32_t east, north;
+    if (!projectFast(lat_a, lng_a, lat_b, lng_b, east, north))
+        return latLongToMeter(lat_a * 1e-7, lng_a * 1e-7, lat_b * 1e-7, lng_b * 1e-7);
+
+    // Length of 1e-7 degrees along a great circle, at the radius used by latLongToMeter()
+    const float metersPerUnit = 6366000 * (float)PI / 180 / FAST_DEGREE;
+    return sqrtf((float)east * east + (float)north * north) * metersPerUnit;
+}
+
+/**
+ * Fast bearing between two positions, with the same approximation and range as latLongToMeterFast().
+ * Within that range, it is off from bearing() by less than 0.5 degrees, falling to under 0.06 degrees at 11 km.
+ *
+ * @param lat1, lon1, lat2, lon2
+ * Positions in degrees * 1e7, as latitude_i / longitude_i
+ * @return Bearing from the first position to the second, in radians
+ */
+float GeoCoord::bearingFast(int32_t lat1, int32_t lon1, int32_t lat2, int32_t lon2)
+{
+    int32_t east, north;
+    if (!projectFast(lat1, lon1, lat2, lon2, east, north))
+        return bearing(lat1 * 1e-7, lon1 * 1e-7, lat2 * 1e-7, lon2 * 1e-7);
+    return atan2f((float)east, (float)north);
+}
+
 /**
  * Ported from http://www.edwilliams.org/avform147.htm#Intro
  * @brief Convert from meters to range in radians on a great circle
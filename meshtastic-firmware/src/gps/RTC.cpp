@@ -1,4 +1,5 @@
 #include "RTC.h"
+#include "Clock.h"
 #include "configuration.h"
 #include "detect/ScanI2C.h"
 #include "main.h"
@@ -28,7 +29,7 @@ void readFromRTC()
     struct timeval tv; /* btw settimeofday() is helpful here too*/
 #ifdef RV3028_RTC
     if (rtc_found.address == RV3028_RTC) {
-        uint32_t now = millis();
+        uint32_t now = clockMillis();
         Melopero_RV3028 rtc;
 #if WIRE_INTERFACES_COUNT == 2
         rtc.initI2C(rtc_found.port == ScanI2C::I2CPort::WIRE1 ? Wire1 : Wire);
@@ -56,7 +57,7 @@ void readFromRTC()
     }
 #elif defined(PCF8563_RTC)
     if (rtc_found.address == PCF8563_RTC) {
-        uint32_t now = millis();
+        uint32_t now = clockMillis();
         PCF8563_Class rtc;
 
 #if WIRE_INTERFACES_COUNT == 2
@@ -87,7 +88,7 @@ void readFromRTC()
     }
 #else
     if (!gettimeofday(&tv, NULL)) {
-        uint32_t now = millis();
+        uint32_t now = clockMillis();
         uint32_t printableEpoch = tv.tv_sec; // Print lib only supports 32 bit but time_t can be 64 bit on some platforms
         LOG_DEBUG("Read RTC time as %ld", printableEpoch);
         timeStartMsec = now;
@@ -108,7 +109,7 @@ void readFromRTC()
 bool perhapsSetRTC(RTCQuality q, const struct timeval *tv, bool forceUpdate)
 {
     static uint32_t lastSetMsec = 0;
-    uint32_t now = millis();
+    uint32_t now = clockMillis();
     uint32_t printableEpoch = tv->tv_sec; // Print lib only supports 32 bit but time_t can be 64 bit on some platforms
 #ifdef BUILD_EPOCH
     if (tv->tv_sec < BUILD_EPOCH) {
@@ -128,7 +129,7 @@ bool perhapsSetRTC(RTCQuality q, const struct timeval *tv, bool forceUpdate)
     } else if (q == RTCQualityGPS) {
         shouldSet = true;
         LOG_DEBUG("Reapply GPS time: %ld secs", printableEpoch);
-    } else if (q == RTCQualityNTP && !Throttle::isWithinTimespanMs(lastSetMsec, (12 * 60 * 60 * 1000UL))) {
+    } else if (q == RTCQualityNTP && !Throttle::isWithinClockTimespanMs(lastSetMsec, (12 * 60 * 60 * 1000UL))) {
         // Every 12 hrs we will slam in a new NTP or Phone GPS / NTP time, to correct for local RTC clock drift
         shouldSet = true;
         LOG_DEBUG("Reapply external time to correct clock drift %ld secs", printableEpoch);
@@ -259,9 +260,9 @@ int32_t getTZOffset()
 uint32_t getTime(bool local)
 {
     if (local) {
-        return (((uint32_t)millis() - timeStartMsec) / 1000) + zeroOffsetSecs + getTZOffset();
+        return (((uint32_t)clockMillis() - timeStartMsec) / 1000) + zeroOffsetSecs + getTZOffset();
     } else {
-        return (((uint32_t)millis() - timeStartMsec) / 1000) + zeroOffsetSecs;
+        return (((uint32_t)clockMillis() - timeStartMsec) / 1000) + zeroOffsetSecs;
     }
 }
 
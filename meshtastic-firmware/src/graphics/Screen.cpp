@@ -43,6 +43,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "main.h"
 #include "mesh-pb-constants.h"
 #include "mesh/Channels.h"
+#include "mesh/NodePositionCache.h"
 #include "mesh/generated/meshtastic/deviceonly.pb.h"
 #include "meshUtils.h"
 #include "modules/AdminModule.h"
@@ -74,6 +75,11 @@ namespace graphics
 // This means the *visible* area (sh1106 can address 132, but shows 128 for example)
 #define IDLE_FRAMERATE 1 // in fps
 
+// A fixed frame nothing marked dirty is still redrawn this often, for what changes with time alone ("heard 2m ago")
+#ifndef SCREEN_MAX_UNCHANGED_MS
+#define SCREEN_MAX_UNCHANGED_MS 5000
+#endif
+
 // DEBUG
 #define NUM_EXTRA_FRAMES 3 // text message and debug frame
 // if defined a pixel will blink to show redraws
@@ -509,6 +515,7 @@ void Screen::drawDigitalClockFrame(OLEDDisplay *display, OLEDDisplayUiState *sta
         int hour = hms / SEC_PER_HOUR;
         int minute = (hms % SEC_PER_HOUR) / SEC_PER_MIN;
         int second = (hms % SEC_PER_HOUR) % SEC_PER_MIN; // or hms % SEC_PER_MIN
+        screen->setFrameShowsSeconds();
 
         hour = hour > 12 ? hour - 12 : hour;
 
@@ -776,6 +783,7 @@ void Screen::drawAnalogClockFrame(OLEDDisplay *display, OLEDDisplayUiState *stat
         int hour = hms / SEC_PER_HOUR;
         int minute = (hms % SEC_PER_HOUR) / SEC_PER_MIN;
         int second = (hms % SEC_PER_HOUR) % SEC_PER_MIN; // or hms % SEC_PER_MIN
+        screen->setFrameShowsSeconds();
 
         hour = hour > 12 ? hour - 12 : hour;
 
@@ -1475,15 +1483,12 @@ static void drawNodeInfo(OLEDDisplay *display, OLEDDisplayUiState *state, int16_
             myHeading = screen->estimatedHeading(DegD(op.latitude_i), DegD(op.longitude_i));
         screen->drawCompassNorth(display, compassX, compassY, myHeading);
 
-        if (nodeDB->hasValidPosition(node)) {
+        const NodePositionCache::Entry *cached = nodePositionCache.get(node);
+        if (cached && cached->hasRelative) {
             // display direction toward node
             hasNodeHeading = true;
-            const meshtastic_PositionLite &p = node->position;
-            float d =
-                GeoCoord::latLongToMeter(DegD(p.latitude_i), DegD(p.longitude_i), DegD(op.latitude_i), DegD(op.longitude_i));
-
-            float bearingToOther =
-                GeoCoord::bearing(DegD(op.latitude_i), DegD(op.longitude_i), DegD(p.latitude_i), DegD(p.longitude_i));
+            float d = cached->distanceMeters;
+            float bearingToOther = cached->bearing;
             // If the top of the compass is a static north then bearingToOther can be drawn on the compass directly
             // If the top of the compass is not a static north we need adjust bearingToOther based on heading
             if (!config.display.compass_north_top)
@@ -1955,9 +1960,22 @@ int32_t Screen::runOnce()
         return 0;
     }
 
+    if (nodeDB->updateGUIforNode || MeshModule::uiFramesChanged) {
+        nodeDB->updateGUIforNode = NULL;
+        MeshModule::uiFramesChanged = false;
+        frameDirty = true;
+    }
+
     // this must be before the frameState == FIXED check, because we always
-    // want to draw at least one FIXED frame before doing forceDisplay
-    ui->update();
+    // want to draw at least one FIXED frame before doing forceDisplay.
+    // Once idle on a fixed frame, only redraw it if it may look different, which also saves sending it to the display
+    if (targetFramerate != IDLE_FRAMERATE || ui->getUiState()->frameState != FIXED || frameDirty || frameShowsSeconds ||
+        !Throttle::isWithinTimespanMs(lastFrameDrawMs, SCREEN_MAX_UNCHANGED_MS)) {
+        frameDirty = false;
+        frameShowsSeconds = false; // The frame sets it again as it draws, if it still shows seconds
+        lastFrameDrawMs = millis();
+        ui->update();
+    }
 
     // Switch to a low framerate (to save CPU) when we are not in transition
     // but we should only call setTargetFPS when framestate changes, because
@@ -2374,8 +2392,10 @@ std::string Screen::drawTimeDelta(uint32_t days, uint32_t hours, uint32_t minute
         uptime = std::to_string(hours) + "h";
     else if (minutes >= 1)
         uptime = std::to_string(minutes) + "m";
-    else
+    else {
         uptime = std::to_string(seconds) + "s";
+        setFrameShowsSeconds();
+    }
     return uptime;
 }
 
@@ -2436,6 +2456,7 @@ void Screen::setFastFramerate()
 {
     // We are about to start a transition so speed up fps
     targetFramerate = SCREEN_TRANSITION_FRAMERATE;
+    frameDirty = true;
 
     ui->setTargetFPS(targetFramerate);
     setInterval(0); // redraw ASAP
@@ -2708,6 +2729,7 @@ void DebugInfo::drawFrameSettings(OLEDDisplay *display, OLEDDisplayUiState *stat
         int hour = hms / SEC_PER_HOUR;
         int min = (hms % SEC_PER_HOUR) / SEC_PER_MIN;
         int sec = (hms % SEC_PER_HOUR) % SEC_PER_MIN; // or hms % SEC_PER_MIN
+        screen->setFrameShowsSeconds();
 
         char timebuf[12];
 
@@ -2760,6 +2782,8 @@ void DebugInfo::drawFrameSettings(OLEDDisplay *display, OLEDDisplayUiState *stat
 int Screen::handleStatusUpdate(const meshtastic::Status *arg)
 {
     // LOG_DEBUG("Screen got status update %d", arg->getStatusType());
+    frameDirty = true; // The battery, GPS and node count shown on most frames
+
     switch (arg->getStatusType()) {
     case STATUS_TYPE_NODE:
         if (showingNormalScreen && nodeStatus->getLastNumTotal() != nodeStatus->getNumTotal()) {
@@ -271,10 +271,15 @@ class Screen : public concurrency::OSThread
     // Mutex needed?
     void setHeading(long _heading)
     {
+        if (!hasCompass || (long)compassHeading != _heading)
+            frameDirty = true;
         hasCompass = true;
         compassHeading = _heading;
     }
 
+    /// Called while drawing a frame that shows the time to the second, so it keeps being redrawn every second
+    void setFrameShowsSeconds() { frameShowsSeconds = true; }
+
     bool hasHeading() { return hasCompass; }
 
     long getHeading() { return compassHeading; }
@@ -582,6 +587,7 @@ class Screen : public concurrency::OSThread
         else {
             bool success = cmdQueue.enqueue(cmd, 0);
             enabled = true; // handle ASAP (we are the registered reader for cmdQueue, but might have been disabled)
+            notifyScheduleChanged();
             return success;
         }
     }
@@ -679,6 +685,12 @@ class Screen : public concurrency::OSThread
     float compassHeading;
     uint32_t endCalibrationAt;
 
+    // A fixed frame is only redrawn when something it shows changed (frameDirty), when it shows seconds, or when it is
+    // SCREEN_MAX_UNCHANGED_MS old. Until then runOnce() skips both drawing it and sending it to the display
+    bool frameDirty = true;
+    bool frameShowsSeconds = false; // Cleared before each draw, and set again by the frame as it draws if it shows seconds
+    uint32_t lastFrameDrawMs = 0;
+
     /// Holds state for debug information
     DebugInfo debugInfo;
 
@@ -1007,28 +1007,33 @@ void TFTDisplay::display(bool fromBlank)
     // tft->clear();
     concurrency::LockGuard g(spiLock);
 
-    uint16_t x, y;
-
-    for (y = 0; y < displayHeight; y++) {
-        for (x = 0; x < displayWidth; x++) {
-            auto isset = buffer[x + (y / 8) * displayWidth] & (1 << (y & 7));
-            if (!fromBlank) {
-                // get src pixel in the page based ordering the OLED lib uses FIXME, super inefficent
-                auto dblbuf_isset = buffer_back[x + (y / 8) * displayWidth] & (1 << (y & 7));
-                if (isset != dblbuf_isset) {
-                    tft->drawPixel(x, y, isset ? TFT_MESH : TFT_BLACK);
+    // Compare by page, the 8 rows of pixels each byte of the buffer holds, and skip the pages that haven't changed since
+    // we last sent them. In the rest, draw each run of changed pixels of one color along a row as a single line
+    for (uint16_t page = 0; page < displayHeight / 8; page++) {
+        const uint8_t *now = buffer + page * displayWidth;
+        uint8_t *sent = buffer_back + page * displayWidth;
+        if (!fromBlank && memcmp(now, sent, displayWidth) == 0)
+            continue;
+
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            const uint8_t mask = 1 << bit;
+            const uint16_t y = page * 8 + bit;
+            // From blank, only the set pixels need drawing
+            auto changed = [&](uint16_t x) { return (now[x] ^ (fromBlank ? 0 : sent[x])) & mask; };
+            for (uint16_t x = 0; x < displayWidth;) {
+                if (!changed(x)) {
+                    x++;
+                    continue;
                 }
-            } else if (isset) {
-                tft->drawPixel(x, y, TFT_MESH);
+                const uint8_t isset = now[x] & mask;
+                uint16_t end = x + 1;
+                while (end < displayWidth && changed(end) && (now[end] & mask) == isset)
+                    end++;
+                tft->drawFastHLine(x, y, end - x, isset ? TFT_MESH : TFT_BLACK);
+                x = end;
             }
         }
-    }
-    // Copy the Buffer to the Back Buffer
-    for (y = 0; y < (displayHeight / 8); y++) {
-        for (x = 0; x < displayWidth; x++) {
-            uint16_t pos = x + y * displayWidth;
-            buffer_back[pos] = buffer[pos];
-        }
+        memcpy(sent, now, displayWidth);
     }
 }
 
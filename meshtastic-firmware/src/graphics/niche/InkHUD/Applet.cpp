@@ -25,7 +25,7 @@ InkHUD::Applet::Applet() : GFX(0, 0)
 }
 
 // Draw a single pixel
-// The raw pixel output generated by AdafruitGFX drawing all passes through here
+// Pixel output generated by AdafruitGFX drawing passes through here, except for spans and filled rects (see fillRect)
 // Hand off to the applet's tile, which will in-turn pass to the renderer
 void InkHUD::Applet::drawPixel(int16_t x, int16_t y, uint16_t color)
 {
@@ -34,6 +34,115 @@ void InkHUD::Applet::drawPixel(int16_t x, int16_t y, uint16_t color)
         assignedTile->handleAppletPixel(x, y, (Color)color);
 }
 
+// Draw a horizontal line
+// AdafruitGFX would draw this pixel by pixel. We hand it to fillRect instead
+void InkHUD::Applet::drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color)
+{
+    fillRect(x, y, w, 1, color);
+}
+
+// Draw a vertical line
+// AdafruitGFX would draw this pixel by pixel. We hand it to fillRect instead
+void InkHUD::Applet::drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color)
+{
+    fillRect(x, y, 1, h, color);
+}
+
+// Draw a filled rectangle
+// Most AdafruitGFX primitives (lines, rects, rounded rects, fillScreen, large text) end up here
+// The rectangle is cropped once, then passed through the tile to the renderer as a whole,
+// where it is written into the image buffer a byte (8px) at a time
+void InkHUD::Applet::fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color)
+{
+    // A negative size extends the rectangle left / up from x,y
+    if (w < 0) {
+        x += w + 1;
+        w = -w;
+    }
+    if (h < 0) {
+        y += h + 1;
+        h = -h;
+    }
+
+    // Crop to the user's region
+    int32_t left = max((int32_t)x, (int32_t)cropLeft);
+    int32_t top = max((int32_t)y, (int32_t)cropTop);
+    int32_t right = min((int32_t)x + w, (int32_t)cropLeft + cropWidth);
+    int32_t bottom = min((int32_t)y + h, (int32_t)cropTop + cropHeight);
+    if (right <= left || bottom <= top)
+        return;
+
+    assignedTile->handleAppletRect(left, top, right - left, bottom - top, (Color)color);
+}
+
+// Print a single character, at the cursor
+// Behaves as AdafruitGFX's write(), but for GFXfonts we draw the glyph ourselves, rather than pixel by pixel
+// The built-in font is left to AdafruitGFX
+size_t InkHUD::Applet::write(uint8_t c)
+{
+    if (!gfxFont)
+        return GFX::write(c);
+
+    if (c == '\n') {
+        cursor_x = 0;
+        cursor_y += (int16_t)textsize_y * gfxFont->yAdvance;
+        return 1;
+    }
+    if (c == '\r' || c < gfxFont->first || c > gfxFont->last)
+        return 1;
+
+    const GFXglyph *glyph = &gfxFont->glyph[c - gfxFont->first];
+    if (glyph->width > 0 && glyph->height > 0) {
+        // Wrap before the glyph, if it would run off the right edge
+        if (wrap && (cursor_x + textsize_x * (glyph->xOffset + glyph->width)) > _width) {
+            cursor_x = 0;
+            cursor_y += (int16_t)textsize_y * gfxFont->yAdvance;
+        }
+        drawGlyph(cursor_x, cursor_y, glyph, textcolor);
+    }
+    cursor_x += glyph->xAdvance * (int16_t)textsize_x;
+    return 1;
+}
+
+// Draw the bitmap of a GFXfont glyph, for a character placed with its cursor at x,y
+// Each horizontal run of set pixels is drawn with one fillRect call
+void InkHUD::Applet::drawGlyph(int16_t x, int16_t y, const GFXglyph *glyph, uint16_t color)
+{
+    const int16_t left = x + glyph->xOffset * textsize_x;
+    const int16_t top = y + glyph->yOffset * textsize_y;
+
+    // Whole glyph is outside the crop region
+    // This is the case for every glyph, when printWrapped is only measuring text
+    if (left >= cropLeft + cropWidth || top >= cropTop + cropHeight || left + glyph->width * textsize_x <= cropLeft ||
+        top + glyph->height * textsize_y <= cropTop)
+        return;
+
+    // Bitmap is packed MSB first, with rows running on from one byte into the next
+    const uint8_t *bitmap = gfxFont->bitmap + glyph->bitmapOffset;
+    uint8_t bits = 0;
+    uint16_t bit = 0;
+    for (uint8_t yy = 0; yy < glyph->height; yy++) {
+        int16_t runStart = -1;
+        for (uint8_t xx = 0; xx < glyph->width; xx++) {
+            if (!(bit++ & 7))
+                bits = *bitmap++;
+            bool set = bits & 0x80;
+            bits <<= 1;
+
+            if (set && runStart < 0)
+                runStart = xx;
+            else if (!set && runStart >= 0) {
+                fillRect(left + runStart * textsize_x, top + yy * textsize_y, (xx - runStart) * textsize_x, textsize_y, color);
+                runStart = -1;
+            }
+        }
+        // Run continues to the right edge of the glyph
+        if (runStart >= 0)
+            fillRect(left + runStart * textsize_x, top + yy * textsize_y, (glyph->width - runStart) * textsize_x, textsize_y,
+                     color);
+    }
+}
+
 // Link our applet to a tile
 // This can only be called by Tile::assignApplet
 // The tile determines the applets dimensions
@@ -533,36 +642,23 @@ uint32_t InkHUD::Applet::getWrappedTextHeight(int16_t left, uint16_t width, std:
 }
 
 // Fill a region with sparse diagonal lines, to create a pseudo-translucent fill
+// Lines are clipped to the region before drawing, so their pixels can go straight to the tile, skipping the crop check.
+// As before, pixels are limited to the region only, regardless of any crop set by the applet
 void InkHUD::Applet::hatchRegion(int16_t x, int16_t y, uint16_t w, uint16_t h, uint8_t spacing, Color color)
 {
-    // Cache the currently cropped region
-    int16_t oldCropL = cropLeft;
-    int16_t oldCropT = cropTop;
-    uint16_t oldCropW = cropWidth;
-    uint16_t oldCropH = cropHeight;
-
-    setCrop(x, y, w, h);
-
     // Draw lines starting along the top edge, every few px
     for (int16_t ix = x; ix < x + w; ix += spacing) {
-        for (int16_t i = 0; i < w || i < h; i++) {
-            drawPixel(ix + i, y + i, color);
-        }
+        int16_t length = min(x + w - ix, (int)h); // Until the line leaves the right or bottom edge
+        for (int16_t i = 0; i < length; i++)
+            assignedTile->handleAppletPixel(ix + i, y + i, color);
     }
 
     // Draw lines starting along the left edge, every few px
     for (int16_t iy = y; iy < y + h; iy += spacing) {
-        for (int16_t i = 0; i < w || i < h; i++) {
-            drawPixel(x + i, iy + i, color);
-        }
+        int16_t length = min((int)w, y + h - iy);
+        for (int16_t i = 0; i < length; i++)
+            assignedTile->handleAppletPixel(x + i, iy + i, color);
     }
-
-    // Restore any previous crop
-    // If none was set, this will clear
-    cropLeft = oldCropL;
-    cropTop = oldCropT;
-    cropWidth = oldCropW;
-    cropHeight = oldCropH;
 }
 
 // Get a human readable time representation of an epoch time (seconds since 1970)
@@ -100,7 +100,12 @@ class Applet : public GFX
     const char *name = nullptr; // Shown in applet selection menu. Also used as an identifier by InkHUD::getSystemApplet
 
   protected:
-    void drawPixel(int16_t x, int16_t y, uint16_t color) override; // Place a single pixel. All drawing output passes through here
+    using GFX::write;
+    void drawPixel(int16_t x, int16_t y, uint16_t color) override;                      // Place a single pixel
+    void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) override;       // Horizontal span, as a fillRect
+    void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) override;       // Vertical span, as a fillRect
+    void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) override; // Cropped once, then whole bytes
+    size_t write(uint8_t c) override;                                                   // Print a char, glyph rows as spans
 
     void requestUpdate(EInk::UpdateTypes type = EInk::UpdateTypes::UNSPECIFIED); // Ask WindowManager to schedule a display update
     void requestAutoshow();                                                      // Ask for applet to be moved to foreground
@@ -164,6 +169,8 @@ class Applet : public GFX
 
     AppletFont currentFont; // As passed to setFont
 
+    void drawGlyph(int16_t x, int16_t y, const GFXglyph *glyph, uint16_t color); // Bitmap of a GFXfont glyph, at the cursor
+
     // As set by setCrop
     int16_t cropLeft = 0;
     int16_t cropTop = 0;
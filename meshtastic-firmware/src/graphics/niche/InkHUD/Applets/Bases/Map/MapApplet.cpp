@@ -90,20 +90,15 @@ void InkHUD::MapApplet::getMapCenter(float *lat, float *lng)
         if (!shouldDrawNode(node))
             continue;
 
-        // Latitude and Longitude of node, in radians
-        float latRad = node->position.latitude_i * (1e-7) * DEG_TO_RAD;
-        float lngRad = node->position.longitude_i * (1e-7) * DEG_TO_RAD;
-
-        // Convert to cartesian points, with center of earth at 0, 0, 0
+        // Position as cartesian points, with center of earth at 0, 0, 0
         // Exact distance from center is irrelevant, as we're only interested in the vector
-        float x = cos(latRad) * cos(lngRad);
-        float y = cos(latRad) * sin(lngRad);
-        float z = sin(latRad);
+        // Cached between renders, recomputed only when the node's position changes
+        const NodePositionCache::Entry *e = nodePositionCache.get(node);
 
         // To find mean values shortly
-        xAvg += x;
-        yAvg += y;
-        zAvg += z;
+        xAvg += e->x;
+        yAvg += e->y;
+        zAvg += e->z;
         positionCount++;
     }
 
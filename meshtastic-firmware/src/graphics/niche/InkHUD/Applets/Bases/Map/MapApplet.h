@@ -20,6 +20,7 @@ The base applet doesn't handle any events; this is left to the derived applets.
 
 #include "MeshModule.h"
 #include "gps/GeoCoord.h"
+#include "mesh/NodePositionCache.h"
 
 namespace NicheGraphics::InkHUD
 {
@@ -2,8 +2,8 @@
 
 #include "RTC.h"
 
-#include "GeoCoord.h"
 #include "NodeDB.h"
+#include "NodePositionCache.h"
 
 #include "./NodeListApplet.h"
 
@@ -51,21 +51,14 @@ ProcessMessage InkHUD::NodeListApplet::handleReceived(const meshtastic_MeshPacke
 
     // Assemble info: from nodeDB (needed to detect changes)
     meshtastic_NodeInfoLite *node = nodeDB->getMeshNode(c.nodeNum);
-    meshtastic_NodeInfoLite *ourNode = nodeDB->getMeshNode(nodeDB->getNodeNum());
     if (node) {
         if (node->has_hops_away)
             c.hopsAway = node->hops_away;
 
-        if (nodeDB->hasValidPosition(node) && nodeDB->hasValidPosition(ourNode)) {
-            // Get lat and long as float
-            // Meshtastic stores these as integers internally
-            float ourLat = ourNode->position.latitude_i * 1e-7;
-            float ourLong = ourNode->position.longitude_i * 1e-7;
-            float theirLat = node->position.latitude_i * 1e-7;
-            float theirLong = node->position.longitude_i * 1e-7;
-
-            c.distanceMeters = (int32_t)GeoCoord::latLongToMeter(theirLat, theirLong, ourLat, ourLong);
-        }
+        // Distance from our own position, if both known
+        const NodePositionCache::Entry *cached = nodePositionCache.get(node);
+        if (cached && cached->hasRelative)
+            c.distanceMeters = (int32_t)cached->distanceMeters;
     }
 
     // Pass to the derived applet
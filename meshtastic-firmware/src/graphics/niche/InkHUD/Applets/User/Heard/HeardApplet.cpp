@@ -2,7 +2,7 @@
 
 #include "RTC.h"
 
-#include "gps/GeoCoord.h"
+#include "mesh/NodePositionCache.h"
 
 #include "./HeardApplet.h"
 
@@ -79,7 +79,6 @@ void InkHUD::HeardApplet::populateFromNodeDB()
         ordered.resize(maxCards());
 
     // Create card info for these (stale) node observations
-    meshtastic_NodeInfoLite *ourNode = nodeDB->getMeshNode(nodeDB->getNodeNum());
     for (meshtastic_NodeInfoLite *node : ordered) {
         CardInfo c;
         c.nodeNum = node->num;
@@ -87,16 +86,10 @@ void InkHUD::HeardApplet::populateFromNodeDB()
         if (node->has_hops_away)
             c.hopsAway = node->hops_away;
 
-        if (nodeDB->hasValidPosition(node) && nodeDB->hasValidPosition(ourNode)) {
-            // Get lat and long as float
-            // Meshtastic stores these as integers internally
-            float ourLat = ourNode->position.latitude_i * 1e-7;
-            float ourLong = ourNode->position.longitude_i * 1e-7;
-            float theirLat = node->position.latitude_i * 1e-7;
-            float theirLong = node->position.longitude_i * 1e-7;
-
-            c.distanceMeters = (int32_t)GeoCoord::latLongToMeter(theirLat, theirLong, ourLat, ourLong);
-        }
+        // Distance from our own position, if both known
+        const NodePositionCache::Entry *cached = nodePositionCache.get(node);
+        if (cached && cached->hasRelative)
+            c.distanceMeters = (int32_t)cached->distanceMeters;
 
         // Insert into the card collection (member of base class)
         cards.push_back(c);
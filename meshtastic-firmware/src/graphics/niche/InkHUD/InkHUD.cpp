@@ -215,4 +215,10 @@ void InkHUD::InkHUD::drawPixel(int16_t x, int16_t y, Color c)
     renderer->handlePixel(x, y, c);
 }
 
+// Pass a filled rectangle (already cropped to its tile) to the renderer
+void InkHUD::InkHUD::fillRect(int16_t x, int16_t y, uint16_t w, uint16_t h, Color c)
+{
+    renderer->handleRect(x, y, w, h, c);
+}
+
 #endif
\ No newline at end of file
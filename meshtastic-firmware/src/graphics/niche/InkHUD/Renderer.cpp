@@ -121,6 +121,49 @@ void InkHUD::Renderer::handlePixel(int16_t x, int16_t y, Color c)
     bitWrite(imageBuffer[byteNum], bitNum, c);
 }
 
+// Fill a rectangle in the image buffer
+// Same coordinates as handlePixel, but the rectangle is rotated as a whole,
+// then written a row at a time: whole bytes in the middle, masked bytes at either end
+void InkHUD::Renderer::handleRect(int16_t x, int16_t y, uint16_t w, uint16_t h, Color c)
+{
+    // Crop to the display
+    int32_t x0 = max((int32_t)x, (int32_t)0);
+    int32_t y0 = max((int32_t)y, (int32_t)0);
+    int32_t x1 = min((int32_t)x + w, (int32_t)width()); // Exclusive
+    int32_t y1 = min((int32_t)y + h, (int32_t)height());
+    if (x1 <= x0 || y1 <= y0)
+        return;
+
+    // Apply the system-wide rotation, as rotatePixelCoords does for pixels
+    // Opposite corners are rotated, then re-ordered
+    int16_t ax = x0, ay = y0;
+    int16_t bx = x1 - 1, by = y1 - 1;
+    rotatePixelCoords(&ax, &ay);
+    rotatePixelCoords(&bx, &by);
+    uint16_t left = min(ax, bx);
+    uint16_t right = max(ax, bx); // Inclusive
+    uint16_t top = min(ay, by);
+    uint16_t bottom = max(ay, by);
+
+    // Leftmost pixel is the most significant bit of its byte
+    uint16_t firstByte = left / 8;
+    uint16_t lastByte = right / 8;
+    uint8_t firstMask = 0xFF >> (left % 8);
+    uint8_t lastMask = 0xFF << (7 - (right % 8));
+    if (firstByte == lastByte)
+        firstMask = lastMask = firstMask & lastMask;
+    uint8_t fill = c ? 0xFF : 0x00;
+
+    for (uint16_t row = top; row <= bottom; row++) {
+        uint8_t *line = imageBuffer + (row * imageBufferWidth);
+        line[firstByte] = (line[firstByte] & ~firstMask) | (fill & firstMask);
+        if (lastByte > firstByte) {
+            memset(line + firstByte + 1, fill, lastByte - firstByte - 1);
+            line[lastByte] = (line[lastByte] & ~lastMask) | (fill & lastMask);
+        }
+    }
+}
+
 // Width of the display, relative to rotation
 uint16_t InkHUD::Renderer::width()
 {
@@ -190,6 +190,27 @@ void InkHUD::Tile::handleAppletPixel(int16_t x, int16_t y, Color c)
     }
 }
 
+// Receive a filled rectangle from the assigned applet, already cropped by the applet
+// Translated and cropped to the tile borders once, instead of for each of its pixels
+void InkHUD::Tile::handleAppletRect(int16_t x, int16_t y, uint16_t w, uint16_t h, Color c)
+{
+    // Move from applet-space to tile-space
+    int32_t x0 = x + left;
+    int32_t y0 = y + top;
+    int32_t x1 = x0 + w; // Exclusive
+    int32_t y1 = y0 + h;
+
+    // Crop to tile borders
+    x0 = max(x0, (int32_t)left);
+    y0 = max(y0, (int32_t)top);
+    x1 = min(x1, (int32_t)left + width);
+    y1 = min(y1, (int32_t)top + height);
+
+    // Pass to the renderer
+    if (x1 > x0 && y1 > y0)
+        inkhud->fillRect(x0, y0, x1 - x0, y1 - y0, c);
+}
+
 // Called by Applet base class, when setting applet dimensions, immediately before render
 uint16_t InkHUD::Tile::getWidth()
 {
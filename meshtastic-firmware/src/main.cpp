@@ -8,6 +8,7 @@
 #include "PowerFSM.h"
 #include "PowerMon.h"
 #include "ReliableRouter.h"
+#include "SaveScheduler.h"
 #include "airtime.h"
 #include "buzz.h"
 
@@ -18,6 +19,7 @@
 #include "Throttle.h"
 #include "concurrency/OSThread.h"
 #include "concurrency/Periodic.h"
+#include "concurrency/ThreadStatsReporter.h"
 #include "detect/ScanI2C.h"
 #include "error.h"
 #include "power.h"
@@ -766,6 +768,7 @@ void setup()
     // We do this as early as possible because this loads preferences from flash
     // but we need to do this after main cpu init (esp32setup), because we need the random seed set
     nodeDB = new NodeDB;
+    saveScheduler = new SaveScheduler();
 
     // If we're taking on the repeater role, use NextHopRouter and turn off 3V3_S rail because peripherals are not needed
     if (config.device.role == meshtastic_Config_DeviceConfig_Role_REPEATER) {
@@ -1279,6 +1282,10 @@ void setup()
         RECORD_CRITICALERROR(meshtastic_CriticalErrorCode_NO_RADIO);
     else {
         router->addInterface(rIf);
+#if RADIO_TASK
+        if (RadioLibInterface::instance)
+            RadioLibInterface::instance->startTask();
+#endif
 
         // Log bit rate to debug output
         LOG_DEBUG("LoRA bitrate = %f bytes / sec", (float(meshtastic_Constants_DATA_PAYLOAD_LEN) /
@@ -1290,6 +1297,10 @@ void setup()
     PowerFSM_setup(); // we will transition to ON in a couple of seconds, FIXME, only do this for cold boots, not waking from SDS
     powerFSMthread = new PowerFSMThread();
 
+#if THREAD_STATS_INTERVAL_MS > 0
+    new concurrency::ThreadStatsReporter();
+#endif
+
 #if !HAS_TFT
     setCPUFast(false); // 80MHz is fine for our slow peripherals
 #endif
@@ -1298,6 +1309,11 @@ void setup()
     LOG_DEBUG("Free heap  : %7d bytes", ESP.getFreeHeap());
     LOG_DEBUG("Free PSRAM : %7d bytes", ESP.getFreePsram());
 #endif
+
+#ifdef DEBUG_PORT
+    // Boot is done, from here on log messages are queued and written by the console thread
+    DEBUG_PORT.startLogRing();
+#endif
 }
 
 #endif
@@ -1405,7 +1421,7 @@ void loop()
 
     service->loop();
 
-    long delayMsec = mainController.runOrDelay();
+    long delayMsec = mainScheduler.runOrDelay();
 
     // We want to sleep as long as possible here - because it saves power
     if (!runASAP && loopCanSleep()) {
@@ -27,8 +27,7 @@ bool FloodingRouter::shouldFilterReceived(const meshtastic_MeshPacket *p)
 
         /* If the original transmitter is doing retransmissions (hopStart equals hopLimit) for a reliable transmission, e.g., when
         the ACK got lost, we will handle the packet again to make sure it gets an implicit ACK. */
-        bool isRepeated = p->hop_start > 0 && p->hop_start == p->hop_limit;
-        if (isRepeated) {
+        if (getDupeAction(p) == DUPE_RELAY) {
             LOG_DEBUG("Repeated reliable tx");
             // Check if it's still in the Tx queue, if not, we have to relay it again
             if (!findInTxQueue(p->from, p->id))
@@ -45,9 +44,7 @@ bool FloodingRouter::shouldFilterReceived(const meshtastic_MeshPacket *p)
 
 void FloodingRouter::perhapsCancelDupe(const meshtastic_MeshPacket *p)
 {
-    if (config.device.role != meshtastic_Config_DeviceConfig_Role_ROUTER &&
-        config.device.role != meshtastic_Config_DeviceConfig_Role_REPEATER &&
-        config.device.role != meshtastic_Config_DeviceConfig_Role_ROUTER_LATE) {
+    if (cancelsDupes(config.device.role)) {
         // cancel rebroadcast of this message *if* there was already one, unless we're a router/repeater!
         if (Router::cancelSending(p->from, p->id))
             txRelayCanceled++;
@@ -57,15 +54,32 @@ void FloodingRouter::perhapsCancelDupe(const meshtastic_MeshPacket *p)
     }
 }
 
+bool FloodingRouter::cancelsDupes(meshtastic_Config_DeviceConfig_Role role)
+{
+    return role != meshtastic_Config_DeviceConfig_Role_ROUTER && role != meshtastic_Config_DeviceConfig_Role_REPEATER &&
+           role != meshtastic_Config_DeviceConfig_Role_ROUTER_LATE;
+}
+
 bool FloodingRouter::isRebroadcaster()
 {
-    return config.device.role != meshtastic_Config_DeviceConfig_Role_CLIENT_MUTE &&
-           config.device.rebroadcast_mode != meshtastic_Config_DeviceConfig_RebroadcastMode_NONE;
+    return isRebroadcaster(config.device.role, config.device.rebroadcast_mode);
+}
+
+bool FloodingRouter::isRebroadcaster(meshtastic_Config_DeviceConfig_Role role,
+                                     meshtastic_Config_DeviceConfig_RebroadcastMode mode)
+{
+    return role != meshtastic_Config_DeviceConfig_Role_CLIENT_MUTE && mode != meshtastic_Config_DeviceConfig_RebroadcastMode_NONE;
+}
+
+bool FloodingRouter::shouldRebroadcast(const meshtastic_MeshPacket *p, NodeNum ourNodeNum)
+{
+    // Like !isToUs(p) && !isFromUs(p), for any node
+    return p->to != ourNodeNum && p->from != 0 && p->from != ourNodeNum && p->hop_limit > 0;
 }
 
 void FloodingRouter::perhapsRebroadcast(const meshtastic_MeshPacket *p)
 {
-    if (!isToUs(p) && (p->hop_limit > 0) && !isFromUs(p)) {
+    if (shouldRebroadcast(p, getNodeNum())) {
         if (p->id != 0) {
             if (isRebroadcaster()) {
                 meshtastic_MeshPacket *tosend = packetPool.allocCopy(*p); // keep a copy because we will be sending it
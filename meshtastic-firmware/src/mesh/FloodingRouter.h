@@ -45,6 +45,30 @@ class FloodingRouter : public Router
      */
     virtual ErrorCode send(meshtastic_MeshPacket *p) override;
 
+    /// What to do about a packet we have already seen
+    enum DupeAction {
+        DUPE_IGNORE,
+        DUPE_RELAY,        // Relay it again, unless it is still in the TX queue
+        DUPE_RELAY_OR_ACK, // Relay it again unless it is still queued, or if we don't and it is for us, ACK it again
+        DUPE_CANCEL_RELAY  // Someone else relayed it, so we needn't
+    };
+
+    // The decisions below are static, so the mesh simulator makes them the same way
+
+    /// The original sender is retransmitting it, e.g. because the ACK got lost
+    static bool isRepeated(const meshtastic_MeshPacket *p) { return p->hop_start > 0 && p->hop_start == p->hop_limit; }
+
+    /// What to do about a duplicate of p
+    static DupeAction getDupeAction(const meshtastic_MeshPacket *p) { return isRepeated(p) ? DUPE_RELAY : DUPE_CANCEL_RELAY; }
+
+    /// Whether node ourNodeNum would rebroadcast p, if its role lets it
+    static bool shouldRebroadcast(const meshtastic_MeshPacket *p, NodeNum ourNodeNum);
+
+    /// Whether a node with this role cancels its relay of a packet someone else relayed, routers always relay
+    static bool cancelsDupes(meshtastic_Config_DeviceConfig_Role role);
+
+    static bool isRebroadcaster(meshtastic_Config_DeviceConfig_Role role, meshtastic_Config_DeviceConfig_RebroadcastMode mode);
+
   protected:
     /**
      * Should this incoming filter be dropped?
@@ -11,6 +11,9 @@ std::vector<MeshModule *> *MeshModule::modules;
 
 const meshtastic_MeshPacket *MeshModule::currentRequest;
 uint8_t MeshModule::numPeriodicModules = 0;
+#if HAS_SCREEN
+bool MeshModule::uiFramesChanged;
+#endif
 
 /**
  * If any of the current chain of modules has already sent a reply, it will be here.  This is useful to allow
@@ -145,6 +148,10 @@ void MeshModule::callModules(meshtastic_MeshPacket &mp, RxSource src)
                 ProcessMessage handled = pi.handleReceived(mp);
 
                 pi.alterReceived(mp);
+#if HAS_SCREEN
+                if (pi.wantUIFrame())
+                    uiFramesChanged = true;
+#endif
 
                 // Possibly send replies (but only if the message was directed to us specifically, i.e. not for promiscious
                 // sniffing) also: we only let the one module send a reply, once that happens, remaining modules are not
@@ -81,6 +81,9 @@ class MeshModule
                                                                     meshtastic_AdminMessage *request,
                                                                     meshtastic_AdminMessage *response);
 #if HAS_SCREEN
+    /// Set when a module with a UI frame has handled a packet, so what it shows may have changed. Screen clears it
+    static bool uiFramesChanged;
+
     virtual void drawFrame(OLEDDisplay *display, OLEDDisplayUiState *state, int16_t x, int16_t y) { return; }
     virtual bool isRequestingFocus();                          // Checked by screen, when regenerating frameset
     virtual bool interceptingKeyboardInput() { return false; } // Can screen use keyboard for nav, or is module handling input?
@@ -133,7 +133,7 @@ void MeshService::reloadConfig(int saveWhat)
     nodeDB->resetRadioConfig(); // Don't let the phone send us fatally bad settings
 
     configChanged.notifyObservers(NULL); // This will cause radio hardware to change freqs etc
-    nodeDB->saveToDisk(saveWhat);
+    nodeDB->saveToDiskSoon(saveWhat);
 }
 
 /// The owner User record just got updated, update our node DB and broadcast the info into the mesh
@@ -1,4 +1,5 @@
 #include "NextHopRouter.h"
+#include "Clock.h"
 
 NextHopRouter::NextHopRouter() {}
 
@@ -20,9 +21,7 @@ ErrorCode NextHopRouter::send(meshtastic_MeshPacket *p)
     p->next_hop = getNextHop(p->to, p->relay_node); // set the next hop
     LOG_DEBUG("Setting next hop for packet with dest %x to %x", p->to, p->next_hop);
 
-    // If it's from us, ReliableRouter already handles retransmissions if want_ack is set. If a next hop is set and hop limit is
-    // not 0 or want_ack is set, start retransmissions
-    if ((!isFromUs(p) || !p->want_ack) && p->next_hop != NO_NEXT_HOP_PREFERENCE && (p->hop_limit > 0 || p->want_ack))
+    if (needsRetransmission(p, isFromUs(p)))
         startRetransmission(packetPool.allocCopy(*p)); // start retransmission for relayed packet
 
     return Router::send(p);
@@ -37,21 +36,22 @@ bool NextHopRouter::shouldFilterReceived(const meshtastic_MeshPacket *p)
         rxDupe++;
         stopRetransmission(p->from, p->id);
 
-        // If it was a fallback to flooding, try to relay again
-        if (wasFallback) {
+        switch (getDupeAction(p, wasFallback, weWereNextHop)) {
+        case DUPE_RELAY:
             LOG_INFO("Fallback to flooding from relay_node=0x%x", p->relay_node);
             // Check if it's still in the Tx queue, if not, we have to relay it again
             if (!findInTxQueue(p->from, p->id))
                 perhapsRelay(p);
-        } else {
-            bool isRepeated = p->hop_start > 0 && p->hop_start == p->hop_limit;
-            // If repeated and not in Tx queue anymore, try relaying again, or if we are the destination, send the ACK again
-            if (isRepeated) {
-                if (!findInTxQueue(p->from, p->id) && !perhapsRelay(p) && isToUs(p) && p->want_ack)
-                    sendAckNak(meshtastic_Routing_Error_NONE, getFrom(p), p->id, p->channel, 0);
-            } else if (!weWereNextHop) {
-                perhapsCancelDupe(p); // If it's a dupe, cancel relay if we were not explicitly asked to relay
-            }
+            break;
+        case DUPE_RELAY_OR_ACK:
+            if (!findInTxQueue(p->from, p->id) && !perhapsRelay(p) && isToUs(p) && p->want_ack)
+                sendAckNak(meshtastic_Routing_Error_NONE, getFrom(p), p->id, p->channel, 0);
+            break;
+        case DUPE_CANCEL_RELAY:
+            perhapsCancelDupe(p);
+            break;
+        case DUPE_IGNORE:
+            break;
         }
         return true;
     }
@@ -59,6 +59,18 @@ bool NextHopRouter::shouldFilterReceived(const meshtastic_MeshPacket *p)
     return Router::shouldFilterReceived(p);
 }
 
+NextHopRouter::DupeAction NextHopRouter::getDupeAction(const meshtastic_MeshPacket *p, bool wasFallback, bool weWereNextHop)
+{
+    // If it was a fallback to flooding, try to relay again
+    if (wasFallback)
+        return DUPE_RELAY;
+    // If repeated and not in Tx queue anymore, try relaying again, or if we are the destination, send the ACK again
+    if (isRepeated(p))
+        return DUPE_RELAY_OR_ACK;
+    // If it's a dupe, cancel relay if we were not explicitly asked to relay
+    return weWereNextHop ? DUPE_IGNORE : DUPE_CANCEL_RELAY;
+}
+
 void NextHopRouter::sniffReceived(const meshtastic_MeshPacket *p, const meshtastic_Routing *c)
 {
     NodeNum ourNodeNum = getNodeNum();
@@ -71,13 +83,11 @@ void NextHopRouter::sniffReceived(const meshtastic_MeshPacket *p, const meshtast
         if (p->from != 0) {
             meshtastic_NodeInfoLite *origTx = nodeDB->getMeshNode(p->from);
             if (origTx) {
-                // Either relayer of ACK was also a relayer of the packet, or we were the relayer and the ACK came directly from
-                // the destination
-                if (wasRelayer(p->relay_node, p->decoded.request_id, p->to) ||
-                    (wasRelayer(ourRelayID, p->decoded.request_id, p->to) && p->hop_start != 0 && p->hop_start == p->hop_limit)) {
+                if (confirmsNextHop(*this, p, p->decoded.request_id, ourRelayID)) {
                     if (origTx->next_hop != p->relay_node) { // Not already set
                         LOG_INFO("Update next hop of 0x%x to 0x%x based on ACK/reply", p->from, p->relay_node);
                         origTx->next_hop = p->relay_node;
+                        nodeDB->markChanged(origTx, NODE_DIRTY_INFO);
                     }
                 }
             }
@@ -95,28 +105,48 @@ void NextHopRouter::sniffReceived(const meshtastic_MeshPacket *p, const meshtast
     Router::sniffReceived(p, c);
 }
 
+bool NextHopRouter::confirmsNextHop(PacketHistory &history, const meshtastic_MeshPacket *p, PacketId requestId,
+                                    uint8_t ourRelayId)
+{
+    // Either relayer of ACK was also a relayer of the packet, or we were the relayer and the ACK came directly from
+    // the destination
+    return history.wasRelayer(p->relay_node, requestId, p->to) ||
+           (history.wasRelayer(ourRelayId, requestId, p->to) && p->hop_start != 0 && p->hop_start == p->hop_limit);
+}
+
+bool NextHopRouter::needsRetransmission(const meshtastic_MeshPacket *p, bool fromUs)
+{
+    // If it's from us, ReliableRouter already handles retransmissions if want_ack is set. If a next hop is set and hop limit is
+    // not 0 or want_ack is set, start retransmissions
+    return (!fromUs || !p->want_ack) && p->next_hop != NO_NEXT_HOP_PREFERENCE && (p->hop_limit > 0 || p->want_ack);
+}
+
 /* Check if we should be relaying this packet if so, do so. */
 bool NextHopRouter::perhapsRelay(const meshtastic_MeshPacket *p)
 {
-    if (!isToUs(p) && !isFromUs(p) && p->hop_limit > 0) {
-        if (p->next_hop == NO_NEXT_HOP_PREFERENCE || p->next_hop == nodeDB->getLastByteOfNodeNum(getNodeNum())) {
-            if (isRebroadcaster()) {
-                meshtastic_MeshPacket *tosend = packetPool.allocCopy(*p); // keep a copy because we will be sending it
-                LOG_INFO("Relaying received message coming from %x", p->relay_node);
+    if (shouldRelay(p, getNodeNum())) {
+        if (isRebroadcaster()) {
+            meshtastic_MeshPacket *tosend = packetPool.allocCopy(*p); // keep a copy because we will be sending it
+            LOG_INFO("Relaying received message coming from %x", p->relay_node);
 
-                tosend->hop_limit--; // bump down the hop count
-                NextHopRouter::send(tosend);
+            tosend->hop_limit--; // bump down the hop count
+            NextHopRouter::send(tosend);
 
-                return true;
-            } else {
-                LOG_DEBUG("Not rebroadcasting: Role = CLIENT_MUTE or Rebroadcast Mode = NONE");
-            }
+            return true;
+        } else {
+            LOG_DEBUG("Not rebroadcasting: Role = CLIENT_MUTE or Rebroadcast Mode = NONE");
         }
     }
 
     return false;
 }
 
+bool NextHopRouter::shouldRelay(const meshtastic_MeshPacket *p, NodeNum ourNodeNum)
+{
+    return shouldRebroadcast(p, ourNodeNum) &&
+           (p->next_hop == NO_NEXT_HOP_PREFERENCE || p->next_hop == NodeDB::getLastByteOfNodeNum(ourNodeNum));
+}
+
 /**
  * Get the next hop for a destination, given the relay node
  * @return the node number of the next hop, 0 if no preference (fallback to FloodingRouter)
@@ -129,16 +159,21 @@ uint8_t NextHopRouter::getNextHop(NodeNum to, uint8_t relay_node)
 
     meshtastic_NodeInfoLite *node = nodeDB->getMeshNode(to);
     if (node && node->next_hop) {
-        // We are careful not to return the relay node as the next hop
-        if (node->next_hop != relay_node) {
-            // LOG_DEBUG("Next hop for 0x%x is 0x%x", to, node->next_hop);
-            return node->next_hop;
-        } else
+        if (node->next_hop == relay_node)
             LOG_WARN("Next hop for 0x%x is 0x%x, same as relayer; set no pref", to, node->next_hop);
+        return chooseNextHop(to, node->next_hop, relay_node);
     }
     return NO_NEXT_HOP_PREFERENCE;
 }
 
+uint8_t NextHopRouter::chooseNextHop(NodeNum to, uint8_t learnt, uint8_t relayNode)
+{
+    // We are careful not to return the relay node as the next hop
+    if (isBroadcast(to) || learnt == relayNode)
+        return NO_NEXT_HOP_PREFERENCE;
+    return learnt;
+}
+
 PendingPacket *NextHopRouter::findPendingPacket(GlobalPacketId key)
 {
     auto old = pending.find(key); // If we have an old record, someone messed up because id got reused
@@ -162,18 +197,11 @@ bool NextHopRouter::stopRetransmission(GlobalPacketId key)
     auto old = findPendingPacket(key);
     if (old) {
         auto p = old->packet;
-        /* Only when we already transmitted a packet via LoRa, we will cancel the packet in the Tx queue
-          to avoid canceling a transmission if it was ACKed super fast via MQTT */
-        if (old->numRetransmissions < NUM_RELIABLE_RETX - 1) {
-            // We only cancel it if we are the original sender or if we're not a router(_late)/repeater
-            if (isFromUs(p) || (config.device.role != meshtastic_Config_DeviceConfig_Role_ROUTER &&
-                                config.device.role != meshtastic_Config_DeviceConfig_Role_REPEATER &&
-                                config.device.role != meshtastic_Config_DeviceConfig_Role_ROUTER_LATE)) {
-                // remove the 'original' (identified by originator and packet->id) from the txqueue and free it
-                cancelSending(getFrom(p), p->id);
-                // now free the pooled copy for retransmission too
-                packetPool.release(p);
-            }
+        if (cancelsOnStop(old->numRetransmissions, isFromUs(p), config.device.role)) {
+            // remove the 'original' (identified by originator and packet->id) from the txqueue and free it
+            cancelSending(getFrom(p), p->id);
+            // now free the pooled copy for retransmission too
+            packetPool.release(p);
         }
         auto numErased = pending.erase(key);
         assert(numErased == 1);
@@ -182,6 +210,14 @@ bool NextHopRouter::stopRetransmission(GlobalPacketId key)
         return false;
 }
 
+bool NextHopRouter::cancelsOnStop(uint8_t numRetransmissions, bool fromUs, meshtastic_Config_DeviceConfig_Role role)
+{
+    /* Only when we already transmitted a packet via LoRa, we will cancel the packet in the Tx queue
+      to avoid canceling a transmission if it was ACKed super fast via MQTT */
+    // We only cancel it if we are the original sender or if we're not a router(_late)/repeater
+    return numRetransmissions < NUM_RELIABLE_RETX - 1 && (fromUs || cancelsDupes(role));
+}
+
 /**
  * Add p to the list of packets to retransmit occasionally.  We will free it once we stop retransmitting.
  */
@@ -203,7 +239,7 @@ PendingPacket *NextHopRouter::startRetransmission(meshtastic_MeshPacket *p, uint
  */
 int32_t NextHopRouter::doRetransmissions()
 {
-    uint32_t now = millis();
+    uint32_t now = clockMillis();
     int32_t d = INT32_MAX;
 
     // FIXME, we should use a better datastructure rather than walking through this map.
@@ -230,7 +266,7 @@ int32_t NextHopRouter::doRetransmissions()
                           p.packet->id, p.numRetransmissions);
 
                 if (!isBroadcast(p.packet->to)) {
-                    if (p.numRetransmissions == 1) {
+                    if (fallsBackToFlooding(p.packet->to, p.numRetransmissions)) {
                         // Last retransmission, reset next_hop (fallback to FloodingRouter)
                         p.packet->next_hop = NO_NEXT_HOP_PREFERENCE;
                         // Also reset it in the nodeDB
@@ -238,6 +274,7 @@ int32_t NextHopRouter::doRetransmissions()
                         if (sentTo) {
                             LOG_INFO("Resetting next hop for packet with dest 0x%x\n", p.packet->to);
                             sentTo->next_hop = NO_NEXT_HOP_PREFERENCE;
+                            nodeDB->markChanged(sentTo, NODE_DIRTY_INFO);
                         }
                         FloodingRouter::send(packetPool.allocCopy(*p.packet));
                     } else {
@@ -270,7 +307,7 @@ void NextHopRouter::setNextTx(PendingPacket *pending)
 {
     assert(iface);
     auto d = iface->getRetransmissionMsec(pending->packet);
-    pending->nextTxMsec = millis() + d;
+    pending->nextTxMsec = clockMillis() + d;
     LOG_DEBUG("Setting next retransmission in %u msecs: ", d);
     printPacket("", pending->packet);
     setReceivedMessage(); // Run ASAP, so we can figure out our correct sleep time
@@ -91,6 +91,30 @@ class NextHopRouter : public FloodingRouter
     // The number of retransmissions the original sender will do
     constexpr static uint8_t NUM_RELIABLE_RETX = 3;
 
+    /// What to do about a duplicate of p, given what PacketHistory::wasSeenRecently() told us about it
+    static DupeAction getDupeAction(const meshtastic_MeshPacket *p, bool wasFallback, bool weWereNextHop);
+
+    /// Whether node ourNodeNum would relay p, if its role lets it
+    static bool shouldRelay(const meshtastic_MeshPacket *p, NodeNum ourNodeNum);
+
+    /// The next hop towards to, given the one we learnt for it (NO_NEXT_HOP_PREFERENCE if none) and who is relaying
+    static uint8_t chooseNextHop(NodeNum to, uint8_t learnt, uint8_t relayNode);
+
+    /// Whether the ACK or reply p to requestId, which history saw, makes the node that relayed it our next hop towards its sender
+    static bool confirmsNextHop(PacketHistory &history, const meshtastic_MeshPacket *p, PacketId requestId, uint8_t ourRelayId);
+
+    /// Whether we retransmit p ourselves until someone relays it, besides the want_ack packets ReliableRouter retransmits
+    static bool needsRetransmission(const meshtastic_MeshPacket *p, bool fromUs);
+
+    /// Whether stopping the retransmission of a packet also takes it out of the TX queue
+    static bool cancelsOnStop(uint8_t numRetransmissions, bool fromUs, meshtastic_Config_DeviceConfig_Role role);
+
+    /// Whether the retransmission with numRetransmissions left forgets the next hop and floods
+    static bool fallsBackToFlooding(NodeNum to, uint8_t numRetransmissions)
+    {
+        return !isBroadcast(to) && numRetransmissions == 1;
+    }
+
   protected:
     /**
      * Pending retransmissions
@@ -10,12 +10,14 @@
 #include "MeshRadio.h"
 #include "MeshService.h"
 #include "NodeDB.h"
+#include "NodePositionCache.h"
 #include "PacketHistory.h"
 #include "PowerFSM.h"
 #include "RTC.h"
 #include "Router.h"
 #include "SPILock.h"
 #include "SafeFile.h"
+#include "SaveScheduler.h"
 #include "TypeConversions.h"
 #include "error.h"
 #include "main.h"
@@ -297,6 +299,7 @@ NodeDB::NodeDB()
     meshtastic_NodeInfoLite *info = getOrCreateMeshNode(getNodeNum());
     info->user = TypeConversions::ConvertToUserLite(owner);
     info->has_user = true;
+    markChanged(info, NODE_DIRTY_USER);
 
     // If node database has not been saved for the first time, save it now
 #ifdef FSCom
@@ -381,8 +384,10 @@ NodeDB::NodeDB()
         config.has_position = true;
         info->has_position = true;
         info->position = TypeConversions::ConvertToPositionLite(fixedGPS);
+        markChanged(info, NODE_DIRTY_POSITION);
         nodeDB->setLocalPosition(fixedGPS);
         config.position.fixed_position = true;
+        saveWhat |= SEGMENT_NODEDATABASE | SEGMENT_CONFIG; // Changed after the CRCs above were taken
 #endif
     }
 #endif
@@ -478,6 +483,10 @@ void NodeDB::installDefaultNodeDatabase()
     nodeDatabase.nodes = std::vector<meshtastic_NodeInfoLite>(MAX_NUM_NODES);
     numMeshNodes = 0;
     meshNodes = &nodeDatabase.nodes;
+    // No journal goes with an empty DB, so the next save writes the whole DB and starts a new one
+    nodeMeta.assign(MAX_NUM_NODES, NodeMeta());
+    journalRemovedNodes.clear();
+    journalNeedsCompaction = true;
 }
 
 void NodeDB::installDefaultConfig(bool preserveKey = false)
@@ -933,6 +942,8 @@ void NodeDB::resetNodes()
     std::fill(nodeDatabase.nodes.begin() + 1, nodeDatabase.nodes.end(), meshtastic_NodeInfoLite());
     devicestate.has_rx_text_message = false;
     devicestate.has_rx_waypoint = false;
+    markNodesRemoved();
+    journalNeedsCompaction = true;
     saveNodeDatabaseToDisk();
     saveDeviceStateToDisk();
     if (neighborInfoModule && moduleConfig.neighbor_info.enabled)
@@ -940,19 +951,30 @@ void NodeDB::resetNodes()
 }
 
 void NodeDB::removeNodeByNum(NodeNum nodeNum)
+{
+    int removed = purgeNode(nodeNum);
+    LOG_DEBUG("NodeDB::removeNodeByNum purged %d entries. Save changes", removed);
+    markNodesRemoved();
+    if (removed)
+        journalRemovedNodes.push_back(nodeNum);
+    saveNodeDatabaseToDisk();
+}
+
+int NodeDB::purgeNode(NodeNum nodeNum)
 {
     int newPos = 0, removed = 0;
     for (int i = 0; i < numMeshNodes; i++) {
-        if (meshNodes->at(i).num != nodeNum)
+        if (meshNodes->at(i).num != nodeNum) {
+            nodeMeta[newPos] = nodeMeta[i];
             meshNodes->at(newPos++) = meshNodes->at(i);
-        else
+        } else
             removed++;
     }
     numMeshNodes -= removed;
-    std::fill(nodeDatabase.nodes.begin() + numMeshNodes, nodeDatabase.nodes.begin() + numMeshNodes + 1,
+    // Empty slots past numMeshNodes aren't read back, see nodeDatabaseStamp()
+    std::fill(nodeDatabase.nodes.begin() + numMeshNodes, nodeDatabase.nodes.begin() + numMeshNodes + removed,
               meshtastic_NodeInfoLite());
-    LOG_DEBUG("NodeDB::removeNodeByNum purged %d entries. Save changes", removed);
-    saveNodeDatabaseToDisk();
+    return removed;
 }
 
 void NodeDB::clearLocalPosition()
@@ -962,6 +984,7 @@ void NodeDB::clearLocalPosition()
     node->position.longitude_i = 0;
     node->position.altitude = 0;
     node->position.time = 0;
+    markChanged(node, NODE_DIRTY_POSITION);
     setLocalPosition(meshtastic_Position_init_default);
 }
 
@@ -975,6 +998,7 @@ void NodeDB::cleanupMeshDB()
                     meshNodes->at(i).user.public_key.size = 0;
                 }
             }
+            nodeMeta[newPos] = nodeMeta[i];
             meshNodes->at(newPos++) = meshNodes->at(i);
         } else {
             removed++;
@@ -984,6 +1008,9 @@ void NodeDB::cleanupMeshDB()
     std::fill(nodeDatabase.nodes.begin() + numMeshNodes, nodeDatabase.nodes.begin() + numMeshNodes + removed,
               meshtastic_NodeInfoLite());
     LOG_DEBUG("cleanupMeshDB purged %d entries", removed);
+    markNodesRemoved();
+    if (removed)
+        journalNeedsCompaction = true;
 }
 
 void NodeDB::installDefaultDeviceState()
@@ -1118,6 +1145,8 @@ void NodeDB::loadFromDisk()
 #endif
     auto state = loadProto(nodeDatabaseFileName, getMaxNodesAllocatedSize(), sizeof(meshtastic_NodeDatabase),
                            &meshtastic_NodeDatabase_msg, &nodeDatabase);
+    if (state == LoadFileResult::LOAD_SUCCESS)
+        nodeJournal.setBase(nodeDatabaseStamp(nodeDatabase.nodes.size())); // Empty slots weren't loaded
     if (nodeDatabase.version < DEVICESTATE_MIN_VER) {
         LOG_WARN("NodeDatabase %d is old, discard", nodeDatabase.version);
         installDefaultNodeDatabase();
@@ -1132,6 +1161,12 @@ void NodeDB::loadFromDisk()
         numMeshNodes = MAX_NUM_NODES;
     }
     meshNodes->resize(MAX_NUM_NODES);
+    nodeMeta.assign(MAX_NUM_NODES, NodeMeta());
+    if (state == LoadFileResult::LOAD_SUCCESS && nodeDatabase.version >= DEVICESTATE_MIN_VER)
+        replayNodeJournal();
+    else
+        journalNeedsCompaction = true; // whatever journal there is doesn't go with this DB
+    markNodesRemoved();
 
     // static DeviceState scratch; We no longer read into a tempbuf because this structure is 15KB of valuable RAM
     state = loadProto(deviceStateFileName, meshtastic_DeviceState_size, sizeof(meshtastic_DeviceState),
@@ -1331,9 +1366,132 @@ bool NodeDB::saveNodeDatabaseToDisk()
     FSCom.mkdir("/prefs");
     spiLock->unlock();
 #endif
+    // Usually only a few nodes changed, so just append those changes to the journal
+    if (!journalNeedsCompaction && nodeJournal.size() < NODEDB_JOURNAL_MAX_BYTES && appendNodeJournal())
+        return true;
+
     size_t nodeDatabaseSize;
     pb_get_encoded_size(&nodeDatabaseSize, meshtastic_NodeDatabase_fields, &nodeDatabase);
-    return saveProto(nodeDatabaseFileName, nodeDatabaseSize, &meshtastic_NodeDatabase_msg, &nodeDatabase, false);
+    bool success = saveProto(nodeDatabaseFileName, nodeDatabaseSize, &meshtastic_NodeDatabase_msg, &nodeDatabase, false);
+    if (success) {
+        // Only drop the old journal now that the DB holds everything in it. Should we lose power before it is gone, its stamp
+        // no longer matches and it is ignored rather than replayed on top of the newer DB
+        nodeJournal.setBase(nodeDatabaseStamp(numMeshNodes));
+        nodeJournal.remove();
+        for (auto &meta : nodeMeta)
+            meta.dirty = 0;
+        journalRemovedNodes.clear();
+        journalNeedsCompaction = false;
+    }
+    return success;
+}
+
+bool NodeDB::appendNodeJournal()
+{
+    std::vector<uint8_t> batch;
+    uint8_t payload[meshtastic_NodeInfoLite_size];
+    size_t numbytes;
+
+    for (NodeNum num : journalRemovedNodes)
+        NodeJournal::addRecord(batch, NodeJournal::RECORD_REMOVE, num, nullptr, 0);
+
+    for (size_t i = 0; i < numMeshNodes; i++) {
+        const uint8_t dirty = nodeMeta[i].dirty;
+        const meshtastic_NodeInfoLite &node = meshNodes->at(i);
+        if (dirty & NODE_DIRTY_INFO) {
+            meshtastic_NodeInfoLite info = node;
+            info.has_user = info.has_position = info.has_device_metrics = false;
+            numbytes = pb_encode_to_bytes(payload, sizeof(payload), &meshtastic_NodeInfoLite_msg, &info);
+            NodeJournal::addRecord(batch, NodeJournal::RECORD_INFO, node.num, payload, numbytes);
+        }
+        if (dirty & NODE_DIRTY_USER) {
+            numbytes = node.has_user ? pb_encode_to_bytes(payload, sizeof(payload), &meshtastic_UserLite_msg, &node.user) : 0;
+            NodeJournal::addRecord(batch, NodeJournal::RECORD_USER, node.num, payload, numbytes);
+        }
+        if (dirty & NODE_DIRTY_POSITION) {
+            numbytes =
+                node.has_position ? pb_encode_to_bytes(payload, sizeof(payload), &meshtastic_PositionLite_msg, &node.position) : 0;
+            NodeJournal::addRecord(batch, NodeJournal::RECORD_POSITION, node.num, payload, numbytes);
+        }
+        if (dirty & NODE_DIRTY_TELEMETRY) {
+            numbytes = node.has_device_metrics
+                           ? pb_encode_to_bytes(payload, sizeof(payload), &meshtastic_DeviceMetrics_msg, &node.device_metrics)
+                           : 0;
+            NodeJournal::addRecord(batch, NodeJournal::RECORD_TELEMETRY, node.num, payload, numbytes);
+        }
+    }
+
+    if (!nodeJournal.append(batch))
+        return false;
+    LOG_DEBUG("Journaled %u bytes of node changes, journal is %u bytes", batch.size(), nodeJournal.size());
+    for (auto &meta : nodeMeta)
+        meta.dirty = 0;
+    journalRemovedNodes.clear();
+    return true;
+}
+
+uint32_t NodeDB::nodeDatabaseStamp(size_t count)
+{
+    // Of the nodes as encoded, which is the same before saving and after loading, unlike the structs in memory
+    uint8_t payload[meshtastic_NodeInfoLite_size];
+    count = std::min(count, nodeDatabase.nodes.size());
+    uint32_t stamp = count;
+    for (size_t i = 0; i < count; i++) {
+        size_t numbytes = pb_encode_to_bytes(payload, sizeof(payload), &meshtastic_NodeInfoLite_msg, &nodeDatabase.nodes[i]);
+        stamp = stamp * 16777619u ^ crc32Buffer(payload, numbytes);
+    }
+    return stamp;
+}
+
+void NodeDB::replayNodeJournal()
+{
+    bool intact = nodeJournal.replay([this](NodeJournal::RecordType type, NodeNum num, const uint8_t *payload, size_t length) {
+        if (type == NodeJournal::RECORD_REMOVE) {
+            purgeNode(num);
+            return;
+        }
+        meshtastic_NodeInfoLite *node = getOrCreateMeshNode(num);
+        if (!node)
+            return;
+        switch (type) {
+        case NodeJournal::RECORD_INFO: {
+            meshtastic_NodeInfoLite info = meshtastic_NodeInfoLite_init_zero;
+            if (!pb_decode_from_bytes(payload, length, &meshtastic_NodeInfoLite_msg, &info))
+                break;
+            // Keep the parts that have records of their own
+            info.has_user = node->has_user;
+            info.user = node->user;
+            info.has_position = node->has_position;
+            info.position = node->position;
+            info.has_device_metrics = node->has_device_metrics;
+            info.device_metrics = node->device_metrics;
+            *node = info;
+            break;
+        }
+        case NodeJournal::RECORD_USER:
+            node->user = meshtastic_UserLite_init_zero;
+            node->has_user = length && pb_decode_from_bytes(payload, length, &meshtastic_UserLite_msg, &node->user);
+            break;
+        case NodeJournal::RECORD_POSITION:
+            node->position = meshtastic_PositionLite_init_zero;
+            node->has_position = length && pb_decode_from_bytes(payload, length, &meshtastic_PositionLite_msg, &node->position);
+            break;
+        case NodeJournal::RECORD_TELEMETRY:
+            node->device_metrics = meshtastic_DeviceMetrics_init_zero;
+            node->has_device_metrics =
+                length && pb_decode_from_bytes(payload, length, &meshtastic_DeviceMetrics_msg, &node->device_metrics);
+            break;
+        default:
+            LOG_WARN("Unknown node journal record %u", type);
+        }
+    });
+
+    // Everything replayed is on flash already
+    for (auto &meta : nodeMeta)
+        meta.dirty = 0;
+    journalRemovedNodes.clear();
+    if (!intact)
+        journalNeedsCompaction = true;
 }
 
 bool NodeDB::saveToDiskNoRetry(int saveWhat)
@@ -1393,6 +1551,8 @@ bool NodeDB::saveToDiskNoRetry(int saveWhat)
 bool NodeDB::saveToDisk(int saveWhat)
 {
     LOG_DEBUG("Save to disk %d", saveWhat);
+    if (saveScheduler)
+        saveScheduler->saved(saveWhat);
     bool success = saveToDiskNoRetry(saveWhat);
 
     if (!success) {
@@ -1412,6 +1572,14 @@ bool NodeDB::saveToDisk(int saveWhat)
     return success;
 }
 
+void NodeDB::saveToDiskSoon(int saveWhat)
+{
+    if (saveScheduler)
+        saveScheduler->request(saveWhat);
+    else
+        saveToDisk(saveWhat);
+}
+
 const meshtastic_NodeInfoLite *NodeDB::readNextMeshNode(uint32_t &readIndex)
 {
     if (readIndex < numMeshNodes)
@@ -1503,6 +1671,8 @@ void NodeDB::updatePosition(uint32_t nodeId, const meshtastic_Position &p, RxSou
             info->position.time = tmp_time;
     }
     info->has_position = true;
+    nodePositionCache.invalidate(nodeId);
+    markChanged(info, NODE_DIRTY_POSITION);
     updateGUIforNode = info;
     notifyObservers(true); // Force an update whether or not our node counts have changed
 }
@@ -1526,6 +1696,7 @@ void NodeDB::updateTelemetry(uint32_t nodeId, const meshtastic_Telemetry &t, RxS
     }
     info->device_metrics = t.variant.device_metrics;
     info->has_device_metrics = true;
+    markChanged(info, NODE_DIRTY_TELEMETRY);
     updateGUIforNode = info;
     notifyObservers(true); // Force an update whether or not our node counts have changed
 }
@@ -1546,6 +1717,7 @@ void NodeDB::addFromContact(meshtastic_SharedContact contact)
     info->is_favorite = true;
     // Mark the node's key as manually verified to indicate trustworthiness.
     info->bitfield |= NODEINFO_BITFIELD_IS_KEY_MANUALLY_VERIFIED_MASK;
+    markChanged(info);
     updateGUIforNode = info;
     powerFSM.trigger(EVENT_NODEDB_UPDATED);
     notifyObservers(true); // Force an update whether or not our node counts have changed
@@ -1603,6 +1775,7 @@ bool NodeDB::updateUser(uint32_t nodeId, meshtastic_User &p, uint8_t channelInde
     info->has_user = true;
 
     if (changed) {
+        markChanged(info, NODE_DIRTY_USER | NODE_DIRTY_INFO);
         updateGUIforNode = info;
         powerFSM.trigger(EVENT_NODEDB_UPDATED);
         notifyObservers(true); // Force an update whether or not our node counts have changed
@@ -1611,7 +1784,7 @@ bool NodeDB::updateUser(uint32_t nodeId, meshtastic_User &p, uint8_t channelInde
         // store our DB unless we just did so less than a minute ago
 
         if (!Throttle::isWithinTimespanMs(lastNodeDbSave, ONE_MINUTE_MS)) {
-            saveToDisk(SEGMENT_NODEDATABASE);
+            saveToDiskSoon(SEGMENT_NODEDATABASE);
             lastNodeDbSave = millis();
         } else {
             LOG_DEBUG("Defer NodeDB saveToDisk for now");
@@ -1650,6 +1823,7 @@ void NodeDB::updateFrom(const meshtastic_MeshPacket &mp)
             info->has_hops_away = true;
             info->hops_away = mp.hop_start - mp.hop_limit;
         }
+        markChanged(info, NODE_DIRTY_INFO);
     }
 }
 
@@ -1673,6 +1847,17 @@ meshtastic_NodeInfoLite *NodeDB::getMeshNode(NodeNum n)
     return NULL;
 }
 
+// Stamp the node with a new generation, so PhoneAPI resends it, and note what to write to the journal
+void NodeDB::markChanged(const meshtastic_NodeInfoLite *node, uint8_t what)
+{
+    generation++;
+    size_t x = node - &meshNodes->at(0);
+    if (x < nodeMeta.size()) {
+        nodeMeta[x].generation = generation;
+        nodeMeta[x].dirty |= what;
+    }
+}
+
 // returns true if the maximum number of nodes is reached or we are running low on memory
 bool NodeDB::isFull()
 {
@@ -1714,9 +1899,12 @@ meshtastic_NodeInfoLite *NodeDB::getOrCreateMeshNode(NodeNum n)
             }
 
             if (oldestIndex != -1) {
+                journalRemovedNodes.push_back(meshNodes->at(oldestIndex).num);
                 // Shove the remaining nodes down the chain
+                // Clients doing differential syncs are not forced to a full sync for this, they just keep the evicted node
                 for (int i = oldestIndex; i < numMeshNodes - 1; i++) {
                     meshNodes->at(i) = meshNodes->at(i + 1);
+                    nodeMeta[i] = nodeMeta[i + 1];
                 }
                 (numMeshNodes)--;
             }
@@ -1727,6 +1915,7 @@ meshtastic_NodeInfoLite *NodeDB::getOrCreateMeshNode(NodeNum n)
         // everything is missing except the nodenum
         memset(lite, 0, sizeof(*lite));
         lite->num = n;
+        markChanged(lite);
         LOG_INFO("Adding node to database with %i nodes and %u bytes free!", numMeshNodes, memGet.getFreeHeap());
     }
 
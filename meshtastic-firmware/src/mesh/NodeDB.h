@@ -8,6 +8,7 @@
 #include <vector>
 
 #include "MeshTypes.h"
+#include "NodeJournal.h"
 #include "NodeStatus.h"
 #include "configuration.h"
 #include "mesh-pb-constants.h"
@@ -71,6 +72,20 @@ DeviceState versions used to be defined in the .proto file but really only this
 #define SEGMENT_CHANNELS 8
 #define SEGMENT_NODEDATABASE 16
 
+/*
+Parts of a node that changed since the node database was last written, see NodeDB::markChanged()
+*/
+#define NODE_DIRTY_INFO 1 // everything not covered below: last heard, SNR, hops, favorite...
+#define NODE_DIRTY_USER 2
+#define NODE_DIRTY_POSITION 4
+#define NODE_DIRTY_TELEMETRY 8
+#define NODE_DIRTY_ALL (NODE_DIRTY_INFO | NODE_DIRTY_USER | NODE_DIRTY_POSITION | NODE_DIRTY_TELEMETRY)
+
+/// Once the node journal grows past this, the next save rewrites the whole node database and starts a new journal
+#ifndef NODEDB_JOURNAL_MAX_BYTES
+#define NODEDB_JOURNAL_MAX_BYTES 4096
+#endif
+
 #define DEVICESTATE_CUR_VER 24
 #define DEVICESTATE_MIN_VER 24
 
@@ -87,6 +102,7 @@ extern meshtastic_Position localPosition;
 static constexpr const char *deviceStateFileName = "/prefs/device.proto";
 static constexpr const char *legacyPrefFileName = "/prefs/db.proto";
 static constexpr const char *nodeDatabaseFileName = "/prefs/nodes.proto";
+static constexpr const char *nodeJournalFileName = "/prefs/nodes.journal";
 static constexpr const char *configFileName = "/prefs/config.proto";
 static constexpr const char *uiconfigFileName = "/prefs/uiconfig.proto";
 static constexpr const char *moduleConfigFileName = "/prefs/module.proto";
@@ -142,6 +158,9 @@ class NodeDB
     bool saveToDisk(int saveWhat = SEGMENT_CONFIG | SEGMENT_MODULECONFIG | SEGMENT_DEVICESTATE | SEGMENT_CHANNELS |
                                    SEGMENT_NODEDATABASE);
 
+    /// write to flash shortly, together with whatever else gets changed in the meantime (see SaveScheduler)
+    void saveToDiskSoon(int saveWhat);
+
     /** Reinit radio config if needed, because either:
      * a) sometimes a buggy android app might send us bogus settings or
      * b) the client set factory_reset
@@ -174,7 +193,7 @@ class NodeDB
     NodeNum getNodeNum() { return myNodeInfo.my_node_num; }
 
     // @return last byte of a NodeNum, 0xFF if it ended at 0x00
-    uint8_t getLastByteOfNodeNum(NodeNum num) { return (uint8_t)((num & 0xFF) ? (num & 0xFF) : 0xFF); }
+    static uint8_t getLastByteOfNodeNum(NodeNum num) { return (uint8_t)((num & 0xFF) ? (num & 0xFF) : 0xFF); }
 
     /// if returns false, that means our node should send a DenyNodeNum response.  If true, we think the number is okay for use
     // bool handleWantNodeNum(NodeNum n);
@@ -220,6 +239,21 @@ class NodeDB
     virtual meshtastic_NodeInfoLite *getMeshNode(NodeNum n);
     size_t getNumMeshNodes() { return numMeshNodes; }
 
+    /** The current change # for the node list.  Incremented any time a node is added, removed or updated, so users of the
+     * DB can tell whether something they cached from it is stale.
+     */
+    uint32_t getGeneration() { return generation; }
+
+    /// The generation at which the node at index x was last added or updated
+    uint32_t getNodeGeneration(size_t x) { return nodeMeta.at(x).generation; }
+
+    /// True if nodes were dropped from the DB after the given generation, so a node list taken at that generation may hold
+    /// nodes that are gone now
+    bool hasRemovedSince(uint32_t since) { return removedGeneration > since; }
+
+    /// Call after changing a node obtained from getMeshNode() in place, with the NODE_DIRTY_* bits for what changed
+    void markChanged(const meshtastic_NodeInfoLite *node, uint8_t what = NODE_DIRTY_ALL);
+
     UserLicenseStatus getLicenseStatus(uint32_t nodeNum);
 
     size_t getMaxNodesAllocatedSize()
@@ -261,6 +295,31 @@ class NodeDB
     bool duplicateWarned = false;
     uint32_t lastNodeDbSave = 0;    // when we last saved our db to flash
     uint32_t lastBackupAttempt = 0; // when we last tried a backup automatically or manually
+    uint32_t generation = 0;        // see getGeneration()
+    uint32_t removedGeneration = 0; // see hasRemovedSince()
+
+    /// What we track about each entry of meshNodes besides the node itself, moved along with the nodes
+    struct NodeMeta {
+        uint32_t generation = 0; // see getNodeGeneration()
+        uint8_t dirty = 0;       // NODE_DIRTY_* bits not yet written to flash
+    };
+    std::vector<NodeMeta> nodeMeta = std::vector<NodeMeta>(MAX_NUM_NODES);
+
+    NodeJournal nodeJournal = NodeJournal(nodeJournalFileName);
+    std::vector<NodeNum> journalRemovedNodes; // removed since the last save, to be journaled
+    bool journalNeedsCompaction = false;      // the journal can't describe the changes, rewrite the whole node database
+
+    /// Write the changed parts of each node to the journal, false if that failed and the whole DB needs to be written
+    bool appendNodeJournal();
+
+    /// Apply the journal on top of the node database just loaded from flash
+    void replayNodeJournal();
+
+    /**
+     * Identifies the node database as written to or read from flash, see NodeJournal::setBase()
+     * @param count the nodes in it: the empty slots past numMeshNodes are written but not read back
+     */
+    uint32_t nodeDatabaseStamp(size_t count);
     /// Find a node in our DB, create an empty NodeInfoLite if missing
     meshtastic_NodeInfoLite *getOrCreateMeshNode(NodeNum n);
 
@@ -272,6 +331,12 @@ class NodeDB
         newStatus.notifyObservers(&status);
     }
 
+    /// Remove a node from meshNodes without saving, returns the number of entries removed
+    int purgeNode(NodeNum nodeNum);
+
+    /// Call after nodes were removed from, or the whole of, meshNodes was replaced
+    void markNodesRemoved() { removedGeneration = ++generation; }
+
     /// read our db from flash
     void loadFromDisk();
 
@@ -325,6 +390,8 @@ extern meshtastic_CriticalErrorCode error_code;
 extern uint32_t error_address;
 #define NODEINFO_BITFIELD_IS_KEY_MANUALLY_VERIFIED_SHIFT 0
 #define NODEINFO_BITFIELD_IS_KEY_MANUALLY_VERIFIED_MASK (1 << NODEINFO_BITFIELD_IS_KEY_MANUALLY_VERIFIED_SHIFT)
+#define NODEINFO_BITFIELD_TEXT_COMPRESSION_SHIFT 1 // Its NodeInfo said it decompresses TEXT_MESSAGE_COMPRESSED_APP
+#define NODEINFO_BITFIELD_TEXT_COMPRESSION_MASK (1 << NODEINFO_BITFIELD_TEXT_COMPRESSION_SHIFT)
 
 #define Module_Config_size                                                                                                       \
     (ModuleConfig_CannedMessageConfig_size + ModuleConfig_ExternalNotificationConfig_size + ModuleConfig_MQTTConfig_size +       \
@@ -0,0 +1,139 @@
+#include "NodeJournal.h"
+#include "FSCommon.h"
+#include "SPILock.h"
+#include <cstring>
+
+namespace
+{
+constexpr uint32_t journalMagic = 0x324a444e; // "NDJ2", followed by the stamp of the base file
+constexpr size_t headerSize = 6;              // type, length, node number
+constexpr size_t checksumSize = 4;
+
+// FNV-1a, good enough to tell a torn record from a complete one
+uint32_t checksum(const uint8_t *data, size_t length)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+} // namespace
+
+void NodeJournal::addRecord(std::vector<uint8_t> &batch, RecordType type, NodeNum num, const uint8_t *payload, size_t length)
+{
+    const size_t start = batch.size();
+    batch.push_back(type);
+    batch.push_back(length);
+    batch.insert(batch.end(), reinterpret_cast<const uint8_t *>(&num), reinterpret_cast<const uint8_t *>(&num) + sizeof(num));
+    batch.insert(batch.end(), payload, payload + length);
+    const uint32_t sum = checksum(&batch[start], headerSize + length);
+    batch.insert(batch.end(), reinterpret_cast<const uint8_t *>(&sum), reinterpret_cast<const uint8_t *>(&sum) + sizeof(sum));
+}
+
+bool NodeJournal::append(const std::vector<uint8_t> &batch)
+{
+    if (batch.empty())
+        return true;
+#ifdef FSCom
+    concurrency::LockGuard g(spiLock);
+    if (bytes == 0 && FSCom.exists(filename))
+        FSCom.remove(filename); // Start over, this also gets rid of a damaged journal
+    auto f = FSCom.open(filename, bytes == 0 ? FILE_O_WRITE : FILE_O_APPEND);
+    if (!f) {
+        LOG_ERROR("Can't open %s", filename);
+        return false;
+    }
+    size_t expected = batch.size();
+    size_t written = 0;
+    if (bytes == 0) {
+        const uint32_t header[] = {journalMagic, baseStamp};
+        expected += sizeof(header);
+        written += f.write(reinterpret_cast<const uint8_t *>(header), sizeof(header));
+    }
+    written += f.write((uint8_t const *)batch.data(), batch.size());
+    f.flush();
+    f.close();
+
+    // Whatever made it to the file counts, a short write leaves a torn record that the next load will stop at
+    bytes += written;
+    if (written != expected) {
+        LOG_ERROR("Can't append to %s, wrote %u of %u bytes", filename, written, expected);
+        return false;
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool NodeJournal::replay(const ReplayFn &fn)
+{
+    bytes = 0;
+#ifdef FSCom
+    concurrency::LockGuard g(spiLock);
+    if (!FSCom.exists(filename))
+        return true;
+    auto f = FSCom.open(filename, FILE_O_READ);
+    if (!f)
+        return false;
+
+    uint32_t header[2] = {0};
+    if (f.readBytes((char *)header, sizeof(header)) != sizeof(header) || header[0] != journalMagic) {
+        LOG_WARN("%s has no valid header, ignore it", filename);
+        f.close();
+        return false;
+    }
+    if (header[1] != baseStamp) {
+        LOG_WARN("%s was started against another node database, ignore it", filename);
+        f.close();
+        return false;
+    }
+    bytes = sizeof(header);
+
+    bool intact = true;
+    size_t numRecords = 0;
+    uint8_t record[headerSize + UINT8_MAX + checksumSize];
+    while (f.available()) {
+        if (f.readBytes((char *)record, headerSize) != headerSize) {
+            intact = false;
+            break;
+        }
+        const size_t length = record[1];
+        uint32_t sum;
+        if (f.readBytes((char *)record + headerSize, length + checksumSize) != length + checksumSize) {
+            intact = false;
+            break;
+        }
+        memcpy(&sum, record + headerSize + length, sizeof(sum));
+        if (sum != checksum(record, headerSize + length)) {
+            intact = false;
+            break;
+        }
+        NodeNum num;
+        memcpy(&num, record + 2, sizeof(num));
+        fn(static_cast<RecordType>(record[0]), num, record + headerSize, length);
+        bytes += headerSize + length + checksumSize;
+        numRecords++;
+    }
+    f.close();
+
+    LOG_INFO("Replayed %u records (%u bytes) from %s", numRecords, bytes, filename);
+    if (!intact)
+        LOG_WARN("%s ends in a damaged record, drop the rest", filename);
+    return intact;
+#else
+    return true;
+#endif
+}
+
+void NodeJournal::remove()
+{
+#ifdef FSCom
+    concurrency::LockGuard g(spiLock);
+    if (FSCom.exists(filename))
+        FSCom.remove(filename);
+#endif
+    bytes = 0;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "MeshTypes.h"
+#include "configuration.h"
+#include <functional>
+#include <vector>
+
+/**
+ * Append-only journal of per-node changes, kept next to the node database so that a NodeDB save only has to write what
+ * changed rather than re-encode and rewrite every node.
+ *
+ * Each record is {type, payload length, node number, payload, checksum}.  The payload is the nanopb encoding of the part of
+ * the node that changed, e.g. a PositionLite for RECORD_POSITION.  Records are replayed in order on top of the base file by
+ * NodeDB::loadFromDisk().  A torn record at the end (power lost during an append) fails its checksum and ends the replay.
+ *
+ * The header holds a stamp of the base file the journal was started against, see setBase().  A journal left over from an
+ * older base file (power lost after the base was rewritten but before the journal was deleted) doesn't match and is ignored.
+ */
+class NodeJournal
+{
+  public:
+    enum RecordType : uint8_t {
+        RECORD_INFO = 1,      // NodeInfoLite without user, position and device metrics
+        RECORD_USER = 2,      // UserLite, empty if the node has no user
+        RECORD_POSITION = 3,  // PositionLite, empty if the node has no position
+        RECORD_TELEMETRY = 4, // DeviceMetrics, empty if the node has no device metrics
+        RECORD_REMOVE = 5,    // empty, the node was removed
+    };
+
+    using ReplayFn = std::function<void(RecordType type, NodeNum num, const uint8_t *payload, size_t length)>;
+
+    explicit NodeJournal(const char *filename) : filename(filename) {}
+
+    /// Set the stamp of the base file that a new journal is started against, and that replay() expects
+    void setBase(uint32_t stamp) { baseStamp = stamp; }
+
+    /// Add a record to a batch that will be written by append()
+    static void addRecord(std::vector<uint8_t> &batch, RecordType type, NodeNum num, const uint8_t *payload, size_t length);
+
+    /// Write a batch of records to the end of the journal
+    bool append(const std::vector<uint8_t> &batch);
+
+    /**
+     * Call fn for every intact record in the journal, oldest first
+     * @return false if the journal ended in a damaged record or is for another base file, in which case it should be rewritten
+     * before appending to it
+     */
+    bool replay(const ReplayFn &fn);
+
+    /// Delete the journal, once everything in it is in the base file
+    void remove();
+
+    /// Bytes in the journal file
+    size_t size() const { return bytes; }
+
+  private:
+    const char *filename;
+    size_t bytes = 0;
+    uint32_t baseStamp = 0;
+};
@@ -0,0 +1,71 @@
+#include "NodePositionCache.h"
+#include "NodeDB.h"
+#include "gps/GeoCoord.h"
+
+NodePositionCache nodePositionCache;
+
+void NodePositionCache::updateOurPosition()
+{
+    const meshtastic_NodeInfoLite *ourNode = nodeDB->getMeshNode(nodeDB->getNodeNum()); // Normally first in the DB, so cheap
+    const bool valid = ourNode && nodeDB->hasValidPosition(ourNode);
+    if (valid == haveOurPosition &&
+        (!valid || (ourNode->position.latitude_i == ourLatitude_i && ourNode->position.longitude_i == ourLongitude_i)))
+        return;
+
+    haveOurPosition = valid;
+    ourLatitude_i = valid ? ourNode->position.latitude_i : 0;
+    ourLongitude_i = valid ? ourNode->position.longitude_i : 0;
+    if (++ourGeneration == 0) // 0 is kept for entries that never had distance and bearing computed
+        ourGeneration = 1;
+}
+
+const NodePositionCache::Entry *NodePositionCache::get(const meshtastic_NodeInfoLite *node)
+{
+    if (!node || !nodeDB->hasValidPosition(node))
+        return nullptr;
+    updateOurPosition();
+
+    const meshtastic_PositionLite &p = node->position;
+    auto it = slots.find(node->num);
+    if (it == slots.end()) {
+        if (slots.size() >= MAX_NUM_NODES)
+            slots.clear(); // Nodes dropped from the DB leave their entries behind, start over rather than let them pile up
+        it = slots.emplace(node->num, Slot()).first;
+        it->second.relativeGeneration = 0;
+    }
+    Slot &slot = it->second;
+
+    if (slot.relativeGeneration == 0 || slot.latitude_i != p.latitude_i || slot.longitude_i != p.longitude_i ||
+        slot.time != p.time) {
+        const double latRad = p.latitude_i * 1e-7 * DEG_TO_RAD;
+        const double lngRad = p.longitude_i * 1e-7 * DEG_TO_RAD;
+        slot.entry.x = cos(latRad) * cos(lngRad);
+        slot.entry.y = cos(latRad) * sin(lngRad);
+        slot.entry.z = sin(latRad);
+        slot.latitude_i = p.latitude_i;
+        slot.longitude_i = p.longitude_i;
+        slot.time = p.time;
+        slot.relativeGeneration = 0;
+    }
+
+    if (slot.relativeGeneration != ourGeneration) {
+        slot.entry.hasRelative = haveOurPosition;
+        if (haveOurPosition) {
+            slot.entry.distanceMeters = GeoCoord::latLongToMeterFast(p.latitude_i, p.longitude_i, ourLatitude_i, ourLongitude_i);
+            slot.entry.bearing = GeoCoord::bearingFast(ourLatitude_i, ourLongitude_i, p.latitude_i, p.longitude_i);
+        }
+        slot.relativeGeneration = ourGeneration;
+    }
+    return &slot.entry;
+}
+
+void NodePositionCache::invalidate(NodeNum num)
+{
+    if (num == nodeDB->getNodeNum()) {
+        // Every distance and bearing is from our position. Forget it, so the next get() takes the new one
+        haveOurPosition = false;
+        if (++ourGeneration == 0)
+            ourGeneration = 1;
+    }
+    slots.erase(num);
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "MeshTypes.h"
+#include "mesh/generated/meshtastic/deviceonly.pb.h"
+#include <unordered_map>
+
+/**
+ * Geometry of each node's position that the UIs use on every render: the position as a unit vector, and its distance and
+ * bearing from our own position.
+ *
+ * An entry is computed the first time a UI asks for it, and kept until NodeDB::updatePosition() changes that node's position.
+ * A change to our own position recomputes the distance and bearing of every entry as they are next asked for. Entries also
+ * remember the position they were computed from and are redone if the node's position differs, so a position changed some
+ * other way (loaded from flash, a node replaced in the DB) is never served stale.
+ */
+class NodePositionCache
+{
+  public:
+    struct Entry {
+        // Unit vector from the center of the earth: x towards 0°N 0°E, y towards 0°N 90°E, z towards the north pole
+        float x, y, z;
+
+        bool hasRelative;     // We have a valid position, so the fields below are set
+        float distanceMeters; // From our position
+        float bearing;        // From our position, radians clockwise from north, -PI to PI
+    };
+
+    /// @return the geometry of a node's position, or nullptr if it has no valid position
+    const Entry *get(const meshtastic_NodeInfoLite *node);
+
+    /// A node's position changed, called from NodeDB::updatePosition()
+    void invalidate(NodeNum num);
+
+  private:
+    struct Slot {
+        Entry entry;
+        int32_t latitude_i, longitude_i; // The position the entry was computed from
+        uint32_t time;
+        uint32_t relativeGeneration; // ourGeneration when distance and bearing were computed, 0 for not yet
+    };
+
+    std::unordered_map<NodeNum, Slot> slots;
+
+    // Our own position, which distances and bearings are from
+    bool haveOurPosition = false;
+    int32_t ourLatitude_i = 0, ourLongitude_i = 0;
+    uint32_t ourGeneration = 1;
+
+    void updateOurPosition();
+};
+
+extern NodePositionCache nodePositionCache;
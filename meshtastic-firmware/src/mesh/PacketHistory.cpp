@@ -1,4 +1,5 @@
 #include "PacketHistory.h"
+#include "Clock.h"
 #include "configuration.h"
 #include "mesh-pb-constants.h"
 
@@ -7,7 +8,7 @@
 #endif
 #include "Throttle.h"
 
-PacketHistory::PacketHistory()
+PacketHistory::PacketHistory(NodeNum _ourNodeNum) : ourNodeNum(_ourNodeNum)
 {
     recentPackets.reserve(MAX_NUM_NODES); // Prealloc the worst case # of records - to prevent heap fragmentation
                                           // setup our periodic task
@@ -23,10 +24,10 @@ bool PacketHistory::wasSeenRecently(const meshtastic_MeshPacket *p, bool withUpd
         return false; // Not a floodable message ID, so we don't care
     }
 
-    PacketRecord r;
+    PacketRecord r = {}; // Relayers we don't know of are 0
     r.id = p->id;
     r.sender = getFrom(p);
-    r.rxTimeMsec = millis();
+    r.rxTimeMsec = clockMillis();
     r.next_hop = p->next_hop;
     r.relayed_by[0] = p->relay_node;
     // LOG_INFO("Add relayed_by 0x%x for id=0x%x", p->relay_node, r.id);
@@ -34,8 +35,8 @@ bool PacketHistory::wasSeenRecently(const meshtastic_MeshPacket *p, bool withUpd
     auto found = recentPackets.find(r);
     bool seenRecently = (found != recentPackets.end()); // found not equal to .end() means packet was seen recently
 
-    if (seenRecently &&
-        !Throttle::isWithinTimespanMs(found->rxTimeMsec, FLOOD_EXPIRE_TIME)) { // Check whether found packet has already expired
+    // Check whether found packet has already expired
+    if (seenRecently && !Throttle::isWithinClockTimespanMs(found->rxTimeMsec, FLOOD_EXPIRE_TIME)) {
         recentPackets.erase(found); // Erase and pretend packet has not been seen recently
         found = recentPackets.end();
         seenRecently = false;
@@ -43,12 +44,12 @@ bool PacketHistory::wasSeenRecently(const meshtastic_MeshPacket *p, bool withUpd
 
     if (seenRecently) {
         LOG_DEBUG("Found existing packet record for fr=0x%x,to=0x%x,id=0x%x", p->from, p->to, p->id);
-        uint8_t ourRelayID = nodeDB->getLastByteOfNodeNum(nodeDB->getNodeNum());
+        uint8_t ourRelayID = NodeDB::getLastByteOfNodeNum(getOurNodeNum());
         if (wasFallback) {
             // If it was seen with a next-hop not set to us and now it's NO_NEXT_HOP_PREFERENCE, and the relayer relayed already
             // before, it's a fallback to flooding. If we didn't already relay and the next-hop neither, we might need to handle
             // it now.
-            if (found->sender != nodeDB->getNodeNum() && found->next_hop != NO_NEXT_HOP_PREFERENCE &&
+            if (found->sender != getOurNodeNum() && found->next_hop != NO_NEXT_HOP_PREFERENCE &&
                 found->next_hop != ourRelayID && p->next_hop == NO_NEXT_HOP_PREFERENCE && wasRelayer(p->relay_node, found) &&
                 !wasRelayer(ourRelayID, found) && !wasRelayer(found->next_hop, found)) {
                 *wasFallback = true;
@@ -92,7 +93,7 @@ void PacketHistory::clearExpiredRecentPackets()
     LOG_DEBUG("recentPackets size=%ld", recentPackets.size());
 
     for (auto it = recentPackets.begin(); it != recentPackets.end();) {
-        if (!Throttle::isWithinTimespanMs(it->rxTimeMsec, FLOOD_EXPIRE_TIME)) {
+        if (!Throttle::isWithinClockTimespanMs(it->rxTimeMsec, FLOOD_EXPIRE_TIME)) {
             it = recentPackets.erase(it); // erase returns iterator pointing to element immediately following the one erased
         } else {
             ++it;
@@ -39,11 +39,15 @@ class PacketHistory
 {
   private:
     std::unordered_set<PacketRecord, PacketRecordHashFunction> recentPackets;
+    const NodeNum ourNodeNum;
 
     void clearExpiredRecentPackets(); // clear all recentPackets older than FLOOD_EXPIRE_TIME
 
+    NodeNum getOurNodeNum() { return ourNodeNum ? ourNodeNum : nodeDB->getNodeNum(); }
+
   public:
-    PacketHistory();
+    /// @param ourNodeNum the node whose history this is, 0 for this one. MeshSim keeps a history for each node it simulates
+    explicit PacketHistory(NodeNum ourNodeNum = 0);
 
     /**
      * Update recentBroadcasts and return true if we have already seen this packet
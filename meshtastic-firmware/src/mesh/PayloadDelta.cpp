@@ -0,0 +1,265 @@
+#include "PayloadDelta.h"
+#include "NodeDB.h"
+#include "Router.h"
+#include "mesh/generated/meshtastic/telemetry.pb.h"
+#include <pb_decode.h>
+
+#if RADIO_TASK
+#include "concurrency/LockGuard.h"
+#endif
+
+PayloadDelta payloadDelta;
+
+// Header: checksum of the keyframe, with this bit set if the payload length byte follows, then the checksum of the payload
+#define DELTA_HEADER_SIZE 4
+#define DELTA_LENGTH_FOLLOWS 0x8000
+
+/// Fletcher-16
+static uint16_t fletcher16(const uint8_t *bytes, size_t size)
+{
+    uint16_t a = 0, b = 0;
+    for (size_t i = 0; i < size; i++) {
+        a = (a + bytes[i]) % 255;
+        b = (b + a) % 255;
+    }
+    return (b << 8) | a;
+}
+
+/// Without its top bit, to tell which keyframe a delta was made against
+static uint16_t checksum(const uint8_t *bytes, size_t size)
+{
+    return fletcher16(bytes, size) & ~DELTA_LENGTH_FOLLOWS;
+}
+
+static bool isDeltaPort(meshtastic_PortNum port)
+{
+    return port == meshtastic_PortNum_TELEMETRY_APP || port == meshtastic_PortNum_POSITION_APP ||
+           port == meshtastic_PortNum_NODEINFO_APP;
+}
+
+/// The variant of a telemetry payload, so device and environment metrics each have a keyframe of their own
+static pb_size_t variantOf(const meshtastic_Data &d)
+{
+    if (d.portnum != meshtastic_PortNum_TELEMETRY_APP)
+        return 0;
+    meshtastic_Telemetry telemetry = meshtastic_Telemetry_init_zero;
+    pb_istream_t stream = pb_istream_from_buffer(d.payload.bytes, d.payload.size);
+    return pb_decode(&stream, &meshtastic_Telemetry_msg, &telemetry) ? telemetry.which_variant : 0;
+}
+
+PayloadDelta::Reference *PayloadDelta::find(NodeNum from, meshtastic_PortNum port, pb_size_t variant)
+{
+    for (Reference &r : references) {
+        if (r.from == from && r.port == port && r.variant == variant) {
+            r.lastUsed = ++useCount;
+            return &r;
+        }
+    }
+    return nullptr;
+}
+
+void PayloadDelta::keep(const Reference &keyframe)
+{
+    Reference *r = find(keyframe.from, keyframe.port, keyframe.variant);
+    if (!r) {
+        if (references.size() < (size_t)PAYLOAD_DELTA_REFERENCES) {
+            references.emplace_back();
+            r = &references.back();
+        } else {
+            r = &references[0];
+            for (Reference &candidate : references) {
+                if (candidate.lastUsed < r->lastUsed)
+                    r = &candidate;
+            }
+        }
+    }
+    *r = keyframe;
+    r->sinceKeyframe = 0;
+    r->lastUsed = ++useCount;
+}
+
+bool PayloadDelta::makeDelta(const Reference &r, meshtastic_Data &d)
+{
+    uint8_t delta[PAYLOAD_DELTA_MAX_SIZE + DELTA_HEADER_SIZE + 1];
+    uint16_t header = checksum(r.bytes, r.size);
+    const uint16_t check = fletcher16(d.payload.bytes, d.payload.size);
+    size_t size = DELTA_HEADER_SIZE;
+    if (d.payload.size != r.size) {
+        header |= DELTA_LENGTH_FOLLOWS;
+        delta[size++] = d.payload.size;
+    }
+    delta[0] = header & 0xff;
+    delta[1] = header >> 8;
+    delta[2] = check & 0xff;
+    delta[3] = check >> 8;
+
+    uint8_t *bitmap = delta + size;
+    const size_t bitmapSize = (d.payload.size + 7) / 8;
+    memset(bitmap, 0, bitmapSize);
+    size += bitmapSize;
+    for (size_t i = 0; i < d.payload.size && size < d.payload.size; i++) {
+        const uint8_t x = d.payload.bytes[i] ^ (i < r.size ? r.bytes[i] : 0);
+        if (x) {
+            bitmap[i / 8] |= 1 << (i % 8);
+            delta[size++] = x;
+        }
+    }
+    if (size >= d.payload.size)
+        return false;
+
+    LOG_DEBUG("Delta of port %d payload %u -> %u bytes", d.portnum, d.payload.size, size);
+    memcpy(d.payload.bytes, delta, size);
+    d.payload.size = size;
+    d.bitfield |= BITFIELD_DELTA_MASK;
+    return true;
+}
+
+void PayloadDelta::compress(meshtastic_MeshPacket &p)
+{
+    meshtastic_Data &d = p.decoded;
+    if (!isDeltaPort(d.portnum) || d.payload.size > PAYLOAD_DELTA_MAX_SIZE)
+        return;
+#if RADIO_TASK
+    concurrency::LockGuard guard(&lock);
+#endif
+
+    const NodeNum from = getFrom(&p);
+    const pb_size_t variant = variantOf(d);
+    if (!isFromUs(&p)) {
+        // Relaying: it arrived as a delta, so send it on as the same delta
+        if (d.bitfield & BITFIELD_DELTA_MASK) {
+            const Reference *r = find(from, d.portnum, variant);
+            if (!r || !makeDelta(*r, d))
+                d.bitfield &= ~BITFIELD_DELTA_MASK;
+        }
+        return;
+    }
+    if (!sendDeltas)
+        return;
+
+    // A keyframe still waiting to go on air would replace the one our delta is against on every receiver, so don't
+    Pending *waiting = nullptr;
+    for (Pending &candidate : pending) {
+        if (candidate.id && candidate.keyframe.port == d.portnum && candidate.keyframe.variant == variant)
+            waiting = &candidate;
+    }
+    Reference *r = find(from, d.portnum, variant);
+    if (!waiting && r && r->sinceKeyframe + 1 < PAYLOAD_DELTA_KEYFRAME_INTERVAL && makeDelta(*r, d)) {
+        r->sinceKeyframe++;
+        return;
+    }
+
+    // Time for a keyframe, or the payload changed too much for a delta to pay off. We use it once sent() says it went on air
+    if (!waiting) {
+        waiting = &pending[0];
+        for (Pending &candidate : pending) {
+            if (waiting->id && (!candidate.id || candidate.keyframe.lastUsed < waiting->keyframe.lastUsed))
+                waiting = &candidate;
+        }
+    }
+    waiting->id = p.id;
+    waiting->keyframe.from = from;
+    waiting->keyframe.port = d.portnum;
+    waiting->keyframe.variant = variant;
+    waiting->keyframe.lastUsed = ++useCount;
+    waiting->keyframe.size = d.payload.size;
+    memcpy(waiting->keyframe.bytes, d.payload.bytes, d.payload.size);
+    d.has_bitfield = true;
+    d.bitfield |= BITFIELD_DELTA_KEYFRAME_MASK;
+}
+
+void PayloadDelta::sent(PacketId id)
+{
+#if RADIO_TASK
+    concurrency::LockGuard guard(&lock);
+#endif
+    for (Pending &candidate : pending) {
+        if (id && candidate.id == id) {
+            keep(candidate.keyframe);
+            candidate.id = 0;
+        }
+    }
+}
+
+bool PayloadDelta::expand(NodeNum from, meshtastic_Data &d)
+{
+    if (!d.has_bitfield || !isDeltaPort(d.portnum))
+        return true;
+
+    if (!(d.bitfield & (BITFIELD_DELTA_KEYFRAME_MASK | BITFIELD_DELTA_MASK)))
+        return true;
+#if RADIO_TASK
+    concurrency::LockGuard guard(&lock);
+#endif
+
+    // A copy of a packet of ours, decoded for the phone or the simulator: sent() keeps our keyframes, once they went on air
+    const bool ours = from == nodeDB->getNodeNum();
+    if (d.bitfield & BITFIELD_DELTA_KEYFRAME_MASK) {
+        if (!ours && d.payload.size <= PAYLOAD_DELTA_MAX_SIZE) {
+            Reference keyframe;
+            keyframe.from = from;
+            keyframe.port = d.portnum;
+            keyframe.variant = variantOf(d);
+            keyframe.size = d.payload.size;
+            memcpy(keyframe.bytes, d.payload.bytes, d.payload.size);
+            keep(keyframe);
+        }
+        return true;
+    }
+
+    if (d.payload.size < DELTA_HEADER_SIZE) {
+        LOG_DEBUG("Delta of port %d from 0x%x is too short", d.portnum, from);
+        return false;
+    }
+    const uint16_t sum = (d.payload.bytes[0] | (d.payload.bytes[1] << 8)) & ~DELTA_LENGTH_FOLLOWS;
+    uint8_t payload[PAYLOAD_DELTA_MAX_SIZE];
+    size_t size = 0;
+    Reference *r = nullptr;
+    for (Reference &candidate : references) {
+        // A checksum of the keyframe alone may match another, applyDelta() checks the result
+        if (candidate.from == from && candidate.port == d.portnum && checksum(candidate.bytes, candidate.size) == sum &&
+            applyDelta(candidate, d.payload, payload, size)) {
+            r = &candidate;
+            break;
+        }
+    }
+    if (!r) {
+        LOG_DEBUG("Delta of port %d from 0x%x doesn't expand against any keyframe we have", d.portnum, from);
+        return false;
+    }
+    if (!ours)
+        r->lastUsed = ++useCount;
+
+    // BITFIELD_DELTA stays set, so if we relay it, compress() knows to send it on as a delta
+    memcpy(d.payload.bytes, payload, size);
+    d.payload.size = size;
+    return true;
+}
+
+bool PayloadDelta::applyDelta(const Reference &r, const meshtastic_Data_payload_t &in, uint8_t *payload, size_t &size)
+{
+    const uint8_t *delta = in.bytes;
+    const uint16_t header = delta[0] | (delta[1] << 8);
+    const uint16_t check = delta[2] | (delta[3] << 8);
+    size_t next = DELTA_HEADER_SIZE;
+    size = r.size;
+    if (header & DELTA_LENGTH_FOLLOWS) {
+        if (next >= in.size)
+            return false;
+        size = delta[next++];
+    }
+    const uint8_t *bitmap = delta + next;
+    next += (size + 7) / 8;
+    if (size > PAYLOAD_DELTA_MAX_SIZE || next > in.size)
+        return false;
+
+    for (size_t i = 0; i < size; i++) {
+        payload[i] = i < r.size ? r.bytes[i] : 0;
+        if (bitmap[i / 8] & (1 << (i % 8))) {
+            if (next >= in.size)
+                return false;
+            payload[i] ^= delta[next++];
+        }
+    }
+    return fletcher16(payload, size) == check;
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include "MeshTypes.h"
+#include "configuration.h"
+
+#include <vector>
+
+#if RADIO_TASK
+#include "concurrency/Lock.h"
+#endif
+
+/// How many keyframes we keep, one per sender, port and telemetry variant, about 150 bytes each. The least recently used goes
+/// first. Only allocated as keyframes come in
+#ifndef PAYLOAD_DELTA_REFERENCES
+#if defined(ARCH_ESP32) || defined(ARCH_PORTDUINO)
+#define PAYLOAD_DELTA_REFERENCES 32
+#else
+#define PAYLOAD_DELTA_REFERENCES 16
+#endif
+#endif
+
+/// How many of our own keyframes can wait to go on air at once
+#ifndef PAYLOAD_DELTA_PENDING
+#define PAYLOAD_DELTA_PENDING 4
+#endif
+
+/// Larger payloads are always sent in full
+#ifndef PAYLOAD_DELTA_MAX_SIZE
+#define PAYLOAD_DELTA_MAX_SIZE 128
+#endif
+
+/// A keyframe at least this often, so a node that missed one can decode again soon
+#ifndef PAYLOAD_DELTA_KEYFRAME_INTERVAL
+#define PAYLOAD_DELTA_KEYFRAME_INTERVAL 8
+#endif
+
+/**
+ * Delta compression of the telemetry, position and nodeinfo broadcasts a node sends over and over, which barely change from
+ * one to the next.
+ *
+ * Every few broadcasts of a port go out in full, flagged as a keyframe (BITFIELD_DELTA_KEYFRAME), and every receiver keeps
+ * the last keyframe of each sender. Telemetry has a keyframe for each of its variants, since device and environment metrics
+ * take turns. The broadcasts in between (BITFIELD_DELTA) only carry the bytes that differ from the keyframe:
+ *
+ *     checksum of the keyframe (15 bits, little endian), with the top bit set if the length differs from the keyframe
+ *     checksum of the payload (16 bits, little endian), so a delta applied to the wrong keyframe is caught
+ *     the length of the payload (1 byte), if it differs
+ *     a bitmap with a bit for each byte of the payload that differs from the keyframe, then each of those bytes XORed with it
+ *
+ * Because deltas are always against a keyframe and never against the previous delta, missing some costs nothing but those
+ * packets. A receiver without the right keyframe can't decode the delta, and drops it. Relays keep the keyframes too, so
+ * they can pass deltas on unchanged. We only make deltas against a keyframe of ours once it went on air, so one that was
+ * cancelled or dropped from the queue doesn't take the deltas after it down with it.
+ *
+ * Only broadcasts are sent as deltas, and only when built with PAYLOAD_DELTA: nodes running firmware without it can't
+ * decode them, so this is for meshes where every node has it. Receiving is always supported.
+ */
+class PayloadDelta
+{
+  public:
+    /// @param sendDeltas whether our own broadcasts are compressed, relays and receiving work either way
+    explicit PayloadDelta(bool sendDeltas = PAYLOAD_DELTA) : sendDeltas(sendDeltas) {}
+
+    /**
+     * A broadcast we are about to send. With sendDeltas, our own becomes a delta if that is smaller, otherwise a keyframe.
+     * One we are relaying goes out as a delta again if it arrived as one.
+     */
+    void compress(meshtastic_MeshPacket &p);
+
+    /// One of our packets went on air: if it is a keyframe, the next deltas are against it
+    void sent(PacketId id);
+
+    /**
+     * A packet we received and decrypted: keep it if it is a keyframe, restore the full payload if it is a delta. A copy of one
+     * of ours, decoded for the phone, is only restored: our keyframes are kept by sent()
+     * @return false if it is a delta we don't have the keyframe of
+     */
+    bool expand(NodeNum from, meshtastic_Data &d);
+
+  private:
+    struct Reference {
+        NodeNum from; // 0 for unused
+        meshtastic_PortNum port;
+        pb_size_t variant; // Of a telemetry payload, 0 for other ports
+        uint32_t lastUsed;
+        uint8_t sinceKeyframe; // Deltas sent since, for our own
+        uint8_t size;
+        uint8_t bytes[PAYLOAD_DELTA_MAX_SIZE];
+    };
+
+    /// A keyframe of ours that hasn't gone on air yet
+    struct Pending {
+        PacketId id; // 0 for unused
+        Reference keyframe;
+    };
+
+    const bool sendDeltas;
+    std::vector<Reference> references;
+    Pending pending[PAYLOAD_DELTA_PENDING] = {};
+    uint32_t useCount = 0;
+#if RADIO_TASK
+    concurrency::Lock lock; // sent() is called from the radio task
+#endif
+
+    Reference *find(NodeNum from, meshtastic_PortNum port, pb_size_t variant);
+    void keep(const Reference &keyframe);
+    bool makeDelta(const Reference &r, meshtastic_Data &d);
+
+    /// Restore the payload of a delta against r into payload, @return false if it is malformed or not against r
+    static bool applyDelta(const Reference &r, const meshtastic_Data_payload_t &in, uint8_t *payload, size_t &size);
+};
+
+extern PayloadDelta payloadDelta;
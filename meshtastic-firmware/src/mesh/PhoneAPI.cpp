@@ -31,6 +31,64 @@
 #include "Throttle.h"
 #include <RTC.h>
 
+#include "concurrency/LockGuard.h"
+
+namespace
+{
+/// The cookies handed out to clients doing differential node syncs, and the NodeDB generation each one refers to
+struct NodeSyncCookie {
+    uint32_t cookie;
+    uint32_t generation;
+};
+constexpr size_t numNodeSyncCookies = 8; // enough for every client we might have connected, plus some reconnects
+NodeSyncCookie nodeSyncCookies[numNodeSyncCookies];
+size_t nextNodeSyncCookie = 0;
+
+concurrency::Lock *getNodeSyncLock()
+{
+    static concurrency::Lock lock;
+    return &lock;
+}
+
+/// Look up a cookie we handed out earlier, and forget it because the client is about to get a new one
+bool takeNodeSyncCookie(uint32_t cookie, uint32_t &generation)
+{
+    concurrency::LockGuard guard(getNodeSyncLock());
+    for (auto &c : nodeSyncCookies) {
+        if (c.cookie != 0 && c.cookie == cookie) {
+            generation = c.generation;
+            c.cookie = 0;
+            return true;
+        }
+    }
+    return false;
+}
+
+uint32_t issueNodeSyncCookie(uint32_t generation, bool differential)
+{
+    uint32_t cookie;
+    do {
+        cookie = ((uint32_t)random(0x10000) << 16) | random(0x10000);
+        cookie = differential ? (cookie | NODES_SYNC_COOKIE_DIFFERENTIAL) : (cookie & ~NODES_SYNC_COOKIE_DIFFERENTIAL);
+    } while (cookie <= SPECIAL_NONCE_NODES_SYNC); // never hand out something that looks like one of the special nonces
+
+    concurrency::LockGuard guard(getNodeSyncLock());
+    nodeSyncCookies[nextNodeSyncCookie] = {cookie, generation};
+    nextNodeSyncCookie = (nextNodeSyncCookie + 1) % numNodeSyncCookies;
+    return cookie;
+}
+} // namespace
+
+#if PHONEAPI_NODEINFO_SNAPSHOT
+/// Every node but our own, each encoded as a FromRadio node_info.  Each frame is prefixed with the generation the node last
+/// changed at (32 bits) and its length (16 bits), both big endian.
+struct NodeInfoSnapshot {
+    uint32_t generation = 0;
+    size_t numNodes = 0;
+    std::vector<uint8_t> frames;
+};
+#endif
+
 PhoneAPI::PhoneAPI()
 {
     lastContactMsec = millis();
@@ -53,8 +111,21 @@ void PhoneAPI::handleStartConfig()
 #endif
     }
 
+    nodeSync = false;
+    nodeSyncSince = 0;
+    nodeSyncGeneration = nodeDB->getGeneration();
+    uint32_t since;
+    if (config_nonce == SPECIAL_NONCE_NODES_SYNC) {
+        nodeSync = true;
+    } else if (takeNodeSyncCookie(config_nonce, since)) {
+        nodeSync = true;
+        // A list of just the changes can't tell the client about nodes that are gone, so send everything in that case
+        nodeSyncSince = nodeDB->hasRemovedSince(since) ? 0 : since;
+        LOG_INFO("Client wants nodes changed since generation %u, sending %s", since, nodeSyncSince ? "changes" : "all nodes");
+    }
+
     // even if we were already connected - restart our state machine
-    if (config_nonce == SPECIAL_NONCE_ONLY_NODES) {
+    if (onlyNodes()) {
         // If client only wants node info, jump directly to sending nodes
         state = STATE_SEND_OWN_NODEINFO;
         LOG_INFO("Client only wants node info, skipping other config");
@@ -70,6 +141,9 @@ void PhoneAPI::handleStartConfig()
     LOG_INFO("Start API client config");
     nodeInfoForPhone.num = 0; // Don't keep returning old nodeinfos
     resetReadIndex();
+#if PHONEAPI_NODEINFO_SNAPSHOT
+    nodeInfoSnapshot.reset();
+#endif
 }
 
 void PhoneAPI::close()
@@ -91,11 +165,15 @@ void PhoneAPI::close()
         fromRadioScratch = {};
         toRadioScratch = {};
         nodeInfoForPhone = {};
+#if PHONEAPI_NODEINFO_SNAPSHOT
+        nodeInfoSnapshot.reset();
+#endif
         packetForPhone = NULL;
         filesManifest.clear();
         fromRadioNum = 0;
         config_nonce = 0;
         config_state = 0;
+        nodeSync = false;
         pauseBluetoothLogging = false;
     }
 }
@@ -230,7 +308,7 @@ size_t PhoneAPI::getFromRadio(uint8_t *buf)
             // Should allow us to resume sending NodeInfo in STATE_SEND_OTHER_NODEINFOS
             nodeInfoForPhone.num = 0;
         }
-        if (config_nonce == SPECIAL_NONCE_ONLY_NODES) {
+        if (onlyNodes()) {
             // If client only wants node info, jump directly to sending nodes
             state = STATE_SEND_OTHER_NODEINFOS;
         } else {
@@ -413,6 +491,26 @@ size_t PhoneAPI::getFromRadio(uint8_t *buf)
 
     case STATE_SEND_OTHER_NODEINFOS: {
         LOG_DEBUG("Send known nodes");
+#if PHONEAPI_NODEINFO_SNAPSHOT
+        if (nodeInfoSnapshot) {
+            const std::vector<uint8_t> &frames = nodeInfoSnapshot->frames;
+            while (nodeInfoSnapshotPos + 6 <= frames.size()) {
+                const uint8_t *frame = &frames[nodeInfoSnapshotPos];
+                uint32_t nodeGeneration = ((uint32_t)frame[0] << 24) | (frame[1] << 16) | (frame[2] << 8) | frame[3];
+                size_t numbytes = (frame[4] << 8) | frame[5];
+                nodeInfoSnapshotPos += 6 + numbytes;
+                if (wantsNode(nodeGeneration)) {
+                    // Already encoded, so just hand over the bytes
+                    memcpy(buf, frame + 6, numbytes);
+                    return numbytes;
+                }
+            }
+            LOG_DEBUG("Done sending nodeinfo");
+            nodeInfoSnapshot.reset();
+            state = STATE_SEND_FILEMANIFEST;
+            return getFromRadio(buf);
+        }
+#endif
         if (nodeInfoForPhone.num != 0) {
             LOG_INFO("nodeinfo: num=0x%x, lastseen=%u, id=%s, name=%s", nodeInfoForPhone.num, nodeInfoForPhone.last_heard,
                      nodeInfoForPhone.user.id, nodeInfoForPhone.user.long_name);
@@ -432,8 +530,7 @@ size_t PhoneAPI::getFromRadio(uint8_t *buf)
     case STATE_SEND_FILEMANIFEST: {
         LOG_DEBUG("FromRadio=STATE_SEND_FILEMANIFEST");
         // last element
-        if (config_state == filesManifest.size() ||
-            config_nonce == SPECIAL_NONCE_ONLY_NODES) { // also handles an empty filesManifest
+        if (config_state == filesManifest.size() || onlyNodes()) { // also handles an empty filesManifest
             config_state = 0;
             filesManifest.clear();
             // Skip to complete packet
@@ -504,6 +601,10 @@ void PhoneAPI::sendConfigComplete()
     LOG_INFO("Config Send Complete");
     fromRadioScratch.which_payload_variant = meshtastic_FromRadio_config_complete_id_tag;
     fromRadioScratch.config_complete_id = config_nonce;
+    if (nodeSync) {
+        fromRadioScratch.config_complete_id = issueNodeSyncCookie(nodeSyncGeneration, nodeSyncSince != 0);
+        nodeSync = false;
+    }
     config_nonce = 0;
     state = STATE_SEND_PACKETS;
     pauseBluetoothLogging = false;
@@ -561,8 +662,16 @@ bool PhoneAPI::available()
         return true;
 
     case STATE_SEND_OTHER_NODEINFOS:
+#if PHONEAPI_NODEINFO_SNAPSHOT
+        if (!nodeInfoSnapshot) {
+            nodeInfoSnapshot = getNodeInfoSnapshot();
+            nodeInfoSnapshotPos = 0;
+        }
+#else
         if (nodeInfoForPhone.num == 0) {
             auto nextNode = nodeDB->readNextMeshNode(readIndex);
+            while (nextNode && !wantsNode(nodeDB->getNodeGeneration(readIndex - 1)))
+                nextNode = nodeDB->readNextMeshNode(readIndex);
             if (nextNode) {
                 nodeInfoForPhone = TypeConversions::ConvertToNodeInfo(nextNode);
                 bool isUs = nodeInfoForPhone.num == nodeDB->getNodeNum();
@@ -573,6 +682,7 @@ bool PhoneAPI::available()
                 nodeInfoForPhone.is_favorite = nodeInfoForPhone.is_favorite || isUs; // Our node is always a favorite
             }
         }
+#endif
         return true; // Always say we have something, because we might need to advance our state machine
     case STATE_SEND_PACKETS: {
         if (!queueStatusPacketForPhone)
@@ -614,6 +724,54 @@ bool PhoneAPI::available()
     return false;
 }
 
+#if PHONEAPI_NODEINFO_SNAPSHOT
+std::shared_ptr<const NodeInfoSnapshot> PhoneAPI::getNodeInfoSnapshot()
+{
+    static concurrency::Lock snapshotLock;
+    static std::shared_ptr<const NodeInfoSnapshot> cached;
+    // Too big for the stack of some of the threads that serve clients, so these are only used with snapshotLock held
+    static meshtastic_FromRadio fromRadio;
+    static uint8_t encoded[meshtastic_FromRadio_size];
+
+    concurrency::LockGuard guard(&snapshotLock);
+    const uint32_t generation = nodeDB->getGeneration();
+    if (cached && cached->generation == generation) {
+        LOG_DEBUG("NodeDB unchanged, reuse encoded node list (%u nodes)", cached->numNodes);
+        return cached;
+    }
+
+    auto snapshot = std::make_shared<NodeInfoSnapshot>();
+    snapshot->generation = generation;
+    snapshot->frames.reserve(nodeDB->getNumMeshNodes() * 128);
+    for (size_t i = 0; i < nodeDB->getNumMeshNodes(); i++) {
+        const meshtastic_NodeInfoLite *node = nodeDB->getMeshNodeByIndex(i);
+        if (node->num == nodeDB->getNodeNum())
+            continue; // Sent by itself in STATE_SEND_OWN_NODEINFO
+
+        fromRadio = {};
+        fromRadio.which_payload_variant = meshtastic_FromRadio_node_info_tag;
+        fromRadio.node_info = TypeConversions::ConvertToNodeInfo(node);
+        size_t numbytes = pb_encode_to_bytes(encoded, sizeof(encoded), &meshtastic_FromRadio_msg, &fromRadio);
+        if (numbytes == 0)
+            continue;
+        const uint32_t nodeGeneration = nodeDB->getNodeGeneration(i);
+        snapshot->frames.push_back(nodeGeneration >> 24);
+        snapshot->frames.push_back(nodeGeneration >> 16);
+        snapshot->frames.push_back(nodeGeneration >> 8);
+        snapshot->frames.push_back(nodeGeneration);
+        snapshot->frames.push_back(numbytes >> 8);
+        snapshot->frames.push_back(numbytes & 0xff);
+        snapshot->frames.insert(snapshot->frames.end(), encoded, encoded + numbytes);
+        snapshot->numNodes++;
+    }
+    LOG_INFO("Encoded node list for clients: %u nodes, %u bytes, generation %u", snapshot->numNodes, snapshot->frames.size(),
+             generation);
+
+    cached = snapshot;
+    return cached;
+}
+#endif
+
 void PhoneAPI::sendNotification(meshtastic_LogRecord_Level level, uint32_t replyId, const char *message)
 {
     meshtastic_ClientNotification *cn = clientNotificationPool.allocZeroed();
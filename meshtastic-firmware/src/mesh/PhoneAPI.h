@@ -4,6 +4,7 @@
 #include "mesh-pb-constants.h"
 #include "meshtastic/portnums.pb.h"
 #include <iterator>
+#include <memory>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -21,6 +22,27 @@
 #define SPECIAL_NONCE_ONLY_CONFIG 69420
 #define SPECIAL_NONCE_ONLY_NODES 69421 // ( ͡° ͜ʖ ͡°)
 
+/**
+ * Differential node sync.  A client that wants it sends want_config_id = SPECIAL_NONCE_NODES_SYNC the first time.  That is
+ * answered like SPECIAL_NONCE_ONLY_NODES, except that config_complete_id is a sync cookie rather than the nonce.  On the next
+ * connect the client sends the cookie as its want_config_id and only gets the nodes that changed since the cookie was issued,
+ * plus a new cookie.  A cookie with the lowest bit clear means the full node list was sent and the client should drop the
+ * nodes it did not receive, which happens if the cookie is unknown (e.g. after a reboot) or nodes were removed since.
+ */
+#define SPECIAL_NONCE_NODES_SYNC 69422
+#define NODES_SYNC_COOKIE_DIFFERENTIAL 1
+
+// Send the node list from a pre-encoded snapshot shared by all clients, on targets with enough RAM to keep one around
+#ifndef PHONEAPI_NODEINFO_SNAPSHOT
+#if defined(ARCH_PORTDUINO) || (defined(ARCH_ESP32) && defined(BOARD_HAS_PSRAM))
+#define PHONEAPI_NODEINFO_SNAPSHOT 1
+#else
+#define PHONEAPI_NODEINFO_SNAPSHOT 0
+#endif
+#endif
+
+struct NodeInfoSnapshot;
+
 /**
  * Provides our protobuf based API which phone/PC clients can use to talk to our device
  * over UDP, bluetooth or serial.
@@ -91,6 +113,28 @@ class PhoneAPI
 
     void resetReadIndex() { readIndex = 0; }
 
+    /// The client asked for a differential node sync, see SPECIAL_NONCE_NODES_SYNC
+    bool nodeSync = false;
+    /// Only nodes changed after this generation are sent, 0 for all of them
+    uint32_t nodeSyncSince = 0;
+    /// The NodeDB generation the sync started at, which the cookie we hand out at the end refers to
+    uint32_t nodeSyncGeneration = 0;
+
+    /// True if the client only asked for node info
+    bool onlyNodes() { return config_nonce == SPECIAL_NONCE_ONLY_NODES || nodeSync; }
+
+    /// True if a node last changed at the given generation should be sent to this client
+    bool wantsNode(uint32_t nodeGeneration) { return !nodeSync || nodeSyncSince == 0 || nodeGeneration > nodeSyncSince; }
+
+#if PHONEAPI_NODEINFO_SNAPSHOT
+    /// The node list this client is downloading in STATE_SEND_OTHER_NODEINFOS, and how far into it we are
+    std::shared_ptr<const NodeInfoSnapshot> nodeInfoSnapshot;
+    size_t nodeInfoSnapshotPos = 0;
+
+    /// Get the snapshot for the current NodeDB generation, encoding a new one only if the DB changed since the last call
+    static std::shared_ptr<const NodeInfoSnapshot> getNodeInfoSnapshot();
+#endif
+
   public:
     PhoneAPI();
 
@@ -163,6 +163,12 @@ const RegionInfo regions[] = {
 const RegionInfo *myRegion;
 bool RadioInterface::uses_default_frequency_slot = true;
 
+constexpr uint8_t RadioInterface::NUM_SYM_CAD;
+constexpr uint8_t RadioInterface::NUM_SYM_CAD_24GHZ;
+constexpr uint32_t RadioInterface::PROCESSING_TIME_MSEC;
+constexpr uint8_t RadioInterface::CWmin;
+constexpr uint8_t RadioInterface::CWmax;
+
 static uint8_t bytes[MAX_LORA_PAYLOAD_LEN + 1];
 
 void initRegion()
@@ -199,6 +205,11 @@ separated by 2.16 MHz with respect to the adjacent channels. Channel zero starts
  * @return num msecs for the packet
  */
 uint32_t RadioInterface::getPacketTime(uint32_t pl)
+{
+    return getPacketTime(pl, bw, sf, cr, preambleLength);
+}
+
+uint32_t RadioInterface::getPacketTime(uint32_t pl, float bw, uint8_t sf, uint8_t cr, uint16_t preambleLength)
 {
     float bandwidthHz = bw * 1000.0f;
     bool headDisable = false; // we currently always use the header
@@ -234,9 +245,13 @@ uint32_t RadioInterface::getRetransmissionMsec(const meshtastic_MeshPacket *p)
 {
     size_t numbytes = pb_encode_to_bytes(bytes, sizeof(bytes), &meshtastic_Data_msg, &p->decoded);
     uint32_t packetAirtime = getPacketTime(numbytes + sizeof(PacketHeader));
-    // Make sure enough time has elapsed for this packet to be sent and an ACK is received.
     // LOG_DEBUG("Waiting for flooding message with airtime %d and slotTime is %d", packetAirtime, slotTimeMsec);
-    float channelUtil = airTime->channelUtilizationPercent();
+    return getRetransmissionMsec(packetAirtime, airTime->channelUtilizationPercent(), slotTimeMsec);
+}
+
+uint32_t RadioInterface::getRetransmissionMsec(uint32_t packetAirtime, float channelUtil, uint32_t slotTimeMsec)
+{
+    // Make sure enough time has elapsed for this packet to be sent and an ACK is received.
     uint8_t CWsize = map(channelUtil, 0, 100, CWmin, CWmax);
     // Assuming we pick max. of CWsize and there will be a client with SNR at half the range
     return 2 * packetAirtime + (pow(2, CWsize) + 2 * CWmax + pow(2, int((CWmax + CWmin) / 2))) * slotTimeMsec +
@@ -249,7 +264,11 @@ uint32_t RadioInterface::getTxDelayMsec()
     /** We wait a random multiple of 'slotTimes' (see definition in header file) in order to avoid collisions.
     The pool to take a random multiple from is the contention window (CW), which size depends on the
     current channel utilization. */
-    float channelUtil = airTime->channelUtilizationPercent();
+    return getTxDelayMsec(airTime->channelUtilizationPercent(), slotTimeMsec);
+}
+
+uint32_t RadioInterface::getTxDelayMsec(float channelUtil, uint32_t slotTimeMsec)
+{
     uint8_t CWsize = map(channelUtil, 0, 100, CWmin, CWmax);
     // LOG_DEBUG("Current channel utilization is %f so setting CWsize to %d", channelUtil, CWsize);
     return random(0, pow(2, CWsize)) * slotTimeMsec;
@@ -278,24 +297,29 @@ uint32_t RadioInterface::getTxDelayMsecWeightedWorst(float snr)
 /** The delay to use when we want to flood a message */
 uint32_t RadioInterface::getTxDelayMsecWeighted(float snr)
 {
-    //  high SNR = large CW size (Long Delay)
-    //  low SNR = small CW size (Short Delay)
-    uint32_t delay = 0;
-    uint8_t CWsize = getCWsize(snr);
-    // LOG_DEBUG("rx_snr of %f so setting CWsize to:%d", snr, CWsize);
-    if (config.device.role == meshtastic_Config_DeviceConfig_Role_ROUTER ||
-        config.device.role == meshtastic_Config_DeviceConfig_Role_REPEATER) {
-        delay = random(0, 2 * CWsize) * slotTimeMsec;
+    bool isRouter = config.device.role == meshtastic_Config_DeviceConfig_Role_ROUTER ||
+                    config.device.role == meshtastic_Config_DeviceConfig_Role_REPEATER;
+    uint32_t delay = getTxDelayMsecWeighted(snr, isRouter, slotTimeMsec);
+    if (isRouter)
         LOG_DEBUG("rx_snr found in packet. Router: setting tx delay:%d", delay);
-    } else {
-        // offset the maximum delay for routers: (2 * CWmax * slotTimeMsec)
-        delay = (2 * CWmax * slotTimeMsec) + random(0, pow(2, CWsize)) * slotTimeMsec;
+    else
         LOG_DEBUG("rx_snr found in packet. Setting tx delay:%d", delay);
-    }
 
     return delay;
 }
 
+uint32_t RadioInterface::getTxDelayMsecWeighted(float snr, bool isRouter, uint32_t slotTimeMsec)
+{
+    //  high SNR = large CW size (Long Delay)
+    //  low SNR = small CW size (Short Delay)
+    uint8_t CWsize = getCWsize(snr);
+    // LOG_DEBUG("rx_snr of %f so setting CWsize to:%d", snr, CWsize);
+    if (isRouter)
+        return random(0, 2 * CWsize) * slotTimeMsec;
+    // offset the maximum delay for routers: (2 * CWmax * slotTimeMsec)
+    return (2 * CWmax * slotTimeMsec) + random(0, pow(2, CWsize)) * slotTimeMsec;
+}
+
 void printPacket(const char *prefix, const meshtastic_MeshPacket *p)
 {
 #if defined(DEBUG_PORT) && !defined(DEBUG_MUTE)
@@ -383,6 +407,10 @@ bool RadioInterface::init()
 
 int RadioInterface::notifyDeepSleepCb(void *unused)
 {
+#if RADIO_TASK
+    concurrency::LockGuard deviceGuard(&deviceLock);
+    concurrency::LockGuard guard(&radioLock);
+#endif
     sleep();
     return 0;
 }
@@ -587,11 +615,16 @@ void RadioInterface::applyModemConfig()
   - Tx/Rx turnaround time (maximum of SX126x and SX127x);
   - MAC processing time (measured on T-beam) */
 uint32_t RadioInterface::computeSlotTimeMsec()
+{
+    return computeSlotTimeMsec(bw, sf, myRegion->wideLora);
+}
+
+uint32_t RadioInterface::computeSlotTimeMsec(float bw, uint8_t sf, bool wideLora)
 {
     float sumPropagationTurnaroundMACTime = 0.2 + 0.4 + 7; // in milliseconds
     float symbolTime = pow(2, sf) / bw;                    // in milliseconds
 
-    if (myRegion->wideLora) {
+    if (wideLora) {
         // CAD duration derived from AN1200.22 of SX1280
         return (NUM_SYM_CAD_24GHZ + (2 * sf + 3) / 32) * symbolTime + sumPropagationTurnaroundMACTime;
     } else {
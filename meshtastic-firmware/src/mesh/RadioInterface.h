@@ -5,8 +5,13 @@
 #include "Observer.h"
 #include "PointerQueue.h"
 #include "airtime.h"
+#include "configuration.h"
 #include "error.h"
 
+#if RADIO_TASK
+#include "concurrency/LockGuard.h"
+#endif
+
 #define MAX_TX_QUEUE 16 // max number of packets which can be waiting for transmission
 
 #define MAX_LORA_PAYLOAD_LEN 255 // max length of 255 per Semtech's datasheets on SX12xx
@@ -84,20 +89,30 @@ class RadioInterface
     uint8_t sf = 9;
     uint8_t cr = 5;
 
-    const uint8_t NUM_SYM_CAD = 2;       // Number of symbols used for CAD, 2 is the default since RadioLib 6.3.0 as per AN1200.48
-    const uint8_t NUM_SYM_CAD_24GHZ = 4; // Number of symbols used for CAD in 2.4 GHz, 4 is recommended in AN1200.22 of SX1280
+    static constexpr uint8_t NUM_SYM_CAD = 2; // Number of symbols used for CAD, 2 is the default since RadioLib 6.3.0 as per AN1200.48
+    static constexpr uint8_t NUM_SYM_CAD_24GHZ =
+        4; // Number of symbols used for CAD in 2.4 GHz, 4 is recommended in AN1200.22 of SX1280
     uint32_t slotTimeMsec = computeSlotTimeMsec();
     uint16_t preambleLength = 16;      // 8 is default, but we use longer to increase the amount of sleep time when receiving
     uint32_t preambleTimeMsec = 165;   // calculated on startup, this is the default for LongFast
     uint32_t maxPacketTimeMsec = 3246; // calculated on startup, this is the default for LongFast
-    const uint32_t PROCESSING_TIME_MSEC =
-        4500;                // time to construct, process and construct a packet again (empirically determined)
-    const uint8_t CWmin = 3; // minimum CWsize
-    const uint8_t CWmax = 8; // maximum CWsize
+    static constexpr uint32_t PROCESSING_TIME_MSEC =
+        4500;                           // time to construct, process and construct a packet again (empirically determined)
+    static constexpr uint8_t CWmin = 3; // minimum CWsize
+    static constexpr uint8_t CWmax = 8; // maximum CWsize
 
     meshtastic_MeshPacket *sendingPacket = NULL; // The packet we are currently sending
     uint32_t lastTxStart = 0L;
 
+#if RADIO_TASK
+    /// Guards the TX queue, the packet counters and when the radio task runs next. The radio task lets go of it for SPI
+    /// transfers, so the main loop is only kept waiting while the queue is being changed
+    concurrency::Lock radioLock;
+    /// Held by the radio task while it runs, and by the main loop while it reconfigures the radio or puts it to sleep. Taken
+    /// before radioLock
+    concurrency::Lock deviceLock;
+#endif
+
     uint32_t computeSlotTimeMsec();
 
     /**
@@ -175,7 +190,7 @@ class RadioInterface
     uint32_t getTxDelayMsec();
 
     /** The CW to use when calculating SNR_based delays */
-    uint8_t getCWsize(float snr);
+    static uint8_t getCWsize(float snr);
 
     /** The worst-case SNR_based packet delay */
     uint32_t getTxDelayMsecWeightedWorst(float snr);
@@ -196,6 +211,16 @@ class RadioInterface
     uint32_t getPacketTime(const meshtastic_MeshPacket *p);
     uint32_t getPacketTime(uint32_t totalPacketLen);
 
+    /*
+     * The timing above for given modem settings and channel utilization rather than ours, for modelling other radios (see
+     * MeshSim). The delays are random, drawn with random().
+     */
+    static uint32_t getPacketTime(uint32_t totalPacketLen, float bw, uint8_t sf, uint8_t cr, uint16_t preambleLength);
+    static uint32_t computeSlotTimeMsec(float bw, uint8_t sf, bool wideLora);
+    static uint32_t getRetransmissionMsec(uint32_t packetAirtime, float channelUtil, uint32_t slotTimeMsec);
+    static uint32_t getTxDelayMsec(float channelUtil, uint32_t slotTimeMsec);
+    static uint32_t getTxDelayMsecWeighted(float snr, bool isRouter, uint32_t slotTimeMsec);
+
     /**
      * Get the channel we saved.
      */
@@ -257,6 +282,10 @@ class RadioInterface
 
     int reloadConfig(void *unused)
     {
+#if RADIO_TASK
+        concurrency::LockGuard deviceGuard(&deviceLock);
+        concurrency::LockGuard guard(&radioLock);
+#endif
         reconfigure();
         return 0;
     }
@@ -1,6 +1,7 @@
 #include "RadioLibInterface.h"
 #include "MeshTypes.h"
 #include "NodeDB.h"
+#include "PayloadDelta.h"
 #include "PowerMon.h"
 #include "SPILock.h"
 #include "Throttle.h"
@@ -15,6 +16,14 @@
 #include "PortduinoGlue.h"
 #include "meshUtils.h"
 #endif
+#if RADIO_TASK
+#include "Router.h"
+#include "concurrency/ThreadStatsReporter.h"
+#include <algorithm>
+#ifdef ARCH_PORTDUINO
+#include <thread>
+#endif
+#endif
 void LockingArduinoHal::spiBeginTransaction()
 {
     spiLock->lock();
@@ -37,9 +46,13 @@ void LockingArduinoHal::spiTransfer(uint8_t *out, size_t len, uint8_t *in)
 
 RadioLibInterface::RadioLibInterface(LockingArduinoHal *hal, RADIOLIB_PIN_TYPE cs, RADIOLIB_PIN_TYPE irq, RADIOLIB_PIN_TYPE rst,
                                      RADIOLIB_PIN_TYPE busy, PhysicalLayer *_iface)
-    : NotifiedWorkerThread("RadioIf"), module(hal, cs, irq, rst, busy), iface(_iface)
+    : NotifiedWorkerThread("RadioIf", RADIO_TASK ? nullptr : &concurrency::mainController), module(hal, cs, irq, rst, busy),
+      iface(_iface)
 {
     instance = this;
+#if RADIO_TASK
+    wakeDelay = &taskDelay;
+#endif
 #if defined(ARCH_STM32WL) && defined(USE_SX1262)
     module.setCb_digitalWrite(stm32wl_emulate_digitalWrite);
     module.setCb_digitalRead(stm32wl_emulate_digitalRead);
@@ -80,6 +93,37 @@ void INTERRUPT_ATTR RadioLibInterface::isrTxLevel0()
  */
 RadioLibInterface *RadioLibInterface::instance;
 
+#if RADIO_TASK
+void RadioLibInterface::startTask()
+{
+#ifdef ARCH_ESP32
+    xTaskCreatePinnedToCore([](void *) { instance->taskLoop(); }, "radio", RADIO_TASK_STACK, NULL, RADIO_TASK_PRIORITY, NULL,
+                            RADIO_TASK_CORE);
+#else
+    std::thread([this] { taskLoop(); }).detach();
+#endif
+    concurrency::ThreadStatsReporter::addThread(this);
+    LOG_INFO("Radio runs on its own task");
+}
+
+void RadioLibInterface::taskLoop()
+{
+    while (true) {
+        int32_t wait;
+        {
+            // onNotify() lets go of radioLock for the SPI transfers, deviceLock keeps the main loop off the radio meanwhile
+            concurrency::LockGuard deviceGuard(&deviceLock);
+            concurrency::LockGuard guard(&radioLock);
+            if (shouldRun(millis()))
+                run();
+            wait = enabled ? (int32_t)tillRun(millis()) : RADIO_TASK_IDLE_MS;
+        }
+        if (wait > 0)
+            taskDelay.delay(std::min<int32_t>(wait, RADIO_TASK_IDLE_MS));
+    }
+}
+#endif
+
 /** Could we send right now (i.e. either not actively receiving or transmitting)? */
 bool RadioLibInterface::canSendImmediately()
 {
@@ -171,6 +215,9 @@ ErrorCode RadioLibInterface::send(meshtastic_MeshPacket *p)
 #ifndef LORA_DISABLE_SENDING
     printPacket("enqueue for send", p);
 
+#if RADIO_TASK
+    concurrency::LockGuard guard(&radioLock);
+#endif
     LOG_DEBUG("txGood=%d,txRelay=%d,rxGood=%d,rxBad=%d", txGood, txRelay, rxGood, rxBad);
     ErrorCode res = txQueue.enqueue(p) ? ERRNO_OK : ERRNO_UNKNOWN;
 
@@ -193,6 +240,9 @@ ErrorCode RadioLibInterface::send(meshtastic_MeshPacket *p)
 meshtastic_QueueStatus RadioLibInterface::getQueueStatus()
 {
     meshtastic_QueueStatus qs;
+#if RADIO_TASK
+    concurrency::LockGuard guard(&radioLock);
+#endif
 
     qs.res = qs.mesh_packet_id = 0;
     qs.free = txQueue.getFree();
@@ -203,6 +253,9 @@ meshtastic_QueueStatus RadioLibInterface::getQueueStatus()
 
 bool RadioLibInterface::canSleep()
 {
+#if RADIO_TASK
+    concurrency::LockGuard guard(&radioLock);
+#endif
     bool res = txQueue.empty();
     if (!res) { // only print debug messages if we are vetoing sleep
         LOG_DEBUG("Radio wait to sleep, txEmpty=%d", res);
@@ -221,6 +274,9 @@ bool RadioLibInterface::isSending()
 /** Attempt to cancel a previously sent packet.  Returns true if a packet was found we could cancel */
 bool RadioLibInterface::cancelSending(NodeNum from, PacketId id)
 {
+#if RADIO_TASK
+    concurrency::LockGuard guard(&radioLock);
+#endif
     auto p = txQueue.remove(from, id);
     if (p)
         packetPool.release(p); // free the packet we just removed
@@ -233,9 +289,23 @@ bool RadioLibInterface::cancelSending(NodeNum from, PacketId id)
 /** Attempt to find a packet in the TxQueue. Returns true if the packet was found. */
 bool RadioLibInterface::findInTxQueue(NodeNum from, PacketId id)
 {
+#if RADIO_TASK
+    concurrency::LockGuard guard(&radioLock);
+#endif
     return txQueue.find(from, id);
 }
 
+void RadioLibInterface::getPacketCounts(meshtastic_LocalStats &stats)
+{
+#if RADIO_TASK
+    concurrency::LockGuard guard(&radioLock);
+#endif
+    stats.num_packets_tx = txGood;
+    stats.num_packets_rx = rxGood + rxBad;
+    stats.num_packets_rx_bad = rxBad;
+    stats.num_tx_relay = txRelay;
+}
+
 /** radio helper thread callback.
 We never immediately transmit after any operation (either Rx or Tx). Instead we should wait a random multiple of
 'slotTimes' (see definition in RadioInterface.h) taken from a contention window (CW) to lower the chance of collision.
@@ -248,12 +318,12 @@ void RadioLibInterface::onNotify(uint32_t notification)
     switch (notification) {
     case ISR_TX:
         handleTransmitInterrupt();
-        startReceive();
+        startReceiveUnlocked();
         setTransmitDelay();
         break;
     case ISR_RX:
         handleReceiveInterrupt();
-        startReceive();
+        startReceiveUnlocked();
         setTransmitDelay();
         break;
     case TRANSMIT_DELAY_COMPLETED:
@@ -271,14 +341,22 @@ void RadioLibInterface::onNotify(uint32_t notification)
                     // There's still some delay pending on this packet, so resume waiting for it to elapse
                     notifyLater(delay_remaining, TRANSMIT_DELAY_COMPLETED, false);
                 } else {
-                    if (isChannelActive()) { // check if there is currently a LoRa packet on the channel
-                        startReceive();      // try receiving this packet, afterwards we'll be trying to transmit again
+                    bool channelActive;
+                    {
+#if RADIO_TASK
+                        concurrency::UnlockGuard unlocked(&radioLock);
+#endif
+                        channelActive = isChannelActive(); // check if there is currently a LoRa packet on the channel
+                    }
+                    if (channelActive) {
+                        startReceiveUnlocked(); // try receiving this packet, afterwards we'll be trying to transmit again
                         setTransmitDelay();
                     } else {
                         // Send any outgoing packets we have ready as fast as possible to keep the time between channel scan and
                         // actual transmission as short as possible
                         txp = txQueue.dequeue();
-                        assert(txp);
+                        if (!txp)
+                            break; // Cancelled by the main loop while we checked the channel
                         bool sent = startSend(txp);
                         if (sent) {
                             // Packet has been sent, count it toward our TX airtime utilization.
@@ -350,6 +428,9 @@ void RadioLibInterface::startTransmitTimerSNR(float snr)
  */
 void RadioLibInterface::clampToLateRebroadcastWindow(NodeNum from, PacketId id)
 {
+#if RADIO_TASK
+    concurrency::LockGuard guard(&radioLock);
+#endif
     // Look for non-late packets only, so we don't do this twice!
     meshtastic_MeshPacket *p = txQueue.remove(from, id, true, false);
     if (p) {
@@ -366,8 +447,11 @@ void RadioLibInterface::handleTransmitInterrupt()
 {
     // This can be null if we forced the device to enter standby mode.  In that case
     // ignore the transmit interrupt
-    if (sendingPacket)
+    if (sendingPacket) {
+        if (isFromUs(sendingPacket))
+            payloadDelta.sent(sendingPacket->id); // It went on air, so receivers have it if it is a keyframe
         completeSending();
+    }
     powerMon->clearState(meshtastic_PowerMon_State_Lora_TXOn); // But our transmitter is definitely off now
 }
 
@@ -415,7 +499,13 @@ void RadioLibInterface::handleReceiveInterrupt()
     }
 #endif
 
-    int state = iface->readData((uint8_t *)&radioBuffer, length);
+    int state;
+    {
+#if RADIO_TASK
+        concurrency::UnlockGuard unlocked(&radioLock); // Only called from onNotify(), which holds it
+#endif
+        state = iface->readData((uint8_t *)&radioBuffer, length);
+    }
 #if ARCH_PORTDUINO
     if (settingsMap[logoutputlevel] == level_trace) {
         printBytes("Raw incoming packet: ", (uint8_t *)&radioBuffer, length);
@@ -475,11 +565,24 @@ void RadioLibInterface::handleReceiveInterrupt()
 
             airTime->logAirtime(RX_LOG, xmitMsec);
 
+#if RADIO_TASK
+            if (router)
+                router->enqueueFromRadioTask(mp);
+#else
             deliverToReceiver(mp);
+#endif
         }
     }
 }
 
+void RadioLibInterface::startReceiveUnlocked()
+{
+#if RADIO_TASK
+    concurrency::UnlockGuard unlocked(&radioLock);
+#endif
+    startReceive();
+}
+
 void RadioLibInterface::startReceive()
 {
     isReceiving = true;
@@ -512,7 +615,13 @@ bool RadioLibInterface::startSend(meshtastic_MeshPacket *txp)
 
         size_t numbytes = beginSending(txp);
 
-        int res = iface->startTransmit((uint8_t *)&radioBuffer, numbytes);
+        int res;
+        {
+#if RADIO_TASK
+            concurrency::UnlockGuard unlocked(&radioLock); // Only called from onNotify(), which holds it
+#endif
+            res = iface->startTransmit((uint8_t *)&radioBuffer, numbytes);
+        }
         if (res != RADIOLIB_ERR_NONE) {
             LOG_ERROR("startTransmit failed, error=%d", res);
             RECORD_CRITICALERROR(meshtastic_CriticalErrorCode_RADIO_SPI_BUG);
@@ -3,6 +3,7 @@
 #include "MeshPacketQueue.h"
 #include "RadioInterface.h"
 #include "concurrency/NotifiedWorkerThread.h"
+#include "mesh/generated/meshtastic/telemetry.pb.h"
 
 #include <RadioLib.h>
 #include <sys/types.h>
@@ -16,6 +17,19 @@
 
 #define RADIOLIB_PIN_TYPE uint32_t
 
+#if RADIO_TASK
+#ifndef RADIO_TASK_STACK
+#define RADIO_TASK_STACK 8192
+#endif
+#ifndef RADIO_TASK_PRIORITY
+#define RADIO_TASK_PRIORITY (tskIDLE_PRIORITY + 2) // Above the main loop
+#endif
+// Longest the radio task sleeps without being notified
+#ifndef RADIO_TASK_IDLE_MS
+#define RADIO_TASK_IDLE_MS 1000
+#endif
+#endif
+
 // In addition to the default Rx flags, we need the PREAMBLE_DETECTED flag to detect whether we are actively receiving
 #define MESHTASTIC_RADIOLIB_IRQ_RX_FLAGS (RADIOLIB_IRQ_RX_DEFAULT_FLAGS | (1 << RADIOLIB_IRQ_PREAMBLE_DETECTED))
 
@@ -60,6 +74,13 @@ class RadioLibInterface : public RadioInterface, protected concurrency::Notified
 
     MeshPacketQueue txQueue = MeshPacketQueue(MAX_TX_QUEUE);
 
+#if RADIO_TASK
+    /// Wakes the radio task when we are notified
+    concurrency::InterruptableDelay taskDelay;
+
+    void taskLoop();
+#endif
+
   protected:
     /**
      * We use a meshtastic sync word, but hashed with the Channel name.  For releases before 1.2 we used 0x12 (or for very old
@@ -146,6 +167,17 @@ class RadioLibInterface : public RadioInterface, protected concurrency::Notified
     /** Attempt to find a packet in the TxQueue. Returns true if the packet was found. */
     virtual bool findInTxQueue(NodeNum from, PacketId id) override;
 
+    /// Copy the packet counts into stats, all from the same moment
+    void getPacketCounts(meshtastic_LocalStats &stats);
+
+#if RADIO_TASK
+    /**
+     * Start running interrupts, the TX queue and receiving on the radio task rather than the main loop.
+     * Call once the radio has been set up.
+     */
+    void startTask();
+#endif
+
   private:
     /** if we have something waiting to send, start a short (random) timer so we can come check for collision before actually
      * doing the transmit */
@@ -166,6 +198,9 @@ class RadioLibInterface : public RadioInterface, protected concurrency::Notified
     void handleTransmitInterrupt();
     void handleReceiveInterrupt();
 
+    /// startReceive() from onNotify(), without holding radioLock through the SPI transfers
+    void startReceiveUnlocked();
+
     static void timerCallback(void *p1, uint32_t p2);
 
     virtual void onNotify(uint32_t notification) override;
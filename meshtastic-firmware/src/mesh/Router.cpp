@@ -4,7 +4,10 @@
 #include "MeshRadio.h"
 #include "MeshService.h"
 #include "NodeDB.h"
+#include "PayloadDelta.h"
 #include "RTC.h"
+#include "TelemetryBatch.h"
+#include "compression/unishox2.h"
 #include "configuration.h"
 #include "detect/LoRaRadioType.h"
 #include "main.h"
@@ -69,6 +72,10 @@ int32_t Router::runOnce()
         // printPacket("handle fromRadioQ", mp);
         perhapsHandleReceived(mp);
     }
+#if RADIO_TASK
+    while (radioTaskQueue.pop(mp))
+        perhapsHandleReceived(mp);
+#endif
 
     // LOG_DEBUG("Sleep forever!");
     return INT32_MAX; // Wait a long time - until we get woken for the message queue
@@ -93,6 +100,21 @@ void Router::enqueueReceivedMessage(meshtastic_MeshPacket *p)
     setReceivedMessage();
 }
 
+#if RADIO_TASK
+void Router::enqueueFromRadioTask(meshtastic_MeshPacket *p)
+{
+    if (!radioTaskQueue.push(p)) {
+        // Only the main loop may take packets out, so unlike fromRadioQueue we drop the newest
+        printPacket("radioTaskQueue full, drop!", p);
+        packetPool.release(p);
+        return;
+    }
+    wake(); // Not setInterval(0), which runOnce() could overwrite if it is running right now
+    runASAP = true;
+    concurrency::mainDelay.interrupt();
+}
+#endif
+
 /// Generate a unique packet id
 // FIXME, move this someplace better
 PacketId generatePacketId()
@@ -286,7 +308,10 @@ ErrorCode Router::send(meshtastic_MeshPacket *p)
 #if !MESHTASTIC_EXCLUDE_MQTT
         // Only publish to MQTT if we're the original transmitter of the packet
         if (moduleConfig.mqtt.enabled && isFromUs(p) && mqtt) {
-            mqtt->onSend(*p, *p_decoded, chIndex);
+            if (TelemetryBatch::isBatch(*p_decoded))
+                mqtt->onSendBatch(*p, *p_decoded, chIndex);
+            else
+                mqtt->onSend(*p, *p_decoded, chIndex);
         }
 #endif
         packetPool.release(p_decoded);
@@ -368,6 +393,8 @@ DecodeState perhapsDecode(meshtastic_MeshPacket *p)
             rawSize -= MESHTASTIC_PKC_OVERHEAD;
             if (pb_decode_from_bytes(bytes, rawSize, &meshtastic_Data_msg, &decodedtmp) &&
                 decodedtmp.portnum != meshtastic_PortNum_UNKNOWN_APP) {
+                if (!payloadDelta.expand(p->from, decodedtmp))
+                    return DecodeState::DECODE_FAILURE;
                 decrypted = true;
                 LOG_INFO("Packet decrypted using PKI!");
                 p->pki_encrypted = true;
@@ -406,6 +433,8 @@ DecodeState perhapsDecode(meshtastic_MeshPacket *p)
                     LOG_ERROR("Invalid protobufs in received mesh packet id=0x%08x (bad psk?)!", p->id);
                 } else if (decodedtmp.portnum == meshtastic_PortNum_UNKNOWN_APP) {
                     LOG_ERROR("Invalid portnum (bad psk?)!");
+                } else if (!payloadDelta.expand(p->from, decodedtmp)) {
+                    return DecodeState::DECODE_FAILURE; // Still encrypted, so it can be relayed as it is
                 } else {
                     p->decoded = decodedtmp;
                     p->which_payload_variant = meshtastic_MeshPacket_decoded_tag; // change type to decoded
@@ -421,26 +450,6 @@ DecodeState perhapsDecode(meshtastic_MeshPacket *p)
         if (p->decoded.has_bitfield)
             p->decoded.want_response |= p->decoded.bitfield & BITFIELD_WANT_RESPONSE_MASK;
 
-        /* Not actually ever used.
-        // Decompress if needed. jm
-        if (p->decoded.portnum == meshtastic_PortNum_TEXT_MESSAGE_COMPRESSED_APP) {
-            // Decompress the payload
-            char compressed_in[meshtastic_Constants_DATA_PAYLOAD_LEN] = {};
-            char decompressed_out[meshtastic_Constants_DATA_PAYLOAD_LEN] = {};
-            int decompressed_len;
-
-            memcpy(compressed_in, p->decoded.payload.bytes, p->decoded.payload.size);
-
-            decompressed_len = unishox2_decompress_simple(compressed_in, p->decoded.payload.size, decompressed_out);
-
-            // LOG_DEBUG("**Decompressed length - %d ", decompressed_len);
-
-            memcpy(p->decoded.payload.bytes, decompressed_out, decompressed_len);
-
-            // Switch the port from PortNum_TEXT_MESSAGE_COMPRESSED_APP to PortNum_TEXT_MESSAGE_APP
-            p->decoded.portnum = meshtastic_PortNum_TEXT_MESSAGE_APP;
-        } */
-
         printPacket("decoded message", p);
 #if ENABLE_JSON_LOGGING
         LOG_TRACE("%s", MeshPacketSerializer::JsonSerialize(p, false).c_str());
@@ -456,6 +465,56 @@ DecodeState perhapsDecode(meshtastic_MeshPacket *p)
     }
 }
 
+#if TEXT_COMPRESSION
+/**
+ * Compress a direct text message we are sending, if the destination said it can decompress it and it comes out smaller
+ */
+static void perhapsCompress(meshtastic_MeshPacket *p)
+{
+    if (p->decoded.portnum != meshtastic_PortNum_TEXT_MESSAGE_APP || isBroadcast(p->to) || p->decoded.payload.size < 2)
+        return;
+    const meshtastic_NodeInfoLite *node = nodeDB->getMeshNode(p->to);
+    if (!node || !(node->bitfield & NODEINFO_BITFIELD_TEXT_COMPRESSION_MASK))
+        return;
+
+    char compressed[meshtastic_Constants_DATA_PAYLOAD_LEN];
+    const int maxLength = p->decoded.payload.size - 1; // Must save at least a byte
+    int length = unishox2_compress((const char *)p->decoded.payload.bytes, p->decoded.payload.size, compressed, maxLength,
+                                   USX_PSET_DFLT);
+    if (length <= 0 || length > maxLength)
+        return;
+
+    LOG_DEBUG("Compressed text message %u -> %d bytes", p->decoded.payload.size, length);
+    memcpy(p->decoded.payload.bytes, compressed, length);
+    p->decoded.payload.size = length;
+    p->decoded.portnum = meshtastic_PortNum_TEXT_MESSAGE_COMPRESSED_APP;
+}
+#endif
+
+/**
+ * Decompress a text message to us back to TEXT_MESSAGE_APP, so modules and the phone never see the compressed form
+ * @return false if it did not decompress
+ */
+static bool perhapsDecompress(meshtastic_MeshPacket *p)
+{
+    if (p->which_payload_variant != meshtastic_MeshPacket_decoded_tag ||
+        p->decoded.portnum != meshtastic_PortNum_TEXT_MESSAGE_COMPRESSED_APP || !isToUs(p))
+        return true;
+
+    char decompressed[meshtastic_Constants_DATA_PAYLOAD_LEN];
+    int length = unishox2_decompress((const char *)p->decoded.payload.bytes, p->decoded.payload.size, decompressed,
+                                     sizeof(decompressed), USX_PSET_DFLT);
+    if (length < 0 || length > (int)sizeof(decompressed)) {
+        LOG_WARN("Can't decompress text message id=0x%08x", p->id);
+        return false;
+    }
+
+    memcpy(p->decoded.payload.bytes, decompressed, length);
+    p->decoded.payload.size = length;
+    p->decoded.portnum = meshtastic_PortNum_TEXT_MESSAGE_APP;
+    return true;
+}
+
 /** Return 0 for success or a Routing_Error code for failure
  */
 meshtastic_Routing_Error perhapsEncode(meshtastic_MeshPacket *p)
@@ -470,45 +529,17 @@ meshtastic_Routing_Error perhapsEncode(meshtastic_MeshPacket *p)
             p->decoded.has_bitfield = true;
             p->decoded.bitfield |= (config.lora.config_ok_to_mqtt << BITFIELD_OK_TO_MQTT_SHIFT);
             p->decoded.bitfield |= (p->decoded.want_response << BITFIELD_WANT_RESPONSE_SHIFT);
+#if TEXT_COMPRESSION
+            if (p->decoded.portnum == meshtastic_PortNum_NODEINFO_APP)
+                p->decoded.bitfield |= BITFIELD_TEXT_COMPRESSION_MASK;
+            perhapsCompress(p);
+#endif
         }
+        if (isBroadcast(p->to))
+            payloadDelta.compress(*p);
 
         size_t numbytes = pb_encode_to_bytes(bytes, sizeof(bytes), &meshtastic_Data_msg, &p->decoded);
 
-        /* Not actually used, so save the cycles
-        //  TODO: Allow modules to opt into compression.
-        if (p->decoded.portnum == meshtastic_PortNum_TEXT_MESSAGE_APP) {
-
-            char original_payload[meshtastic_Constants_DATA_PAYLOAD_LEN];
-            memcpy(original_payload, p->decoded.payload.bytes, p->decoded.payload.size);
-
-            char compressed_out[meshtastic_Constants_DATA_PAYLOAD_LEN] = {0};
-
-            int compressed_len;
-            compressed_len = unishox2_compress_simple(original_payload, p->decoded.payload.size, compressed_out);
-
-            LOG_DEBUG("Original length - %d ", p->decoded.payload.size);
-            LOG_DEBUG("Compressed length - %d ", compressed_len);
-            LOG_DEBUG("Original message - %s ", p->decoded.payload.bytes);
-
-            // If the compressed length is greater than or equal to the original size, don't use the compressed form
-            if (compressed_len >= p->decoded.payload.size) {
-
-                LOG_DEBUG("Not using compressing message");
-                // Set the uncompressed payload variant anyway. Shouldn't hurt?
-                // p->decoded.which_payloadVariant = Data_payload_tag;
-
-                // Otherwise we use the compressor
-            } else {
-                LOG_DEBUG("Use compressed message");
-                // Copy the compressed data into the meshpacket
-
-                p->decoded.payload.size = compressed_len;
-                memcpy(p->decoded.payload.bytes, compressed_out, compressed_len);
-
-                p->decoded.portnum = meshtastic_PortNum_TEXT_MESSAGE_COMPRESSED_APP;
-            }
-        } */
-
         if (numbytes + MESHTASTIC_HEADER_LENGTH > MAX_LORA_PAYLOAD_LEN)
             return meshtastic_Routing_Error_TOO_LARGE;
 
@@ -658,10 +689,34 @@ void Router::handleReceived(meshtastic_MeshPacket *p, RxSource src)
             cancelSending(p->from, p->id);
             skipHandle = true;
         }
+
+        // Only once it is to us, so if we relay it instead it stays compressed
+        if (!perhapsDecompress(p))
+            skipHandle = true;
     } else {
         printPacket("packet decoding failed or skipped (no PSK?)", p);
     }
 
+    // A telemetry batch is relayed as it is, then everything else gets each of its samples as a packet of its own. Our own
+    // went to the phone sample by sample already
+    if (!skipHandle && decodedState == DecodeState::DECODE_SUCCESS && TelemetryBatch::isBatch(*p)) {
+        if (!isFromUs(p)) {
+            if (!owner.is_licensed || nodeDB->getLicenseStatus(p->from) != UserLicenseStatus::NotLicensed)
+                sniffReceived(p, nullptr);
+            nodeDB->updateFrom(*p); // The samples don't have the hops away
+            TelemetryBatch::Reader reader(*p);
+            while (meshtastic_MeshPacket *sample = reader.next()) {
+                MeshModule::callModules(*sample, src);
+                packetPool.release(sample);
+            }
+#if !MESHTASTIC_EXCLUDE_MQTT
+            if (moduleConfig.mqtt.enabled && mqtt)
+                mqtt->onSendBatch(*p_encrypted, *p, p->channel);
+#endif
+        }
+        skipHandle = true;
+    }
+
     // call modules here
     if (!skipHandle) {
         MeshModule::callModules(*p, src);
@@ -9,6 +9,15 @@
 #include "RadioInterface.h"
 #include "concurrency/OSThread.h"
 
+#if RADIO_TASK
+#include "concurrency/SPSCQueue.h"
+
+// Packets the radio task can hand over before the main loop picks them up, must be a power of two
+#ifndef RADIO_TASK_RX_QUEUE
+#define RADIO_TASK_RX_QUEUE 8
+#endif
+#endif
+
 /**
  * A mesh aware router that supports multiple interfaces.
  */
@@ -19,6 +28,11 @@ class Router : protected concurrency::OSThread, protected PacketHistory
     /// forwarded to the phone.
     PointerQueue<meshtastic_MeshPacket> fromRadioQueue;
 
+#if RADIO_TASK
+    /// Packets received by the radio task, fromRadioQueue isn't safe to use across cores on every platform
+    concurrency::SPSCQueue<meshtastic_MeshPacket *, RADIO_TASK_RX_QUEUE> radioTaskQueue;
+#endif
+
   protected:
     RadioInterface *iface = NULL;
 
@@ -77,6 +91,11 @@ class Router : protected concurrency::OSThread, protected PacketHistory
      */
     virtual void enqueueReceivedMessage(meshtastic_MeshPacket *p);
 
+#if RADIO_TASK
+    /// enqueueReceivedMessage() for the radio task, the only task that may call this
+    void enqueueFromRadioTask(meshtastic_MeshPacket *p);
+#endif
+
     /**
      * Send a packet on a suitable interface.  This routine will
      * later free() the packet to pool.  This routine is not allowed to stall.
@@ -159,7 +178,19 @@ extern Router *router;
 // FIXME, move this someplace better
 PacketId generatePacketId();
 
+/*
+ * Bits of Data.bitfield. Bits 0 and 1 are upstream's. Bits 2 to 5 are only used by this firmware, and upstream may give them
+ * other meanings, so each is only set when the option it belongs to is built in. Bits 6 and up are free.
+ */
+#define BITFIELD_TELEMETRY_BATCH_SHIFT 5  // Payload is several telemetry samples, see TelemetryBatch.h
+#define BITFIELD_DELTA_KEYFRAME_SHIFT 4   // Payload is a keyframe for later deltas, see PayloadDelta.h
+#define BITFIELD_DELTA_SHIFT 3            // Payload is a delta against the sender's last keyframe
+#define BITFIELD_TEXT_COMPRESSION_SHIFT 2 // Set on our NodeInfo: we decompress TEXT_MESSAGE_COMPRESSED_APP
 #define BITFIELD_WANT_RESPONSE_SHIFT 1
 #define BITFIELD_OK_TO_MQTT_SHIFT 0
+#define BITFIELD_TELEMETRY_BATCH_MASK (1 << BITFIELD_TELEMETRY_BATCH_SHIFT)
+#define BITFIELD_DELTA_KEYFRAME_MASK (1 << BITFIELD_DELTA_KEYFRAME_SHIFT)
+#define BITFIELD_DELTA_MASK (1 << BITFIELD_DELTA_SHIFT)
+#define BITFIELD_TEXT_COMPRESSION_MASK (1 << BITFIELD_TEXT_COMPRESSION_SHIFT)
 #define BITFIELD_WANT_RESPONSE_MASK (1 << BITFIELD_WANT_RESPONSE_SHIFT)
 #define BITFIELD_OK_TO_MQTT_MASK (1 << BITFIELD_OK_TO_MQTT_SHIFT)
\ No newline at end of file
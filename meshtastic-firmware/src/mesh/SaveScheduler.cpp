@@ -0,0 +1,49 @@
+#include "SaveScheduler.h"
+#include "NodeDB.h"
+#include "configuration.h"
+#include <algorithm>
+
+SaveScheduler *saveScheduler;
+
+SaveScheduler::SaveScheduler() : concurrency::OSThread("SaveScheduler")
+{
+    disable(); // Nothing to do until the first request
+}
+
+void SaveScheduler::request(int saveWhat)
+{
+    uint32_t now = millis();
+    if (!pending)
+        firstRequestMsec = now;
+    pending |= saveWhat;
+    lastRequestMsec = now;
+    LOG_DEBUG("Save of %d requested, pending %d", saveWhat, pending);
+
+    enabled = true;
+    setIntervalFromNow(SAVE_DEBOUNCE_MS);
+}
+
+bool SaveScheduler::flush()
+{
+    if (!pending)
+        return true;
+    int saveWhat = pending;
+    pending = 0;
+    LOG_INFO("Write pending changes to disk %d", saveWhat);
+    return nodeDB->saveToDisk(saveWhat);
+}
+
+int32_t SaveScheduler::runOnce()
+{
+    if (!pending)
+        return disable();
+
+    // Wait until requests stop coming in, but not forever
+    uint32_t now = millis();
+    uint32_t due = std::min(lastRequestMsec + SAVE_DEBOUNCE_MS, firstRequestMsec + SAVE_MAX_DELAY_MS);
+    if ((int32_t)(due - now) > 0)
+        return due - now;
+
+    flush();
+    return disable();
+}
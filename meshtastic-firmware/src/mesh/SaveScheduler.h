@@ -0,0 +1,48 @@
+#pragma once
+
+#include "concurrency/OSThread.h"
+
+/// How long to wait for more changes before writing, each new request restarts the wait
+#ifndef SAVE_DEBOUNCE_MS
+#define SAVE_DEBOUNCE_MS 2000
+#endif
+
+/// Never hold back a requested save longer than this, even while requests keep coming in
+#ifndef SAVE_MAX_DELAY_MS
+#define SAVE_MAX_DELAY_MS 15000
+#endif
+
+/**
+ * Coalesces requests to save prefs to flash.
+ *
+ * A client changing settings sends one admin message per change, and each used to rewrite the affected prefs files right
+ * away.  Instead the SEGMENT_* bits of each request are collected here and written in one go once no new request has come in
+ * for SAVE_DEBOUNCE_MS.  Anything still pending is written by flush(), which must be called before rebooting, shutting down
+ * or going to deep sleep.
+ */
+class SaveScheduler : private concurrency::OSThread
+{
+  public:
+    SaveScheduler();
+
+    /// Save the given SEGMENT_* bits soon
+    void request(int saveWhat);
+
+    /// Write anything that is pending right now
+    bool flush();
+
+    /// Forget about pending bits because they were just saved by a direct call to NodeDB::saveToDisk()
+    void saved(int saveWhat) { pending &= ~saveWhat; }
+
+    bool isPending() { return pending != 0; }
+
+  protected:
+    virtual int32_t runOnce() override;
+
+  private:
+    int pending = 0;
+    uint32_t firstRequestMsec = 0;
+    uint32_t lastRequestMsec = 0;
+};
+
+extern SaveScheduler *saveScheduler;
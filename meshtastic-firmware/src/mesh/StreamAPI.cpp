@@ -3,6 +3,8 @@
 #include "RTC.h"
 #include "Throttle.h"
 #include "configuration.h"
+#include <algorithm>
+#include <cstring>
 
 #define START1 0x94
 #define START2 0xc3
@@ -26,48 +28,21 @@ int32_t StreamAPI::readStream()
         bool recentRx = Throttle::isWithinTimespanMs(lastRxMsec, 2000);
         return recentRx ? 5 : 250;
     } else {
-        while (stream->available()) { // Currently we never want to block
-            int cInt = stream->read();
-            if (cInt < 0)
+        int avail;
+        while ((avail = stream->available()) > 0) { // Currently we never want to block
+            // Move any partial frame to the front, so there is always room for at least one complete frame
+            if (rxStart != 0) {
+                memmove(rxBuf, rxBuf + rxStart, rxEnd - rxStart);
+                rxEnd -= rxStart;
+                rxStart = 0;
+            }
+
+            size_t numRead = readAvailable(rxBuf + rxEnd, std::min<size_t>(avail, sizeof(rxBuf) - rxEnd));
+            if (numRead == 0)
                 break; // We ran out of characters (even though available said otherwise) - this can happen on rf52 adafruit
                        // arduino
-
-            uint8_t c = (uint8_t)cInt;
-
-            // Use the read pointer for a little state machine, first look for framing, then length bytes, then payload
-            size_t ptr = rxPtr;
-
-            rxPtr++;        // assume we will probably advance the rxPtr
-            rxBuf[ptr] = c; // store all bytes (including framing)
-
-            // console->printf("rxPtr %d ptr=%d c=0x%x\n", rxPtr, ptr, c);
-
-            if (ptr == 0) { // looking for START1
-                if (c != START1)
-                    rxPtr = 0;     // failed to find framing
-            } else if (ptr == 1) { // looking for START2
-                if (c != START2)
-                    rxPtr = 0;                             // failed to find framing
-            } else if (ptr >= HEADER_LEN - 1) {            // we have at least read our 4 byte framing
-                uint32_t len = (rxBuf[2] << 8) + rxBuf[3]; // big endian 16 bit length follows framing
-
-                // console->printf("len %d\n", len);
-
-                if (ptr == HEADER_LEN - 1) {
-                    // we _just_ finished our 4 byte header, validate length now (note: a length of zero is a valid
-                    // protobuf also)
-                    if (len > MAX_TO_FROM_RADIO_SIZE)
-                        rxPtr = 0; // length is bogus, restart search for framing
-                }
-
-                if (rxPtr != 0)                        // Is packet still considered 'good'?
-                    if (ptr + 1 >= len + HEADER_LEN) { // have we received all of the payload?
-                        rxPtr = 0;                     // start over again on the next packet
-
-                        // If we didn't just fail the packet and we now have the right # of bytes, parse it
-                        handleToRadio(rxBuf + HEADER_LEN, len);
-                    }
-            }
+            rxEnd += numRead;
+            parseRxBuf();
         }
 
         // we had bytes available this time, so assume we might have them next time also
@@ -76,31 +51,112 @@ int32_t StreamAPI::readStream()
     }
 }
 
+size_t StreamAPI::readAvailable(uint8_t *buf, size_t maxLen)
+{
+#if STREAM_BUF_FRAMES > 1
+    // We never ask for more than available() said was waiting, so this doesn't block on the stream timeout
+    return stream->readBytes(reinterpret_cast<char *>(buf), maxLen);
+#else
+    size_t numRead = 0;
+    while (numRead < maxLen) {
+        int cInt = stream->read();
+        if (cInt < 0)
+            break;
+        buf[numRead++] = (uint8_t)cInt;
+    }
+    return numRead;
+#endif
+}
+
+/**
+ * Each frame is START1, START2, a 16 bit big endian length and then the payload. Anything that doesn't look like a frame
+ * header is skipped until we find the next START1.
+ */
+void StreamAPI::parseRxBuf()
+{
+    size_t pos = rxStart;
+    while (pos < rxEnd) {
+        if (rxBuf[pos] != START1) {
+            // Frame sync. memchr is vectorized by the C library, so skipping over non-API bytes (like someone typing at the
+            // console) costs much less than checking them one at a time
+            const uint8_t *start = static_cast<const uint8_t *>(memchr(rxBuf + pos, START1, rxEnd - pos));
+            pos = start ? start - rxBuf : rxEnd;
+            continue;
+        }
+        if (rxEnd - pos < 2)
+            break; // Wait for START2
+        if (rxBuf[pos + 1] != START2) {
+            pos++; // failed to find framing
+            continue;
+        }
+        if (rxEnd - pos < HEADER_LEN)
+            break; // Wait for the length
+
+        // Note: a length of zero is a valid protobuf also
+        uint32_t len = (rxBuf[pos + 2] << 8) + rxBuf[pos + 3];
+        if (len > MAX_TO_FROM_RADIO_SIZE) {
+            pos++; // length is bogus, restart search for framing
+            continue;
+        }
+        if (rxEnd - pos < HEADER_LEN + len)
+            break; // Wait for the rest of the payload
+
+        handleToRadio(rxBuf + pos + HEADER_LEN, len);
+        pos += HEADER_LEN + len;
+    }
+
+    rxStart = pos;
+    if (rxStart == rxEnd)
+        rxStart = rxEnd = 0;
+}
+
 /**
  * call getFromRadio() and deliver encapsulated packets to the Stream
  */
 void StreamAPI::writeStream()
 {
     if (canWrite) {
-        uint32_t len;
-        do {
-            // Send every packet we can
-            len = getFromRadio(txBuf + HEADER_LEN);
+#if STREAM_BUF_FRAMES > 1
+        // Send every packet we can, encoding as many frames as fit into txBatch before each write
+        size_t used = 0;
+        while (true) {
+            if (used + MAX_STREAM_BUF_SIZE > sizeof(txBatch)) {
+                stream->write(txBatch, used);
+                used = 0;
+            }
+            uint32_t len = getFromRadio(txBatch + used + HEADER_LEN);
+            if (len == 0)
+                break;
+            writeHeader(txBatch + used, len);
+            used += HEADER_LEN + len;
+        }
+        if (used != 0) {
+            stream->write(txBatch, used);
+            stream->flush();
+        }
+#else
+        // Room for one frame only, so there is nothing to batch: send each straight from txBuf
+        while (uint32_t len = getFromRadio(txBuf + HEADER_LEN))
             emitTxBuffer(len);
-        } while (len);
+#endif
     }
 }
 
+void StreamAPI::writeHeader(uint8_t *buf, size_t len)
+{
+    buf[0] = START1;
+    buf[1] = START2;
+    buf[2] = (len >> 8) & 0xff;
+    buf[3] = len & 0xff;
+}
+
 /**
  * Send the current txBuffer over our stream
  */
 void StreamAPI::emitTxBuffer(size_t len)
 {
     if (len != 0) {
-        txBuf[0] = START1;
-        txBuf[1] = START2;
-        txBuf[2] = (len >> 8) & 0xff;
-        txBuf[3] = len & 0xff;
+        writeHeader(txBuf, len);
 
         auto totalLen = len + HEADER_LEN;
         stream->write(txBuf, totalLen);
@@ -8,6 +8,16 @@
 // A To/FromRadio packet + our 32 bit header
 #define MAX_STREAM_BUF_SIZE (MAX_TO_FROM_RADIO_SIZE + sizeof(uint32_t))
 
+// How many maximum sized frames our rx and tx batch buffers hold. With more than one, incoming bytes are read in bulk and
+// several outgoing FromRadio frames go out in a single write.
+#ifndef STREAM_BUF_FRAMES
+#if defined(ARCH_PORTDUINO) || defined(ARCH_ESP32)
+#define STREAM_BUF_FRAMES 4
+#else
+#define STREAM_BUF_FRAMES 1
+#endif
+#endif
+
 /**
  * A version of our 'phone' API that talks over a Stream.  So therefore well suited to use with serial links
  * or TCP connections.
@@ -36,8 +46,15 @@ class StreamAPI : public PhoneAPI
      */
     Stream *stream;
 
-    uint8_t rxBuf[MAX_STREAM_BUF_SIZE] = {0};
-    size_t rxPtr = 0;
+    /// Bytes read from the stream but not parsed yet live in rxBuf[rxStart, rxEnd)
+    uint8_t rxBuf[MAX_STREAM_BUF_SIZE * STREAM_BUF_FRAMES] = {0};
+    size_t rxStart = 0;
+    size_t rxEnd = 0;
+
+#if STREAM_BUF_FRAMES > 1
+    /// Outgoing FromRadio frames are collected here so they can be written together
+    uint8_t txBatch[MAX_STREAM_BUF_SIZE * STREAM_BUF_FRAMES] = {0};
+#endif
 
     /// time of last rx, used, to slow down our polling if we haven't heard from anyone
     uint32_t lastRxMsec = 0;
@@ -57,6 +74,12 @@ class StreamAPI : public PhoneAPI
      */
     int32_t readStream();
 
+    /// Read up to maxLen bytes that are already waiting on the stream, without blocking
+    size_t readAvailable(uint8_t *buf, size_t maxLen);
+
+    /// Find and handle every complete frame in rxBuf
+    void parseRxBuf();
+
     /**
      * call getFromRadio() and deliver encapsulated packets to the Stream
      */
@@ -78,6 +101,9 @@ class StreamAPI : public PhoneAPI
      */
     void emitTxBuffer(size_t len);
 
+    /// Fill in the 4 byte frame header for a payload of len bytes
+    static void writeHeader(uint8_t *buf, size_t len);
+
     /// Are we allowed to write packets to our output stream (subclasses can turn this off - i.e. SerialConsole)
     bool canWrite = true;
 
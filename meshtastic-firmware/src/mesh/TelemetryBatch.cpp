@@ -0,0 +1,137 @@
+#include "TelemetryBatch.h"
+#include "MeshService.h"
+#include "NodeDB.h"
+#include "Router.h"
+
+TelemetryBatch *telemetryBatch;
+
+bool TelemetryBatch::encodeSample(const meshtastic_Data_payload_t &sample, const meshtastic_Data_payload_t &previous,
+                                  meshtastic_Data_payload_t &out)
+{
+    const size_t bitmapSize = (sample.size + 7) / 8;
+    size_t size = out.size;
+    if (size + 1 + bitmapSize > sizeof(out.bytes))
+        return false;
+    out.bytes[size++] = sample.size;
+    uint8_t *bitmap = out.bytes + size;
+    memset(bitmap, 0, bitmapSize);
+    size += bitmapSize;
+    for (size_t i = 0; i < sample.size; i++) {
+        const uint8_t x = sample.bytes[i] ^ (i < previous.size ? previous.bytes[i] : 0);
+        if (x) {
+            if (size >= sizeof(out.bytes))
+                return false;
+            bitmap[i / 8] |= 1 << (i % 8);
+            out.bytes[size++] = x;
+        }
+    }
+    out.size = size;
+    return true;
+}
+
+bool TelemetryBatch::decodeSample(const meshtastic_Data_payload_t &in, size_t &offset,
+                                  const meshtastic_Data_payload_t &previous, meshtastic_Data_payload_t &sample)
+{
+    sample.size = in.bytes[offset++];
+    const uint8_t *bitmap = in.bytes + offset;
+    offset += (sample.size + 7) / 8;
+    if (sample.size > sizeof(sample.bytes) || offset > in.size)
+        return false;
+    for (size_t i = 0; i < sample.size; i++) {
+        sample.bytes[i] = i < previous.size ? previous.bytes[i] : 0;
+        if (bitmap[i / 8] & (1 << (i % 8))) {
+            if (offset >= in.size)
+                return false;
+            sample.bytes[i] ^= in.bytes[offset++];
+        }
+    }
+    return true;
+}
+
+TelemetryBatch::TelemetryBatch() : concurrency::OSThread("TelemetryBatch") {}
+
+bool TelemetryBatch::add(meshtastic_MeshPacket *p)
+{
+    if (!isBroadcast(p->to) ||
+        (config.device.role == meshtastic_Config_DeviceConfig_Role_SENSOR && config.power.is_power_saving))
+        return false;
+
+    if (!encodeSample(p->decoded.payload, previous, pending)) {
+        flush();
+        if (!encodeSample(p->decoded.payload, previous, pending))
+            return false;
+    }
+    previous = p->decoded.payload;
+    if (count++ == 0) {
+        firstAddedMs = millis();
+        setIntervalFromNow(TELEMETRY_BATCH_MAX_LATENCY_SECS * 1000);
+    }
+    if (p->priority > priority)
+        priority = p->priority;
+    LOG_DEBUG("Telemetry sample %u of %u batched, %u bytes", count, TELEMETRY_BATCH_SIZE, pending.size);
+
+    service->sendToPhone(p);
+    if (count >= TELEMETRY_BATCH_SIZE)
+        flush();
+    return true;
+}
+
+void TelemetryBatch::flush()
+{
+    if (count == 0)
+        return;
+
+    meshtastic_MeshPacket *p = router->allocForSending();
+    p->to = NODENUM_BROADCAST;
+    p->decoded.portnum = meshtastic_PortNum_TELEMETRY_APP;
+    p->decoded.payload = pending;
+    p->decoded.has_bitfield = true;
+    p->decoded.bitfield |= BITFIELD_TELEMETRY_BATCH_MASK;
+    p->priority = priority;
+    LOG_INFO("Send batch of %u telemetry samples to mesh, %u bytes", count, pending.size);
+    service->sendToMesh(p, RX_SRC_LOCAL, false); // The phone got each sample as it was added
+
+    pending.size = 0;
+    previous.size = 0;
+    count = 0;
+    priority = meshtastic_MeshPacket_Priority_BACKGROUND;
+}
+
+int32_t TelemetryBatch::runOnce()
+{
+    if (count > 0 && millis() - firstAddedMs >= TELEMETRY_BATCH_MAX_LATENCY_SECS * 1000)
+        flush();
+    return INT32_MAX; // add() wakes us when a batch starts
+}
+
+bool TelemetryBatch::isBatch(const meshtastic_MeshPacket &p)
+{
+    return p.which_payload_variant == meshtastic_MeshPacket_decoded_tag &&
+           p.decoded.portnum == meshtastic_PortNum_TELEMETRY_APP && p.decoded.has_bitfield &&
+           (p.decoded.bitfield & BITFIELD_TELEMETRY_BATCH_MASK);
+}
+
+meshtastic_MeshPacket *TelemetryBatch::Reader::next()
+{
+    const meshtastic_Data_payload_t &in = batch.decoded.payload;
+    if (offset >= in.size || index >= TELEMETRY_BATCH_MAX_SAMPLES)
+        return nullptr;
+
+    meshtastic_Data_payload_t sample;
+    if (!decodeSample(in, offset, previous, sample)) {
+        LOG_WARN("Malformed telemetry batch from 0x%x, %u samples read", batch.from, index);
+        offset = in.size;
+        return nullptr;
+    }
+    previous = sample;
+
+    meshtastic_MeshPacket *p = packetPool.allocCopy(batch);
+    // The same on every receiver, so MQTT consumers still drop what several gateways publish, but not the other samples
+    p->id = batch.id + index++;
+    p->hop_limit = 0;
+    p->hop_start = 0;
+    p->want_ack = false;
+    p->decoded.payload = sample;
+    p->decoded.bitfield &= ~(BITFIELD_TELEMETRY_BATCH_MASK | BITFIELD_DELTA_MASK | BITFIELD_DELTA_KEYFRAME_MASK);
+    return p;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "MeshTypes.h"
+#include "concurrency/OSThread.h"
+#include "configuration.h"
+
+/// A batch that isn't full goes out this long after its first sample anyway
+#ifndef TELEMETRY_BATCH_MAX_LATENCY_SECS
+#define TELEMETRY_BATCH_MAX_LATENCY_SECS (60 * 60)
+#endif
+
+/// The most samples a batch holds. Receivers ignore any past this, so TELEMETRY_BATCH_SIZE can't be larger
+#define TELEMETRY_BATCH_MAX_SAMPLES 16
+
+static_assert(TELEMETRY_BATCH_SIZE <= TELEMETRY_BATCH_MAX_SAMPLES, "TELEMETRY_BATCH_SIZE is larger than a batch can hold");
+
+/**
+ * Batching of our environment, power and air quality telemetry broadcasts: with TELEMETRY_BATCH_SIZE above 1, the modules
+ * hand their samples here instead of sending each in a packet of its own. The phone gets every sample right away, the mesh
+ * gets them TELEMETRY_BATCH_SIZE at a time in one TELEMETRY_APP broadcast flagged with BITFIELD_TELEMETRY_BATCH, or fewer once
+ * the first has waited TELEMETRY_BATCH_MAX_LATENCY_SECS. Each sample is a Telemetry message with its own time.
+ *
+ * The payload of a batch is the encoded samples one after the other, each as:
+ *
+ *     its length (1 byte)
+ *     a bitmap with a bit for each byte that differs from the previous sample, then each of those bytes XORed with it
+ *
+ * The first sample is against an empty one. Consecutive samples of the same sensor differ in few bytes, so most take a
+ * fraction of their size.
+ *
+ * A receiver relays the batch as it is, and gives its modules, phone and MQTT each sample as a packet of its own, see Reader.
+ * Receiving is always supported. A batch is still a TELEMETRY_APP packet though, and firmware from before batching ignores the
+ * bitfield and decodes the payload as one Telemetry message, so only turn batching on when every node in the mesh is new.
+ */
+class TelemetryBatch : private concurrency::OSThread
+{
+  public:
+    TelemetryBatch();
+
+    /**
+     * A telemetry packet one of our modules is about to send to the mesh. A broadcast is added to the batch and given to the
+     * phone now, unless we deep sleep between samples and would lose the batch.
+     * @return false if it isn't batched, and should be sent as it is
+     */
+    bool add(meshtastic_MeshPacket *p);
+
+    /// Send the samples we have now, if any
+    void flush();
+
+    static bool isBatch(const meshtastic_MeshPacket &p);
+
+    /// Append a sample to a batch payload, encoded against the one before it
+    /// @return false if it doesn't fit, with out left as it was
+    static bool encodeSample(const meshtastic_Data_payload_t &sample, const meshtastic_Data_payload_t &previous,
+                             meshtastic_Data_payload_t &out);
+
+    /// Read back the sample at offset in a batch payload, and move offset past it. @return false if the batch is malformed
+    static bool decodeSample(const meshtastic_Data_payload_t &in, size_t &offset, const meshtastic_Data_payload_t &previous,
+                             meshtastic_Data_payload_t &sample);
+
+    /// Takes a batch apart, one sample at a time
+    class Reader
+    {
+      public:
+        explicit Reader(const meshtastic_MeshPacket &batch) : batch(batch) {}
+
+        /**
+         * @return the next sample as a copy of the batch packet with the sample for its payload, to be released by the caller,
+         * or nullptr after the last. It has hop_limit and hop_start 0: it was relayed as part of the batch and must not be
+         * relayed again, and NodeDB takes the hops away from the batch.
+         */
+        meshtastic_MeshPacket *next();
+
+      private:
+        const meshtastic_MeshPacket &batch;
+        size_t offset = 0;
+        uint8_t index = 0;
+        meshtastic_Data_payload_t previous = {};
+    };
+
+  protected:
+    virtual int32_t runOnce() override;
+
+  private:
+    meshtastic_Data_payload_t pending = {};  // The batch payload so far
+    meshtastic_Data_payload_t previous = {}; // The last sample added, which the next is encoded against
+    uint8_t count = 0;
+    uint32_t firstAddedMs = 0;
+    meshtastic_MeshPacket_Priority priority = meshtastic_MeshPacket_Priority_BACKGROUND;
+};
+
+/// Only created when built with TELEMETRY_BATCH_SIZE above 1
+extern TelemetryBatch *telemetryBatch;
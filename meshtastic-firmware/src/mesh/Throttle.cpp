@@ -1,5 +1,5 @@
 #include "Throttle.h"
-#include <Arduino.h>
+#include "Clock.h"
 
 /// @brief Execute a function throttled to a minimum interval
 /// @param lastExecutionMs Pointer to the last execution time in milliseconds
@@ -32,4 +32,12 @@ bool Throttle::execute(uint32_t *lastExecutionMs, uint32_t minumumIntervalMs, vo
 bool Throttle::isWithinTimespanMs(uint32_t lastExecutionMs, uint32_t timeSpanMs)
 {
     return (millis() - lastExecutionMs) < timeSpanMs;
+}
+
+/// @brief Like isWithinTimespanMs(), for a time taken from clockMillis() rather than millis()
+/// @param lastClockMs The time in milliseconds, from clockMillis()
+/// @param timeSpanMs The interval in milliseconds of the timespan
+bool Throttle::isWithinClockTimespanMs(uint32_t lastClockMs, uint32_t timeSpanMs)
+{
+    return (clockMillis() - lastClockMs) < timeSpanMs;
 }
\ No newline at end of file
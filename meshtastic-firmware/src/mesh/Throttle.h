@@ -7,4 +7,5 @@ class Throttle
   public:
     static bool execute(uint32_t *lastExecutionMs, uint32_t minumumIntervalMs, void (*func)(void), void (*onDefer)(void) = NULL);
     static bool isWithinTimespanMs(uint32_t lastExecutionMs, uint32_t intervalMs);
+    static bool isWithinClockTimespanMs(uint32_t lastClockMs, uint32_t intervalMs);
 };
\ No newline at end of file
@@ -19,6 +19,20 @@ bool NodeInfoModule::handleReceivedProtobuf(const meshtastic_MeshPacket &mp, mes
 
     bool hasChanged = nodeDB->updateUser(getFrom(&mp), p, mp.channel);
 
+#if TEXT_COMPRESSION
+    // Remember whether it can take compressed text messages. Firmware that doesn't know the bit sends it cleared
+    meshtastic_NodeInfoLite *node = nodeDB->getMeshNode(getFrom(&mp));
+    if (node && mp.decoded.has_bitfield) {
+        uint32_t bitfield = node->bitfield & ~NODEINFO_BITFIELD_TEXT_COMPRESSION_MASK;
+        if (mp.decoded.bitfield & BITFIELD_TEXT_COMPRESSION_MASK)
+            bitfield |= NODEINFO_BITFIELD_TEXT_COMPRESSION_MASK;
+        if (bitfield != node->bitfield) {
+            node->bitfield = bitfield;
+            nodeDB->markChanged(node, NODE_DIRTY_INFO);
+        }
+    }
+#endif
+
     bool wasBroadcast = isBroadcast(mp.to);
 
     // Show new nodes on LCD screen
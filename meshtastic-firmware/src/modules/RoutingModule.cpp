@@ -57,20 +57,25 @@ void RoutingModule::sendAckNak(meshtastic_Routing_Error err, NodeNum to, PacketI
 }
 
 uint8_t RoutingModule::getHopLimitForResponse(uint8_t hopStart, uint8_t hopLimit)
+{
+    return getHopLimitForResponse(hopStart, hopLimit, config.lora.hop_limit);
+}
+
+uint8_t RoutingModule::getHopLimitForResponse(uint8_t hopStart, uint8_t hopLimit, uint8_t ourHopLimit)
 {
     if (hopStart != 0) {
         // Hops used by the request. If somebody in between running modified firmware modified it, ignore it
-        uint8_t hopsUsed = hopStart < hopLimit ? config.lora.hop_limit : hopStart - hopLimit;
-        if (hopsUsed > config.lora.hop_limit) {
+        uint8_t hopsUsed = hopStart < hopLimit ? ourHopLimit : hopStart - hopLimit;
+        if (hopsUsed > ourHopLimit) {
 // In event mode, we never want to send packets with more than our default 3 hops.
 #if !(EVENTMODE)             // This falls through to the default.
             return hopsUsed; // If the request used more hops than the limit, use the same amount of hops
 #endif
-        } else if ((uint8_t)(hopsUsed + 2) < config.lora.hop_limit) {
+        } else if ((uint8_t)(hopsUsed + 2) < ourHopLimit) {
             return hopsUsed + 2; // Use only the amount of hops needed with some margin as the way back may be different
         }
     }
-    return Default::getConfiguredOrDefaultHopLimit(config.lora.hop_limit); // Use the default hop limit
+    return Default::getConfiguredOrDefaultHopLimit(ourHopLimit); // Use the default hop limit
 }
 
 RoutingModule::RoutingModule() : ProtobufModule("routing", meshtastic_PortNum_ROUTING_APP, &meshtastic_Routing_msg)
@@ -19,6 +19,9 @@ class RoutingModule : public ProtobufModule<meshtastic_Routing>
     // Given the hopStart and hopLimit upon reception of a request, return the hop limit to use for the response
     uint8_t getHopLimitForResponse(uint8_t hopStart, uint8_t hopLimit);
 
+    // The same, for a node whose configured hop limit is ourHopLimit
+    static uint8_t getHopLimitForResponse(uint8_t hopStart, uint8_t hopLimit, uint8_t ourHopLimit);
+
   protected:
     friend class Router;
 
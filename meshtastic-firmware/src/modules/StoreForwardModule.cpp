@@ -27,6 +27,9 @@
 #include <Arduino.h>
 #include <iterator>
 #include <map>
+#ifdef ARCH_PORTDUINO
+#include "PortduinoGlue.h"
+#endif
 
 StoreForwardModule *storeForwardModule;
 
@@ -41,6 +44,7 @@ int32_t StoreForwardModule::runOnce()
                 if (!storeForwardModule->sendPayload(this->busyTo, this->last_time)) {
                     this->requestCount = 0;
                     this->busy = false;
+                    saveCursors();
                 }
             }
         } else if (this->heartbeat && (!Throttle::isWithinTimespanMs(lastHeartbeat, heartbeatInterval * 1000)) &&
@@ -81,9 +85,24 @@ void StoreForwardModule::populatePSRAM()
     this->records = numberOfPackets;
 #if defined(ARCH_ESP32)
     this->packetHistory = static_cast<PacketHistoryStruct *>(ps_calloc(numberOfPackets, sizeof(PacketHistoryStruct)));
+    // Keep the history in a file as well, and start with what was there before the last reboot
+    if (this->packetHistory && historyStore.open()) {
+        historyStore.load(this->packetHistory, numberOfPackets);
+        historyRestore();
+    }
 #elif defined(ARCH_PORTDUINO)
-    this->packetHistory = static_cast<PacketHistoryStruct *>(calloc(numberOfPackets, sizeof(PacketHistoryStruct)));
-
+    // With a directory configured the history lives in a memory mapped file, which can be far larger than RAM
+    if (settingsStrings[storeforward_directory] != "") {
+        if (!moduleConfig.store_forward.records && settingsMap[storeforward_records] > 0)
+            numberOfPackets = this->records = settingsMap[storeforward_records];
+        this->packetHistory = historyStore.map(settingsStrings[storeforward_directory], numberOfPackets);
+        if (this->packetHistory)
+            historyRestore();
+        else
+            LOG_ERROR("S&F history file unavailable, keep history in RAM only");
+    }
+    if (!this->packetHistory)
+        this->packetHistory = static_cast<PacketHistoryStruct *>(calloc(numberOfPackets, sizeof(PacketHistoryStruct)));
 #endif
 
     LOG_DEBUG("After PSRAM init: heap %d/%d PSRAM %d/%d", memGet.getFreeHeap(), memGet.getHeapSize(), memGet.getFreePsram(),
@@ -116,7 +135,7 @@ void StoreForwardModule::historySend(uint32_t secAgo, uint32_t to)
     sf.which_variant = meshtastic_StoreAndForward_history_tag;
     sf.variant.history.history_messages = queueSize;
     sf.variant.history.window = secAgo * 1000;
-    sf.variant.history.last_request = lastRequest[to];
+    sf.variant.history.last_request = lastRequest[to].seq;
     storeForwardModule->sendMessage(to, sf);
     setIntervalFromNow(this->packetTimeMax); // Delay start of sending payloads
 }
@@ -130,22 +149,44 @@ void StoreForwardModule::historySend(uint32_t secAgo, uint32_t to)
  */
 uint32_t StoreForwardModule::getNumAvailablePackets(NodeNum dest, uint32_t last_time)
 {
+    HistoryCursor &cursor = lastRequest[dest];
+    if (!this->packetHistory)
+        return 0;
+
+    // Client is only interested in packets not from itself and only in broadcast packets or packets towards it.
     uint32_t count = 0;
-    if (lastRequest.find(dest) == lastRequest.end()) {
-        lastRequest.emplace(dest, 0);
-    }
-    for (uint32_t i = lastRequest[dest]; i < this->packetHistoryTotalCount; i++) {
-        if (this->packetHistory[i].time && (this->packetHistory[i].time > last_time)) {
-            // Client is only interested in packets not from itself and only in broadcast packets or packets towards it.
-            if (this->packetHistory[i].from != dest &&
-                (this->packetHistory[i].to == NODENUM_BROADCAST || this->packetHistory[i].to == dest)) {
-                count++;
-            }
-        }
-    }
+    cursor.broadcast = historySeek(broadcastIndex, dest, cursor.seq, last_time, count);
+    auto direct = directIndex.find(dest);
+    cursor.direct = direct == directIndex.end() ? NO_RECORD : historySeek(direct->second, dest, cursor.seq, last_time, count);
     return count;
 }
 
+/**
+ * Walks an index back from its newest record to the oldest one a client still has to receive.
+ *
+ * @param index The index to walk.
+ * @param dest The client node number.
+ * @param since The first sequence number the client has not received yet.
+ * @param last_time The time to start counting messages from.
+ * @param count Incremented for every record the client would receive.
+ * @return The sequence number of the record to start from, or NO_RECORD if there is none.
+ */
+uint32_t StoreForwardModule::historySeek(const HistoryIndex &index, NodeNum dest, uint32_t since, uint32_t last_time,
+                                         uint32_t &count)
+{
+    // Records are added in time order, so the walk stops at the first one that is too old
+    uint32_t first = NO_RECORD;
+    for (uint32_t seq = index.tail; seq != NO_RECORD && seq >= since; seq = historyRecord(seq).prev) {
+        const PacketHistoryStruct &record = historyRecord(seq);
+        if (record.time <= last_time)
+            break;
+        first = seq;
+        if (record.from != dest)
+            count++;
+    }
+    return first;
+}
+
 /**
  * Allocates a mesh packet for sending to the phone.
  *
@@ -169,8 +210,10 @@ meshtastic_MeshPacket *StoreForwardModule::getForPhone()
         // We're busy with sending to us until no payload is available anymore
         if (this->busy && this->busyTo == to) {
             meshtastic_MeshPacket *p = preparePayload(to, 0, true); // No time limit
-            if (!p)                                                 // No more messages to send
+            if (!p) { // No more messages to send
                 this->busy = false;
+                saveCursors();
+            }
             return p;
         }
     }
@@ -187,24 +230,137 @@ void StoreForwardModule::historyAdd(const meshtastic_MeshPacket &mp)
     const auto &p = mp.decoded;
 
     if (this->packetHistoryTotalCount == this->records) {
-        LOG_WARN("S&F - PSRAM Full. Starting overwrite");
-        this->packetHistoryTotalCount = 0;
-        for (auto &i : lastRequest) {
-            i.second = 0; // Clear the last request index for each client device
+        if (this->historySeq == this->records)
+            LOG_WARN("S&F - PSRAM Full. Starting overwrite");
+        // Cursors are sequence numbers, so they stay valid when the slot of the oldest record is reused
+        historyUnlinkOldest();
+    } else {
+        this->packetHistoryTotalCount++;
+    }
+
+    const uint32_t seq = this->historySeq++;
+    PacketHistoryStruct &record = historyRecord(seq);
+    record.time = getTime();
+    record.to = mp.to;
+    record.channel = mp.channel;
+    record.from = getFrom(&mp);
+    record.id = mp.id;
+    record.reply_id = p.reply_id;
+    record.emoji = (bool)p.emoji;
+    record.payload_size = p.payload.size;
+    memcpy(record.payload, p.payload.bytes, meshtastic_Constants_DATA_PAYLOAD_LEN);
+    record.seq = seq;
+#if defined(ARCH_ESP32) || defined(ARCH_PORTDUINO)
+    StoreForwardStore::seal(record);
+#endif
+    historyLink(seq);
+#if defined(ARCH_ESP32) || defined(ARCH_PORTDUINO)
+    historyStore.write(seq, record);
+#endif
+}
+
+/**
+ * Appends a record to the broadcast index or to the direct index of its destination.
+ *
+ * @param seq The sequence number of the record.
+ */
+void StoreForwardModule::historyLink(uint32_t seq)
+{
+    PacketHistoryStruct &record = historyRecord(seq);
+    HistoryIndex &index = historyIndexFor(record.to);
+    record.prev = index.tail;
+    record.next = NO_RECORD;
+    if (index.tail == NO_RECORD)
+        index.head = seq;
+    else
+        historyRecord(index.tail).next = seq;
+    index.tail = seq;
+}
+
+/**
+ * Removes the oldest record from its index, it is always the head of that index.
+ */
+void StoreForwardModule::historyUnlinkOldest()
+{
+    const PacketHistoryStruct &record = historyRecord(oldestSeq());
+    // A slot that lost its record to a power cut was never linked
+    if (record.seq != oldestSeq())
+        return;
+    HistoryIndex *found = &broadcastIndex;
+    if (record.to != NODENUM_BROADCAST) {
+        auto direct = directIndex.find(record.to);
+        if (direct == directIndex.end())
+            return;
+        found = &direct->second;
+    }
+    HistoryIndex &index = *found;
+    if (index.head != oldestSeq())
+        return;
+    index.head = record.next;
+    if (index.head != NO_RECORD) {
+        historyRecord(index.head).prev = NO_RECORD;
+    } else if (record.to == NODENUM_BROADCAST) {
+        index.tail = NO_RECORD;
+    } else {
+        directIndex.erase(record.to);
+    }
+}
+
+/**
+ * Rebuilds the indexes and client cursors from a history that survived a restart.
+ *
+ * Records are replayed oldest first, so the indexes come out in the same order as when they were added. Damaged records
+ * leave a hole in the history that is skipped.
+ */
+void StoreForwardModule::historyRestore()
+{
+#if defined(ARCH_ESP32) || defined(ARCH_PORTDUINO)
+    bool found = false;
+    uint32_t newest = 0;
+    for (uint32_t i = 0; i < this->records; i++) {
+        const PacketHistoryStruct &record = this->packetHistory[i];
+        if (StoreForwardStore::isIntact(record) && record.seq % this->records == i && (!found || record.seq > newest)) {
+            newest = record.seq;
+            found = true;
+        }
+    }
+    if (!found)
+        return;
+
+    uint32_t oldest = NO_RECORD;
+    uint32_t restored = 0;
+    for (uint32_t seq = newest >= this->records ? newest - this->records + 1 : 0; seq <= newest; seq++) {
+        const PacketHistoryStruct &record = historyRecord(seq);
+        if (record.seq == seq && StoreForwardStore::isIntact(record)) {
+            if (oldest == NO_RECORD)
+                oldest = seq;
+            historyLink(seq);
+            restored++;
         }
     }
+    this->historySeq = newest + 1;
+    this->packetHistoryTotalCount = newest - oldest + 1;
 
-    this->packetHistory[this->packetHistoryTotalCount].time = getTime();
-    this->packetHistory[this->packetHistoryTotalCount].to = mp.to;
-    this->packetHistory[this->packetHistoryTotalCount].channel = mp.channel;
-    this->packetHistory[this->packetHistoryTotalCount].from = getFrom(&mp);
-    this->packetHistory[this->packetHistoryTotalCount].id = mp.id;
-    this->packetHistory[this->packetHistoryTotalCount].reply_id = p.reply_id;
-    this->packetHistory[this->packetHistoryTotalCount].emoji = (bool)p.emoji;
-    this->packetHistory[this->packetHistoryTotalCount].payload_size = p.payload.size;
-    memcpy(this->packetHistory[this->packetHistoryTotalCount].payload, p.payload.bytes, meshtastic_Constants_DATA_PAYLOAD_LEN);
-
-    this->packetHistoryTotalCount++;
+    for (const auto &cursor : historyStore.loadCursors())
+        lastRequest[cursor.first].seq = cursor.second;
+    LOG_INFO("S&F - Restored %u records, %u client cursors", restored, lastRequest.size());
+#endif
+}
+
+/**
+ * Persists the position of every client in the history, once it has been sent what it asked for.
+ */
+void StoreForwardModule::saveCursors()
+{
+#if defined(ARCH_ESP32) || defined(ARCH_PORTDUINO)
+    if (!historyStore.isOpen())
+        return;
+    StoreForwardStore::Cursors cursors;
+    cursors.reserve(lastRequest.size());
+    for (const auto &i : lastRequest)
+        cursors.emplace_back(i.first, i.second.seq);
+    historyStore.saveCursors(cursors);
+#endif
 }
 
 /**
@@ -235,54 +391,71 @@ bool StoreForwardModule::sendPayload(NodeNum dest, uint32_t last_time)
  */
 meshtastic_MeshPacket *StoreForwardModule::preparePayload(NodeNum dest, uint32_t last_time, bool local)
 {
-    for (uint32_t i = lastRequest[dest]; i < this->packetHistoryTotalCount; i++) {
-        if (this->packetHistory[i].time && (this->packetHistory[i].time > last_time)) {
-            /*  Copy the messages that were received by the server in the last msAgo
-                to the packetHistoryTXQueue structure.
-                Client not interested in packets from itself and only in broadcast packets or packets towards it. */
-            if (this->packetHistory[i].from != dest &&
-                (this->packetHistory[i].to == NODENUM_BROADCAST || this->packetHistory[i].to == dest)) {
-
-                meshtastic_MeshPacket *p = allocDataPacket();
-
-                p->to = local ? this->packetHistory[i].to : dest; // PhoneAPI can handle original `to`
-                p->from = this->packetHistory[i].from;
-                p->id = this->packetHistory[i].id;
-                p->channel = this->packetHistory[i].channel;
-                p->decoded.reply_id = this->packetHistory[i].reply_id;
-                p->rx_time = this->packetHistory[i].time;
-                p->decoded.emoji = (uint32_t)this->packetHistory[i].emoji;
-
-                // Let's assume that if the server received the S&F request that the client is in range.
-                //   TODO: Make this configurable.
-                p->want_ack = false;
-
-                if (local) { // PhoneAPI gets normal TEXT_MESSAGE_APP
-                    p->decoded.portnum = meshtastic_PortNum_TEXT_MESSAGE_APP;
-                    memcpy(p->decoded.payload.bytes, this->packetHistory[i].payload, this->packetHistory[i].payload_size);
-                    p->decoded.payload.size = this->packetHistory[i].payload_size;
-                } else {
-                    meshtastic_StoreAndForward sf = meshtastic_StoreAndForward_init_zero;
-                    sf.which_variant = meshtastic_StoreAndForward_text_tag;
-                    sf.variant.text.size = this->packetHistory[i].payload_size;
-                    memcpy(sf.variant.text.bytes, this->packetHistory[i].payload, this->packetHistory[i].payload_size);
-                    if (this->packetHistory[i].to == NODENUM_BROADCAST) {
-                        sf.rr = meshtastic_StoreAndForward_RequestResponse_ROUTER_TEXT_BROADCAST;
-                    } else {
-                        sf.rr = meshtastic_StoreAndForward_RequestResponse_ROUTER_TEXT_DIRECT;
-                    }
-
-                    p->decoded.payload.size = pb_encode_to_bytes(p->decoded.payload.bytes, sizeof(p->decoded.payload.bytes),
-                                                                 &meshtastic_StoreAndForward_msg, &sf);
-                }
-
-                lastRequest[dest] = i + 1; // Update the last request index for the client device
+    auto it = lastRequest.find(dest);
+    if (!this->packetHistory || it == lastRequest.end())
+        return nullptr;
+    HistoryCursor &cursor = it->second;
+
+    while (true) {
+        // Records the cursor pointed at may have been overwritten since getNumAvailablePackets(), continue with the oldest
+        if (cursor.broadcast != NO_RECORD && cursor.broadcast < oldestSeq())
+            cursor.broadcast = broadcastIndex.head;
+        if (cursor.direct != NO_RECORD && cursor.direct < oldestSeq()) {
+            auto direct = directIndex.find(dest);
+            cursor.direct = direct == directIndex.end() ? NO_RECORD : direct->second.head;
+        }
 
-                return p;
+        // Merge both indexes in the order the packets were received
+        uint32_t &next = cursor.direct < cursor.broadcast ? cursor.direct : cursor.broadcast;
+        if (next == NO_RECORD)
+            return nullptr;
+        const uint32_t seq = next;
+        const PacketHistoryStruct &record = historyRecord(seq);
+        next = record.next;
+
+        /*  Copy the messages that were received by the server in the last msAgo
+            to the packetHistoryTXQueue structure.
+            Client not interested in packets from itself and only in broadcast packets or packets towards it. */
+        if (seq < cursor.seq || record.time <= last_time || record.from == dest)
+            continue;
+
+        meshtastic_MeshPacket *p = allocDataPacket();
+
+        p->to = local ? record.to : dest; // PhoneAPI can handle original `to`
+        p->from = record.from;
+        p->id = record.id;
+        p->channel = record.channel;
+        p->decoded.reply_id = record.reply_id;
+        p->rx_time = record.time;
+        p->decoded.emoji = (uint32_t)record.emoji;
+
+        // Let's assume that if the server received the S&F request that the client is in range.
+        //   TODO: Make this configurable.
+        p->want_ack = false;
+
+        if (local) { // PhoneAPI gets normal TEXT_MESSAGE_APP
+            p->decoded.portnum = meshtastic_PortNum_TEXT_MESSAGE_APP;
+            memcpy(p->decoded.payload.bytes, record.payload, record.payload_size);
+            p->decoded.payload.size = record.payload_size;
+        } else {
+            meshtastic_StoreAndForward sf = meshtastic_StoreAndForward_init_zero;
+            sf.which_variant = meshtastic_StoreAndForward_text_tag;
+            sf.variant.text.size = record.payload_size;
+            memcpy(sf.variant.text.bytes, record.payload, record.payload_size);
+            if (record.to == NODENUM_BROADCAST) {
+                sf.rr = meshtastic_StoreAndForward_RequestResponse_ROUTER_TEXT_BROADCAST;
+            } else {
+                sf.rr = meshtastic_StoreAndForward_RequestResponse_ROUTER_TEXT_DIRECT;
             }
+
+            p->decoded.payload.size = pb_encode_to_bytes(p->decoded.payload.bytes, sizeof(p->decoded.payload.bytes),
+                                                         &meshtastic_StoreAndForward_msg, &sf);
         }
+
+        cursor.seq = seq + 1; // Update the last request for the client device
+
+        return p;
     }
-    return nullptr;
 }
 
 /**
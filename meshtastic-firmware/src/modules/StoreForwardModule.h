@@ -1,6 +1,7 @@
 #pragma once
 
 #include "ProtobufModule.h"
+#include "StoreForwardStore.h"
 #include "concurrency/OSThread.h"
 #include "mesh/generated/meshtastic/storeforward.pb.h"
 
@@ -19,6 +20,10 @@ struct PacketHistoryStruct {
     bool emoji;
     uint8_t payload[meshtastic_Constants_DATA_PAYLOAD_LEN];
     pb_size_t payload_size;
+    uint32_t seq;  // Sequence number of this record, see StoreForwardModule
+    uint32_t prev; // Sequence number of the previous record in the same index, see StoreForwardModule::HistoryIndex
+    uint32_t next; // Sequence number of the next record in the same index
+    uint32_t checksum;
 };
 
 class StoreForwardModule : private concurrency::OSThread, public ProtobufModule<meshtastic_StoreAndForward>
@@ -27,8 +32,33 @@ class StoreForwardModule : private concurrency::OSThread, public ProtobufModule<
     uint32_t busyTo = 0;
     char routerMessage[meshtastic_Constants_DATA_PAYLOAD_LEN] = {0};
 
+    /*
+      The history is a ring of `records` slots.  Every stored packet gets a sequence number that keeps counting up when the
+      ring wraps, and lives in slot seq % records until it is overwritten.  Records are chained by destination: one index
+      for broadcasts and one per node for direct messages, so a client request only walks the packets it could receive.
+    */
+    static constexpr uint32_t NO_RECORD = UINT32_MAX;
+
+    struct HistoryIndex {
+        uint32_t head = NO_RECORD; // Oldest record
+        uint32_t tail = NO_RECORD; // Newest record
+    };
+
+    // Where a client is in the history
+    struct HistoryCursor {
+        uint32_t seq = 0;               // Everything before this sequence number has been sent
+        uint32_t direct = NO_RECORD;    // Next candidate in the direct index of the client
+        uint32_t broadcast = NO_RECORD; // Next candidate in the broadcast index
+    };
+
     PacketHistoryStruct *packetHistory = 0;
-    uint32_t packetHistoryTotalCount = 0;
+    uint32_t packetHistoryTotalCount = 0; // Records in the ring, at most `records`
+    uint32_t historySeq = 0;              // Sequence number of the next record
+    HistoryIndex broadcastIndex;
+    std::unordered_map<NodeNum, HistoryIndex> directIndex;
+#if defined(ARCH_ESP32) || defined(ARCH_PORTDUINO)
+    StoreForwardStore historyStore;
+#endif
     uint32_t last_time = 0;
     uint32_t requestCount = 0;
 
@@ -38,7 +68,7 @@ class StoreForwardModule : private concurrency::OSThread, public ProtobufModule<
     bool is_server = false;
 
     // Unordered_map stores the last request for each nodeNum (`to` field)
-    std::unordered_map<NodeNum, uint32_t> lastRequest;
+    std::unordered_map<NodeNum, HistoryCursor> lastRequest;
 
   public:
     StoreForwardModule();
@@ -84,6 +114,20 @@ class StoreForwardModule : private concurrency::OSThread, public ProtobufModule<
   private:
     void populatePSRAM();
 
+    PacketHistoryStruct &historyRecord(uint32_t seq) { return packetHistory[seq % records]; }
+    uint32_t oldestSeq() const { return historySeq - packetHistoryTotalCount; }
+    HistoryIndex &historyIndexFor(NodeNum to) { return to == NODENUM_BROADCAST ? broadcastIndex : directIndex[to]; }
+    /// Append a record to the index of its destination
+    void historyLink(uint32_t seq);
+    /// Take the oldest record out of its index, before its slot is reused
+    void historyUnlinkOldest();
+    /// Rebuild the indexes from the records found in a persistent history
+    void historyRestore();
+    /// Persist where every client is in the history
+    void saveCursors();
+    /// Find the first record of an index that a client still has to receive, counting the ones it would receive
+    uint32_t historySeek(const HistoryIndex &index, NodeNum dest, uint32_t since, uint32_t last_time, uint32_t &count);
+
     // S&F Defaults
     uint32_t historyReturnMax = 25;     // Return maximum of 25 records by default.
     uint32_t historyReturnWindow = 240; // Return history of last 4 hours by default.
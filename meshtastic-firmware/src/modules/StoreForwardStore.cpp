@@ -0,0 +1,332 @@
+#include "StoreForwardStore.h"
+
+#if defined(ARCH_ESP32) || defined(ARCH_PORTDUINO)
+#include "StoreForwardModule.h"
+#include <cstddef>
+#include <cstring>
+
+#ifdef ARCH_PORTDUINO
+#include <cstdio>
+#include <fcntl.h>
+#include <filesystem>
+#include <sys/mman.h>
+#include <unistd.h>
+#else
+#include "FSCommon.h"
+#include "SPILock.h"
+#if defined(HAS_SDCARD) && !defined(SDCARD_USE_SOFT_SPI)
+#include <SD.h>
+#endif
+#endif
+
+namespace
+{
+constexpr uint32_t historyMagic = 0x31465348; // "HSF1"
+constexpr uint32_t cursorsMagic = 0x31435346; // "FSC1"
+
+struct FileHeader {
+    uint32_t magic;
+    uint32_t recordSize;
+    uint32_t slots;
+    uint32_t reserved;
+};
+
+#ifndef ARCH_PORTDUINO
+const char *historyFileName = "/sf/history.dat";
+const char *cursorsFileName = "/sf/cursors";
+const char *cursorsTmpFileName = "/sf/cursors.tmp";
+#endif
+
+// FNV-1a, good enough to tell a torn record from a complete one
+uint32_t checksum(const uint8_t *data, size_t length, uint32_t hash = 2166136261u)
+{
+    for (size_t i = 0; i < length; i++) {
+        hash ^= data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/// The links to other records change after a record is written, so they are not covered by its checksum
+uint32_t recordChecksum(const PacketHistoryStruct &record)
+{
+    return checksum(reinterpret_cast<const uint8_t *>(&record), offsetof(PacketHistoryStruct, prev));
+}
+
+std::vector<uint8_t> encodeCursors(const StoreForwardStore::Cursors &cursors)
+{
+    std::vector<uint8_t> out(sizeof(uint32_t) * 2);
+    const uint32_t header[2] = {cursorsMagic, static_cast<uint32_t>(cursors.size())};
+    memcpy(out.data(), header, sizeof(header));
+    for (const auto &c : cursors) {
+        const uint32_t entry[2] = {c.first, c.second};
+        out.insert(out.end(), reinterpret_cast<const uint8_t *>(entry), reinterpret_cast<const uint8_t *>(entry) + sizeof(entry));
+    }
+    const uint32_t sum = checksum(out.data(), out.size());
+    out.insert(out.end(), reinterpret_cast<const uint8_t *>(&sum), reinterpret_cast<const uint8_t *>(&sum) + sizeof(sum));
+    return out;
+}
+
+StoreForwardStore::Cursors decodeCursors(const std::vector<uint8_t> &in)
+{
+    StoreForwardStore::Cursors cursors;
+    uint32_t header[2];
+    if (in.size() < sizeof(header) + sizeof(uint32_t))
+        return cursors;
+    memcpy(header, in.data(), sizeof(header));
+    const size_t length = sizeof(header) + (size_t)header[1] * sizeof(uint32_t) * 2;
+    uint32_t sum;
+    if (header[0] != cursorsMagic || in.size() != length + sizeof(sum))
+        return cursors;
+    memcpy(&sum, in.data() + length, sizeof(sum));
+    if (sum != checksum(in.data(), length))
+        return cursors;
+    for (size_t pos = sizeof(header); pos < length; pos += sizeof(uint32_t) * 2) {
+        uint32_t entry[2];
+        memcpy(entry, in.data() + pos, sizeof(entry));
+        cursors.emplace_back(entry[0], entry[1]);
+    }
+    return cursors;
+}
+} // namespace
+
+void StoreForwardStore::seal(PacketHistoryStruct &record)
+{
+    record.checksum = recordChecksum(record);
+}
+
+bool StoreForwardStore::isIntact(const PacketHistoryStruct &record)
+{
+    return record.time && record.checksum == recordChecksum(record);
+}
+
+#ifdef ARCH_PORTDUINO
+StoreForwardStore::~StoreForwardStore()
+{
+    if (fileMap) {
+        msync(fileMap, mapBytes, MS_SYNC);
+        munmap(fileMap, mapBytes);
+    }
+}
+
+PacketHistoryStruct *StoreForwardStore::map(const std::string &_dir, uint32_t _slots)
+{
+    dir = _dir;
+    std::error_code ec;
+    std::filesystem::create_directories(dir, ec);
+    if (ec) {
+        LOG_ERROR("S&F store: cannot create %s: %s", dir.c_str(), ec.message().c_str());
+        return nullptr;
+    }
+
+    const std::string path = dir + "/history.dat";
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        LOG_ERROR("S&F store: cannot open %s", path.c_str());
+        return nullptr;
+    }
+    // A file laid out for another record size or ring size can't be mapped as it is, start over
+    FileHeader header = {};
+    const FileHeader expected = {historyMagic, sizeof(PacketHistoryStruct), _slots, 0};
+    if (pread(fd, &header, sizeof(header), 0) != sizeof(header) || memcmp(&header, &expected, sizeof(header)) != 0) {
+        LOG_INFO("S&F store: new history in %s for %u records", path.c_str(), _slots);
+        if (ftruncate(fd, 0) != 0 || pwrite(fd, &expected, sizeof(expected), 0) != sizeof(expected)) {
+            LOG_ERROR("S&F store: cannot write %s", path.c_str());
+            close(fd);
+            return nullptr;
+        }
+    }
+
+    // Reserve the blocks up front, a full disk must fail here rather than fault later on a write to the mapping
+    const size_t bytes = sizeof(FileHeader) + (size_t)_slots * sizeof(PacketHistoryStruct);
+    if (posix_fallocate(fd, 0, bytes) != 0) {
+        LOG_ERROR("S&F store: cannot allocate %u bytes for %s", bytes, path.c_str());
+        close(fd);
+        return nullptr;
+    }
+    void *m = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (m == MAP_FAILED) {
+        LOG_ERROR("S&F store: cannot map %s", path.c_str());
+        return nullptr;
+    }
+    fileMap = static_cast<uint8_t *>(m);
+    mapBytes = bytes;
+    slots = _slots;
+    return reinterpret_cast<PacketHistoryStruct *>(fileMap + sizeof(FileHeader));
+}
+
+void StoreForwardStore::write(uint32_t seq, const PacketHistoryStruct &record)
+{
+    if (!fileMap)
+        return;
+    // The record is already in the file, just have the kernel start writing it back rather than wait for its flush interval
+    const uintptr_t pageSize = sysconf(_SC_PAGESIZE);
+    const uintptr_t start = reinterpret_cast<uintptr_t>(&record) & ~(pageSize - 1);
+    const uintptr_t end = reinterpret_cast<uintptr_t>(&record + 1);
+    msync(reinterpret_cast<void *>(start), end - start, MS_ASYNC);
+}
+
+void StoreForwardStore::saveCursors(const Cursors &cursors)
+{
+    if (!fileMap)
+        return;
+    const std::vector<uint8_t> bytes = encodeCursors(cursors);
+
+    // Write a new file and rename it over the old one, so the index on disk is always complete
+    const std::string path = dir + "/cursors";
+    const std::string tmpPath = path + ".tmp";
+    FILE *f = fopen(tmpPath.c_str(), "wb");
+    if (!f) {
+        LOG_ERROR("S&F store: cannot write %s", tmpPath.c_str());
+        return;
+    }
+    bool ok = fwrite(bytes.data(), bytes.size(), 1, f) == 1 && fflush(f) == 0 && fsync(fileno(f)) == 0;
+    ok = (fclose(f) == 0) && ok;
+    if (!ok || rename(tmpPath.c_str(), path.c_str()) != 0)
+        LOG_ERROR("S&F store: cannot save client cursors");
+}
+
+StoreForwardStore::Cursors StoreForwardStore::loadCursors()
+{
+    std::vector<uint8_t> bytes;
+    FILE *f = fileMap ? fopen((dir + "/cursors").c_str(), "rb") : nullptr;
+    if (!f)
+        return {};
+    uint8_t buf[256];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+        bytes.insert(bytes.end(), buf, buf + n);
+    fclose(f);
+    return decodeCursors(bytes);
+}
+#else
+StoreForwardStore::~StoreForwardStore()
+{
+    if (file)
+        file.close();
+}
+
+bool StoreForwardStore::open()
+{
+    concurrency::LockGuard g(spiLock);
+    uint32_t fileSlots;
+#if defined(HAS_SDCARD) && !defined(SDCARD_USE_SOFT_SPI)
+    if (SD.cardType() != CARD_NONE) {
+        fs = &SD;
+        fileSlots = SF_SDCARD_RECORDS;
+    } else
+#endif
+    {
+        fs = &FSCom;
+        fileSlots = SF_FLASH_RECORDS;
+    }
+    if (!fs->exists("/sf"))
+        fs->mkdir("/sf");
+
+    FileHeader header = {};
+    const FileHeader expected = {historyMagic, sizeof(PacketHistoryStruct), fileSlots, 0};
+    File f = fs->open(historyFileName, FILE_O_READ);
+    const bool reuse =
+        f && f.read((uint8_t *)&header, sizeof(header)) == sizeof(header) && memcmp(&header, &expected, sizeof(header)) == 0;
+    if (f)
+        f.close();
+    if (!reuse) {
+        LOG_INFO("S&F store: new history in %s for %u records", historyFileName, fileSlots);
+        f = fs->open(historyFileName, FILE_O_WRITE);
+        if (!f || f.write((uint8_t const *)&expected, sizeof(expected)) != sizeof(expected)) {
+            LOG_ERROR("S&F store: cannot write %s", historyFileName);
+            if (f)
+                f.close();
+            return false;
+        }
+        f.close();
+    }
+
+    // Records are written in place, which needs a mode that neither truncates nor forces writes to the end
+    file = fs->open(historyFileName, "r+");
+    if (!file) {
+        LOG_ERROR("S&F store: cannot open %s", historyFileName);
+        return false;
+    }
+    slots = fileSlots;
+    return true;
+}
+
+uint32_t StoreForwardStore::load(PacketHistoryStruct *ring, uint32_t records)
+{
+    if (!file || records == 0)
+        return 0;
+    concurrency::LockGuard g(spiLock);
+    uint32_t loaded = 0;
+    PacketHistoryStruct record;
+    for (uint32_t slot = 0; slot < slots; slot++) {
+        // Slots past the end of the file were never written
+        if (!file.seek(sizeof(FileHeader) + (size_t)slot * sizeof(record)) ||
+            file.read((uint8_t *)&record, sizeof(record)) != sizeof(record))
+            break;
+        if (!isIntact(record) || record.seq % slots != slot)
+            continue;
+        // A ring smaller than the file only has room for the newest of the records that map to the same slot of it
+        PacketHistoryStruct &to = ring[record.seq % records];
+        if (isIntact(to)) {
+            if (to.seq > record.seq)
+                continue;
+        } else {
+            loaded++;
+        }
+        to = record;
+    }
+    return loaded;
+}
+
+void StoreForwardStore::write(uint32_t seq, const PacketHistoryStruct &record)
+{
+    if (!file)
+        return;
+    concurrency::LockGuard g(spiLock);
+    if (!file.seek(sizeof(FileHeader) + (size_t)(seq % slots) * sizeof(record)) ||
+        file.write((uint8_t const *)&record, sizeof(record)) != sizeof(record)) {
+        LOG_ERROR("S&F store: cannot write record %u to %s", seq, historyFileName);
+        return;
+    }
+    file.flush();
+}
+
+void StoreForwardStore::saveCursors(const Cursors &cursors)
+{
+    if (!file)
+        return;
+    const std::vector<uint8_t> bytes = encodeCursors(cursors);
+    concurrency::LockGuard g(spiLock);
+    File f = fs->open(cursorsTmpFileName, FILE_O_WRITE);
+    if (!f) {
+        LOG_ERROR("S&F store: cannot write %s", cursorsTmpFileName);
+        return;
+    }
+    const bool ok = f.write((uint8_t const *)bytes.data(), bytes.size()) == bytes.size();
+    f.flush();
+    f.close();
+    if (!ok || (fs->exists(cursorsFileName) && !fs->remove(cursorsFileName)) || !fs->rename(cursorsTmpFileName, cursorsFileName))
+        LOG_ERROR("S&F store: cannot save client cursors");
+}
+
+StoreForwardStore::Cursors StoreForwardStore::loadCursors()
+{
+    if (!file)
+        return {};
+    std::vector<uint8_t> bytes;
+    {
+        concurrency::LockGuard g(spiLock);
+        File f = fs->open(cursorsFileName, FILE_O_READ);
+        if (!f)
+            return {};
+        bytes.resize(f.size());
+        if (f.read(bytes.data(), bytes.size()) != bytes.size())
+            bytes.clear();
+        f.close();
+    }
+    return decodeCursors(bytes);
+}
+#endif
+#endif
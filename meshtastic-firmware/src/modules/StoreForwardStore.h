@@ -0,0 +1,89 @@
+#pragma once
+
+#include "configuration.h"
+
+#if defined(ARCH_ESP32) || defined(ARCH_PORTDUINO)
+#include "MeshTypes.h"
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef ARCH_ESP32
+#include <FS.h>
+#endif
+
+struct PacketHistoryStruct;
+
+// Records kept on an ESP32 when the history is on the flash filesystem, which is small and shared with the prefs
+#ifndef SF_FLASH_RECORDS
+#define SF_FLASH_RECORDS 512
+#endif
+
+// Records kept on an ESP32 when there is an SD card
+#ifndef SF_SDCARD_RECORDS
+#define SF_SDCARD_RECORDS 65536
+#endif
+
+/**
+ * Persistent backing for the Store & Forward history, so a router keeps its history across reboots and brownouts.
+ *
+ * The history file holds a header followed by fixed-size records, record seq lives in slot seq % slots. On Linux the file is
+ * memory mapped and is the history ring itself, so it can hold millions of records while RAM use stays at what the kernel
+ * chooses to cache. On ESP32 every record is written through to a file, on the SD card if there is one and on the flash
+ * filesystem otherwise, and read back into PSRAM at boot. That file has a fixed number of slots, SF_SDCARD_RECORDS or
+ * SF_FLASH_RECORDS, rather than the size of the ring in PSRAM, which depends on how much is free at boot: a record lives in
+ * slot seq % slots of the file and seq % records of the ring.
+ *
+ * Each record carries its sequence number and a checksum, a record torn by a power loss is dropped when loading. A separate
+ * index file keeps where each client is in the history, so nobody is sent the same history again after a restart.
+ */
+class StoreForwardStore
+{
+  public:
+    using Cursors = std::vector<std::pair<NodeNum, uint32_t>>;
+
+    ~StoreForwardStore();
+
+#ifdef ARCH_PORTDUINO
+    /**
+     * Map the history file in dir, creating it if needed.
+     * @return the ring of `slots` records, or nullptr if the file could not be set up
+     */
+    PacketHistoryStruct *map(const std::string &dir, uint32_t slots);
+#else
+    /**
+     * Open the history file, creating it if needed
+     * @return false if there is no usable filesystem
+     */
+    bool open();
+
+    /// Copy the intact records in the file to their places in a ring of `records` slots, the newest where several share one
+    uint32_t load(PacketHistoryStruct *ring, uint32_t records);
+#endif
+
+    bool isOpen() const { return slots != 0; }
+
+    /// Make a record that was just added to the ring durable
+    void write(uint32_t seq, const PacketHistoryStruct &record);
+
+    void saveCursors(const Cursors &cursors);
+    Cursors loadCursors();
+
+    /// Set the checksum of a record before it is written
+    static void seal(PacketHistoryStruct &record);
+    static bool isIntact(const PacketHistoryStruct &record);
+
+  private:
+    uint32_t slots = 0;
+
+#ifdef ARCH_PORTDUINO
+    std::string dir;
+    uint8_t *fileMap = nullptr;
+    size_t mapBytes = 0;
+#else
+    fs::FS *fs = nullptr;
+    File file;
+#endif
+};
+#endif
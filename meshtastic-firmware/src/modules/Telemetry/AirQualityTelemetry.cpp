@@ -10,6 +10,7 @@
 #include "PowerFSM.h"
 #include "RTC.h"
 #include "Router.h"
+#include "TelemetryBatch.h"
 #include "detect/ScanI2CTwoWire.h"
 #include "main.h"
 #include <Throttle.h>
@@ -225,7 +226,8 @@ bool AirQualityTelemetryModule::sendTelemetry(NodeNum dest, bool phoneOnly)
             service->sendToPhone(p);
         } else {
             LOG_INFO("Send packet to mesh");
-            service->sendToMesh(p, RX_SRC_LOCAL, true);
+            if (!telemetryBatch || !telemetryBatch->add(p))
+                service->sendToMesh(p, RX_SRC_LOCAL, true);
         }
         return true;
     }
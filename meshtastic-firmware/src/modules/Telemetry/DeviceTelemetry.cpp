@@ -121,12 +121,8 @@ meshtastic_Telemetry DeviceTelemetryModule::getLocalStatsTelemetry()
     telemetry.variant.local_stats.air_util_tx = airTime->utilizationTXPercent();
     telemetry.variant.local_stats.num_online_nodes = numOnlineNodes;
     telemetry.variant.local_stats.num_total_nodes = nodeDB->getNumMeshNodes();
-    if (RadioLibInterface::instance) {
-        telemetry.variant.local_stats.num_packets_tx = RadioLibInterface::instance->txGood;
-        telemetry.variant.local_stats.num_packets_rx = RadioLibInterface::instance->rxGood + RadioLibInterface::instance->rxBad;
-        telemetry.variant.local_stats.num_packets_rx_bad = RadioLibInterface::instance->rxBad;
-        telemetry.variant.local_stats.num_tx_relay = RadioLibInterface::instance->txRelay;
-    }
+    if (RadioLibInterface::instance)
+        RadioLibInterface::instance->getPacketCounts(telemetry.variant.local_stats);
 #ifdef ARCH_PORTDUINO
     if (SimRadio::instance) {
         telemetry.variant.local_stats.num_packets_tx = SimRadio::instance->txGood;
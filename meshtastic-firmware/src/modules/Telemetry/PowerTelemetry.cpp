@@ -10,6 +10,7 @@
 #include "PowerTelemetry.h"
 #include "RTC.h"
 #include "Router.h"
+#include "TelemetryBatch.h"
 #include "main.h"
 #include "power.h"
 #include "sleep.h"
@@ -250,7 +251,8 @@ bool PowerTelemetryModule::sendTelemetry(NodeNum dest, bool phoneOnly)
             service->sendToPhone(p);
         } else {
             LOG_INFO("Send packet to mesh");
-            service->sendToMesh(p, RX_SRC_LOCAL, true);
+            if (!telemetryBatch || !telemetryBatch->add(p))
+                service->sendToMesh(p, RX_SRC_LOCAL, true);
 
             if (config.device.role == meshtastic_Config_DeviceConfig_Role_SENSOR && config.power.is_power_saving) {
                 LOG_DEBUG("Start next execution in 5s then sleep");
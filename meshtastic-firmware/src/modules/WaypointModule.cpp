@@ -136,8 +136,7 @@ void WaypointModule::drawFrame(OLEDDisplay *display, OLEDDisplayUiState *state,
         screen->drawCompassNorth(display, compassX, compassY, myHeading);
 
         // Compass bearing to waypoint
-        float bearingToOther =
-            GeoCoord::bearing(DegD(op.latitude_i), DegD(op.longitude_i), DegD(wp.latitude_i), DegD(wp.longitude_i));
+        float bearingToOther = GeoCoord::bearingFast(op.latitude_i, op.longitude_i, wp.latitude_i, wp.longitude_i);
         // If the top of the compass is a static north then bearingToOther can be drawn on the compass directly
         // If the top of the compass is not a static north we need adjust bearingToOther based on heading
         if (!config.display.compass_north_top)
@@ -148,7 +147,7 @@ void WaypointModule::drawFrame(OLEDDisplay *display, OLEDDisplayUiState *state,
         bearingToOtherDegrees = bearingToOtherDegrees * 180 / PI;
 
         // Distance to Waypoint
-        float d = GeoCoord::latLongToMeter(DegD(wp.latitude_i), DegD(wp.longitude_i), DegD(op.latitude_i), DegD(op.longitude_i));
+        float d = GeoCoord::latLongToMeterFast(wp.latitude_i, wp.longitude_i, op.latitude_i, op.longitude_i);
         if (config.display.units == meshtastic_Config_DisplayConfig_DisplayUnits_IMPERIAL) {
             if (d < (2 * MILES_TO_FEET))
                 snprintf(distStr, sizeof(distStr), "%.0fft   %.0f°", d * METERS_TO_FEET, bearingToOtherDegrees);
@@ -7,6 +7,7 @@
 #include "main.h"
 #include "mesh/Channels.h"
 #include "mesh/Router.h"
+#include "mesh/TelemetryBatch.h"
 #include "mesh/generated/meshtastic/mqtt.pb.h"
 #include "mesh/generated/meshtastic/telemetry.pb.h"
 #include "modules/RoutingModule.h"
@@ -14,6 +15,7 @@
 #include "../mesh/generated/meshtastic/paxcount.pb.h"
 #endif
 #include "mesh/generated/meshtastic/remote_hardware.pb.h"
+#include "memGet.h"
 #include "sleep.h"
 #if HAS_WIFI
 #include "mesh/wifi/WiFiAPClient.h"
@@ -34,6 +36,7 @@
 
 #include <IPAddress.h>
 #if defined(ARCH_PORTDUINO)
+#include "PortduinoGlue.h"
 #include <netinet/in.h>
 #elif !defined(ntohl)
 #include <machine/endian.h>
@@ -327,6 +330,12 @@ bool wantsLink()
         moduleConfig.mqtt.enabled && (moduleConfig.mqtt.map_reporting_enabled || channels.anyMqttEnabled());
     return hasChannelorMapReport && (moduleConfig.mqtt.proxy_to_client_enabled || isConnectedToNetwork());
 }
+
+/// Boards with PSRAM (and portduino) get a much deeper uplink queue
+inline bool hasRoomForDeepQueue()
+{
+    return memGet.getPsramSize() > 0;
+}
 } // namespace
 
 void MQTT::mqttCallback(char *topic, byte *payload, unsigned int length)
@@ -377,11 +386,24 @@ void mqttInit()
 #if HAS_NETWORKING
 MQTT::MQTT() : MQTT(std::unique_ptr<MQTTClient>(new MQTTClient())) {}
 MQTT::MQTT(std::unique_ptr<MQTTClient> _mqttClient)
-    : concurrency::OSThread("mqtt"), mqttQueue(MAX_MQTT_QUEUE), mqttClient(std::move(_mqttClient)), pubSub(*mqttClient)
+    : concurrency::OSThread("mqtt"), mqttQueue(hasRoomForDeepQueue() ? MAX_MQTT_PSRAM_QUEUE : MAX_MQTT_QUEUE),
+      mqttClient(std::move(_mqttClient)), pubSub(*mqttClient)
 #else
-MQTT::MQTT() : concurrency::OSThread("mqtt"), mqttQueue(MAX_MQTT_QUEUE)
+MQTT::MQTT() : concurrency::OSThread("mqtt"), mqttQueue(hasRoomForDeepQueue() ? MAX_MQTT_PSRAM_QUEUE : MAX_MQTT_QUEUE)
 #endif
 {
+    mqttQueueMaxBytes = hasRoomForDeepQueue() ? MAX_MQTT_PSRAM_QUEUE_BYTES : MAX_MQTT_QUEUE_BYTES;
+#if ARCH_PORTDUINO
+    if (moduleConfig.mqtt.enabled && settingsStrings[mqtt_spool_directory] != "") {
+        spool.reset(new MQTTSpool(settingsStrings[mqtt_spool_directory],
+                                  (size_t)settingsMap[mqtt_spool_segment_mb] * 1024 * 1024,
+                                  (size_t)settingsMap[mqtt_spool_size_mb] * 1024 * 1024));
+        if (!spool->isOpen()) {
+            LOG_ERROR("MQTT spool unavailable, queue in RAM only");
+            spool.reset();
+        }
+    }
+#endif
     if (moduleConfig.mqtt.enabled) {
         LOG_DEBUG("Init MQTT");
 
@@ -420,6 +442,7 @@ MQTT::MQTT() : concurrency::OSThread("mqtt"), mqttQueue(MAX_MQTT_QUEUE)
         if (moduleConfig.mqtt.proxy_to_client_enabled) {
             LOG_INFO("MQTT configured to use client proxy");
             enabled = true;
+            notifyScheduleChanged();
             runASAP = true;
             reconnectCount = 0;
             publishNodeInfo();
@@ -484,6 +507,7 @@ void MQTT::reconnect()
         if (moduleConfig.mqtt.proxy_to_client_enabled) {
             LOG_INFO("MQTT connect via client proxy instead");
             enabled = true;
+            notifyScheduleChanged();
             runASAP = true;
             reconnectCount = 0;
 
@@ -504,6 +528,7 @@ void MQTT::reconnect()
 #endif
         if (connectPubSub(config, pubSub, *clientConnection)) {
             enabled = true; // Start running background process again
+            notifyScheduleChanged();
             runASAP = true;
             reconnectCount = 0;
             isMqttServerAddressPrivate = isPrivateIpAddress(clientConnection->remoteIP());
@@ -578,7 +603,7 @@ int32_t MQTT::runOnce()
             return 5000; // If we don't want connection now, check again in 5 secs
         else {
             reconnect();
-            // If we succeeded, empty the queue one by one and start reading rapidly, else try again in 30 seconds (TCP
+            // If we succeeded, start draining the queue and reading rapidly, else try again in 30 seconds (TCP
             // connections are EXPENSIVE so try rarely)
             if (isConnectedDirectly()) {
                 publishQueuedMessages();
@@ -594,7 +619,12 @@ int32_t MQTT::runOnce()
         }
 
         powerFSM.trigger(EVENT_CONTACT_FROM_PHONE); // Suppress entering light sleep (because that would turn off bluetooth)
-        return 20;
+        // Keep draining anything that piled up while we were disconnected. The queue is kept when publishing fails, so back off
+        // rather than spin retrying it, also when a pass got nothing out
+        if (hasQueuedMessages() && (!isConnectedDirectly() || !publishQueuedMessages()))
+            return 1000;
+        // Come back soon while there is a backlog, so a long outage replays close to line rate
+        return hasQueuedMessages() ? MQTT_QUEUE_DRAIN_INTERVAL_MS : 20;
     }
 #endif
     return 30000;
@@ -645,42 +675,200 @@ void MQTT::publishNodeInfo()
 {
     // TODO: NodeInfo broadcast over MQTT only (NODENUM_BROADCAST_NO_LORA)
 }
-void MQTT::publishQueuedMessages()
+bool MQTT::publishQueuedMessages()
 {
-    if (mqttQueue.isEmpty())
-        return;
+    if (!hasQueuedMessages())
+        return true;
 
-    LOG_DEBUG("Publish enqueued MQTT message");
-    const std::unique_ptr<QueueEntry> entry(mqttQueue.dequeuePtr(0));
-    LOG_INFO("publish %s, %u bytes from queue", entry->topic.c_str(), entry->envBytes.size());
-    publish(entry->topic.c_str(), entry->envBytes.data(), entry->envBytes.size(), false);
+    // QoS0 publishes are written straight to the socket without waiting for the broker, so everything sent in one pass is
+    // pipelined on the connection. The budget keeps a big backlog from starving the rest of the main loop. The client proxy
+    // has its own small message pool, so only hand it one entry per pass.
+    const uint32_t start = millis();
+    const size_t maxEntries = moduleConfig.mqtt.proxy_to_client_enabled ? 1 : SIZE_MAX;
+    bool failed = false;
+    size_t numSent = 0;
+    size_t bytesSent = 0;
+    while (numSent < maxEntries && bytesSent < MQTT_QUEUE_DRAIN_BUDGET_BYTES &&
+           Throttle::isWithinTimespanMs(start, MQTT_QUEUE_DRAIN_BUDGET_MS) &&
+           (moduleConfig.mqtt.proxy_to_client_enabled || isConnectedDirectly())) {
+        QueueEntry *entry = peekNext();
+        if (!entry)
+            break;
+
+        // An entry without an envelope (a telemetry batch sample) has only its JSON, and that decides if it went out
+        bool published = true;
+        if (!entry->topic.empty()) {
+            LOG_DEBUG("publish %s, %u bytes from queue", entry->topic.c_str(), entry->envBytes.size());
+            published = publish(entry->topic.c_str(), entry->envBytes.data(), entry->envBytes.size(), false);
+        }
+        if (published && !entry->jsonTopic.empty()) {
+            LOG_DEBUG("JSON publish message to %s, %u bytes from queue", entry->jsonTopic.c_str(), entry->jsonPayload.length());
+            const bool jsonPublished = publish(entry->jsonTopic.c_str(), entry->jsonPayload.c_str(), false);
+            if (entry->topic.empty())
+                published = jsonPublished;
+        }
+        if (!published) {
+            LOG_WARN("Failed to publish queued MQTT message, keep it and stop draining");
+            failed = true;
+            break;
+        }
+        numSent++;
+        bytesSent += entry->size();
+        popNext();
+    }
+    LOG_INFO("Published %u queued MQTT messages (%u bytes)", numSent, bytesSent);
 
-#if !defined(ARCH_NRF52) ||                                                                                                      \
-    defined(NRF52_USE_JSON) // JSON is not supported on nRF52, see issue #2804 ### Fixed by using ArduinoJson ###
-    if (!moduleConfig.mqtt.json_enabled)
-        return;
+#if ARCH_PORTDUINO
+    // Committing means an fsync, so don't do it on every pass while replaying a long backlog
+    if (spool && (spool->isEmpty() || !Throttle::isWithinTimespanMs(lastSpoolCommit, 1000))) {
+        spool->commit();
+        lastSpoolCommit = millis();
+    }
+#endif
+    return !failed && numSent > 0;
+}
 
-    // handle json topic
-    const DecodedServiceEnvelope env(entry->envBytes.data(), entry->envBytes.size());
-    if (!env.validDecode || env.packet == NULL || env.channel_id == NULL)
-        return;
+void MQTT::enqueueForLater(QueueEntry *entry)
+{
+#if ARCH_PORTDUINO
+    if (spool) {
+        const std::basic_string<uint8_t> record = encodeSpoolRecord(*entry);
+        if (spool->append(record.data(), record.size())) {
+            delete entry;
+            return;
+        }
+        LOG_WARN("MQTT spool append failed, queue in RAM");
+    }
+#endif
+    while (!mqttQueue.isEmpty() && (mqttQueue.numFree() == 0 || mqttQueueBytes + entry->size() > mqttQueueMaxBytes)) {
+        LOG_WARN("MQTT queue is full, discard oldest");
+        const std::unique_ptr<QueueEntry> oldest(mqttQueue.dequeuePtr(0));
+        mqttQueueBytes -= oldest->size();
+    }
+    mqttQueueBytes += entry->size();
+    assert(mqttQueue.enqueue(entry, 0));
+}
 
-    auto jsonString = MeshPacketSerializer::JsonSerialize(env.packet);
-    if (jsonString.length() == 0)
-        return;
+bool MQTT::hasQueuedMessages()
+{
+#if ARCH_PORTDUINO
+    if (spool && !spool->isEmpty())
+        return true;
+#endif
+    return queueHead || !mqttQueue.isEmpty();
+}
 
-    std::string topicJson;
-    if (env.packet->pki_encrypted) {
-        topicJson = jsonTopic + "PKI/" + owner.id;
-    } else {
-        topicJson = jsonTopic + env.channel_id + "/" + owner.id;
+MQTT::QueueEntry *MQTT::peekNext()
+{
+    if (queueHead)
+        return queueHead.get();
+#if ARCH_PORTDUINO
+    // Spool records stay in the spool until popNext(), so one whose publish fails is still there after a restart. Decode the
+    // head again on every call, because appending may have dropped the oldest segment since the last one
+    spoolHead.reset();
+    const uint8_t *data;
+    size_t length;
+    while (spool && spool->peek(&data, &length)) {
+        std::unique_ptr<QueueEntry> entry(new QueueEntry);
+        if (decodeSpoolRecord(data, length, *entry)) {
+            spoolHead = std::move(entry);
+            return spoolHead.get();
+        }
+        LOG_WARN("Skip malformed MQTT spool record");
+        spool->pop();
     }
-    LOG_INFO("JSON publish message to %s, %u bytes: %s", topicJson.c_str(), jsonString.length(), jsonString.c_str());
-    publish(topicJson.c_str(), jsonString.c_str(), false);
-#endif // ARCH_NRF52 NRF52_USE_JSON
+#endif
+    // The queue has no way to look at its head in place, so take it off and hold it until it is published
+    queueHead.reset(mqttQueue.dequeuePtr(0));
+    return queueHead.get();
 }
 
+void MQTT::popNext()
+{
+#if ARCH_PORTDUINO
+    if (spoolHead) {
+        spoolHead.reset();
+        spool->pop();
+        return;
+    }
+#endif
+    if (queueHead) {
+        mqttQueueBytes -= queueHead->size();
+        queueHead.reset();
+    }
+}
+
+#if ARCH_PORTDUINO
+// A spool record holds a QueueEntry as: u16 topic length, topic, u16 JSON topic length, JSON topic, u32 envelope length,
+// envelope, and then the JSON payload up to the end of the record. Lengths are little endian.
+std::basic_string<uint8_t> MQTT::encodeSpoolRecord(const QueueEntry &entry)
+{
+    std::basic_string<uint8_t> record;
+    record.reserve(entry.size() + 8);
+    auto putLength = [&record](size_t length, size_t width) {
+        for (size_t i = 0; i < width; i++)
+            record.push_back((length >> (8 * i)) & 0xff);
+    };
+    putLength(entry.topic.size(), 2);
+    record.append(reinterpret_cast<const uint8_t *>(entry.topic.data()), entry.topic.size());
+    putLength(entry.jsonTopic.size(), 2);
+    record.append(reinterpret_cast<const uint8_t *>(entry.jsonTopic.data()), entry.jsonTopic.size());
+    putLength(entry.envBytes.size(), 4);
+    record.append(entry.envBytes.data(), entry.envBytes.size());
+    record.append(reinterpret_cast<const uint8_t *>(entry.jsonPayload.data()), entry.jsonPayload.size());
+    return record;
+}
+
+bool MQTT::decodeSpoolRecord(const uint8_t *data, size_t length, QueueEntry &entry)
+{
+    size_t pos = 0;
+    auto getLength = [&](size_t width, size_t &out) {
+        if (pos + width > length)
+            return false;
+        out = 0;
+        for (size_t i = 0; i < width; i++)
+            out |= (size_t)data[pos++] << (8 * i);
+        return pos + out <= length;
+    };
+    size_t n;
+    if (!getLength(2, n))
+        return false;
+    entry.topic.assign(reinterpret_cast<const char *>(data + pos), n);
+    pos += n;
+    if (!getLength(2, n))
+        return false;
+    entry.jsonTopic.assign(reinterpret_cast<const char *>(data + pos), n);
+    pos += n;
+    if (!getLength(4, n))
+        return false;
+    entry.envBytes.assign(data + pos, n);
+    pos += n;
+    entry.jsonPayload.assign(reinterpret_cast<const char *>(data + pos), length - pos);
+    return !entry.topic.empty() || !entry.jsonTopic.empty();
+}
+#endif
+
 void MQTT::onSend(const meshtastic_MeshPacket &mp_encrypted, const meshtastic_MeshPacket &mp_decoded, ChannelIndex chIndex)
+{
+    publishPacket(mp_encrypted, mp_decoded, chIndex, true, true);
+}
+
+void MQTT::onSendBatch(const meshtastic_MeshPacket &mp_encrypted, const meshtastic_MeshPacket &batch, ChannelIndex chIndex)
+{
+    // The samples all come from the one encrypted packet, so publishing it with each would repeat it, with the same id
+    const bool encrypted = moduleConfig.mqtt.encryption_enabled;
+    if (encrypted)
+        publishPacket(mp_encrypted, batch, chIndex, true, false);
+
+    TelemetryBatch::Reader reader(batch);
+    while (meshtastic_MeshPacket *sample = reader.next()) {
+        publishPacket(mp_encrypted, *sample, chIndex, !encrypted, true);
+        packetPool.release(sample);
+    }
+}
+
+void MQTT::publishPacket(const meshtastic_MeshPacket &mp_encrypted, const meshtastic_MeshPacket &mp_decoded, ChannelIndex chIndex,
+                         bool withEnvelope, bool withJson)
 {
     if (mp_encrypted.via_mqtt)
         return; // Don't send messages that came from MQTT back into MQTT
@@ -731,39 +919,48 @@ void MQTT::onSend(const meshtastic_MeshPacket &mp_encrypted, const meshtastic_Me
         return; // Don't upload a still-encrypted PKI packet if not encryption_enabled
     }
 
-    const meshtastic_ServiceEnvelope env = {
-        .packet = const_cast<meshtastic_MeshPacket *>(p), .channel_id = const_cast<char *>(channelId), .gateway_id = owner.id};
-    size_t numBytes = pb_encode_to_bytes(bytes, sizeof(bytes), &meshtastic_ServiceEnvelope_msg, &env);
-    std::string topic = cryptTopic + channelId + "/" + owner.id;
-
-    if (moduleConfig.mqtt.proxy_to_client_enabled || this->isConnectedDirectly()) {
-        LOG_DEBUG("MQTT Publish %s, %u bytes", topic.c_str(), numBytes);
-        publish(topic.c_str(), bytes, numBytes, false);
+    std::string topic;
+    size_t numBytes = 0;
+    if (withEnvelope) {
+        const meshtastic_ServiceEnvelope env = {.packet = const_cast<meshtastic_MeshPacket *>(p),
+                                                .channel_id = const_cast<char *>(channelId),
+                                                .gateway_id = owner.id};
+        numBytes = pb_encode_to_bytes(bytes, sizeof(bytes), &meshtastic_ServiceEnvelope_msg, &env);
+        topic = cryptTopic + channelId + "/" + owner.id;
+    }
 
+    // JSON is serialized from the decoded packet right away, so queued entries never need to be decoded again
+    std::string topicJson;
+    std::string jsonString;
 #if !defined(ARCH_NRF52) ||                                                                                                      \
     defined(NRF52_USE_JSON) // JSON is not supported on nRF52, see issue #2804 ### Fixed by using ArduinoJson ###
-        if (!moduleConfig.mqtt.json_enabled)
-            return;
-        // handle json topic
-        auto jsonString = MeshPacketSerializer::JsonSerialize(&mp_decoded);
-        if (jsonString.length() == 0)
+    if (withJson && moduleConfig.mqtt.json_enabled) {
+        jsonString = MeshPacketSerializer::JsonSerialize(&mp_decoded);
+        if (jsonString.length() != 0)
+            topicJson = jsonTopic + channelId + "/" + owner.id;
+    }
+#endif // ARCH_NRF52 NRF52_USE_JSON
+    if (topic.empty() && topicJson.empty())
+        return;
+
+    if (moduleConfig.mqtt.proxy_to_client_enabled || this->isConnectedDirectly()) {
+        if (!topic.empty()) {
+            LOG_DEBUG("MQTT Publish %s, %u bytes", topic.c_str(), numBytes);
+            publish(topic.c_str(), bytes, numBytes, false);
+        }
+
+        if (topicJson.empty())
             return;
-        std::string topicJson = jsonTopic + channelId + "/" + owner.id;
         LOG_INFO("JSON publish message to %s, %u bytes: %s", topicJson.c_str(), jsonString.length(), jsonString.c_str());
         publish(topicJson.c_str(), jsonString.c_str(), false);
-#endif // ARCH_NRF52 NRF52_USE_JSON
     } else {
         LOG_INFO("MQTT not connected, queue packet");
-        QueueEntry *entry;
-        if (mqttQueue.numFree() == 0) {
-            LOG_WARN("MQTT queue is full, discard oldest");
-            entry = mqttQueue.dequeuePtr(0);
-        } else {
-            entry = new QueueEntry;
-        }
+        QueueEntry *entry = new QueueEntry;
         entry->topic = std::move(topic);
         entry->envBytes.assign(bytes, numBytes);
-        assert(mqttQueue.enqueue(entry, 0));
+        entry->jsonTopic = std::move(topicJson);
+        entry->jsonPayload.assign(jsonString.data(), jsonString.size());
+        enqueueForLater(entry);
     }
 }
 
@@ -4,8 +4,11 @@
 #include "configuration.h"
 
 #include "concurrency/OSThread.h"
+#include "MQTTSpool.h"
 #include "mesh/Channels.h"
 #include "mesh/generated/meshtastic/mqtt.pb.h"
+#include <memory>
+#include <string>
 #if !defined(ARCH_NRF52) || NRF52_USE_JSON
 #include "serialization/JSON.h"
 #endif
@@ -21,10 +24,63 @@
 
 #if HAS_NETWORKING
 #include <PubSubClient.h>
-#include <memory>
+#endif
+#if defined(ARCH_ESP32) && defined(BOARD_HAS_PSRAM)
+#include <esp_heap_caps.h>
 #endif
 
+#ifndef MAX_MQTT_QUEUE
 #define MAX_MQTT_QUEUE 16
+#endif
+// Upper bound on the bytes held by the uplink queue while the broker is unreachable
+#ifndef MAX_MQTT_QUEUE_BYTES
+#define MAX_MQTT_QUEUE_BYTES (MAX_MQTT_QUEUE * 512)
+#endif
+// On boards with PSRAM the uplink queue is allowed to grow much deeper, so gateways can ride out longer WAN outages
+#ifndef MAX_MQTT_PSRAM_QUEUE
+#define MAX_MQTT_PSRAM_QUEUE 512
+#endif
+#ifndef MAX_MQTT_PSRAM_QUEUE_BYTES
+#define MAX_MQTT_PSRAM_QUEUE_BYTES (MAX_MQTT_PSRAM_QUEUE * 512)
+#endif
+// Per-pass budget for draining the uplink queue once the broker is reachable again
+#ifndef MQTT_QUEUE_DRAIN_BUDGET_MS
+#define MQTT_QUEUE_DRAIN_BUDGET_MS 50
+#endif
+#ifndef MQTT_QUEUE_DRAIN_BUDGET_BYTES
+#define MQTT_QUEUE_DRAIN_BUDGET_BYTES 8192
+#endif
+// Pause between those passes while a backlog remains, so the rest of the main loop gets to run
+#ifndef MQTT_QUEUE_DRAIN_INTERVAL_MS
+#define MQTT_QUEUE_DRAIN_INTERVAL_MS 5
+#endif
+
+#if defined(ARCH_ESP32) && defined(BOARD_HAS_PSRAM)
+/**
+ * Allocator for queued MQTT payloads that prefers PSRAM, so a deep uplink queue doesn't eat internal heap.
+ * Falls back to internal RAM if PSRAM is exhausted.
+ */
+template <class T> struct MQTTQueueAllocator {
+    using value_type = T;
+    MQTTQueueAllocator() = default;
+    template <class U> MQTTQueueAllocator(const MQTTQueueAllocator<U> &) {}
+    T *allocate(size_t n)
+    {
+        return static_cast<T *>(heap_caps_malloc_prefer(n * sizeof(T), 2, MALLOC_CAP_SPIRAM, MALLOC_CAP_DEFAULT));
+    }
+    void deallocate(T *p, size_t) { heap_caps_free(p); }
+};
+template <class T, class U> bool operator==(const MQTTQueueAllocator<T> &, const MQTTQueueAllocator<U> &)
+{
+    return true;
+}
+template <class T, class U> bool operator!=(const MQTTQueueAllocator<T> &, const MQTTQueueAllocator<U> &)
+{
+    return false;
+}
+#else
+template <class T> using MQTTQueueAllocator = std::allocator<T>;
+#endif
 
 /**
  * Our wrapper/singleton for sending/receiving MQTT "udp" packets.  This object isolates the MQTT protocol implementation from
@@ -46,6 +102,12 @@ class MQTT : private concurrency::OSThread
      */
     void onSend(const meshtastic_MeshPacket &mp_encrypted, const meshtastic_MeshPacket &mp_decoded, ChannelIndex chIndex);
 
+    /**
+     * Publish a telemetry batch, see TelemetryBatch. With encryption enabled the encrypted batch is published once, as it went
+     * over the air, otherwise each sample is published as a packet of its own. The JSON is always per sample.
+     */
+    void onSendBatch(const meshtastic_MeshPacket &mp_encrypted, const meshtastic_MeshPacket &batch, ChannelIndex chIndex);
+
     bool isConnectedDirectly();
 
     bool publish(const char *topic, const char *payload, bool retained);
@@ -67,9 +129,23 @@ class MQTT : private concurrency::OSThread
   protected:
     struct QueueEntry {
         std::string topic;
-        std::basic_string<uint8_t> envBytes; // binary/pb_encode_to_bytes ServiceEnvelope
+        // binary/pb_encode_to_bytes ServiceEnvelope
+        std::basic_string<uint8_t, std::char_traits<uint8_t>, MQTTQueueAllocator<uint8_t>> envBytes;
+        std::string jsonTopic; // empty if no JSON is to be published for this packet
+        // serialized from the decoded packet at enqueue time
+        std::basic_string<char, std::char_traits<char>, MQTTQueueAllocator<char>> jsonPayload;
+
+        size_t size() const { return topic.size() + envBytes.size() + jsonTopic.size() + jsonPayload.size(); }
     };
     PointerQueue<QueueEntry> mqttQueue;
+    std::unique_ptr<QueueEntry> queueHead; // taken off mqttQueue by peekNext(), but not published yet, so it goes first
+    size_t mqttQueueBytes = 0;             // sum of QueueEntry::size() for everything in mqttQueue and queueHead
+    size_t mqttQueueMaxBytes = 0;          // byte budget for mqttQueue, chosen at construction
+#if ARCH_PORTDUINO
+    std::unique_ptr<MQTTSpool> spool;      // on-disk uplink queue, used instead of mqttQueue when configured
+    std::unique_ptr<QueueEntry> spoolHead; // decoded copy of the spool record last returned by peekNext()
+    uint32_t lastSpoolCommit = 0;
+#endif
 
     int reconnectCount = 0;
     bool isConfiguredForDefaultServer = true;
@@ -127,7 +203,29 @@ class MQTT : private concurrency::OSThread
     /// Called when a new publish arrives from the MQTT server
     void onReceive(char *topic, byte *payload, size_t length);
 
-    void publishQueuedMessages();
+    /// Drain the uplink queue, bounded by MQTT_QUEUE_DRAIN_BUDGET_MS and MQTT_QUEUE_DRAIN_BUDGET_BYTES per call
+    /// @return false if a publish failed, leaving its entry at the head of the queue, or if nothing could be published
+    bool publishQueuedMessages();
+
+    /// onSend(), but with the service envelope and the JSON each optional
+    void publishPacket(const meshtastic_MeshPacket &mp_encrypted, const meshtastic_MeshPacket &mp_decoded, ChannelIndex chIndex,
+                       bool withEnvelope, bool withJson);
+
+    /// Queue an entry for later publishing, evicting the oldest entries if the count or byte budget is exceeded
+    void enqueueForLater(QueueEntry *entry);
+
+    bool hasQueuedMessages();
+
+    /// The oldest queued entry, from the spool first, or nullptr if nothing is queued. It stays queued until popNext()
+    QueueEntry *peekNext();
+
+    /// Remove the entry returned by peekNext(), once it has been published
+    void popNext();
+
+#if ARCH_PORTDUINO
+    static std::basic_string<uint8_t> encodeSpoolRecord(const QueueEntry &entry);
+    static bool decodeSpoolRecord(const uint8_t *data, size_t length, QueueEntry &entry);
+#endif
 
     void publishNodeInfo();
 
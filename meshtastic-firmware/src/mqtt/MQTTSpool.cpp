@@ -0,0 +1,297 @@
+#include "MQTTSpool.h"
+
+#if ARCH_PORTDUINO
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace
+{
+constexpr uint32_t offsetMagic = 0x4d515331; // "MQS1"
+constexpr size_t recordAlign = 8;
+
+struct OffsetRecord {
+    uint32_t magic;
+    uint32_t seq;
+    uint64_t pos;
+    uint32_t checksum;
+    uint32_t reserved;
+};
+
+// FNV-1a, good enough to tell a torn or stale record from a complete one
+uint32_t checksum(const uint8_t *data, size_t length, uint32_t hash = 2166136261u)
+{
+    for (size_t i = 0; i < length; i++) {
+        hash ^= data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+uint32_t offsetChecksum(const OffsetRecord &rec)
+{
+    return checksum(reinterpret_cast<const uint8_t *>(&rec), offsetof(OffsetRecord, checksum));
+}
+
+/// Bytes used on disk by a record with the given payload length, including the header and padding
+size_t recordBytes(size_t length)
+{
+    return (sizeof(uint32_t) * 2 + length + recordAlign - 1) & ~(recordAlign - 1);
+}
+} // namespace
+
+MQTTSpool::MQTTSpool(const std::string &_dir, size_t _segmentBytes, size_t maxBytes)
+    : dir(_dir), segmentBytes(std::max<size_t>(_segmentBytes, 64 * 1024)),
+      maxSegments(std::max<size_t>(2, maxBytes / segmentBytes))
+{
+    std::error_code ec;
+    std::filesystem::create_directories(dir, ec);
+    if (ec) {
+        LOG_ERROR("MQTT spool: cannot create %s: %s", dir.c_str(), ec.message().c_str());
+        return;
+    }
+
+    bool found = false;
+    uint32_t lowest = UINT32_MAX, highest = 0;
+    for (const auto &entry : std::filesystem::directory_iterator(dir, ec)) {
+        const std::string name = entry.path().filename().string();
+        unsigned int seq;
+        char ext[5] = {0};
+        if (name.length() != 12 || sscanf(name.c_str(), "%8x.%3s", &seq, ext) != 2 || strcmp(ext, "seg") != 0)
+            continue;
+        found = true;
+        lowest = std::min<uint32_t>(lowest, seq);
+        highest = std::max<uint32_t>(highest, seq);
+    }
+    if (!found)
+        lowest = highest = 0;
+
+    writeSeq = highest;
+    writeMap = mapSegment(writeSeq);
+    if (!writeMap)
+        return;
+
+    // Find the end of the log. Anything after the last valid record is a torn append, so clear it before writing over it.
+    writePos = 0;
+    while (size_t length = validRecordAt(writeMap, writePos))
+        writePos += recordBytes(length);
+    memset(writeMap + writePos, 0, segmentBytes - writePos);
+
+    readSeq = lowest;
+    readPos = 0;
+    readMap = (readSeq == writeSeq) ? writeMap : mapSegment(readSeq);
+    loadOffset();
+
+    LOG_INFO("MQTT spool: %s, segments %u..%u, resume at %u:%u", dir.c_str(), readSeq, writeSeq, readSeq, readPos);
+}
+
+MQTTSpool::~MQTTSpool()
+{
+    if (!isOpen())
+        return;
+    commit();
+    msync(writeMap, segmentBytes, MS_SYNC);
+    if (readMap != writeMap)
+        unmapSegment(readMap);
+    unmapSegment(writeMap);
+}
+
+std::string MQTTSpool::segmentPath(uint32_t seq) const
+{
+    char name[16];
+    snprintf(name, sizeof(name), "%08x.seg", seq);
+    return dir + "/" + name;
+}
+
+uint8_t *MQTTSpool::mapSegment(uint32_t seq)
+{
+    const std::string path = segmentPath(seq);
+    int fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        LOG_ERROR("MQTT spool: cannot open %s", path.c_str());
+        return nullptr;
+    }
+    // Reserve the blocks up front, a full disk must fail here rather than fault later on a write to the mapping
+    if (posix_fallocate(fd, 0, segmentBytes) != 0) {
+        LOG_ERROR("MQTT spool: cannot allocate %u bytes for %s", segmentBytes, path.c_str());
+        close(fd);
+        return nullptr;
+    }
+    void *map = mmap(nullptr, segmentBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        LOG_ERROR("MQTT spool: cannot map %s", path.c_str());
+        return nullptr;
+    }
+    return static_cast<uint8_t *>(map);
+}
+
+void MQTTSpool::unmapSegment(uint8_t *map)
+{
+    if (map)
+        munmap(map, segmentBytes);
+}
+
+void MQTTSpool::removeSegment(uint32_t seq)
+{
+    unlink(segmentPath(seq).c_str());
+}
+
+size_t MQTTSpool::validRecordAt(const uint8_t *map, size_t pos) const
+{
+    if (!map || pos + sizeof(RecordHeader) > segmentBytes)
+        return 0;
+    RecordHeader header;
+    memcpy(&header, map + pos, sizeof(header));
+    if (header.length == 0 || pos + recordBytes(header.length) > segmentBytes)
+        return 0;
+    if (checksum(map + pos + sizeof(header), header.length) != header.checksum)
+        return 0;
+    return header.length;
+}
+
+bool MQTTSpool::append(const uint8_t *data, size_t length)
+{
+    if (!isOpen() || length == 0 || recordBytes(length) > segmentBytes)
+        return false;
+    if (writePos + recordBytes(length) > segmentBytes && !rotate())
+        return false;
+
+    uint8_t *p = writeMap + writePos;
+    memcpy(p + sizeof(RecordHeader), data, length);
+    // The header goes in last, so a record cut short by a crash never checks out as valid
+    const RecordHeader header = {static_cast<uint32_t>(length), checksum(data, length)};
+    memcpy(p, &header, sizeof(header));
+    writePos += recordBytes(length);
+
+    // Have the kernel start writing the record back rather than wait for its flush interval
+    const uintptr_t pageSize = sysconf(_SC_PAGESIZE);
+    const uintptr_t start = reinterpret_cast<uintptr_t>(p) & ~(pageSize - 1);
+    const uintptr_t end = reinterpret_cast<uintptr_t>(writeMap + writePos);
+    msync(reinterpret_cast<void *>(start), end - start, MS_ASYNC);
+    return true;
+}
+
+bool MQTTSpool::rotate()
+{
+    uint8_t *next = mapSegment(writeSeq + 1);
+    if (!next)
+        return false;
+
+    msync(writeMap, segmentBytes, MS_ASYNC);
+    if (readMap != writeMap)
+        unmapSegment(writeMap);
+    writeSeq++;
+    writeMap = next;
+    writePos = 0;
+
+    // Bound disk use by dropping the oldest segment, even if it was never sent
+    while (writeSeq - readSeq + 1 > maxSegments) {
+        LOG_WARN("MQTT spool full, drop unsent segment %u", readSeq);
+        moveReaderTo(readSeq + 1);
+    }
+    return true;
+}
+
+void MQTTSpool::moveReaderTo(uint32_t seq)
+{
+    if (readMap != writeMap)
+        unmapSegment(readMap);
+    readMap = nullptr;
+    // Everything before the new read segment has been consumed
+    for (uint32_t s = readSeq; s < seq; s++)
+        removeSegment(s);
+
+    readSeq = seq;
+    readPos = 0;
+    while (readSeq < writeSeq && !(readMap = mapSegment(readSeq))) {
+        removeSegment(readSeq);
+        readSeq++;
+    }
+    if (readSeq == writeSeq)
+        readMap = writeMap;
+}
+
+bool MQTTSpool::peek(const uint8_t **data, size_t *length)
+{
+    while (!isEmpty()) {
+        if (size_t recordLength = validRecordAt(readMap, readPos)) {
+            *data = readMap + readPos + sizeof(RecordHeader);
+            *length = recordLength;
+            return true;
+        }
+        if (readSeq == writeSeq) {
+            // Only complete records are ever behind writePos, so this means the segment was modified underneath us
+            LOG_ERROR("MQTT spool: bad record at %u:%u, skip to end", readSeq, readPos);
+            readPos = writePos;
+            return false;
+        }
+        // End of this segment, continue with the next one
+        moveReaderTo(readSeq + 1);
+    }
+    return false;
+}
+
+void MQTTSpool::pop()
+{
+    if (isEmpty())
+        return;
+    RecordHeader header;
+    memcpy(&header, readMap + readPos, sizeof(header));
+    readPos += recordBytes(header.length);
+}
+
+void MQTTSpool::commit()
+{
+    if (!isOpen() || (committedSeq == readSeq && committedPos == readPos))
+        return;
+
+    OffsetRecord rec = {offsetMagic, readSeq, readPos, 0, 0};
+    rec.checksum = offsetChecksum(rec);
+
+    // Write a new file and rename it over the old one, so the offset on disk is always either the old or the new value
+    const std::string path = offsetPath();
+    const std::string tmpPath = path + ".tmp";
+    FILE *f = fopen(tmpPath.c_str(), "wb");
+    if (!f) {
+        LOG_ERROR("MQTT spool: cannot write %s", tmpPath.c_str());
+        return;
+    }
+    bool ok = fwrite(&rec, sizeof(rec), 1, f) == 1 && fflush(f) == 0 && fsync(fileno(f)) == 0;
+    ok = (fclose(f) == 0) && ok;
+    if (!ok || rename(tmpPath.c_str(), path.c_str()) != 0) {
+        LOG_ERROR("MQTT spool: cannot commit consumer offset");
+        return;
+    }
+    committedSeq = readSeq;
+    committedPos = readPos;
+}
+
+void MQTTSpool::loadOffset()
+{
+    OffsetRecord rec;
+    FILE *f = fopen(offsetPath().c_str(), "rb");
+    if (!f)
+        return;
+    const bool readOk = fread(&rec, sizeof(rec), 1, f) == 1;
+    fclose(f);
+    if (!readOk || rec.magic != offsetMagic || rec.checksum != offsetChecksum(rec)) {
+        LOG_WARN("MQTT spool: ignore invalid consumer offset, replay from the oldest segment");
+        return;
+    }
+    if (rec.seq < readSeq || rec.seq > writeSeq)
+        return; // Segment is gone, start at the oldest one we still have
+
+    if (rec.seq != readSeq)
+        moveReaderTo(rec.seq);
+    readPos = std::min<size_t>(rec.pos, (readSeq == writeSeq) ? writePos : segmentBytes);
+    committedSeq = readSeq;
+    committedPos = readPos;
+}
+#endif
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "configuration.h"
+
+#if ARCH_PORTDUINO
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * Persistent uplink spool for MQTT on Linux gateways.
+ *
+ * Records are appended to fixed-size, memory-mapped segment files (<dir>/<seq>.seg). When a segment is full the spool rotates
+ * to a new one, and once more than maxBytes is on disk the oldest segment is dropped, so disk use stays bounded. Fully
+ * consumed segments are deleted as the reader moves past them.
+ *
+ * The consumer position is kept in <dir>/consumer.offset, which is replaced atomically by commit(). After a crash or power
+ * loss the spool resumes from the last committed position, so delivery is at-least-once: records consumed after the last
+ * commit are replayed. Torn records at the end of the last segment are detected by their checksum and discarded.
+ */
+class MQTTSpool
+{
+  public:
+    MQTTSpool(const std::string &dir, size_t segmentBytes, size_t maxBytes);
+    ~MQTTSpool();
+
+    MQTTSpool(const MQTTSpool &) = delete;
+    MQTTSpool &operator=(const MQTTSpool &) = delete;
+
+    /// False if the spool directory or its segments could not be set up
+    bool isOpen() const { return writeMap != nullptr; }
+
+    bool isEmpty() const { return readSeq == writeSeq && readPos == writePos; }
+
+    /// Append a record, rotating segments as needed. Returns false if the record is too large or on I/O failure.
+    bool append(const uint8_t *data, size_t length);
+
+    /// Get the oldest unconsumed record without consuming it. The data stays valid until the next call that changes the spool.
+    bool peek(const uint8_t **data, size_t *length);
+
+    /// Consume the record last returned by peek()
+    void pop();
+
+    /// Persist the consumer position, so records consumed so far are not replayed after a restart
+    void commit();
+
+  private:
+    struct RecordHeader {
+        uint32_t length;
+        uint32_t checksum;
+    };
+
+    std::string dir;
+    size_t segmentBytes;
+    uint32_t maxSegments;
+
+    uint32_t firstSeq = 0; // oldest segment still on disk
+    uint32_t readSeq = 0;
+    uint32_t writeSeq = 0;
+    size_t readPos = 0;
+    size_t writePos = 0;
+    size_t committedPos = 0;
+    uint32_t committedSeq = 0;
+    uint8_t *readMap = nullptr; // same as writeMap while reading the segment being written
+    uint8_t *writeMap = nullptr;
+
+    std::string segmentPath(uint32_t seq) const;
+    std::string offsetPath() const { return dir + "/consumer.offset"; }
+
+    uint8_t *mapSegment(uint32_t seq);
+    void unmapSegment(uint8_t *map);
+    void removeSegment(uint32_t seq);
+
+    /// Returns the length of the valid record at pos, or 0 if there is none
+    size_t validRecordAt(const uint8_t *map, size_t pos) const;
+
+    bool rotate();
+    void moveReaderTo(uint32_t seq);
+    void loadOffset();
+};
+#endif
@@ -0,0 +1,676 @@
+#include "MeshSim.h"
+#include "NextHopRouter.h"
+#include "PortduinoGlue.h"
+#include "RadioInterface.h"
+#include "SerialConsole.h"
+#include "modules/RoutingModule.h"
+#include "yaml-cpp/yaml.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+namespace meshsim
+{
+
+// Size of the Data protobuf of an ACK: the portnum, an empty Routing payload and the request id
+static constexpr uint16_t ACK_PAYLOAD_BYTES = 11;
+
+float LogDistancePropagation::snr(const NodeConfig &from, const NodeConfig &to)
+{
+    const double distance = std::max(1.0, std::hypot(from.x - to.x, from.y - to.y));
+    float shadowing = 0;
+    if (shadowingDb > 0) {
+        // Seed from both ends of the link, in a fixed order, so both directions see the same obstacles
+        const NodeConfig &a = (from.x < to.x || (from.x == to.x && from.y < to.y)) ? from : to;
+        const NodeConfig &b = &a == &from ? to : from;
+        std::seed_seq seq{seed, (uint32_t)a.x, (uint32_t)a.y, (uint32_t)b.x, (uint32_t)b.y};
+        std::mt19937 linkRng(seq);
+        shadowing = std::normal_distribution<float>(0, shadowingDb)(linkRng);
+    }
+    const float pathLoss = referenceLossDb + 10 * pathLossExponent * log10(distance) + shadowing;
+    return txPowerDbm - pathLoss - noiseFloorDbm;
+}
+
+MeshSim::MeshSim(const Config &_config, std::unique_ptr<PropagationModel> _propagation)
+    : config(_config), propagation(std::move(_propagation)), rng(_config.seed)
+{
+    // The contention window delays come from RadioInterface, which draws them with random()
+    randomSeed(config.seed);
+    slotTimeMsec = RadioInterface::computeSlotTimeMsec(config.bw, config.sf, config.wideLora);
+    // Demodulation floor of the SX126x/SX127x, -7.5 dB at SF7 and 2.5 dB lower for every step up
+    sensitivitySnr = -7.5f - 2.5f * (config.sf - 7);
+}
+
+size_t MeshSim::addNode(const NodeConfig &node)
+{
+    Node n;
+    n.num = nodes.size() + 1;
+    n.config = node;
+    n.history.reset(new PacketHistory(n.num));
+    nodes.push_back(std::move(n));
+    links.clear();
+    return nodes.size() - 1;
+}
+
+void MeshSim::send(uint32_t atMsec, size_t from, NodeNum to, uint16_t payloadBytes, bool wantAck)
+{
+    Packet p = {};
+    p.to = to;
+    p.length = payloadBytes;
+    p.wantAck = wantAck;
+    schedule(atMsec, SEND, from, 0, &p);
+}
+
+void MeshSim::addTraffic(const Traffic &_traffic, uint32_t untilMsec)
+{
+    traffic = _traffic;
+    trafficUntilMsec = untilMsec;
+    for (size_t i = 0; i < nodes.size(); i++) {
+        if (traffic.broadcastIntervalMsec)
+            schedule(now + rng() % traffic.broadcastIntervalMsec, TRAFFIC_BROADCAST, i);
+        if (traffic.directIntervalMsec && nodes.size() > 1)
+            schedule(now + rng() % traffic.directIntervalMsec, TRAFFIC_DIRECT, i);
+    }
+}
+
+void MeshSim::schedule(uint32_t time, EventType type, size_t node, uint64_t key, const Packet *packet)
+{
+    Event e = {};
+    e.time = time;
+    e.seq = eventSeq++;
+    e.type = type;
+    e.node = node;
+    e.key = key;
+    if (packet)
+        e.packet = *packet;
+    events.push(e);
+}
+
+void MeshSim::buildLinks()
+{
+    links.assign(nodes.size(), {});
+    for (size_t from = 0; from < nodes.size(); from++)
+        for (size_t to = 0; to < nodes.size(); to++) {
+            if (from == to)
+                continue;
+            // Signals too weak to decode still count as interference, down to where they can't disturb anything we can decode
+            const float snr = propagation->snr(nodes[from].config, nodes[to].config);
+            if (snr >= sensitivitySnr - config.captureDb)
+                links[from].push_back({to, snr});
+        }
+}
+
+void MeshSim::run(uint32_t untilMsec)
+{
+    if (links.size() != nodes.size())
+        buildLinks();
+    Clock *const previousClock = installedClock;
+    installedClock = &clock;
+
+    while (!events.empty() && events.top().time <= untilMsec) {
+        Event e = events.top();
+        events.pop();
+        now = e.time;
+        clock.set(now);
+        Node &n = nodes[e.node];
+
+        switch (e.type) {
+        case SEND:
+            originate(n, e.packet.to, e.packet.length, e.packet.wantAck);
+            break;
+        case TRAFFIC_BROADCAST:
+            originate(n, NODENUM_BROADCAST, traffic.payloadBytes, false);
+            if (now + traffic.broadcastIntervalMsec < trafficUntilMsec)
+                schedule(now + traffic.broadcastIntervalMsec / 2 + rng() % traffic.broadcastIntervalMsec, TRAFFIC_BROADCAST,
+                         e.node);
+            break;
+        case TRAFFIC_DIRECT: {
+            size_t to = rng() % (nodes.size() - 1);
+            if (to >= e.node)
+                to++;
+            originate(n, nodes[to].num, traffic.payloadBytes, traffic.wantAck);
+            if (now + traffic.directIntervalMsec < trafficUntilMsec)
+                schedule(now + traffic.directIntervalMsec / 2 + rng() % traffic.directIntervalMsec, TRAFFIC_DIRECT, e.node);
+            break;
+        }
+        case TX_TIMER:
+            onTxTimer(n);
+            break;
+        case TX_END:
+            n.transmitting = false;
+            startTransmitTimer(n);
+            break;
+        case RX_END:
+            onRxEnd(n, e.key, e.packet);
+            break;
+        case RETRANSMIT:
+            onRetransmit(n, e.key);
+            break;
+        }
+    }
+    now = untilMsec;
+    clock.set(now);
+    installedClock = previousClock;
+}
+
+uint32_t MeshSim::airtime(const Packet &p) const
+{
+    return RadioInterface::getPacketTime(p.length, config.bw, config.sf, config.cr, config.preambleLength);
+}
+
+float MeshSim::channelUtilization(const Node &n) const
+{
+    const uint32_t period = now / UTILIZATION_PERIOD_MSEC;
+    uint32_t busy = 0;
+    for (uint8_t i = 0; i < UTILIZATION_PERIODS; i++)
+        if (period - n.busyPeriod[i] < UTILIZATION_PERIODS)
+            busy += n.busyMsec[i];
+    return 100.0f * busy / (UTILIZATION_PERIODS * UTILIZATION_PERIOD_MSEC);
+}
+
+void MeshSim::addBusy(Node &n, uint32_t msec)
+{
+    // Overlapping signals keep the channel busy only once
+    const uint32_t end = now + msec;
+    msec = end > std::max(now, n.busyUntil) ? end - std::max(now, n.busyUntil) : 0;
+    n.busyUntil = std::max(n.busyUntil, end);
+
+    const uint32_t period = now / UTILIZATION_PERIOD_MSEC;
+    const uint8_t i = period % UTILIZATION_PERIODS;
+    if (n.busyPeriod[i] != period) {
+        n.busyPeriod[i] = period;
+        n.busyMsec[i] = 0;
+    }
+    n.busyMsec[i] += msec;
+    n.totalBusyMsec += msec;
+}
+
+void MeshSim::enqueue(Node &n, const Packet &p)
+{
+    if (n.txQueue.size() >= MAX_TX_QUEUE) {
+        stats.txQueueFull++;
+        return;
+    }
+    n.txQueue.push_back(p);
+    setTransmitDelay(n);
+}
+
+void MeshSim::setTransmitDelay(Node &n)
+{
+    if (n.txTimerPending || n.txQueue.empty())
+        return;
+    const Packet &p = n.txQueue.front();
+    // Our own packets wait a random part of the contention window, relayed ones longer the better we heard them
+    const bool isRouter = n.config.role == meshtastic_Config_DeviceConfig_Role_ROUTER ||
+                          n.config.role == meshtastic_Config_DeviceConfig_Role_REPEATER;
+    const uint32_t delay = p.rxSnr == 0 ? RadioInterface::getTxDelayMsec(channelUtilization(n), slotTimeMsec)
+                                        : RadioInterface::getTxDelayMsecWeighted(p.rxSnr, isRouter, slotTimeMsec);
+    n.txTimerPending = true;
+    schedule(now + delay, TX_TIMER, &n - &nodes[0]);
+}
+
+void MeshSim::startTransmitTimer(Node &n)
+{
+    if (n.txTimerPending || n.txQueue.empty())
+        return;
+    n.txTimerPending = true;
+    schedule(now + RadioInterface::getTxDelayMsec(channelUtilization(n), slotTimeMsec), TX_TIMER, &n - &nodes[0]);
+}
+
+bool MeshSim::cancelSending(Node &n, NodeNum from, PacketId id)
+{
+    for (auto it = n.txQueue.begin(); it != n.txQueue.end(); ++it)
+        if (it->from == from && it->id == id) {
+            n.txQueue.erase(it);
+            n.history->removeRelayer(relayIdOf(n.num), id, from); // Like Router::cancelSending(), we won't relay it now
+            return true;
+        }
+    return false;
+}
+
+bool MeshSim::findInTxQueue(const Node &n, NodeNum from, PacketId id) const
+{
+    for (auto &p : n.txQueue)
+        if (p.from == from && p.id == id)
+            return true;
+    return false;
+}
+
+void MeshSim::onTxTimer(Node &n)
+{
+    n.txTimerPending = false;
+    if (n.txQueue.empty())
+        return;
+
+    // Busy sending, or channel activity detection hears a preamble: wait another random delay. Detecting a transmission takes
+    // a slot time, so two nodes picking the same slot still collide.
+    bool channelActive = n.transmitting;
+    for (auto &r : n.receptions)
+        channelActive |= r.snr >= sensitivitySnr && now - r.start >= slotTimeMsec;
+    if (channelActive) {
+        setTransmitDelay(n);
+        return;
+    }
+
+    Packet p = n.txQueue.front();
+    n.txQueue.erase(n.txQueue.begin());
+    transmit(n, p);
+}
+
+void MeshSim::transmit(Node &n, const Packet &p)
+{
+    const uint32_t msec = airtime(p);
+    const uint64_t transmission = transmissionSeq++;
+    const size_t from = &n - &nodes[0];
+    stats.transmissions++;
+
+    // We can't hear anything while we send
+    n.transmitting = true;
+    for (auto &r : n.receptions)
+        r.corrupted = true;
+    addBusy(n, msec);
+
+    for (auto &link : links[from]) {
+        Node &to = nodes[link.to];
+        if (to.transmitting) {
+            if (link.snr >= sensitivitySnr)
+                stats.missedWhileSending++;
+            continue;
+        }
+
+        Reception reception = {transmission, now, link.snr, false};
+        for (auto &other : to.receptions) {
+            // Either packet survives only if it is enough stronger than the other, and the receiver stays locked on the
+            // preamble of one it could already decode
+            if (other.snr - link.snr < config.captureDb)
+                other.corrupted = true;
+            if (link.snr - other.snr < config.captureDb || other.snr >= sensitivitySnr)
+                reception.corrupted = true;
+        }
+        to.receptions.push_back(reception);
+        addBusy(to, msec);
+
+        Packet rx = p;
+        rx.rxSnr = link.snr;
+        schedule(now + msec, RX_END, link.to, transmission, &rx);
+    }
+
+    schedule(now + msec, TX_END, from);
+}
+
+void MeshSim::onRxEnd(Node &n, uint64_t transmission, Packet p)
+{
+    auto it = std::find_if(n.receptions.begin(), n.receptions.end(),
+                           [transmission](const Reception &r) { return r.transmission == transmission; });
+    if (it == n.receptions.end())
+        return;
+    const Reception reception = *it;
+    n.receptions.erase(it);
+    if (reception.snr < sensitivitySnr)
+        return; // Only ever interference
+
+    // Like the receive interrupt, which restarts the transmit timer before the router gets to look at the packet
+    startTransmitTimer(n);
+
+    if (reception.corrupted) {
+        stats.collisions++;
+        return;
+    }
+    stats.received++;
+    handleReceived(n, p);
+}
+
+void MeshSim::originate(Node &n, NodeNum to, uint16_t payloadBytes, bool wantAck, PacketId requestId, uint8_t hopLimit)
+{
+    Packet p = {};
+    p.from = n.num;
+    p.to = to;
+    p.id = ++n.lastId;
+    p.hopLimit = p.hopStart = hopLimit ? hopLimit : config.hopLimit;
+    p.relayNode = relayIdOf(n.num);
+    p.wantAck = wantAck;
+    p.requestId = requestId;
+    p.length = payloadBytes + sizeof(PacketHeader);
+    sniffSent(n, p);
+    p.nextHop = usesNextHop(p) ? getNextHop(n, to, p.relayNode) : NO_NEXT_HOP_PREFERENCE;
+
+    if (!requestId) {
+        if (isBroadcast(to))
+            stats.broadcastsSent++;
+        else
+            stats.directSent++;
+        sent[keyOf(p.from, p.id)] = {now, 0, false};
+    }
+
+    const meshtastic_MeshPacket mp = toMeshPacket(p);
+    if (wantAck)
+        startRetransmission(n, p, NextHopRouter::NUM_RELIABLE_RETX);
+    else if (usesNextHop(p) && NextHopRouter::needsRetransmission(&mp, true))
+        startRetransmission(n, p, NextHopRouter::NUM_INTERMEDIATE_RETX);
+    enqueue(n, p);
+}
+
+void MeshSim::sendAck(Node &n, const Packet &p)
+{
+    // Only as many hops as the request needed, with some margin
+    originate(n, p.from, ACK_PAYLOAD_BYTES, false, p.id,
+              RoutingModule::getHopLimitForResponse(p.hopStart, p.hopLimit, config.hopLimit));
+}
+
+meshtastic_MeshPacket MeshSim::toMeshPacket(const Packet &p)
+{
+    meshtastic_MeshPacket mp = meshtastic_MeshPacket_init_zero;
+    mp.from = p.from;
+    mp.to = p.to;
+    mp.id = p.id;
+    mp.hop_limit = p.hopLimit;
+    mp.hop_start = p.hopStart;
+    mp.relay_node = p.relayNode;
+    mp.next_hop = p.nextHop;
+    mp.want_ack = p.wantAck;
+    return mp;
+}
+
+void MeshSim::sniffSent(Node &n, const Packet &p)
+{
+    const meshtastic_MeshPacket mp = toMeshPacket(p);
+    n.history->wasSeenRecently(&mp);
+}
+
+void MeshSim::handleReceived(Node &n, const Packet &p)
+{
+    const uint8_t ourRelayId = relayIdOf(n.num);
+    const meshtastic_MeshPacket mp = toMeshPacket(p);
+    bool wasFallback = false, weWereNextHop = false;
+
+    if (n.history->wasSeenRecently(&mp, true, &wasFallback, &weWereNextHop)) {
+        stats.duplicates++;
+        FloodingRouter::DupeAction action;
+        if (usesNextHop(p)) {
+            stopRetransmission(n, p.from, p.id);
+            action = NextHopRouter::getDupeAction(&mp, wasFallback, weWereNextHop);
+        } else {
+            if (p.from == n.num)
+                stopRetransmission(n, p.from, p.id); // Somebody relayed our packet: an implicit ACK
+            action = FloodingRouter::getDupeAction(&mp);
+        }
+
+        switch (action) {
+        case FloodingRouter::DUPE_RELAY:
+            if (!findInTxQueue(n, p.from, p.id))
+                perhapsRelay(n, p);
+            break;
+        case FloodingRouter::DUPE_RELAY_OR_ACK:
+            if (!findInTxQueue(n, p.from, p.id) && !perhapsRelay(n, p) && p.to == n.num && p.wantAck)
+                sendAck(n, p);
+            break;
+        case FloodingRouter::DUPE_CANCEL_RELAY:
+            perhapsCancelDupe(n, p);
+            break;
+        case FloodingRouter::DUPE_IGNORE:
+            break;
+        }
+        return;
+    }
+
+    if (p.requestId) {
+        // Learn the next hop towards the sender of an ACK from who relayed it, if they also relayed what it acknowledges
+        if (usesNextHop(p) && NextHopRouter::confirmsNextHop(*n.history, &mp, p.requestId, ourRelayId))
+            n.nextHops[p.from] = p.relayNode;
+        if (p.to != n.num) {
+            if (cancelSending(n, p.to, p.requestId))
+                stats.relaysCanceled++;
+            if (usesNextHop(p))
+                stopRetransmission(n, p.to, p.requestId);
+        }
+    }
+
+    perhapsRelay(n, p);
+
+    if (p.to == n.num || isBroadcast(p.to))
+        delivered(n, p);
+}
+
+bool MeshSim::perhapsRelay(Node &n, const Packet &p)
+{
+    const meshtastic_MeshPacket mp = toMeshPacket(p);
+    const bool relays = usesNextHop(p) ? NextHopRouter::shouldRelay(&mp, n.num) : FloodingRouter::shouldRebroadcast(&mp, n.num);
+    if (!relays || p.id == 0 ||
+        !FloodingRouter::isRebroadcaster(n.config.role, meshtastic_Config_DeviceConfig_RebroadcastMode_ALL))
+        return false;
+
+    Packet relay = p;
+    relay.hopLimit--;
+    relay.relayNode = relayIdOf(n.num);
+    sniffSent(n, relay);
+    relay.nextHop = usesNextHop(relay) ? getNextHop(n, relay.to, relay.relayNode) : NO_NEXT_HOP_PREFERENCE;
+    const meshtastic_MeshPacket relayMp = toMeshPacket(relay);
+    if (usesNextHop(relay) && NextHopRouter::needsRetransmission(&relayMp, false))
+        startRetransmission(n, relay, NextHopRouter::NUM_INTERMEDIATE_RETX);
+    stats.relays++;
+    enqueue(n, relay);
+    return true;
+}
+
+void MeshSim::perhapsCancelDupe(Node &n, const Packet &p)
+{
+    // Routers always relay, everybody else leaves it to whoever already did
+    if (FloodingRouter::cancelsDupes(n.config.role) && cancelSending(n, p.from, p.id))
+        stats.relaysCanceled++;
+}
+
+uint8_t MeshSim::getNextHop(const Node &n, NodeNum to, uint8_t relayNode) const
+{
+    auto found = n.nextHops.find(to);
+    return NextHopRouter::chooseNextHop(to, found != n.nextHops.end() ? found->second : NO_NEXT_HOP_PREFERENCE, relayNode);
+}
+
+void MeshSim::delivered(Node &n, const Packet &p)
+{
+    if (p.requestId) {
+        // An ACK for us: our packet made it
+        if (p.to == n.num) {
+            stopRetransmission(n, n.num, p.requestId);
+            auto original = sent.find(keyOf(n.num, p.requestId));
+            if (original != sent.end() && !original->second.acked) {
+                original->second.acked = true;
+                stats.directAcked++;
+            }
+        }
+        return;
+    }
+
+    auto original = sent.find(keyOf(p.from, p.id));
+    if (original != sent.end()) {
+        if (original->second.reached++ == 0 && !isBroadcast(p.to))
+            stats.directDelivered++;
+        if (isBroadcast(p.to))
+            stats.broadcastReached++;
+        stats.latencies.push_back(now - original->second.time);
+    }
+    if (p.to == n.num && p.wantAck)
+        sendAck(n, p);
+}
+
+void MeshSim::startRetransmission(Node &n, const Packet &p, uint8_t numReTx)
+{
+    stopRetransmission(n, p.from, p.id);
+    const uint64_t key = keyOf(p.from, p.id);
+    const uint32_t nextTxMsec =
+        now + RadioInterface::getRetransmissionMsec(airtime(p), channelUtilization(n), slotTimeMsec);
+    // We subtract one, because the first send is already on its way
+    n.pending[key] = {p, (uint8_t)(numReTx - 1), nextTxMsec};
+    schedule(nextTxMsec, RETRANSMIT, &n - &nodes[0], key);
+}
+
+bool MeshSim::stopRetransmission(Node &n, NodeNum from, PacketId id)
+{
+    auto found = n.pending.find(keyOf(from, id));
+    if (found == n.pending.end())
+        return false;
+    // Only a copy we already retransmitted is taken back out of the queue, and routers leave theirs in
+    if (NextHopRouter::cancelsOnStop(found->second.numRetransmissions, from == n.num, n.config.role))
+        cancelSending(n, from, id);
+    n.pending.erase(found);
+    return true;
+}
+
+void MeshSim::onRetransmit(Node &n, uint64_t key)
+{
+    auto found = n.pending.find(key);
+    if (found == n.pending.end() || found->second.nextTxMsec != now)
+        return; // Stopped, or restarted since
+    Pending &pending = found->second;
+    if (pending.numRetransmissions == 0) {
+        n.pending.erase(found);
+        return;
+    }
+
+    Packet p = pending.packet;
+    p.relayNode = relayIdOf(n.num);
+    if (NextHopRouter::fallsBackToFlooding(p.to, pending.numRetransmissions)) {
+        // Last try, forget the next hop and flood
+        p.nextHop = NO_NEXT_HOP_PREFERENCE;
+        n.nextHops.erase(p.to);
+    } else if (usesNextHop(p)) {
+        p.nextHop = getNextHop(n, p.to, p.relayNode);
+    }
+    sniffSent(n, p);
+    stats.retransmissions++;
+    enqueue(n, p);
+
+    pending.numRetransmissions--;
+    pending.nextTxMsec = now + RadioInterface::getRetransmissionMsec(airtime(p), channelUtilization(n), slotTimeMsec);
+    schedule(pending.nextTxMsec, RETRANSMIT, &n - &nodes[0], key);
+}
+
+std::string MeshSim::report() const
+{
+    auto percent = [](double part, double whole) { return whole > 0 ? 100.0 * part / whole : 0.0; };
+    char buf[256];
+    std::string out;
+
+    snprintf(buf, sizeof(buf), "Simulated %.1f minutes of %zu nodes with %s routing, SF%u/%.0f kHz, hop limit %u\n",
+             now / 60000.0, nodes.size(), config.nextHopRouting ? "next-hop" : "flooding", config.sf, config.bw,
+             config.hopLimit);
+    out += buf;
+    snprintf(buf, sizeof(buf), "Broadcasts: %u sent, reached %.1f%% of the other nodes\n", stats.broadcastsSent,
+             percent(stats.broadcastReached, (double)stats.broadcastsSent * (nodes.size() - 1)));
+    out += buf;
+    snprintf(buf, sizeof(buf), "Direct messages: %u sent, %.1f%% delivered, %.1f%% acknowledged\n", stats.directSent,
+             percent(stats.directDelivered, stats.directSent), percent(stats.directAcked, stats.directSent));
+    out += buf;
+
+    if (!stats.latencies.empty()) {
+        std::vector<uint32_t> sorted = stats.latencies;
+        std::sort(sorted.begin(), sorted.end());
+        double sum = 0;
+        for (auto l : sorted)
+            sum += l;
+        snprintf(buf, sizeof(buf), "Delivery latency: mean %.0f ms, median %u ms, 95th percentile %u ms, max %u ms\n",
+                 sum / sorted.size(), sorted[sorted.size() / 2], sorted[sorted.size() * 95 / 100], sorted.back());
+        out += buf;
+    }
+
+    snprintf(buf, sizeof(buf), "On air: %u transmissions, %u relays, %u retransmissions, %u relays canceled, %u queue full\n",
+             stats.transmissions, stats.relays, stats.retransmissions, stats.relaysCanceled, stats.txQueueFull);
+    out += buf;
+    snprintf(buf, sizeof(buf), "Received: %u, %.1f%% duplicates, %u lost to collisions, %u missed while sending\n",
+             stats.received, percent(stats.duplicates, stats.received), stats.collisions, stats.missedWhileSending);
+    out += buf;
+
+    double busySum = 0, busyMax = 0;
+    for (auto &n : nodes) {
+        const double busy = percent(n.totalBusyMsec, now);
+        busySum += busy;
+        busyMax = std::max(busyMax, busy);
+    }
+    snprintf(buf, sizeof(buf), "Channel utilization: mean %.1f%%, max %.1f%%\n", nodes.empty() ? 0 : busySum / nodes.size(),
+             busyMax);
+    out += buf;
+    return out;
+}
+
+static meshtastic_Config_DeviceConfig_Role parseRole(const std::string &role)
+{
+    if (role == "ROUTER")
+        return meshtastic_Config_DeviceConfig_Role_ROUTER;
+    if (role == "CLIENT_MUTE")
+        return meshtastic_Config_DeviceConfig_Role_CLIENT_MUTE;
+    return meshtastic_Config_DeviceConfig_Role_CLIENT;
+}
+
+int runScenario(const char *path)
+{
+    try {
+        YAML::Node yaml = YAML::LoadFile(path);
+
+        // We run instead of setup(), but PacketHistory logs and sizes itself for MAX_NUM_NODES
+        concurrency::hasBeenSetup = true;
+        consoleInit();
+        settingsMap[logoutputlevel] = level_warn;
+        settingsMap[maxnodes] = yaml["MaxNodes"].as<int>(200);
+
+        Config config;
+        config.seed = yaml["Seed"].as<uint32_t>(config.seed);
+        config.hopLimit = yaml["HopLimit"].as<int>(config.hopLimit);
+        config.nextHopRouting = yaml["Routing"].as<std::string>("NextHop") != "Flooding";
+        config.bw = yaml["Radio"]["Bandwidth"].as<float>(config.bw);
+        config.sf = yaml["Radio"]["SpreadFactor"].as<int>(config.sf);
+        config.cr = yaml["Radio"]["CodingRate"].as<int>(config.cr);
+        config.preambleLength = yaml["Radio"]["Preamble"].as<int>(config.preambleLength);
+
+        auto propagation = std::unique_ptr<LogDistancePropagation>(new LogDistancePropagation());
+        YAML::Node p = yaml["Propagation"];
+        propagation->txPowerDbm = p["TxPower"].as<float>(propagation->txPowerDbm);
+        propagation->pathLossExponent = p["PathLossExponent"].as<float>(propagation->pathLossExponent);
+        propagation->referenceLossDb = p["ReferenceLoss"].as<float>(propagation->referenceLossDb);
+        propagation->noiseFloorDbm = p["NoiseFloor"].as<float>(propagation->noiseFloorDbm);
+        propagation->shadowingDb = p["Shadowing"].as<float>(propagation->shadowingDb);
+        propagation->seed = config.seed;
+        config.captureDb = p["Capture"].as<float>(config.captureDb);
+
+        MeshSim sim(config, std::move(propagation));
+
+        std::mt19937 placement(config.seed);
+        YAML::Node random = yaml["Nodes"]["Random"];
+        if (random) {
+            std::uniform_real_distribution<double> x(0, random["Width"].as<double>(10000));
+            std::uniform_real_distribution<double> y(0, random["Height"].as<double>(10000));
+            const meshtastic_Config_DeviceConfig_Role role = parseRole(random["Role"].as<std::string>("CLIENT"));
+            for (int i = random["Count"].as<int>(0); i > 0; i--) {
+                NodeConfig node;
+                node.x = x(placement);
+                node.y = y(placement);
+                node.role = role;
+                sim.addNode(node);
+            }
+        }
+        for (auto n : yaml["Nodes"]["List"]) {
+            NodeConfig node;
+            node.x = n["X"].as<double>(0);
+            node.y = n["Y"].as<double>(0);
+            node.role = parseRole(n["Role"].as<std::string>("CLIENT"));
+            sim.addNode(node);
+        }
+
+        const uint32_t durationMsec = yaml["Duration"].as<uint32_t>(3600) * 1000;
+        Traffic traffic;
+        YAML::Node t = yaml["Traffic"];
+        traffic.broadcastIntervalMsec = t["BroadcastInterval"].as<uint32_t>(0) * 1000;
+        traffic.directIntervalMsec = t["DirectInterval"].as<uint32_t>(0) * 1000;
+        traffic.payloadBytes = t["PayloadSize"].as<int>(traffic.payloadBytes);
+        traffic.wantAck = t["WantAck"].as<bool>(traffic.wantAck);
+        sim.addTraffic(traffic, durationMsec);
+
+        // Let the last packets settle before reporting
+        sim.run(durationMsec + 5 * 60 * 1000);
+        std::cout << sim.report();
+        return EXIT_SUCCESS;
+    } catch (YAML::Exception &e) {
+        std::cerr << "Unable to run mesh simulation " << path << ": " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+}
+
+} // namespace meshsim
@@ -0,0 +1,255 @@
+#pragma once
+
+#include "Clock.h"
+#include "MeshTypes.h"
+#include "PacketHistory.h"
+#include <functional>
+#include <map>
+#include <memory>
+#include <queue>
+#include <random>
+#include <string>
+#include <vector>
+
+/**
+ * A whole mesh in one process: a discrete-event simulation of many nodes on a virtual clock.
+ *
+ * Each node models what decides when and what goes on air in the firmware: the contention window delays and airtime of
+ * RadioInterface, channel activity detection, and the relaying, next-hop learning and retransmission rules of FloodingRouter,
+ * NextHopRouter and ReliableRouter. The timing and the routing decisions are the static functions of those classes, so the
+ * numbers and rules are the same; the simulator only supplies the TX queue, the timers and the learnt next hops around them.
+ * Each node has a PacketHistory of its own, the one the routers use, for duplicate detection, fallback to flooding and who
+ * relayed what.
+ * Payloads are not encoded or encrypted, a packet is just its header fields and its length on air.
+ *
+ * Time jumps from one event to the next, so hours of traffic between hundreds of nodes take seconds. The simulation installs
+ * its clock while it runs, so PacketHistory forgets packets after FLOOD_EXPIRE_TIME of simulated time. The same scenario and
+ * seed always give the same result. Run with `meshtasticd --mesh-sim scenario.yaml`, see bin/mesh-sim.yaml.
+ */
+namespace meshsim
+{
+
+struct NodeConfig {
+    double x = 0, y = 0; // Position in metres
+    meshtastic_Config_DeviceConfig_Role role = meshtastic_Config_DeviceConfig_Role_CLIENT;
+};
+
+/// Decides how well one node hears another
+class PropagationModel
+{
+  public:
+    virtual ~PropagationModel() {}
+
+    /// SNR in dB at which a transmission from one node arrives at another, asked once per pair when the simulation starts
+    virtual float snr(const NodeConfig &from, const NodeConfig &to) = 0;
+};
+
+/// Log-distance path loss, with optional log-normal shadowing that is the same in both directions of a link
+class LogDistancePropagation : public PropagationModel
+{
+  public:
+    float txPowerDbm = 22;
+    float pathLossExponent = 2.7;
+    float referenceLossDb = 31.2; // Free space loss at 1 m for 868 MHz
+    float noiseFloorDbm = -114;   // Thermal noise in 250 kHz plus a 6 dB noise figure
+    float shadowingDb = 0;        // Standard deviation of the shadowing
+    uint32_t seed = 1;
+
+    virtual float snr(const NodeConfig &from, const NodeConfig &to) override;
+};
+
+struct Config {
+    // Modem settings, the defaults are LongFast
+    float bw = 250;
+    uint8_t sf = 11;
+    uint8_t cr = 5;
+    uint16_t preambleLength = 16;
+    bool wideLora = false;
+
+    uint8_t hopLimit = 3;
+    bool nextHopRouting = true; // NextHopRouter rather than FloodingRouter
+    float captureDb = 6;        // A packet survives an overlapping one that is at least this much weaker
+    uint32_t seed = 1;
+};
+
+/// Background traffic, each node sends at random around the given intervals
+struct Traffic {
+    uint32_t broadcastIntervalMsec = 0; // 0 for none
+    uint32_t directIntervalMsec = 0;    // To a random other node, 0 for none
+    uint16_t payloadBytes = 40;
+    bool wantAck = true; // For direct messages
+};
+
+struct Stats {
+    uint32_t broadcastsSent = 0;
+    uint32_t directSent = 0;
+    uint32_t directDelivered = 0;
+    uint32_t directAcked = 0;
+    uint64_t broadcastReached = 0; // Sum over broadcasts of the nodes that got them
+
+    uint32_t transmissions = 0; // Everything put on air
+    uint32_t relays = 0;
+    uint32_t retransmissions = 0;
+    uint32_t relaysCanceled = 0;
+    uint32_t txQueueFull = 0;
+
+    uint32_t received = 0;   // Packets decoded
+    uint32_t duplicates = 0; // Decoded packets the node had already seen
+    uint32_t collisions = 0; // Packets lost to an overlapping one, or to the receiver starting to send
+    uint32_t missedWhileSending = 0;
+
+    std::vector<uint32_t> latencies; // Msecs from sending to first delivery, for every node a packet was delivered to
+};
+
+class MeshSim
+{
+  public:
+    MeshSim(const Config &config, std::unique_ptr<PropagationModel> propagation);
+
+    /// @return the index of the new node, its node number is index + 1
+    size_t addNode(const NodeConfig &node);
+
+    /// Have a node send a packet at the given time, to another node's number or NODENUM_BROADCAST
+    void send(uint32_t atMsec, size_t from, NodeNum to, uint16_t payloadBytes, bool wantAck);
+
+    /// Generate traffic from every node until the given time
+    void addTraffic(const Traffic &traffic, uint32_t untilMsec);
+
+    /// Process events until the virtual clock reaches untilMsec
+    void run(uint32_t untilMsec);
+
+    uint32_t getTime() const { return now; }
+    const Stats &getStats() const { return stats; }
+
+    /// Human readable summary of the run so far
+    std::string report() const;
+
+  private:
+    struct Packet {
+        NodeNum from, to;
+        PacketId id;
+        uint8_t hopLimit, hopStart;
+        uint8_t relayNode, nextHop;
+        bool wantAck;
+        PacketId requestId; // Set for ACKs
+        uint16_t length;    // Bytes on air, header included
+        float rxSnr;        // 0 for packets we send ourselves
+    };
+
+    struct Pending {
+        Packet packet;
+        uint8_t numRetransmissions;
+        uint32_t nextTxMsec;
+    };
+
+    struct Reception {
+        uint64_t transmission;
+        uint32_t start;
+        float snr;
+        bool corrupted;
+    };
+
+    static constexpr uint8_t UTILIZATION_PERIODS = 6; // Like AirTime, the last minute in 10 second periods
+    static constexpr uint32_t UTILIZATION_PERIOD_MSEC = 10 * 1000;
+
+    struct Node {
+        NodeNum num;
+        NodeConfig config;
+        std::vector<Packet> txQueue; // MeshPacketQueue orders by priority, all our packets have the same one
+        bool txTimerPending = false;
+        bool transmitting = false;
+        std::vector<Reception> receptions;
+        std::unique_ptr<PacketHistory> history;
+        std::map<NodeNum, uint8_t> nextHops;
+        std::map<uint64_t, Pending> pending;
+        PacketId lastId = 0;
+        uint32_t busyMsec[UTILIZATION_PERIODS] = {0};
+        uint32_t busyPeriod[UTILIZATION_PERIODS] = {0};
+        uint32_t busyUntil = 0;
+        uint64_t totalBusyMsec = 0;
+    };
+
+    struct Link {
+        size_t to;
+        float snr;
+    };
+
+    enum EventType { SEND, TRAFFIC_BROADCAST, TRAFFIC_DIRECT, TX_TIMER, TX_END, RX_END, RETRANSMIT };
+
+    struct Event {
+        uint32_t time;
+        uint64_t seq; // Keeps events at the same time in the order they were scheduled
+        EventType type;
+        size_t node;
+        uint64_t key; // The transmission for RX_END, the packet for RETRANSMIT
+        Packet packet;
+
+        bool operator>(const Event &other) const { return time != other.time ? time > other.time : seq > other.seq; }
+    };
+
+    struct Sent {
+        uint32_t time;
+        uint32_t reached;
+        bool acked;
+    };
+
+    Config config;
+    std::unique_ptr<PropagationModel> propagation;
+    std::mt19937 rng;
+    std::vector<Node> nodes;
+    std::vector<std::vector<Link>> links; // Who hears each node, built when the simulation starts
+    std::priority_queue<Event, std::vector<Event>, std::greater<Event>> events;
+    std::map<uint64_t, Sent> sent;
+    Traffic traffic;
+    uint32_t trafficUntilMsec = 0;
+    uint32_t now = 0;
+    VirtualClock clock; // Installed while we run, at now
+    uint64_t eventSeq = 0;
+    uint64_t transmissionSeq = 0;
+    uint32_t slotTimeMsec;
+    float sensitivitySnr; // Lowest SNR we can decode at our spreading factor
+    Stats stats;
+
+    static uint64_t keyOf(NodeNum from, PacketId id) { return ((uint64_t)from << 32) | id; }
+    static uint8_t relayIdOf(NodeNum num) { return NodeDB::getLastByteOfNodeNum(num); }
+    /// The header fields PacketHistory looks at
+    static meshtastic_MeshPacket toMeshPacket(const Packet &p);
+
+    void schedule(uint32_t time, EventType type, size_t node, uint64_t key = 0, const Packet *packet = nullptr);
+    void buildLinks();
+    uint32_t airtime(const Packet &p) const;
+    float channelUtilization(const Node &n) const;
+    void addBusy(Node &n, uint32_t msec);
+
+    // Radio, after RadioLibInterface
+    void enqueue(Node &n, const Packet &p);
+    void setTransmitDelay(Node &n);
+    void startTransmitTimer(Node &n);
+    bool cancelSending(Node &n, NodeNum from, PacketId id);
+    bool findInTxQueue(const Node &n, NodeNum from, PacketId id) const;
+    void onTxTimer(Node &n);
+    void transmit(Node &n, const Packet &p);
+    void onRxEnd(Node &n, uint64_t transmission, Packet p);
+
+    // Routing, after FloodingRouter, NextHopRouter and ReliableRouter
+    /// @param hopLimit 0 for the configured one
+    void originate(Node &n, NodeNum to, uint16_t payloadBytes, bool wantAck, PacketId requestId = 0, uint8_t hopLimit = 0);
+    void sendAck(Node &n, const Packet &p);
+    void handleReceived(Node &n, const Packet &p);
+    /// Whether NextHopRouter rather than FloodingRouter handles p, as ReliableRouter decides
+    bool usesNextHop(const Packet &p) const { return config.nextHopRouting && !isBroadcast(p.to); }
+    bool perhapsRelay(Node &n, const Packet &p);
+    void perhapsCancelDupe(Node &n, const Packet &p);
+    /// Like the routers do with every packet they send: add ourselves as a relayer
+    void sniffSent(Node &n, const Packet &p);
+    uint8_t getNextHop(const Node &n, NodeNum to, uint8_t relayNode) const;
+    void delivered(Node &n, const Packet &p);
+    void startRetransmission(Node &n, const Packet &p, uint8_t numReTx);
+    bool stopRetransmission(Node &n, NodeNum from, PacketId id);
+    void onRetransmit(Node &n, uint64_t key);
+};
+
+/// Run the scenario in a yaml file and print a report, @return the process exit code
+int runScenario(const char *path);
+
+} // namespace meshsim
@@ -5,6 +5,7 @@
 #include "sleep.h"
 #include "target_specific.h"
 
+#include "MeshSim.h"
 #include "PortduinoGlue.h"
 #include "api/ServerAPI.h"
 #include "linux/gpio/LinuxGPIOPin.h"
@@ -30,10 +31,15 @@
 std::map<configNames, int> settingsMap;
 std::map<configNames, std::string> settingsStrings;
 std::ofstream traceFile;
+uint8_t logSubsystemSeverity[LOG_SUBSYSTEM_COUNT];
 Ch341Hal *ch341Hal = nullptr;
 char *configPath = nullptr;
 char *optionMac = nullptr;
 bool forceSimulated = false;
+char *meshSimScenario = nullptr;
+
+// Options without a short form
+#define OPTION_MESH_SIM 0x100
 
 // FIXME - move setBluetoothEnable into a HALPlatform class
 void setBluetoothEnable(bool enable)
@@ -68,6 +74,9 @@ static error_t parse_opt(int key, char *arg, struct argp_state *state)
     case 'h':
         optionMac = arg;
         break;
+    case OPTION_MESH_SIM:
+        meshSimScenario = arg;
+        break;
 
     case ARGP_KEY_ARG:
         return 0;
@@ -83,6 +92,8 @@ void portduinoCustomInit()
                                            {"config", 'c', "CONFIG_PATH", 0, "Full path of the .yaml config file to use."},
                                            {"hwid", 'h', "HWID", 0, "The mac address to assign to this virtual machine"},
                                            {"sim", 's', 0, 0, "Run in Simulated radio mode"},
+                                           {"mesh-sim", OPTION_MESH_SIM, "SCENARIO", 0,
+                                            "Simulate the whole mesh described in SCENARIO in this process, then exit"},
                                            {0}};
     static void *childArguments;
     static char doc[] = "Meshtastic native build.";
@@ -141,6 +152,9 @@ void getMacAddr(uint8_t *dmac)
  */
 void portduinoSetup()
 {
+    if (meshSimScenario)
+        exit(meshsim::runScenario(meshSimScenario));
+
     printf("Set up Meshtastic on Portduino...\n");
     int max_GPIO = 0;
     const configNames GPIO_lines[] = {
@@ -410,7 +424,33 @@ bool loadConfig(const char *configPath)
             } else if (yamlConfig["Logging"]["LogLevel"].as<std::string>("info") == "error") {
                 settingsMap[logoutputlevel] = level_error;
             }
+            if (yamlConfig["Logging"]["Subsystems"]) {
+                const struct {
+                    LogSubsystem subsystem;
+                    std::string name;
+                } subsystems[] = {{LOG_SUBSYSTEM_MESH, "mesh"},
+                                  {LOG_SUBSYSTEM_RADIO, "radio"},
+                                  {LOG_SUBSYSTEM_GPS, "gps"},
+                                  {LOG_SUBSYSTEM_MQTT, "mqtt"},
+                                  {LOG_SUBSYSTEM_MODULES, "modules"},
+                                  {LOG_SUBSYSTEM_OTHER, "other"}};
+                const struct {
+                    uint8_t severity;
+                    std::string name;
+                } severities[] = {{LOG_SEVERITY_TRACE, "trace"}, {LOG_SEVERITY_DEBUG, "debug"}, {LOG_SEVERITY_INFO, "info"},
+                                  {LOG_SEVERITY_WARN, "warn"},   {LOG_SEVERITY_ERROR, "error"}, {LOG_SEVERITY_OFF, "off"}};
+                for (auto &subsystem : subsystems) {
+                    std::string level = yamlConfig["Logging"]["Subsystems"][subsystem.name].as<std::string>("");
+                    for (auto &severity : severities) {
+                        if (level == severity.name) {
+                            logSubsystemSeverity[subsystem.subsystem] = severity.severity;
+                            break;
+                        }
+                    }
+                }
+            }
             settingsStrings[traceFilename] = yamlConfig["Logging"]["TraceFile"].as<std::string>("");
+            settingsStrings[threadStatsFilename] = yamlConfig["Logging"]["ThreadStatsFile"].as<std::string>("");
             if (yamlConfig["Logging"]["AsciiLogs"]) {
                 // Default is !isatty(1) but can be set explicitly in config.yaml
                 settingsMap[ascii_logs] = yamlConfig["Logging"]["AsciiLogs"].as<bool>();
@@ -606,6 +646,17 @@ bool loadConfig(const char *configPath)
             settingsStrings[hostMetrics_user_command] = (yamlConfig["HostMetrics"]["UserStringCommand"]).as<std::string>("");
         }
 
+        if (yamlConfig["MQTT"]) {
+            settingsStrings[mqtt_spool_directory] = (yamlConfig["MQTT"]["SpoolDirectory"]).as<std::string>("");
+            settingsMap[mqtt_spool_size_mb] = (yamlConfig["MQTT"]["SpoolSizeMB"]).as<int>(256);
+            settingsMap[mqtt_spool_segment_mb] = (yamlConfig["MQTT"]["SpoolSegmentMB"]).as<int>(4);
+        }
+
+        if (yamlConfig["StoreForward"]) {
+            settingsStrings[storeforward_directory] = (yamlConfig["StoreForward"]["Directory"]).as<std::string>("");
+            settingsMap[storeforward_records] = (yamlConfig["StoreForward"]["Records"]).as<int>(100000);
+        }
+
         if (yamlConfig["General"]) {
             settingsMap[maxnodes] = (yamlConfig["General"]["MaxNodes"]).as<int>(200);
             settingsMap[maxtophone] = (yamlConfig["General"]["MaxMessageQueue"]).as<int>(100);
@@ -1,5 +1,6 @@
 #include "SimRadio.h"
 #include "MeshService.h"
+#include "PayloadDelta.h"
 #include "Router.h"
 
 SimRadio::SimRadio() : NotifiedWorkerThread("SimRadio")
@@ -71,8 +72,11 @@ void SimRadio::handleTransmitInterrupt()
 {
     // This can be null if we forced the device to enter standby mode.  In that case
     // ignore the transmit interrupt
-    if (sendingPacket)
+    if (sendingPacket) {
+        if (isFromUs(sendingPacket))
+            payloadDelta.sent(sendingPacket->id); // It went on air, so receivers have it if it is a keyframe
         completeSending();
+    }
 
     isReceiving = true;
     if (receivingPacket) // This happens when we don't consider something a collision if we weren't sending long enough
@@ -2,6 +2,7 @@
 #include "configuration.h"
 #include "graphics/Screen.h"
 #include "main.h"
+#include "mesh/SaveScheduler.h"
 #include "power.h"
 #include "sleep.h"
 #if defined(ARCH_PORTDUINO)
@@ -14,6 +15,11 @@ void powerCommandsCheck()
 {
     if (rebootAtMsec && millis() > rebootAtMsec) {
         LOG_INFO("Rebooting");
+        if (saveScheduler)
+            saveScheduler->flush();
+#ifdef DEBUG_PORT
+        DEBUG_PORT.drainLog();
+#endif
         notifyReboot.notifyObservers(NULL);
 #if defined(ARCH_ESP32)
         ESP.restart();
@@ -48,6 +54,11 @@ void powerCommandsCheck()
 
     if (shutdownAtMsec && millis() > shutdownAtMsec) {
         LOG_INFO("Shut down from admin command");
+        if (saveScheduler)
+            saveScheduler->flush();
+#ifdef DEBUG_PORT
+        DEBUG_PORT.drainLog();
+#endif
 #if defined(ARCH_NRF52) || defined(ARCH_ESP32) || defined(ARCH_RP2040)
         playShutdownMelody();
         power->shutdown();
@@ -10,6 +10,7 @@
 #include "MeshService.h"
 #include "NodeDB.h"
 #include "PowerMon.h"
+#include "SaveScheduler.h"
 #include "detect/LoRaRadioType.h"
 #include "error.h"
 #include "main.h"
@@ -224,6 +225,8 @@ void doDeepSleep(uint32_t msecToWake, bool skipPreflight = false, bool skipSaveN
 
     screen->doDeepSleep(); // datasheet says this will draw only 10ua
 
+    if (saveScheduler)
+        saveScheduler->flush(); // Even if we skip the full save below, don't lose changes that are waiting to be written
     if (!skipSaveNodeDb) {
         nodeDB->saveToDisk();
     }
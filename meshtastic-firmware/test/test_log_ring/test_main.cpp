@@ -0,0 +1,194 @@
+#include "DebugConfiguration.h"
+#include "TestUtil.h"
+#include <unity.h>
+
+#ifdef ARCH_PORTDUINO
+#include "LogRing.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+LogRing *ring;
+
+bool push(const char *format, ...) __attribute__((format(printf, 1, 2)));
+bool push(const char *format, ...)
+{
+    LogRing::Entry entry = {MESHTASTIC_LOG_LEVEL_DEBUG, 0, 0, "test"};
+    va_list arg;
+    va_start(arg, format);
+    bool queued = ring->push(entry, format, arg);
+    va_end(arg);
+    return queued;
+}
+
+bool pushNoting(bool &wasEmpty, const char *format, ...) __attribute__((format(printf, 2, 3)));
+bool pushNoting(bool &wasEmpty, const char *format, ...)
+{
+    LogRing::Entry entry = {MESHTASTIC_LOG_LEVEL_DEBUG, 0, 0, "test"};
+    va_list arg;
+    va_start(arg, format);
+    bool queued = ring->push(entry, format, arg, &wasEmpty);
+    va_end(arg);
+    return queued;
+}
+
+std::string pop()
+{
+    LogRing::Entry entry;
+    char buf[LOG_RING_SLOT_SIZE * 2];
+    return ring->pop(entry, buf, sizeof(buf)) ? buf : "<empty>";
+}
+} // namespace
+
+void setUp(void)
+{
+    ring = new LogRing();
+}
+
+void tearDown(void)
+{
+    delete ring;
+}
+
+// Deferred formatting gives the same text as printf, even when the strings passed have changed since.
+void test_format(void)
+{
+    std::string name = "Router";
+    push("a %d b %s c %5.2f d %llu e %08x f %c g %-6s| %% %*d %.*s %zu %hhd", -5, name.c_str(), 3.14159, 123456789012ULL,
+         0xbeef, 'Z', "hi", 4, 7, 2, "abcdef", (size_t)99, 300);
+    name = "XXXXXX";
+    push("no arguments");
+    push("%s", (const char *)nullptr);
+
+    TEST_ASSERT_EQUAL_STRING("a -5 b Router c  3.14 d 123456789012 e 0000beef f Z g hi    | %    7 ab 99 44", pop().c_str());
+    TEST_ASSERT_EQUAL_STRING("no arguments", pop().c_str());
+    TEST_ASSERT_EQUAL_STRING("(null)", pop().c_str());
+    TEST_ASSERT_EQUAL_STRING("<empty>", pop().c_str());
+}
+
+// A message too long for a slot is formatted right away rather than lost.
+void test_long_message(void)
+{
+    std::string text(LOG_RING_SLOT_SIZE * 2, 'x');
+    push("%s", text.c_str());
+    TEST_ASSERT_EQUAL(LOG_RING_SLOT_SIZE - 1, pop().length());
+}
+
+// "%.*s" only copies as much of the string as it prints, so it may be a buffer that isn't terminated.
+void test_precision(void)
+{
+    const char payload[3] = {'a', 'b', 'c'}; // Followed by whatever is next on the stack
+    push("msg=%.*s|%.2s|%.*s", (int)sizeof(payload), payload, payload, -1, "whole");
+    TEST_ASSERT_EQUAL_STRING("msg=abc|ab|whole", pop().c_str());
+}
+
+// A full queue refuses messages, leaving what it holds alone, and says when it goes from empty to not.
+void test_full(void)
+{
+    int refused = 0;
+    for (int i = 0; i < LOG_RING_SLOTS + 10; i++)
+        refused += !push("message %d", i);
+    TEST_ASSERT_EQUAL(10, refused);
+    TEST_ASSERT_EQUAL_STRING("message 0", pop().c_str());
+    while (!ring->isEmpty())
+        pop();
+
+    bool wasEmpty = false;
+    TEST_ASSERT_TRUE(pushNoting(wasEmpty, "first"));
+    TEST_ASSERT_TRUE(wasEmpty);
+    TEST_ASSERT_TRUE(pushNoting(wasEmpty, "second"));
+    TEST_ASSERT_FALSE(wasEmpty);
+}
+
+// Messages pushed from several threads at once all come out intact.
+void test_concurrent(void)
+{
+    constexpr int numThreads = 4;
+    constexpr int perThread = 20000;
+    std::atomic<int> queued{0};
+    std::atomic<int> finished{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < numThreads; t++)
+        threads.emplace_back([t, &queued, &finished] {
+            for (int i = 0; i < perThread; i++)
+                queued += push("thread %d message %d", t, i);
+            finished++;
+        });
+
+    int popped = 0;
+    LogRing::Entry entry;
+    char buf[64];
+    auto drain = [&] {
+        while (ring->pop(entry, buf, sizeof(buf))) {
+            int t, i;
+            TEST_ASSERT_EQUAL(2, sscanf(buf, "thread %d message %d", &t, &i));
+            popped++;
+        }
+    };
+    while (finished < numThreads)
+        drain();
+    for (auto &thread : threads)
+        thread.join();
+    drain();
+
+    TEST_ASSERT_EQUAL(queued.load(), popped);
+}
+
+// Not a pass/fail test: reports what a log call costs the caller, compared to formatting it on the spot.
+void test_overhead(void)
+{
+    constexpr int rounds = 2000;
+    LogRing::Entry entry;
+    char buf[LOG_RING_SLOT_SIZE * 2];
+    double pushNs = 0;
+    for (int r = 0; r < rounds; r++) {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < LOG_RING_SLOTS; i++)
+            push("Packet id=0x%08x fr=0x%08x to=0x%08x hop=%d/%d %s", i, 0x1234abcd, 0xffffffff, i % 7, 3, "rx");
+        pushNs += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        while (ring->pop(entry, buf, sizeof(buf)))
+            ;
+    }
+
+    double formatNs = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++)
+        for (int i = 0; i < LOG_RING_SLOTS; i++)
+            snprintf(buf, sizeof(buf), "Packet id=0x%08x fr=0x%08x to=0x%08x hop=%d/%d %s", i, 0x1234abcd, 0xffffffff, i % 7,
+                     3, "rx");
+    formatNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+    char msg[128];
+    snprintf(msg, sizeof(msg), "push %.1f ns per call, snprintf alone %.1f ns per call", pushNs / (rounds * LOG_RING_SLOTS),
+             formatNs / (rounds * LOG_RING_SLOTS));
+    TEST_MESSAGE(msg);
+}
+
+void setup()
+{
+    initializeTestEnvironment();
+    UNITY_BEGIN();
+    RUN_TEST(test_format);
+    RUN_TEST(test_long_message);
+    RUN_TEST(test_precision);
+    RUN_TEST(test_full);
+    RUN_TEST(test_concurrent);
+    RUN_TEST(test_overhead);
+    exit(UNITY_END());
+}
+#else
+void setup()
+{
+    initializeTestEnvironment();
+    LOG_WARN("This test requires the ARCH_PORTDUINO variant");
+    UNITY_BEGIN();
+    UNITY_END();
+}
+#endif
+void loop() {}
@@ -0,0 +1,576 @@
+#include "DebugConfiguration.h"
+#include "TestUtil.h"
+#include <unity.h>
+
+#ifdef ARCH_PORTDUINO
+#include "Clock.h"
+#include "gps/GeoCoord.h"
+#include "mesh/Channels.h"
+#include "mesh/CryptoEngine.h"
+#include "mesh/MeshPacketQueue.h"
+#include "mesh/NodeDB.h"
+#include "mesh/PacketHistory.h"
+#include "mesh/Router.h"
+#include "mesh/compression/unishox2.h"
+#include "platform/portduino/MeshSim.h"
+#include "platform/portduino/PortduinoGlue.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+/*
+ * Throughput and latency benchmarks of the mesh stack, on reproducible synthetic traffic.
+ *
+ * Every benchmark reports ns/op, heap allocations/op (packets included, they come from the heap on Linux) and the p50/p99 of
+ * the time a single op took, and all results are
+ * written to MESH_BENCH_RESULTS (default mesh_bench_results.json), one benchmark per line. To catch regressions, run once on
+ * the base commit, then again with MESH_BENCH_BASELINE set to the first results file: the comparison fails if any benchmark
+ * allocates more per op, or is slower per op by more than MESH_BENCH_TOLERANCE percent (default 25).
+ */
+
+namespace
+{
+std::atomic<uint64_t> allocations{0};
+} // namespace
+
+// Count every heap allocation where they all end up: new, the packet pool (MemoryDynamic) and the C libraries call malloc
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t n, size_t size);
+void *__libc_realloc(void *p, size_t size);
+
+void *malloc(size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t n, size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_calloc(n, size);
+}
+
+void *realloc(void *p, size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_realloc(p, size);
+}
+}
+
+namespace
+{
+constexpr int NUM_NODES = 250;
+constexpr NodeNum FIRST_NODE = 0x10000001;
+constexpr NodeNum NODE_A = FIRST_NODE;     // Sends the PKI direct messages
+constexpr NodeNum NODE_B = FIRST_NODE + 1; // Receives them
+constexpr uint32_t SEED = 1;
+
+struct Result {
+    std::string name;
+    uint64_t ops;
+    double nsPerOp;
+    double allocsPerOp;
+    double p50, p99;
+    const char *unit; // Of p50 and p99
+};
+
+std::vector<Result> results;
+
+/// Key pairs of the two nodes, generated like on first boot
+uint8_t publicA[32], privateA[32], publicB[32], privateB[32];
+
+// cryptLock is created in the constructor for Router, which perhapsEncode() and perhapsDecode() need.
+class BenchRouter : public Router
+{
+  public:
+    ~BenchRouter()
+    {
+        delete cryptLock;
+        cryptLock = NULL;
+    }
+};
+
+double percentile(std::vector<double> &samples, double p)
+{
+    const size_t i = std::min(samples.size() - 1, (size_t)(p * samples.size()));
+    std::nth_element(samples.begin(), samples.begin() + i, samples.end());
+    return samples[i];
+}
+
+void record(const Result &result)
+{
+    results.push_back(result);
+    char msg[192];
+    snprintf(msg, sizeof(msg), "%-20s %8llu ops %10.1f ns/op %7.2f allocs/op  p50 %.1f %s  p99 %.1f %s", result.name.c_str(),
+             (unsigned long long)result.ops, result.nsPerOp, result.allocsPerOp, result.p50, result.unit, result.p99,
+             result.unit);
+    TEST_MESSAGE(msg);
+}
+
+/// Time every call of op(i) for i from 0 to ops - 1 and count the heap allocations they make
+template <typename Op> void measure(const char *name, size_t ops, Op op)
+{
+    std::vector<double> samples(ops);
+    const uint64_t allocsBefore = allocations.load(std::memory_order_relaxed);
+    double totalNs = 0;
+    for (size_t i = 0; i < ops; i++) {
+        const auto start = std::chrono::steady_clock::now();
+        op(i);
+        samples[i] = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        totalNs += samples[i];
+    }
+    const uint64_t allocs = allocations.load(std::memory_order_relaxed) - allocsBefore;
+    record({name, ops, totalNs / ops, (double)allocs / ops, percentile(samples, 0.5), percentile(samples, 0.99), "ns"});
+}
+
+meshtastic_MeshPacket textMessage(NodeNum from, NodeNum to, PacketId id, size_t length)
+{
+    meshtastic_MeshPacket p = meshtastic_MeshPacket_init_zero;
+    p.from = from;
+    p.to = to;
+    p.id = id;
+    p.channel = 0;
+    p.hop_limit = p.hop_start = 3;
+    p.want_ack = to != NODENUM_BROADCAST;
+    p.which_payload_variant = meshtastic_MeshPacket_decoded_tag;
+    p.decoded.portnum = meshtastic_PortNum_TEXT_MESSAGE_APP;
+    p.decoded.payload.size = length;
+    for (size_t i = 0; i < length; i++)
+        p.decoded.payload.bytes[i] = 'a' + i % 26;
+    return p;
+}
+
+/// Take on the identity of node A or B, the other one being in our node DB
+void becomeNode(NodeNum num)
+{
+    myNodeInfo.my_node_num = num;
+    uint8_t *privateKey = num == NODE_A ? privateA : privateB;
+    config.security.private_key.size = 32;
+    memcpy(config.security.private_key.bytes, privateKey, 32);
+    crypto->setDHPrivateKey(privateKey);
+}
+} // namespace
+
+void setUp(void)
+{
+    becomeNode(NODE_A);
+}
+
+void tearDown(void)
+{
+    installedClock = nullptr;
+}
+
+// Duplicate detection in a broadcast flood: every node sends, and each packet is heard up to three times, once from the
+// sender and from up to two relayers. Ten minutes of virtual time pass, so old records expire as they would on air.
+void test_flood_dedup(void)
+{
+    constexpr size_t ops = 30000;
+    std::mt19937 rng(SEED);
+    std::vector<meshtastic_MeshPacket> heard;
+    heard.reserve(ops + 3);
+    while (heard.size() < ops) {
+        meshtastic_MeshPacket p = meshtastic_MeshPacket_init_zero;
+        p.from = FIRST_NODE + rng() % NUM_NODES;
+        p.id = rng();
+        p.hop_limit = p.hop_start = 3;
+        const int copies = 1 + rng() % 3;
+        for (int c = 0; c < copies; c++) {
+            p.relay_node = (uint8_t)rng();
+            heard.push_back(p);
+            p.hop_limit--;
+        }
+    }
+    // Copies of a packet arrive out of order with those of the packets around it
+    for (size_t i = 0; i + 32 <= heard.size(); i += 32)
+        std::shuffle(heard.begin() + i, heard.begin() + i + 32, rng);
+
+    VirtualClock clock(1000);
+    installedClock = &clock;
+    PacketHistory history;
+    size_t duplicates = 0;
+    measure("flood_dedup", ops, [&](size_t i) {
+        clock.advance(20);
+        duplicates += history.wasSeenRecently(&heard[i]);
+    });
+    TEST_ASSERT_GREATER_THAN(ops / 3, duplicates);
+}
+
+// A full TX queue during an ACK storm: each op queues a reliable packet, then the ACK for one of the last MAX_TX_QUEUE arrives,
+// which is queued at ACK priority and cancels that packet if it is still waiting, and the radio sends whatever is in front.
+void test_ack_storm(void)
+{
+    constexpr size_t ops = 30000;
+    std::mt19937 rng(SEED);
+    MeshPacketQueue queue(MAX_TX_QUEUE);
+    std::vector<PacketId> waiting; // Sent by us and not yet acked
+    waiting.reserve(MAX_TX_QUEUE + 1);
+    size_t canceled = 0;
+
+    auto makePacket = [](NodeNum from, PacketId id, meshtastic_MeshPacket_Priority priority) {
+        meshtastic_MeshPacket *p = packetPool.allocZeroed();
+        p->from = from;
+        p->to = FIRST_NODE + 2;
+        p->id = id;
+        p->priority = priority;
+        return p;
+    };
+    auto enqueue = [&](meshtastic_MeshPacket *p) {
+        if (!queue.enqueue(p))
+            packetPool.release(p);
+    };
+
+    measure("ack_storm", ops, [&](size_t i) {
+        const PacketId id = 1 + i;
+        enqueue(makePacket(NODE_A, id, meshtastic_MeshPacket_Priority_RELIABLE));
+        waiting.push_back(id);
+
+        if (waiting.size() > MAX_TX_QUEUE) {
+            const size_t acked = rng() % waiting.size();
+            enqueue(makePacket(FIRST_NODE + 2, 0x80000000 | id, meshtastic_MeshPacket_Priority_ACK));
+            if (meshtastic_MeshPacket *p = queue.remove(NODE_A, waiting[acked])) {
+                packetPool.release(p);
+                canceled++;
+            }
+            waiting[acked] = waiting.back();
+            waiting.pop_back();
+        }
+
+        if (meshtastic_MeshPacket *p = queue.dequeue())
+            packetPool.release(p);
+    });
+
+    while (meshtastic_MeshPacket *p = queue.dequeue())
+        packetPool.release(p);
+    TEST_ASSERT_GREATER_THAN(0, canceled);
+}
+
+// Encrypting broadcasts for the primary channel, then decrypting them, trying the channels that match the hash
+void test_channel_crypto(void)
+{
+    constexpr size_t ops = 5000;
+    std::vector<meshtastic_MeshPacket> packets;
+    packets.reserve(ops);
+    for (size_t i = 0; i < ops; i++)
+        packets.push_back(textMessage(NODE_A, NODENUM_BROADCAST, 1 + i, 40));
+
+    size_t failed = 0;
+    measure("channel_encode", ops,
+            [&](size_t i) { failed += perhapsEncode(&packets[i]) != meshtastic_Routing_Error_NONE; });
+    TEST_ASSERT_EQUAL(0, failed);
+
+    becomeNode(NODE_B);
+    measure("channel_decode", ops, [&](size_t i) { failed += perhapsDecode(&packets[i]) != DecodeState::DECODE_SUCCESS; });
+    TEST_ASSERT_EQUAL(0, failed);
+}
+
+// Direct messages between two nodes that know each other's keys, so they are encrypted with PKI
+void test_pki_crypto(void)
+{
+    constexpr size_t ops = 500;
+    std::vector<meshtastic_MeshPacket> packets;
+    packets.reserve(ops);
+    for (size_t i = 0; i < ops; i++)
+        packets.push_back(textMessage(NODE_A, NODE_B, 1 + i, 40));
+
+    size_t failed = 0;
+    measure("pki_encode", ops, [&](size_t i) { failed += perhapsEncode(&packets[i]) != meshtastic_Routing_Error_NONE; });
+    TEST_ASSERT_EQUAL(0, failed);
+    TEST_ASSERT_TRUE(packets[0].pki_encrypted);
+
+    becomeNode(NODE_B);
+    measure("pki_decode", ops, [&](size_t i) { failed += perhapsDecode(&packets[i]) != DecodeState::DECODE_SUCCESS; });
+    TEST_ASSERT_EQUAL(0, failed);
+}
+
+// Broadcasts from the rest of the mesh on the primary channel, a fifth of them heard twice, going through the router's
+// receive queue into Router::perhapsHandleReceived(): the ignore checks, decryption, the node DB and the modules
+void test_router_receive(void)
+{
+    constexpr size_t ops = 5000;
+    std::mt19937 rng(SEED);
+    std::vector<meshtastic_MeshPacket> packets;
+    packets.reserve(ops);
+    while (packets.size() < ops) {
+        meshtastic_MeshPacket p = textMessage(FIRST_NODE + 2 + rng() % (NUM_NODES - 2), NODENUM_BROADCAST, rng(), 40);
+        TEST_ASSERT_EQUAL(meshtastic_Routing_Error_NONE, perhapsEncode(&p));
+        p.hop_limit--; // Relayed once on the way here
+        packets.push_back(p);
+        if (rng() % 5 == 0 && packets.size() < ops)
+            packets.push_back(p);
+    }
+
+    becomeNode(NODE_B);
+    measure("router_receive", ops, [&](size_t i) {
+        router->enqueueReceivedMessage(packetPool.allocCopy(packets[i]));
+        router->runOnce();
+    });
+}
+
+// Looking up nodes in a full node DB, as the router does for every packet it handles, with one lookup in ten for a node we
+// have never heard of
+void test_nodedb_lookup(void)
+{
+    constexpr size_t ops = 50000;
+    std::mt19937 rng(SEED);
+    std::vector<NodeNum> nums(ops);
+    for (auto &num : nums)
+        num = rng() % 10 ? FIRST_NODE + rng() % NUM_NODES : FIRST_NODE + NUM_NODES + rng() % 1000;
+
+    size_t found = 0;
+    measure("nodedb_lookup", ops, [&](size_t i) { found += nodeDB->getMeshNode(nums[i]) != nullptr; });
+    TEST_ASSERT_GREATER_THAN(ops * 8 / 10, found);
+}
+
+// Distance and bearing between positions a mesh apart, as the UIs compute for every node they draw: the exact double
+// precision functions against the fast integer ones, which must stay within their documented error bounds
+void test_geo_distance(void)
+{
+    constexpr size_t ops = 50000;
+    std::mt19937 rng(SEED);
+    std::vector<int32_t> lat(ops + 1), lng(ops + 1);
+    for (size_t i = 0; i <= ops; i++) {
+        // A walk in steps of up to about 50 km, so consecutive positions are in range of each other
+        lat[i] = i ? std::max(-800000000, std::min(800000000, lat[i - 1] + (int32_t)(rng() % 9000001) - 4500000))
+                   : (int32_t)(rng() % 1200000001) - 600000000;
+        int64_t next = i ? lng[i - 1] + (int64_t)(rng() % 9000001) - 4500000 : (int64_t)(rng() % 3600000001) - 1800000000;
+        if (next > 1800000000)
+            next -= 3600000000LL;
+        else if (next < -1800000000)
+            next += 3600000000LL;
+        lng[i] = (int32_t)next;
+    }
+
+    std::vector<float> exact(ops), fast(ops), exactBearing(ops), fastBearing(ops);
+    measure("geo_distance_exact", ops, [&](size_t i) {
+        exact[i] = GeoCoord::latLongToMeter(lat[i] * 1e-7, lng[i] * 1e-7, lat[i + 1] * 1e-7, lng[i + 1] * 1e-7);
+    });
+    measure("geo_distance_fast", ops,
+            [&](size_t i) { fast[i] = GeoCoord::latLongToMeterFast(lat[i], lng[i], lat[i + 1], lng[i + 1]); });
+    measure("geo_bearing_exact", ops, [&](size_t i) {
+        exactBearing[i] = GeoCoord::bearing(lat[i] * 1e-7, lng[i] * 1e-7, lat[i + 1] * 1e-7, lng[i + 1] * 1e-7);
+    });
+    measure("geo_bearing_fast", ops,
+            [&](size_t i) { fastBearing[i] = GeoCoord::bearingFast(lat[i], lng[i], lat[i + 1], lng[i + 1]); });
+
+    for (size_t i = 0; i < ops; i++) {
+        TEST_ASSERT_FLOAT_WITHIN(exact[i] * 0.0002f + 0.1f, exact[i], fast[i]);
+        if (exact[i] > 100) // Bearings between points closer than this are mostly rounding of the integer coordinates
+            TEST_ASSERT_FLOAT_WITHIN(0.5f * (float)PI / 180, 0, remainder(fastBearing[i] - exactBearing[i], 2 * PI));
+    }
+}
+
+// Compressing and decompressing text messages with unishox2, as the router does for direct messages to nodes that support
+// it, on a corpus of the kind of messages people send over a mesh. Also reports how much smaller they get
+void test_text_compression(void)
+{
+    static const char *const corpus[] = {
+        "ok",
+        "Copy that",
+        "Good morning everyone!",
+        "Anyone on the mesh near the trailhead?",
+        "Testing 1 2 3, can you hear me?",
+        "I'm at the north parking lot, heading to the summit now",
+        "ETA 15 min",
+        "Battery at 20%, switching to power saving mode",
+        "Signal is weak here, will try again from the ridge",
+        "Meet at the checkpoint at 14:30",
+        "Roger, we have eyes on the second team. Standing by for instructions.",
+        "Weather is turning, wind picking up from the west. Recommend heading back before dark.",
+        "Thanks for relaying!",
+        "Who has the spare antenna? Mine broke on the way up",
+        "Net check-in: KD2ABC portable, 5 miles south of the repeater, all good",
+        "Lunch at the cafe on Main Street at noon, anyone want to join?",
+        "Water station 3 is out of cups, please send more with the next runner",
+        "Aid station 7 reports two runners dropped, both OK and waiting for pickup",
+        "Node is back online after the firmware update",
+        "https://meshtastic.org/docs/getting-started/",
+        "\xf0\x9f\x91\x8d",
+        "Sehr gut, danke! Wir treffen uns um 18 Uhr am Bahnhof.",
+    };
+    constexpr size_t corpusSize = sizeof(corpus) / sizeof(corpus[0]);
+    constexpr size_t ops = 20000;
+
+    char compressed[corpusSize][2 * meshtastic_Constants_DATA_PAYLOAD_LEN];
+    int lengths[corpusSize];
+    measure("text_compress", ops, [&](size_t i) {
+        const char *text = corpus[i % corpusSize];
+        lengths[i % corpusSize] = unishox2_compress_simple(text, strlen(text), compressed[i % corpusSize]);
+    });
+
+    char out[2 * meshtastic_Constants_DATA_PAYLOAD_LEN];
+    size_t failed = 0;
+    measure("text_decompress", ops, [&](size_t i) {
+        const int length = unishox2_decompress_simple(compressed[i % corpusSize], lengths[i % corpusSize], out);
+        const char *text = corpus[i % corpusSize];
+        failed += length != (int)strlen(text) || memcmp(out, text, length) != 0;
+    });
+    TEST_ASSERT_EQUAL(0, failed);
+
+    size_t before = 0, after = 0, smaller = 0;
+    for (size_t i = 0; i < corpusSize; i++) {
+        before += strlen(corpus[i]);
+        after += std::min<size_t>(lengths[i], strlen(corpus[i])); // The router sends whichever is smaller
+        smaller += (size_t)lengths[i] < strlen(corpus[i]);
+    }
+    char msg[128];
+    snprintf(msg, sizeof(msg), "text compression: %u of %u messages smaller, %u -> %u bytes (%.1f%%)", (unsigned)smaller,
+             (unsigned)corpusSize, (unsigned)before, (unsigned)after, 100.0 * after / before);
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_LESS_THAN(before, after);
+}
+
+// A whole mesh of NUM_NODES nodes sending broadcasts and acked direct messages for an hour, in the mesh simulator. The op
+// is a transmission, and p50/p99 are the virtual time from sending to delivery.
+void test_mesh_flood(void)
+{
+    meshsim::Config simConfig;
+    simConfig.seed = SEED;
+    auto propagation = std::unique_ptr<meshsim::LogDistancePropagation>(new meshsim::LogDistancePropagation());
+    propagation->seed = SEED;
+    meshsim::MeshSim sim(simConfig, std::move(propagation));
+
+    std::mt19937 placement(SEED);
+    std::uniform_real_distribution<double> position(0, 20000);
+    for (int i = 0; i < NUM_NODES; i++) {
+        meshsim::NodeConfig node;
+        node.x = position(placement);
+        node.y = position(placement);
+        sim.addNode(node);
+    }
+    constexpr uint32_t durationMsec = 60 * 60 * 1000;
+    meshsim::Traffic traffic;
+    traffic.broadcastIntervalMsec = 15 * 60 * 1000;
+    traffic.directIntervalMsec = 30 * 60 * 1000;
+    sim.addTraffic(traffic, durationMsec);
+
+    const uint64_t allocsBefore = allocations.load(std::memory_order_relaxed);
+    const auto start = std::chrono::steady_clock::now();
+    sim.run(durationMsec + 5 * 60 * 1000);
+    const double totalNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    const uint64_t allocs = allocations.load(std::memory_order_relaxed) - allocsBefore;
+
+    const meshsim::Stats &stats = sim.getStats();
+    TEST_ASSERT_GREATER_THAN(0, stats.transmissions);
+    TEST_ASSERT_FALSE(stats.latencies.empty());
+    std::vector<double> latencies(stats.latencies.begin(), stats.latencies.end());
+    record({"mesh_flood", stats.transmissions, totalNs / stats.transmissions, (double)allocs / stats.transmissions,
+            percentile(latencies, 0.5), percentile(latencies, 0.99), "ms"});
+}
+
+// Not a benchmark: writes the results, and compares them with a baseline if there is one
+void test_results(void)
+{
+    const char *path = getenv("MESH_BENCH_RESULTS") ? getenv("MESH_BENCH_RESULTS") : "mesh_bench_results.json";
+    FILE *f = fopen(path, "w");
+    TEST_ASSERT_NOT_NULL_MESSAGE(f, path);
+    fprintf(f, "[\n");
+    for (size_t i = 0; i < results.size(); i++) {
+        const Result &r = results[i];
+        fprintf(f,
+                "{\"name\": \"%s\", \"ops\": %llu, \"ns_per_op\": %.1f, \"allocs_per_op\": %.3f, \"p50\": %.1f, \"p99\": %.1f, "
+                "\"unit\": \"%s\"}%s\n",
+                r.name.c_str(), (unsigned long long)r.ops, r.nsPerOp, r.allocsPerOp, r.p50, r.p99, r.unit,
+                i + 1 < results.size() ? "," : "");
+    }
+    fprintf(f, "]\n");
+    fclose(f);
+
+    const char *baselinePath = getenv("MESH_BENCH_BASELINE");
+    if (!baselinePath)
+        TEST_IGNORE_MESSAGE("No MESH_BENCH_BASELINE to compare with");
+    f = fopen(baselinePath, "r");
+    TEST_ASSERT_NOT_NULL_MESSAGE(f, baselinePath);
+    std::map<std::string, Result> baseline;
+    char line[256];
+    while (fgets(line, sizeof(line), f)) {
+        char name[64];
+        Result r = {};
+        if (sscanf(line, "{\"name\": \"%63[^\"]\", \"ops\": %*u, \"ns_per_op\": %lf, \"allocs_per_op\": %lf", name, &r.nsPerOp,
+                   &r.allocsPerOp) == 3)
+            baseline[name] = r;
+    }
+    fclose(f);
+
+    const double tolerance = getenv("MESH_BENCH_TOLERANCE") ? atof(getenv("MESH_BENCH_TOLERANCE")) : 25;
+    bool regressed = false;
+    for (const Result &r : results) {
+        auto base = baseline.find(r.name);
+        if (base == baseline.end())
+            continue;
+        const double change = 100 * (r.nsPerOp / base->second.nsPerOp - 1);
+        const bool slower = change > tolerance;
+        const bool moreAllocs = r.allocsPerOp > base->second.allocsPerOp + 0.01;
+        char msg[160];
+        snprintf(msg, sizeof(msg), "%-20s %+6.1f%% ns/op, %.2f -> %.2f allocs/op%s", r.name.c_str(), change,
+                 base->second.allocsPerOp, r.allocsPerOp, slower || moreAllocs ? "  REGRESSION" : "");
+        TEST_MESSAGE(msg);
+        regressed |= slower || moreAllocs;
+    }
+    TEST_ASSERT_FALSE_MESSAGE(regressed, "Slower or allocating more than the baseline");
+}
+
+void setup()
+{
+    initializeTestEnvironment();
+    settingsMap[logoutputlevel] = level_warn; // Logging would cost more than most of what we measure
+    settingsMap[maxnodes] = NUM_NODES + 1;    // MAX_NUM_NODES, ourselves included
+    const std::unique_ptr<NodeDB> benchNodeDB(new NodeDB());
+    nodeDB = benchNodeDB.get();
+    const std::unique_ptr<BenchRouter> benchRouter(new BenchRouter());
+    router = benchRouter.get();
+    channels.initDefaults();
+    channels.onConfigChanged();
+
+    crypto->generateKeyPair(publicA, privateA);
+    crypto->generateKeyPair(publicB, privateB);
+    std::mt19937 rng(SEED);
+    for (int i = 0; i < NUM_NODES; i++) {
+        const NodeNum num = FIRST_NODE + i;
+        meshtastic_User user = meshtastic_User_init_zero;
+        snprintf(user.id, sizeof(user.id), "!%08x", num);
+        snprintf(user.long_name, sizeof(user.long_name), "Bench node %d", i);
+        snprintf(user.short_name, sizeof(user.short_name), "%04x", num & 0xffff);
+        user.public_key.size = 32;
+        if (num == NODE_A || num == NODE_B) {
+            memcpy(user.public_key.bytes, num == NODE_A ? publicA : publicB, 32);
+        } else {
+            for (auto &b : user.public_key.bytes)
+                b = rng();
+        }
+        nodeDB->updateUser(num, user);
+    }
+
+    UNITY_BEGIN();
+    RUN_TEST(test_flood_dedup);
+    RUN_TEST(test_ack_storm);
+    RUN_TEST(test_channel_crypto);
+    RUN_TEST(test_pki_crypto);
+    RUN_TEST(test_router_receive);
+    RUN_TEST(test_nodedb_lookup);
+    RUN_TEST(test_geo_distance);
+    RUN_TEST(test_text_compression);
+    RUN_TEST(test_mesh_flood);
+    RUN_TEST(test_results);
+    exit(UNITY_END());
+}
+#else
+void setup()
+{
+    initializeTestEnvironment();
+    LOG_WARN("This test requires the ARCH_PORTDUINO variant");
+    UNITY_BEGIN();
+    UNITY_END();
+}
+#endif
+void loop() {}
@@ -0,0 +1,214 @@
+#include "DebugConfiguration.h"
+#include "TestUtil.h"
+#include <unity.h>
+
+#ifdef ARCH_PORTDUINO
+#include "Clock.h"
+#include "mesh/NextHopRouter.h"
+#include "mesh/NodeDB.h"
+#include "mesh/PacketHistory.h"
+#include "platform/portduino/MeshSim.h"
+#include "platform/portduino/PortduinoGlue.h"
+
+#include <cmath>
+#include <memory>
+#include <random>
+
+namespace
+{
+/// Nodes in a line, x being their place in it: each hears only its neighbours, all of them clearly
+class ChainPropagation : public meshsim::PropagationModel
+{
+  public:
+    virtual float snr(const meshsim::NodeConfig &from, const meshsim::NodeConfig &to) override
+    {
+        return std::abs(from.x - to.x) == 1 ? 10 : -100;
+    }
+};
+
+std::unique_ptr<meshsim::MeshSim> makeChain(size_t length, uint8_t hopLimit)
+{
+    meshsim::Config config;
+    config.hopLimit = hopLimit;
+    std::unique_ptr<meshsim::PropagationModel> propagation(new ChainPropagation());
+    std::unique_ptr<meshsim::MeshSim> sim(new meshsim::MeshSim(config, std::move(propagation)));
+    for (size_t i = 0; i < length; i++) {
+        meshsim::NodeConfig node;
+        node.x = i;
+        sim->addNode(node);
+    }
+    return sim;
+}
+
+std::string runRandomMesh(uint32_t seed)
+{
+    meshsim::Config config;
+    config.seed = seed;
+    auto propagation = std::unique_ptr<meshsim::LogDistancePropagation>(new meshsim::LogDistancePropagation());
+    propagation->shadowingDb = 4;
+    propagation->seed = seed;
+    meshsim::MeshSim sim(config, std::move(propagation));
+
+    std::mt19937 placement(seed);
+    std::uniform_real_distribution<double> position(0, 5000);
+    for (int i = 0; i < 20; i++) {
+        meshsim::NodeConfig node;
+        node.x = position(placement);
+        node.y = position(placement);
+        sim.addNode(node);
+    }
+    meshsim::Traffic traffic;
+    traffic.broadcastIntervalMsec = 60 * 1000;
+    traffic.directIntervalMsec = 120 * 1000;
+    sim.addTraffic(traffic, 10 * 60 * 1000);
+    sim.run(15 * 60 * 1000);
+    return sim.report();
+}
+} // namespace
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// A broadcast goes as many hops as its hop limit allows, and no further.
+void test_broadcast_hops(void)
+{
+    auto sim = makeChain(4, 3);
+    sim->send(0, 0, NODENUM_BROADCAST, 40, false);
+    sim->run(60 * 1000);
+    TEST_ASSERT_EQUAL(1, sim->getStats().broadcastsSent);
+    TEST_ASSERT_EQUAL(3, sim->getStats().broadcastReached);
+
+    sim = makeChain(4, 1);
+    sim->send(0, 0, NODENUM_BROADCAST, 40, false);
+    sim->run(60 * 1000);
+    TEST_ASSERT_EQUAL(2, sim->getStats().broadcastReached);
+}
+
+// A direct message three hops away is delivered and acknowledged, also once the next hops are learned from the first ACK.
+void test_direct_ack(void)
+{
+    auto sim = makeChain(4, 3);
+    sim->send(0, 0, 4, 40, true);
+    sim->send(5 * 60 * 1000, 0, 4, 40, true);
+    sim->run(10 * 60 * 1000);
+    TEST_ASSERT_EQUAL(2, sim->getStats().directSent);
+    TEST_ASSERT_EQUAL(2, sim->getStats().directDelivered);
+    TEST_ASSERT_EQUAL(2, sim->getStats().directAcked);
+}
+
+// The same seed gives the same run, and the simulation clock is only installed while it runs.
+void test_deterministic(void)
+{
+    const std::string first = runRandomMesh(7);
+    TEST_ASSERT_NULL(installedClock);
+    TEST_ASSERT_EQUAL_STRING(first.c_str(), runRandomMesh(7).c_str());
+    TEST_ASSERT_NOT_EQUAL(0, first.compare(runRandomMesh(8)));
+}
+
+// The history each simulated node keeps forgets a packet FLOOD_EXPIRE_TIME after it was last seen, on the installed clock.
+void test_history_expires(void)
+{
+    VirtualClock clock;
+    installedClock = &clock;
+    PacketHistory history(1);
+    meshtastic_MeshPacket p = meshtastic_MeshPacket_init_zero;
+    p.from = 2;
+    p.id = 7;
+    p.relay_node = 2;
+
+    TEST_ASSERT_FALSE(history.wasSeenRecently(&p));
+    clock.advance(FLOOD_EXPIRE_TIME - 1);
+    TEST_ASSERT_TRUE(history.wasSeenRecently(&p));
+    TEST_ASSERT_TRUE(history.wasRelayer(2, p.id, p.from));
+    clock.advance(FLOOD_EXPIRE_TIME);
+    TEST_ASSERT_FALSE(history.wasSeenRecently(&p));
+    installedClock = nullptr;
+}
+
+// A direct message from A via B to C, and the ACK back, taken through the routers' own decisions, which MeshSim makes too.
+void test_router_rules(void)
+{
+    const NodeNum a = 0x11, b = 0x12, c = 0x13, d = 0x14; // D hears everything B sends
+    PacketHistory historyA(a);
+    meshtastic_MeshPacket p = meshtastic_MeshPacket_init_zero;
+    p.from = a;
+    p.to = c;
+    p.id = 7;
+    p.hop_limit = p.hop_start = 3;
+    p.want_ack = true;
+    p.relay_node = NodeDB::getLastByteOfNodeNum(a);
+    p.next_hop = NextHopRouter::chooseNextHop(c, NO_NEXT_HOP_PREFERENCE, p.relay_node);
+    TEST_ASSERT_EQUAL(NO_NEXT_HOP_PREFERENCE, p.next_hop);
+    TEST_ASSERT_FALSE(NextHopRouter::needsRetransmission(&p, true)); // ReliableRouter retransmits it
+    historyA.wasSeenRecently(&p);
+
+    // Nobody was asked, so B and D both relay, and A hears B's relay
+    TEST_ASSERT_TRUE(NextHopRouter::shouldRelay(&p, b));
+    TEST_ASSERT_TRUE(NextHopRouter::shouldRelay(&p, d));
+    TEST_ASSERT_FALSE(NextHopRouter::shouldRelay(&p, c));
+    meshtastic_MeshPacket relayed = p;
+    relayed.hop_limit--;
+    relayed.relay_node = NodeDB::getLastByteOfNodeNum(b);
+    TEST_ASSERT_FALSE(NextHopRouter::needsRetransmission(&relayed, false));
+    TEST_ASSERT_TRUE(historyA.wasSeenRecently(&relayed));
+
+    // C's ACK comes back through B, which makes B A's next hop towards C
+    meshtastic_MeshPacket ack = meshtastic_MeshPacket_init_zero;
+    ack.from = c;
+    ack.to = a;
+    ack.id = 8;
+    ack.hop_start = 3;
+    ack.hop_limit = 2;
+    ack.relay_node = NodeDB::getLastByteOfNodeNum(b);
+    TEST_ASSERT_TRUE(NextHopRouter::confirmsNextHop(historyA, &ack, p.id, NodeDB::getLastByteOfNodeNum(a)));
+    ack.relay_node = NodeDB::getLastByteOfNodeNum(d);
+    TEST_ASSERT_FALSE(NextHopRouter::confirmsNextHop(historyA, &ack, p.id, NodeDB::getLastByteOfNodeNum(a)));
+
+    // The next message only asks B, D gives up its relay once it hears B's, and the last retransmission floods
+    p.id = 9;
+    p.want_ack = false;
+    p.next_hop = NextHopRouter::chooseNextHop(c, NodeDB::getLastByteOfNodeNum(b), p.relay_node);
+    TEST_ASSERT_EQUAL(NodeDB::getLastByteOfNodeNum(b), p.next_hop);
+    TEST_ASSERT_TRUE(NextHopRouter::needsRetransmission(&p, true));
+    TEST_ASSERT_TRUE(NextHopRouter::shouldRelay(&p, b));
+    TEST_ASSERT_FALSE(NextHopRouter::shouldRelay(&p, d));
+    TEST_ASSERT_TRUE(FloodingRouter::shouldRebroadcast(&p, d)); // If it were a broadcast
+    TEST_ASSERT_EQUAL(FloodingRouter::DUPE_CANCEL_RELAY, NextHopRouter::getDupeAction(&relayed, false, false));
+    TEST_ASSERT_EQUAL(FloodingRouter::DUPE_IGNORE, NextHopRouter::getDupeAction(&relayed, false, true));
+    TEST_ASSERT_EQUAL(FloodingRouter::DUPE_RELAY_OR_ACK, NextHopRouter::getDupeAction(&p, false, false));
+    TEST_ASSERT_TRUE(NextHopRouter::fallsBackToFlooding(c, 1));
+    TEST_ASSERT_FALSE(NextHopRouter::fallsBackToFlooding(c, 2));
+    TEST_ASSERT_FALSE(NextHopRouter::fallsBackToFlooding(NODENUM_BROADCAST, 1));
+
+    // Routers keep relaying what others relayed, and leave their queued copy when the retransmissions stop
+    TEST_ASSERT_FALSE(FloodingRouter::cancelsDupes(meshtastic_Config_DeviceConfig_Role_ROUTER));
+    TEST_ASSERT_TRUE(FloodingRouter::cancelsDupes(meshtastic_Config_DeviceConfig_Role_CLIENT));
+    TEST_ASSERT_FALSE(NextHopRouter::cancelsOnStop(0, false, meshtastic_Config_DeviceConfig_Role_ROUTER));
+    TEST_ASSERT_TRUE(NextHopRouter::cancelsOnStop(0, true, meshtastic_Config_DeviceConfig_Role_ROUTER));
+    TEST_ASSERT_FALSE(FloodingRouter::isRebroadcaster(meshtastic_Config_DeviceConfig_Role_CLIENT_MUTE,
+                                                      meshtastic_Config_DeviceConfig_RebroadcastMode_ALL));
+}
+
+void setup()
+{
+    initializeTestEnvironment();
+    settingsMap[logoutputlevel] = level_warn;
+    settingsMap[maxnodes] = 200;
+    UNITY_BEGIN();
+    RUN_TEST(test_broadcast_hops);
+    RUN_TEST(test_direct_ack);
+    RUN_TEST(test_deterministic);
+    RUN_TEST(test_history_expires);
+    RUN_TEST(test_router_rules);
+    exit(UNITY_END());
+}
+#else
+void setup()
+{
+    initializeTestEnvironment();
+    LOG_WARN("This test requires the ARCH_PORTDUINO variant");
+    UNITY_BEGIN();
+    UNITY_END();
+}
+#endif
+void loop() {}
@@ -18,6 +18,7 @@
 #include <arpa/inet.h>
 
 #include <algorithm>
+#include <filesystem>
 #include <list>
 #include <optional>
 #include <set>
@@ -131,6 +132,8 @@ class MockPubSubServer : public WiFiClient
     size_t write(uint8_t data) override { return write(&data, 1); }
     size_t write(const uint8_t *buf, size_t size) override
     {
+        if (failPublish_ && command_.empty() && size > 0 && (buf[0] & 0xf0) == MQTTPUBLISH)
+            return 0;
         command_ += std::string(reinterpret_cast<const char *>(buf), size);
         if (command_.size() < 2)
             return size;
@@ -199,6 +202,7 @@ class MockPubSubServer : public WiFiClient
 
     bool connected_ = false;
     bool refuseConnection_ = false;       // Simulate a failed connection.
+    bool failPublish_ = false;            // Simulate publishes failing on a connected client.
     uint32_t ipAddress_ = 0x01010101;     // IP address of the MQTT server.
     std::string host_;                    // Requested host.
     uint16_t port_;                       // Requested port.
@@ -225,7 +229,7 @@ bool loopUntil(std::function<bool()> conditionMet)
 {
     long start = millis();
     while (start + 4000 > millis()) {
-        long delayMsec = concurrency::mainController.runOrDelay();
+        long delayMsec = concurrency::mainScheduler.runOrDelay();
         if (conditionMet())
             return true;
         concurrency::mainDelay.delay(std::min(delayMsec, 5L));
@@ -248,8 +252,17 @@ class MQTTUnitTest : public MQTT
         delete pubsub;
     }
     using MQTT::isValidConfig;
+    using MQTT::publishQueuedMessages;
     using MQTT::reconnect;
-    int queueSize() { return mqttQueue.numUsed(); }
+    int queueSize() { return mqttQueue.numUsed() + (queueHead ? 1 : 0); }
+    using MQTT::hasQueuedMessages;
+    // Queue to an on-disk spool in dir from now on, as if it had been configured. Opening the same dir again is a restart.
+    void useSpool(const std::string &dir)
+    {
+        spool.reset();
+        spool.reset(new MQTTSpool(dir, 64 * 1024, 256 * 1024));
+        TEST_ASSERT_TRUE(spool->isOpen());
+    }
     void reportToMap(std::optional<uint32_t> precision = std::nullopt)
     {
         if (precision.has_value())
@@ -491,6 +504,93 @@ void test_sendQueued(void)
     TEST_ASSERT_EQUAL(decoded.id, env.packet->id);
 }
 
+// Test that a queued MeshPacket whose publish fails stays queued, and is published once publishing works again.
+void test_sendQueuedKeptOnPublishFailure(void)
+{
+    pubsub->connected_ = false;
+    pubsub->refuseConnection_ = true;
+    TEST_ASSERT_TRUE(loopUntil([] { return !unitTest->getPubSub().connected(); }));
+    mqtt->onSend(encrypted, decoded, 0);
+    TEST_ASSERT_EQUAL(1, unitTest->queueSize());
+
+    // Reconnect, but fail every publish: the drain must not lose the entry.
+    pubsub->failPublish_ = true;
+    pubsub->refuseConnection_ = false;
+    TEST_ASSERT_TRUE(loopUntil([] { return unitTest->getPubSub().connected(); }));
+    unitTest->publishQueuedMessages();
+    TEST_ASSERT_TRUE(pubsub->published_.empty());
+    TEST_ASSERT_EQUAL(1, unitTest->queueSize());
+
+    pubsub->failPublish_ = false;
+    TEST_ASSERT_TRUE(loopUntil([] { return !pubsub->published_.empty(); }));
+    TEST_ASSERT_EQUAL(0, unitTest->queueSize());
+    const DecodedServiceEnvelope &env = std::get<DecodedServiceEnvelope>(pubsub->published_.front().second);
+    TEST_ASSERT_TRUE(env.validDecode);
+    TEST_ASSERT_EQUAL(decoded.id, env.packet->id);
+}
+
+// Test that MeshPackets spooled while disconnected are all published in order once reconnected, and leave the spool empty.
+void test_spoolDrainsInOrder(void)
+{
+    const std::string dir = "/tmp/test_mqtt_spool_order";
+    std::filesystem::remove_all(dir);
+    unitTest->useSpool(dir);
+
+    pubsub->connected_ = false;
+    pubsub->refuseConnection_ = true;
+    TEST_ASSERT_TRUE(loopUntil([] { return !unitTest->getPubSub().connected(); }));
+    meshtastic_MeshPacket p = decoded;
+    for (uint32_t id = 10; id < 13; id++) {
+        p.id = id;
+        mqtt->onSend(encrypted, p, 0);
+    }
+    TEST_ASSERT_EQUAL(0, unitTest->queueSize()); // In the spool, not the RAM queue
+    TEST_ASSERT_TRUE(unitTest->hasQueuedMessages());
+
+    pubsub->refuseConnection_ = false;
+    TEST_ASSERT_TRUE(loopUntil([] { return pubsub->published_.size() >= 3; }));
+    uint32_t id = 10;
+    for (const auto &[topic, payload] : pubsub->published_) {
+        const DecodedServiceEnvelope &env = std::get<DecodedServiceEnvelope>(payload);
+        TEST_ASSERT_TRUE(env.validDecode);
+        TEST_ASSERT_EQUAL(id++, env.packet->id);
+    }
+    TEST_ASSERT_FALSE(unitTest->hasQueuedMessages());
+    std::filesystem::remove_all(dir);
+}
+
+// Test that a spooled MeshPacket whose publish fails stays in the spool, also across a restart, until a publish succeeds.
+void test_spoolKeptOnPublishFailure(void)
+{
+    const std::string dir = "/tmp/test_mqtt_spool_failure";
+    std::filesystem::remove_all(dir);
+    unitTest->useSpool(dir);
+
+    pubsub->connected_ = false;
+    pubsub->refuseConnection_ = true;
+    TEST_ASSERT_TRUE(loopUntil([] { return !unitTest->getPubSub().connected(); }));
+    mqtt->onSend(encrypted, decoded, 0);
+
+    pubsub->failPublish_ = true;
+    pubsub->refuseConnection_ = false;
+    TEST_ASSERT_TRUE(loopUntil([] { return unitTest->getPubSub().connected(); }));
+    unitTest->publishQueuedMessages();
+    TEST_ASSERT_TRUE(pubsub->published_.empty());
+    TEST_ASSERT_TRUE(unitTest->hasQueuedMessages());
+
+    // Reopening the spool finds the record again
+    unitTest->useSpool(dir);
+    TEST_ASSERT_TRUE(unitTest->hasQueuedMessages());
+
+    pubsub->failPublish_ = false;
+    TEST_ASSERT_TRUE(loopUntil([] { return !pubsub->published_.empty(); }));
+    const DecodedServiceEnvelope &env = std::get<DecodedServiceEnvelope>(pubsub->published_.front().second);
+    TEST_ASSERT_TRUE(env.validDecode);
+    TEST_ASSERT_EQUAL(decoded.id, env.packet->id);
+    TEST_ASSERT_FALSE(unitTest->hasQueuedMessages());
+    std::filesystem::remove_all(dir);
+}
+
 // Verify reconnecting with the proxy enabled does not reconnect to a MQTT server.
 void test_reconnectProxyDoesNotReconnectMqtt(void)
 {
@@ -882,6 +982,9 @@ void setup()
     RUN_TEST(test_noRangeTestAppOnDefaultServer);
     RUN_TEST(test_noDetectionSensorAppOnDefaultServer);
     RUN_TEST(test_sendQueued);
+    RUN_TEST(test_sendQueuedKeptOnPublishFailure);
+    RUN_TEST(test_spoolDrainsInOrder);
+    RUN_TEST(test_spoolKeptOnPublishFailure);
     RUN_TEST(test_reconnectProxyDoesNotReconnectMqtt);
     RUN_TEST(test_receiveEmptyMeshPacket);
     RUN_TEST(test_receiveDecodedProto);
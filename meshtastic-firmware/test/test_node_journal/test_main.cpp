@@ -0,0 +1,97 @@
+#include "DebugConfiguration.h"
+#include "TestUtil.h"
+#include <unity.h>
+
+#ifdef ARCH_PORTDUINO
+#include "FSCommon.h"
+#include "mesh/NodeDB.h"
+#include "platform/portduino/PortduinoGlue.h"
+
+#include <cstdio>
+#include <cstring>
+
+#define FIRST_NODE 0x10000001
+#define NUM_NODES 5
+#define MAX_NODES 20 // MAX_NUM_NODES, so the node database has empty slots when it is written
+
+namespace
+{
+void addNode(NodeNum num, const char *longName)
+{
+    meshtastic_User user = meshtastic_User_init_zero;
+    snprintf(user.id, sizeof(user.id), "!%08x", num);
+    snprintf(user.long_name, sizeof(user.long_name), "%s", longName);
+    snprintf(user.short_name, sizeof(user.short_name), "%04x", num & 0xffff);
+    nodeDB->updateUser(num, user);
+}
+
+// Like a reboot: a new NodeDB loads the node database and its journal from flash
+void reload()
+{
+    delete nodeDB;
+    nodeDB = new NodeDB();
+}
+} // namespace
+
+void setUp(void)
+{
+    nodeDB = new NodeDB();
+    nodeDB->resetNodes();
+    for (int i = 0; i < NUM_NODES; i++)
+        addNode(FIRST_NODE + i, "Before");
+    TEST_ASSERT_TRUE(nodeDB->saveToDisk(SEGMENT_NODEDATABASE)); // The whole DB, as the reset needs
+    TEST_ASSERT_FALSE(FSCom.exists(nodeJournalFileName));
+}
+
+void tearDown(void)
+{
+    delete nodeDB;
+    nodeDB = nullptr;
+}
+
+// A change saved after the DB is only in the journal, and is back after a reboot.
+void test_journaled_change_survives_reload(void)
+{
+    addNode(FIRST_NODE + 2, "After");
+    TEST_ASSERT_TRUE(nodeDB->saveToDisk(SEGMENT_NODEDATABASE));
+    TEST_ASSERT_TRUE(FSCom.exists(nodeJournalFileName));
+
+    reload();
+    TEST_ASSERT_EQUAL(NUM_NODES + 1, nodeDB->getNumMeshNodes()); // Ourselves too
+    const meshtastic_NodeInfoLite *node = nodeDB->getMeshNode(FIRST_NODE + 2);
+    TEST_ASSERT_NOT_NULL(node);
+    TEST_ASSERT_EQUAL_STRING("After", node->user.long_name);
+    TEST_ASSERT_EQUAL_STRING("Before", nodeDB->getMeshNode(FIRST_NODE + 1)->user.long_name);
+}
+
+// A node removed after the DB was saved stays removed after a reboot.
+void test_journaled_removal_survives_reload(void)
+{
+    nodeDB->removeNodeByNum(FIRST_NODE + 3); // Saves right away
+    TEST_ASSERT_TRUE(FSCom.exists(nodeJournalFileName));
+
+    reload();
+    TEST_ASSERT_NULL(nodeDB->getMeshNode(FIRST_NODE + 3));
+    TEST_ASSERT_NOT_NULL(nodeDB->getMeshNode(FIRST_NODE + 4));
+}
+
+void setup()
+{
+    initializeTestEnvironment();
+    settingsMap[maxnodes] = MAX_NODES;
+
+    UNITY_BEGIN();
+    RUN_TEST(test_journaled_change_survives_reload);
+    RUN_TEST(test_journaled_removal_survives_reload);
+    exit(UNITY_END());
+}
+#else
+void setup()
+{
+    initializeTestEnvironment();
+    LOG_WARN("This test requires the ARCH_PORTDUINO variant");
+    UNITY_BEGIN();
+    UNITY_END();
+}
+#endif
+void loop() {}
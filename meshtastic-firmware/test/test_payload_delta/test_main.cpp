@@ -0,0 +1,329 @@
+#include "DebugConfiguration.h"
+#include "TestUtil.h"
+#include <unity.h>
+
+#ifdef ARCH_PORTDUINO
+#include "mesh/NodeDB.h"
+#include "mesh/PayloadDelta.h"
+#include "mesh/Router.h"
+#include "mesh/generated/meshtastic/telemetry.pb.h"
+#include "platform/portduino/PortduinoGlue.h"
+
+#include <memory>
+#include <random>
+
+#define SENDER 0x1001
+#define RELAY 0x2002
+#define RECEIVER 0x3003
+#define DELTA_HEADER_SIZE 4 // The checksums of the keyframe and the payload, see PayloadDelta.h
+
+namespace
+{
+std::mt19937 rng(1234);
+PacketId nextId = 1;
+
+meshtastic_Data_payload_t telemetry(pb_size_t variant, uint32_t time)
+{
+    meshtastic_Telemetry t = meshtastic_Telemetry_init_zero;
+    t.time = time;
+    t.which_variant = variant;
+    if (variant == meshtastic_Telemetry_device_metrics_tag) {
+        t.variant.device_metrics = meshtastic_DeviceMetrics_init_zero;
+        t.variant.device_metrics.has_battery_level = true;
+        t.variant.device_metrics.battery_level = 80 + time % 3;
+        t.variant.device_metrics.has_voltage = true;
+        t.variant.device_metrics.voltage = 4.1f;
+        t.variant.device_metrics.has_uptime_seconds = true;
+        t.variant.device_metrics.uptime_seconds = time;
+    } else {
+        t.variant.environment_metrics = meshtastic_EnvironmentMetrics_init_zero;
+        t.variant.environment_metrics.has_temperature = true;
+        t.variant.environment_metrics.temperature = 20.5f + time % 2;
+        t.variant.environment_metrics.has_relative_humidity = true;
+        t.variant.environment_metrics.relative_humidity = 45.0f;
+        t.variant.environment_metrics.has_barometric_pressure = true;
+        t.variant.environment_metrics.barometric_pressure = 1013.25f;
+    }
+    meshtastic_Data_payload_t payload = {};
+    payload.size = pb_encode_to_bytes(payload.bytes, sizeof(payload.bytes), &meshtastic_Telemetry_msg, &t);
+    return payload;
+}
+
+meshtastic_MeshPacket makeBroadcast(NodeNum from, const meshtastic_Data_payload_t &payload)
+{
+    meshtastic_MeshPacket p = meshtastic_MeshPacket_init_zero;
+    p.from = from;
+    p.to = NODENUM_BROADCAST;
+    p.id = nextId++;
+    p.which_payload_variant = meshtastic_MeshPacket_decoded_tag;
+    p.decoded.portnum = meshtastic_PortNum_TELEMETRY_APP;
+    p.decoded.has_bitfield = true;
+    p.decoded.payload = payload;
+    return p;
+}
+
+// What a node running as `us` sends for a payload
+meshtastic_MeshPacket compress(PayloadDelta &delta, NodeNum us, NodeNum from, const meshtastic_Data_payload_t &payload)
+{
+    myNodeInfo.my_node_num = us;
+    meshtastic_MeshPacket p = makeBroadcast(from, payload);
+    delta.compress(p);
+    return p;
+}
+
+bool isDelta(const meshtastic_MeshPacket &p)
+{
+    return p.decoded.bitfield & BITFIELD_DELTA_MASK;
+}
+
+bool isKeyframe(const meshtastic_MeshPacket &p)
+{
+    return p.decoded.bitfield & BITFIELD_DELTA_KEYFRAME_MASK;
+}
+
+// What a node other than the sender makes of p
+bool receive(PayloadDelta &delta, meshtastic_MeshPacket &p)
+{
+    myNodeInfo.my_node_num = RECEIVER;
+    return delta.expand(p.from, p.decoded);
+}
+
+// Receives p, and checks it comes back as the payload it was made from
+void expandTo(PayloadDelta &delta, meshtastic_MeshPacket p, const meshtastic_Data_payload_t &expected)
+{
+    TEST_ASSERT_TRUE(receive(delta, p));
+    TEST_ASSERT_EQUAL(expected.size, p.decoded.payload.size);
+    TEST_ASSERT_EQUAL_MEMORY(expected.bytes, p.decoded.payload.bytes, expected.size);
+}
+} // namespace
+
+void setUp(void)
+{
+    myNodeInfo.my_node_num = SENDER;
+}
+void tearDown(void) {}
+
+// Our first broadcast is a keyframe, and the ones after it deltas once it went on air, each expanding to what was sent.
+void test_round_trip(void)
+{
+    PayloadDelta sender(true), receiver;
+    const meshtastic_Data_payload_t keyframe = telemetry(meshtastic_Telemetry_device_metrics_tag, 1000);
+    meshtastic_MeshPacket p = compress(sender, SENDER, SENDER, keyframe);
+    TEST_ASSERT_TRUE(isKeyframe(p));
+    TEST_ASSERT_FALSE(isDelta(p));
+    sender.sent(p.id);
+    expandTo(receiver, p, keyframe);
+
+    for (uint32_t time = 1001; time < 1001 + PAYLOAD_DELTA_KEYFRAME_INTERVAL - 1; time++) {
+        const meshtastic_Data_payload_t payload = telemetry(meshtastic_Telemetry_device_metrics_tag, time);
+        p = compress(sender, SENDER, SENDER, payload);
+        TEST_ASSERT_TRUE(isDelta(p));
+        TEST_ASSERT_LESS_THAN(payload.size, p.decoded.payload.size);
+        sender.sent(p.id);
+        expandTo(receiver, p, payload);
+    }
+
+    // And then it is time for a keyframe again
+    p = compress(sender, SENDER, SENDER, telemetry(meshtastic_Telemetry_device_metrics_tag, 2000));
+    TEST_ASSERT_TRUE(isKeyframe(p));
+}
+
+// A keyframe that never went on air isn't what the broadcasts after it are against, so receivers can still read them.
+void test_cancelled_keyframe(void)
+{
+    PayloadDelta sender(true), receiver;
+    const meshtastic_Data_payload_t first = telemetry(meshtastic_Telemetry_device_metrics_tag, 1000);
+    meshtastic_MeshPacket p = compress(sender, SENDER, SENDER, first);
+    sender.sent(p.id);
+    expandTo(receiver, p, first);
+
+    uint32_t time = 1001;
+    do {
+        p = compress(sender, SENDER, SENDER, telemetry(meshtastic_Telemetry_device_metrics_tag, time++));
+    } while (!isKeyframe(p)); // Cancelled, along with the deltas before it
+    sender.sent(nextId + 100); // Some other packet
+
+    // Until a keyframe goes on air, we keep sending keyframes
+    const meshtastic_Data_payload_t second = telemetry(meshtastic_Telemetry_device_metrics_tag, time++);
+    p = compress(sender, SENDER, SENDER, second);
+    TEST_ASSERT_TRUE(isKeyframe(p));
+    TEST_ASSERT_FALSE(isDelta(p));
+    sender.sent(p.id);
+    expandTo(receiver, p, second);
+
+    const meshtastic_Data_payload_t payload = telemetry(meshtastic_Telemetry_device_metrics_tag, time++);
+    p = compress(sender, SENDER, SENDER, payload);
+    TEST_ASSERT_TRUE(isDelta(p));
+    expandTo(receiver, p, payload);
+}
+
+// Device and environment metrics take turns, and each is a delta against a keyframe of its own.
+void test_telemetry_variants(void)
+{
+    PayloadDelta sender(true), receiver;
+    const pb_size_t variants[] = {meshtastic_Telemetry_device_metrics_tag, meshtastic_Telemetry_environment_metrics_tag};
+    for (pb_size_t variant : variants) {
+        const meshtastic_Data_payload_t keyframe = telemetry(variant, 1000);
+        meshtastic_MeshPacket p = compress(sender, SENDER, SENDER, keyframe);
+        TEST_ASSERT_TRUE(isKeyframe(p));
+        sender.sent(p.id);
+        expandTo(receiver, p, keyframe);
+    }
+    for (uint32_t time = 1001; time < 1005; time++) {
+        for (pb_size_t variant : variants) {
+            const meshtastic_Data_payload_t payload = telemetry(variant, time);
+            meshtastic_MeshPacket p = compress(sender, SENDER, SENDER, payload);
+            TEST_ASSERT_TRUE(isDelta(p));
+            sender.sent(p.id);
+            expandTo(receiver, p, payload);
+        }
+    }
+}
+
+// A relay passes a delta on as the same delta, and the nodes behind it expand it.
+void test_relay(void)
+{
+    PayloadDelta sender(true), relay, receiver;
+    const meshtastic_Data_payload_t keyframe = telemetry(meshtastic_Telemetry_environment_metrics_tag, 1000);
+    meshtastic_MeshPacket p = compress(sender, SENDER, SENDER, keyframe);
+    sender.sent(p.id);
+    expandTo(relay, p, keyframe);
+    expandTo(receiver, p, keyframe);
+
+    const meshtastic_Data_payload_t payload = telemetry(meshtastic_Telemetry_environment_metrics_tag, 1001);
+    const meshtastic_MeshPacket sent = compress(sender, SENDER, SENDER, payload);
+    TEST_ASSERT_TRUE(isDelta(sent));
+    meshtastic_MeshPacket relayed = sent;
+    TEST_ASSERT_TRUE(receive(relay, relayed));
+    myNodeInfo.my_node_num = RELAY;
+    relay.compress(relayed);
+    TEST_ASSERT_TRUE(isDelta(relayed));
+    TEST_ASSERT_EQUAL(sent.decoded.payload.size, relayed.decoded.payload.size);
+    TEST_ASSERT_EQUAL_MEMORY(sent.decoded.payload.bytes, relayed.decoded.payload.bytes, sent.decoded.payload.size);
+    expandTo(receiver, relayed, payload);
+}
+
+// Copies of our own packets, decoded for the phone, come back whole, and our keyframe is only used once it went on air.
+void test_own_copy(void)
+{
+    PayloadDelta sender(true);
+    const meshtastic_Data_payload_t keyframe = telemetry(meshtastic_Telemetry_device_metrics_tag, 1000);
+    meshtastic_MeshPacket p = compress(sender, SENDER, SENDER, keyframe);
+    TEST_ASSERT_TRUE(sender.expand(p.from, p.decoded));
+    TEST_ASSERT_EQUAL_MEMORY(keyframe.bytes, p.decoded.payload.bytes, keyframe.size);
+    sender.sent(p.id);
+    const meshtastic_Data_payload_t payload = telemetry(meshtastic_Telemetry_device_metrics_tag, 1001);
+    p = compress(sender, SENDER, SENDER, payload);
+    TEST_ASSERT_TRUE(isDelta(p));
+    TEST_ASSERT_TRUE(sender.expand(p.from, p.decoded));
+    TEST_ASSERT_EQUAL(payload.size, p.decoded.payload.size);
+    TEST_ASSERT_EQUAL_MEMORY(payload.bytes, p.decoded.payload.bytes, payload.size);
+}
+
+// Keyframes are kept for up to PAYLOAD_DELTA_REFERENCES senders, and the one used least recently goes first.
+void test_eviction(void)
+{
+    PayloadDelta receiver;
+    meshtastic_MeshPacket deltas[PAYLOAD_DELTA_REFERENCES + 1];
+    for (NodeNum i = 0; i <= PAYLOAD_DELTA_REFERENCES; i++) {
+        PayloadDelta sender(true);
+        meshtastic_MeshPacket p = compress(sender, SENDER + i, SENDER + i, telemetry(meshtastic_Telemetry_device_metrics_tag, i));
+        sender.sent(p.id);
+        TEST_ASSERT_TRUE(receive(receiver, p));
+        deltas[i] = compress(sender, SENDER + i, SENDER + i, telemetry(meshtastic_Telemetry_device_metrics_tag, i + 1));
+        TEST_ASSERT_TRUE(isDelta(deltas[i]));
+    }
+    TEST_ASSERT_FALSE(receive(receiver, deltas[0]));
+    for (NodeNum i = 1; i <= PAYLOAD_DELTA_REFERENCES; i++)
+        TEST_ASSERT_TRUE(receive(receiver, deltas[i]));
+}
+
+// A delta that doesn't restore the payload it was made from, because of a damaged byte or a keyframe that only shares its
+// checksum, is refused rather than handed on.
+void test_integrity(void)
+{
+    PayloadDelta sender(true), receiver;
+    meshtastic_MeshPacket p = compress(sender, SENDER, SENDER, telemetry(meshtastic_Telemetry_device_metrics_tag, 1000));
+    sender.sent(p.id);
+    TEST_ASSERT_TRUE(receive(receiver, p));
+    const meshtastic_Data_payload_t payload = telemetry(meshtastic_Telemetry_device_metrics_tag, 1001);
+    const meshtastic_MeshPacket valid = compress(sender, SENDER, SENDER, payload);
+    TEST_ASSERT_TRUE(isDelta(valid));
+
+    for (size_t i = 2; i < valid.decoded.payload.size; i++) {
+        for (int bit = 0; bit < 8; bit++) {
+            meshtastic_MeshPacket damaged = valid;
+            damaged.decoded.payload.bytes[i] ^= 1 << bit;
+            const meshtastic_Data_payload_t before = damaged.decoded.payload;
+            if (receive(receiver, damaged)) {
+                // Only a bit of the bitmap past the end of the payload, which changes nothing
+                TEST_ASSERT_EQUAL(payload.size, damaged.decoded.payload.size);
+                TEST_ASSERT_EQUAL_MEMORY(payload.bytes, damaged.decoded.payload.bytes, payload.size);
+            } else {
+                TEST_ASSERT_EQUAL(before.size, damaged.decoded.payload.size); // Left alone
+                TEST_ASSERT_EQUAL_MEMORY(before.bytes, damaged.decoded.payload.bytes, before.size);
+            }
+        }
+    }
+}
+
+// Garbage deltas are refused or expand to at most PAYLOAD_DELTA_MAX_SIZE bytes, never reading or writing past a payload.
+void test_fuzz(void)
+{
+    PayloadDelta sender(true), receiver;
+    meshtastic_MeshPacket p = compress(sender, SENDER, SENDER, telemetry(meshtastic_Telemetry_device_metrics_tag, 1000));
+    sender.sent(p.id);
+    TEST_ASSERT_TRUE(receive(receiver, p));
+    const meshtastic_MeshPacket valid =
+        compress(sender, SENDER, SENDER, telemetry(meshtastic_Telemetry_device_metrics_tag, 1001));
+    TEST_ASSERT_TRUE(isDelta(valid));
+
+    for (int round = 0; round < 50000; round++) {
+        meshtastic_MeshPacket garbage = valid;
+        meshtastic_Data_payload_t &payload = garbage.decoded.payload;
+        if (round % 2) {
+            // Keep the checksum of the keyframe, so it gets past that
+            payload.size = 2 + rng() % (sizeof(payload.bytes) - 2 + 1);
+            payload.bytes[1] = (payload.bytes[1] & 0x7f) | (rng() % 2 ? 0x80 : 0);
+            for (size_t i = 2; i < payload.size; i++)
+                payload.bytes[i] = rng();
+        } else {
+            payload.size = rng() % (sizeof(payload.bytes) + 1);
+            for (size_t i = 0; i < payload.size; i++)
+                payload.bytes[i] = rng();
+        }
+        if (receive(receiver, garbage))
+            TEST_ASSERT_LESS_OR_EQUAL(PAYLOAD_DELTA_MAX_SIZE, payload.size);
+    }
+    meshtastic_MeshPacket again = valid;
+    TEST_ASSERT_TRUE(receive(receiver, again)); // The keyframe is still there
+}
+
+void setup()
+{
+    initializeTestEnvironment();
+    settingsMap[logoutputlevel] = level_warn;
+    const std::unique_ptr<NodeDB> testNodeDB(new NodeDB());
+    nodeDB = testNodeDB.get();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_round_trip);
+    RUN_TEST(test_cancelled_keyframe);
+    RUN_TEST(test_telemetry_variants);
+    RUN_TEST(test_relay);
+    RUN_TEST(test_own_copy);
+    RUN_TEST(test_eviction);
+    RUN_TEST(test_integrity);
+    RUN_TEST(test_fuzz);
+    exit(UNITY_END());
+}
+#else
+void setup()
+{
+    initializeTestEnvironment();
+    LOG_WARN("This test requires the ARCH_PORTDUINO variant");
+    UNITY_BEGIN();
+    UNITY_END();
+}
+#endif
+void loop() {}
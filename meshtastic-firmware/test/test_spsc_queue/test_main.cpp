@@ -0,0 +1,103 @@
+#include "DebugConfiguration.h"
+#include "TestUtil.h"
+#include <unity.h>
+
+#ifdef ARCH_PORTDUINO
+#include "concurrency/SPSCQueue.h"
+
+#include <atomic>
+#include <thread>
+
+namespace
+{
+// Items that would show a torn or stale read: both halves must always match
+struct Item {
+    uint32_t seq;
+    uint32_t check;
+};
+
+constexpr uint32_t CHECK = 0x5a5a5a5a;
+} // namespace
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// Items come out in order, a full queue refuses more and an empty one gives nothing.
+void test_fill_and_drain(void)
+{
+    concurrency::SPSCQueue<int, 4> queue;
+    int item;
+    TEST_ASSERT_TRUE(queue.isEmpty());
+    TEST_ASSERT_FALSE(queue.pop(item));
+
+    for (int round = 0; round < 3; round++) { // Wrap around the slots
+        for (int i = 0; i < 4; i++)
+            TEST_ASSERT_TRUE(queue.push(round * 10 + i));
+        TEST_ASSERT_FALSE(queue.push(99));
+        TEST_ASSERT_FALSE(queue.isEmpty());
+        for (int i = 0; i < 4; i++) {
+            TEST_ASSERT_TRUE(queue.pop(item));
+            TEST_ASSERT_EQUAL(round * 10 + i, item);
+        }
+        TEST_ASSERT_FALSE(queue.pop(item));
+        TEST_ASSERT_TRUE(queue.isEmpty());
+    }
+}
+
+// One thread pushing while another pops, like the radio task and the Router: nothing lost, duplicated, reordered or torn.
+void test_concurrent(void)
+{
+    constexpr uint32_t count = 2000000;
+    concurrency::SPSCQueue<Item, 8> queue; // Small, so it is full and empty over and over
+    std::atomic<uint32_t> full{0};
+
+    std::thread producer([&] {
+        for (uint32_t seq = 0; seq < count; seq++) {
+            const Item item = {seq, seq ^ CHECK};
+            while (!queue.push(item)) {
+                full++;
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    uint32_t expected = 0;
+    Item item;
+    while (expected < count) {
+        if (!queue.pop(item)) {
+            std::this_thread::yield();
+            continue;
+        }
+        if (item.seq != expected || item.check != (expected ^ CHECK)) {
+            producer.join();
+            TEST_FAIL_MESSAGE("Item lost, reordered or torn");
+        }
+        expected++;
+    }
+    producer.join();
+
+    TEST_ASSERT_TRUE(queue.isEmpty());
+    TEST_ASSERT_FALSE(queue.pop(item));
+    char msg[64];
+    snprintf(msg, sizeof(msg), "Producer found the queue full %u times", full.load());
+    TEST_MESSAGE(msg);
+}
+
+void setup()
+{
+    initializeTestEnvironment();
+    UNITY_BEGIN();
+    RUN_TEST(test_fill_and_drain);
+    RUN_TEST(test_concurrent);
+    exit(UNITY_END());
+}
+#else
+void setup()
+{
+    initializeTestEnvironment();
+    LOG_WARN("This test requires the ARCH_PORTDUINO variant");
+    UNITY_BEGIN();
+    UNITY_END();
+}
+#endif
+void loop() {}
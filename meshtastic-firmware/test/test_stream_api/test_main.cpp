@@ -0,0 +1,179 @@
+#include "DebugConfiguration.h"
+#include "TestUtil.h"
+#include <unity.h>
+
+#ifdef ARCH_PORTDUINO
+#include "mesh/StreamAPI.h"
+
+#include <chrono>
+#include <fcntl.h>
+#include <pty.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <vector>
+
+namespace
+{
+// A Stream on the slave side of a pseudo terminal, which is what a USB serial client looks like on a Linux host.
+class PtyStream : public Stream
+{
+  public:
+    explicit PtyStream(int _fd) : fd(_fd) {}
+    int available() override
+    {
+        int n = 0;
+        return ioctl(fd, FIONREAD, &n) == 0 ? n : 0;
+    }
+    int read() override
+    {
+        uint8_t c;
+        return ::read(fd, &c, 1) == 1 ? c : -1;
+    }
+    int peek() override { return -1; }
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t *buf, size_t len) override
+    {
+        ssize_t n = ::write(fd, buf, len);
+        return n < 0 ? 0 : n;
+    }
+    void flush() override {}
+
+  private:
+    int fd;
+};
+
+// StreamAPI that just counts the ToRadio frames it is handed.
+class CountingStreamAPI : public StreamAPI
+{
+  public:
+    explicit CountingStreamAPI(Stream *stream) : StreamAPI(stream) { canWrite = false; }
+    bool handleToRadio(const uint8_t *buf, size_t len) override
+    {
+        numFrames++;
+        numBytes += len;
+        lastLen = len;
+        return true;
+    }
+    bool checkIsConnected() override { return true; }
+
+    size_t numFrames = 0;
+    size_t numBytes = 0;
+    size_t lastLen = 0;
+};
+
+int master = -1;
+int slave = -1;
+PtyStream *stream;
+CountingStreamAPI *api;
+
+void appendFrame(std::vector<uint8_t> &out, size_t len)
+{
+    out.push_back(0x94);
+    out.push_back(0xc3);
+    out.push_back((len >> 8) & 0xff);
+    out.push_back(len & 0xff);
+    for (size_t i = 0; i < len; i++)
+        out.push_back(i & 0xff);
+}
+
+// Write everything to the master side, letting the API drain the slave side as we go so the pty buffer never fills.
+void pump(const std::vector<uint8_t> &bytes)
+{
+    size_t pos = 0;
+    while (pos < bytes.size()) {
+        ssize_t n = ::write(master, bytes.data() + pos, std::min<size_t>(bytes.size() - pos, 1024));
+        if (n > 0)
+            pos += n;
+        api->runOncePart();
+    }
+    while (stream->available())
+        api->runOncePart();
+}
+} // namespace
+
+void setUp(void)
+{
+    TEST_ASSERT_EQUAL(0, openpty(&master, &slave, nullptr, nullptr, nullptr));
+    struct termios tio;
+    tcgetattr(slave, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(slave, TCSANOW, &tio);
+    fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+    stream = new PtyStream(slave);
+    api = new CountingStreamAPI(stream);
+}
+
+void tearDown(void)
+{
+    delete api;
+    delete stream;
+    close(slave);
+    close(master);
+}
+
+// Frames split across reads, zero length frames and maximum length frames are all delivered intact.
+void test_framing(void)
+{
+    std::vector<uint8_t> bytes;
+    appendFrame(bytes, 0);
+    appendFrame(bytes, 1);
+    appendFrame(bytes, MAX_TO_FROM_RADIO_SIZE);
+    appendFrame(bytes, 37);
+    pump(bytes);
+
+    TEST_ASSERT_EQUAL(4, api->numFrames);
+    TEST_ASSERT_EQUAL(1 + MAX_TO_FROM_RADIO_SIZE + 37, api->numBytes);
+    TEST_ASSERT_EQUAL(37, api->lastLen);
+}
+
+// Console noise, a lone START1 and a bogus length between frames are skipped without losing the next frame.
+void test_resync(void)
+{
+    std::vector<uint8_t> bytes = {'h', 'e', 'l', 'p', '\r', '\n', 0x94, 'x', 0x94, 0xc3, 0xff, 0xff};
+    appendFrame(bytes, 20);
+    bytes.insert(bytes.end(), {'a', 'b', 0x94});
+    appendFrame(bytes, 30);
+    pump(bytes);
+
+    TEST_ASSERT_EQUAL(2, api->numFrames);
+    TEST_ASSERT_EQUAL(50, api->numBytes);
+}
+
+// Not a pass/fail test: reports how fast a packet flood is parsed over the pty.
+void test_throughput(void)
+{
+    constexpr size_t numFrames = 20000;
+    std::vector<uint8_t> bytes;
+    for (size_t i = 0; i < numFrames; i++)
+        appendFrame(bytes, 16 + (i * 7) % 240);
+
+    auto start = std::chrono::steady_clock::now();
+    pump(bytes);
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    TEST_ASSERT_EQUAL(numFrames, api->numFrames);
+    char msg[128];
+    snprintf(msg, sizeof(msg), "%zu frames, %zu bytes in %.3f s: %.0f frames/s, %.2f MB/s", numFrames, bytes.size(), secs,
+             numFrames / secs, bytes.size() / secs / 1e6);
+    TEST_MESSAGE(msg);
+}
+
+void setup()
+{
+    initializeTestEnvironment();
+    UNITY_BEGIN();
+    RUN_TEST(test_framing);
+    RUN_TEST(test_resync);
+    RUN_TEST(test_throughput);
+    exit(UNITY_END());
+}
+#else
+void setup()
+{
+    initializeTestEnvironment();
+    LOG_WARN("This test requires the ARCH_PORTDUINO variant");
+    UNITY_BEGIN();
+    UNITY_END();
+}
+#endif
+void loop() {}
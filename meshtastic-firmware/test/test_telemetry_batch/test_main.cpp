@@ -0,0 +1,208 @@
+#include "DebugConfiguration.h"
+#include "TestUtil.h"
+#include <unity.h>
+
+#ifdef ARCH_PORTDUINO
+#include "mesh/Router.h"
+#include "mesh/TelemetryBatch.h"
+
+#include <random>
+#include <vector>
+
+namespace
+{
+std::mt19937 rng(1234);
+
+// Samples that differ from each other in a few bytes and in length, like consecutive readings of one sensor.
+std::vector<meshtastic_Data_payload_t> makeSamples(size_t count)
+{
+    std::vector<meshtastic_Data_payload_t> samples;
+    meshtastic_Data_payload_t sample = {};
+    sample.size = 40;
+    for (size_t i = 0; i < sample.size; i++)
+        sample.bytes[i] = rng();
+    for (size_t n = 0; n < count; n++) {
+        sample.size = 36 + rng() % 8;
+        for (int changes = rng() % 5; changes > 0; changes--)
+            sample.bytes[rng() % sample.size] = rng();
+        samples.push_back(sample);
+    }
+    return samples;
+}
+
+meshtastic_Data_payload_t encode(const std::vector<meshtastic_Data_payload_t> &samples)
+{
+    meshtastic_Data_payload_t out = {}, previous = {};
+    for (const auto &sample : samples) {
+        TEST_ASSERT_TRUE(TelemetryBatch::encodeSample(sample, previous, out));
+        previous = sample;
+    }
+    return out;
+}
+
+meshtastic_MeshPacket makeBatch(const meshtastic_Data_payload_t &payload)
+{
+    meshtastic_MeshPacket p = meshtastic_MeshPacket_init_zero;
+    p.from = 0x1234;
+    p.to = NODENUM_BROADCAST;
+    p.id = 1000;
+    p.hop_limit = 2;
+    p.hop_start = 3;
+    p.want_ack = true;
+    p.which_payload_variant = meshtastic_MeshPacket_decoded_tag;
+    p.decoded.portnum = meshtastic_PortNum_TELEMETRY_APP;
+    p.decoded.has_bitfield = true;
+    p.decoded.bitfield = BITFIELD_OK_TO_MQTT_MASK | BITFIELD_TELEMETRY_BATCH_MASK;
+    p.decoded.payload = payload;
+    return p;
+}
+
+// Reads every sample out of a batch, checking each against the one it should be. @return how many there were
+size_t readAll(const meshtastic_MeshPacket &batch, const std::vector<meshtastic_Data_payload_t> &expected)
+{
+    TelemetryBatch::Reader reader(batch);
+    size_t n = 0;
+    while (meshtastic_MeshPacket *sample = reader.next()) {
+        TEST_ASSERT_LESS_THAN(TELEMETRY_BATCH_MAX_SAMPLES, n);
+        TEST_ASSERT_LESS_OR_EQUAL(sizeof(sample->decoded.payload.bytes), sample->decoded.payload.size);
+        if (n < expected.size()) {
+            TEST_ASSERT_EQUAL(expected[n].size, sample->decoded.payload.size);
+            TEST_ASSERT_EQUAL_MEMORY(expected[n].bytes, sample->decoded.payload.bytes, expected[n].size);
+        }
+        packetPool.release(sample);
+        n++;
+    }
+    return n;
+}
+} // namespace
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// Every sample comes back as it went in, and takes less room than it did.
+void test_round_trip(void)
+{
+    auto samples = makeSamples(TELEMETRY_BATCH_MAX_SAMPLES);
+    meshtastic_Data_payload_t out = encode(samples);
+
+    size_t raw = 0;
+    for (const auto &sample : samples)
+        raw += sample.size;
+    TEST_ASSERT_LESS_THAN(raw, out.size);
+
+    size_t offset = 0;
+    meshtastic_Data_payload_t previous = {};
+    for (const auto &expected : samples) {
+        meshtastic_Data_payload_t sample;
+        TEST_ASSERT_TRUE(TelemetryBatch::decodeSample(out, offset, previous, sample));
+        TEST_ASSERT_EQUAL(expected.size, sample.size);
+        TEST_ASSERT_EQUAL_MEMORY(expected.bytes, sample.bytes, expected.size);
+        previous = sample;
+    }
+    TEST_ASSERT_EQUAL(out.size, offset);
+}
+
+// A sample that doesn't fit is refused without touching what is already in the batch.
+void test_full(void)
+{
+    meshtastic_Data_payload_t out = {}, previous = {}, sample = {};
+    sample.size = 200;
+    for (size_t i = 0; i < sample.size; i++)
+        sample.bytes[i] = i + 1;
+    TEST_ASSERT_TRUE(TelemetryBatch::encodeSample(sample, previous, out));
+    const size_t size = out.size;
+    TEST_ASSERT_FALSE(TelemetryBatch::encodeSample(sample, previous, out));
+    TEST_ASSERT_EQUAL(size, out.size);
+}
+
+// The Reader hands out each sample as a packet that isn't a batch, isn't relayed and has an id of its own.
+void test_reader(void)
+{
+    auto samples = makeSamples(5);
+    meshtastic_MeshPacket batch = makeBatch(encode(samples));
+    TEST_ASSERT_TRUE(TelemetryBatch::isBatch(batch));
+
+    TelemetryBatch::Reader reader(batch);
+    for (size_t n = 0; n < samples.size(); n++) {
+        meshtastic_MeshPacket *sample = reader.next();
+        TEST_ASSERT_NOT_NULL(sample);
+        TEST_ASSERT_EQUAL_UINT32(batch.id + n, sample->id);
+        TEST_ASSERT_EQUAL_UINT32(batch.from, sample->from);
+        TEST_ASSERT_EQUAL(0, sample->hop_limit);
+        TEST_ASSERT_EQUAL(0, sample->hop_start);
+        TEST_ASSERT_FALSE(sample->want_ack);
+        TEST_ASSERT_FALSE(TelemetryBatch::isBatch(*sample));
+        TEST_ASSERT_EQUAL(BITFIELD_OK_TO_MQTT_MASK, sample->decoded.bitfield);
+        TEST_ASSERT_EQUAL(samples[n].size, sample->decoded.payload.size);
+        TEST_ASSERT_EQUAL_MEMORY(samples[n].bytes, sample->decoded.payload.bytes, samples[n].size);
+        packetPool.release(sample);
+    }
+    TEST_ASSERT_NULL(reader.next());
+    TEST_ASSERT_NULL(reader.next());
+}
+
+// Cut anywhere, a batch gives the samples that are whole and then stops.
+void test_truncated(void)
+{
+    auto samples = makeSamples(8);
+    meshtastic_Data_payload_t out = {}, previous = {};
+    std::vector<size_t> ends;
+    for (const auto &sample : samples) {
+        TEST_ASSERT_TRUE(TelemetryBatch::encodeSample(sample, previous, out));
+        ends.push_back(out.size);
+        previous = sample;
+    }
+
+    for (size_t size = 0; size <= out.size; size++) {
+        meshtastic_MeshPacket batch = makeBatch(out);
+        batch.decoded.payload.size = size;
+        size_t whole = 0;
+        while (whole < ends.size() && ends[whole] <= size)
+            whole++;
+        TEST_ASSERT_EQUAL(whole, readAll(batch, samples));
+    }
+}
+
+// Garbage never decodes to more than TELEMETRY_BATCH_MAX_SAMPLES samples or to one larger than a payload.
+void test_malformed(void)
+{
+    meshtastic_Data_payload_t payload = {};
+    payload.size = 3;
+    payload.bytes[0] = 250; // Longer than any payload
+    payload.bytes[1] = 0xff;
+    payload.bytes[2] = 0xff;
+    TEST_ASSERT_EQUAL(0, readAll(makeBatch(payload), {}));
+
+    payload.size = sizeof(payload.bytes);
+    memset(payload.bytes, 0, payload.size); // Empty samples, as many as fit
+    TEST_ASSERT_EQUAL(TELEMETRY_BATCH_MAX_SAMPLES, readAll(makeBatch(payload), {}));
+
+    for (int round = 0; round < 20000; round++) {
+        payload.size = rng() % (sizeof(payload.bytes) + 1);
+        for (size_t i = 0; i < payload.size; i++)
+            payload.bytes[i] = rng() % 4 ? rng() % 16 : rng();
+        readAll(makeBatch(payload), {});
+    }
+}
+
+void setup()
+{
+    initializeTestEnvironment();
+    UNITY_BEGIN();
+    RUN_TEST(test_round_trip);
+    RUN_TEST(test_full);
+    RUN_TEST(test_reader);
+    RUN_TEST(test_truncated);
+    RUN_TEST(test_malformed);
+    exit(UNITY_END());
+}
+#else
+void setup()
+{
+    initializeTestEnvironment();
+    LOG_WARN("This test requires the ARCH_PORTDUINO variant");
+    UNITY_BEGIN();
+    UNITY_END();
+}
+#endif
+void loop() {}